@@ -0,0 +1,21 @@
+function(cpprest_find_zstd)
+  if(TARGET cpprestsdk_zstd_internal)
+    return()
+  endif()
+
+  find_package(PkgConfig)
+  pkg_check_modules(ZSTD libzstd)
+  if(ZSTD_FOUND)
+    target_link_libraries(cpprest PRIVATE ${ZSTD_LDFLAGS})
+  else(ZSTD_FOUND)
+    find_package(zstd REQUIRED)
+    add_library(cpprestsdk_zstd_internal INTERFACE)
+    if(TARGET zstd::libzstd_shared)
+      target_link_libraries(cpprestsdk_zstd_internal INTERFACE zstd::libzstd_shared)
+    else()
+      target_link_libraries(cpprestsdk_zstd_internal INTERFACE zstd::libzstd_static)
+    endif()
+    target_link_libraries(cpprest PRIVATE cpprestsdk_zstd_internal)
+  endif(ZSTD_FOUND)
+
+endfunction()
@@ -30,6 +30,9 @@ namespace streams
 template<typename _CollectionType>
 class container_buffer;
 
+template<typename _CollectionType>
+class segmented_container_buffer;
+
 namespace details
 {
 /// <summary>
@@ -464,6 +467,396 @@ private:
     size_t m_current_position;
 };
 
+
+/// <summary>
+/// The basic_segmented_container_buffer class serves as a memory-based stream buffer that keeps its data in a list of
+/// STL containers (segments) rather than in a single one. Appending never moves data already written, so growing the
+/// buffer costs neither reallocation nor copying of its earlier contents.
+/// The class itself should not be used in application code, it is used by the stream definitions farther down in the
+/// header file.
+/// </summary>
+/// <remarks> When closed, neither writing nor reading is supported any longer. Like <c>basic_container_buffer</c>,
+/// it does not support simultaneous use of the buffer for reading and writing.</remarks>
+template<typename _CollectionType>
+class basic_segmented_container_buffer
+    : public streams::details::streambuf_state_manager<typename _CollectionType::value_type>
+{
+public:
+    typedef typename _CollectionType::value_type _CharType;
+    typedef typename basic_streambuf<_CharType>::traits traits;
+    typedef typename basic_streambuf<_CharType>::int_type int_type;
+    typedef typename basic_streambuf<_CharType>::pos_type pos_type;
+    typedef typename basic_streambuf<_CharType>::off_type off_type;
+
+    /// <summary>
+    /// Returns the segments holding the data, in order.
+    /// </summary>
+    const std::vector<_CollectionType>& segments() const { return m_segments; }
+
+    /// <summary>
+    /// Copies the data into a single collection, which is allocated once.
+    /// </summary>
+    _CollectionType gather() const
+    {
+        _CollectionType result;
+        result.reserve(m_size);
+        for (const auto& segment : m_segments)
+        {
+            result.insert(result.end(), segment.begin(), segment.end());
+        }
+        return result;
+    }
+
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    virtual ~basic_segmented_container_buffer()
+    {
+        // Invoke the synchronous versions since we need to
+        // purge the request queue before deleting the buffer
+        this->_close_read();
+        this->_close_write();
+    }
+
+protected:
+    virtual bool can_seek() const { return this->is_open(); }
+
+    virtual bool has_size() const { return this->is_open(); }
+
+    virtual utility::size64_t size() const { return utility::size64_t(m_size); }
+
+    virtual size_t buffer_size(std::ios_base::openmode = std::ios_base::in) const { return 0; }
+
+    virtual void set_buffer_size(size_t, std::ios_base::openmode = std::ios_base::in) { return; }
+
+    virtual size_t in_avail() const
+    {
+        _ASSERTE(m_position <= m_size);
+        return this->can_read() ? m_size - m_position : 0;
+    }
+
+    virtual pplx::task<bool> _sync() { return pplx::task_from_result(true); }
+
+    virtual pplx::task<int_type> _putc(_CharType ch)
+    {
+        int_type retVal = (this->write(&ch, 1) == 1) ? static_cast<int_type>(ch) : traits::eof();
+        return pplx::task_from_result<int_type>(retVal);
+    }
+
+    virtual pplx::task<size_t> _putn(const _CharType* ptr, size_t count)
+    {
+        return pplx::task_from_result<size_t>(this->write(ptr, count));
+    }
+
+    _CharType* _alloc(size_t count)
+    {
+        if (!this->can_write()) return nullptr;
+
+        auto& segment = segment_for_write(count);
+        m_allocated = count;
+        segment.resize(segment.size() + count);
+        return &segment[segment.size() - count];
+    }
+
+    void _commit(size_t actual)
+    {
+        // The block handed out by _alloc is at the end of the last segment; drop what was not used.
+        auto& segment = m_segments.back();
+        segment.resize(segment.size() - m_allocated + actual);
+        m_allocated = 0;
+        m_size += actual;
+        m_position = m_size;
+    }
+
+    /// <summary>
+    /// Gets a pointer to the rest of the current segment.
+    /// </summary>
+    /// <remarks>
+    /// If the end of the stream is reached, the function will return <c>true</c>, a null pointer, and a count of zero.
+    /// </remarks>
+    virtual bool acquire(_Out_ _CharType*& ptr, _Out_ size_t& count)
+    {
+        ptr = nullptr;
+        count = 0;
+
+        if (!this->can_read()) return false;
+
+        skip_drained_segments();
+        if (m_read_segment < m_segments.size())
+        {
+            auto& segment = m_segments[m_read_segment];
+            count = segment.size() - m_read_offset;
+            ptr = &segment[m_read_offset];
+        }
+        return true;
+    }
+
+    virtual void release(_Out_writes_opt_(count) _CharType* ptr, _In_ size_t count)
+    {
+        if (ptr != nullptr) advance(count);
+    }
+
+    virtual pplx::task<size_t> _getn(_Out_writes_(count) _CharType* ptr, _In_ size_t count)
+    {
+        return pplx::task_from_result(this->read(ptr, count));
+    }
+
+    size_t _sgetn(_Out_writes_(count) _CharType* ptr, _In_ size_t count) { return this->read(ptr, count); }
+
+    virtual size_t _scopy(_Out_writes_(count) _CharType* ptr, _In_ size_t count)
+    {
+        return this->read(ptr, count, false);
+    }
+
+    virtual pplx::task<int_type> _bumpc() { return pplx::task_from_result(this->read_byte(true)); }
+
+    virtual int_type _sbumpc() { return this->read_byte(true); }
+
+    virtual pplx::task<int_type> _getc() { return pplx::task_from_result(this->read_byte(false)); }
+
+    int_type _sgetc() { return this->read_byte(false); }
+
+    virtual pplx::task<int_type> _nextc()
+    {
+        this->read_byte(true);
+        return pplx::task_from_result(this->read_byte(false));
+    }
+
+    virtual pplx::task<int_type> _ungetc()
+    {
+        auto pos = seekoff(-1, std::ios_base::cur, std::ios_base::in);
+        if (pos == (pos_type)traits::eof()) return pplx::task_from_result(traits::eof());
+        return this->getc();
+    }
+
+    virtual pos_type getpos(std::ios_base::openmode mode) const
+    {
+        if (((mode & std::ios_base::in) && !this->can_read()) || ((mode & std::ios_base::out) && !this->can_write()))
+            return static_cast<pos_type>(traits::eof());
+
+        return static_cast<pos_type>(m_position);
+    }
+
+    /// <summary>
+    /// Seeks to the given position.
+    /// </summary>
+    /// <remarks>The read head may move anywhere within the data. Since segments are only ever appended to, the write
+    /// head stays at the end.</remarks>
+    virtual pos_type seekpos(pos_type position, std::ios_base::openmode mode)
+    {
+        if (position >= pos_type(0))
+        {
+            auto pos = static_cast<size_t>(position);
+
+            if ((mode & std::ios_base::in) && this->can_read() && pos <= m_size)
+            {
+                // Segments are walked from the closer of the start and the current segment.
+                if (pos < m_position - m_read_offset)
+                {
+                    m_read_segment = 0;
+                    m_read_offset = 0;
+                    m_position = 0;
+                }
+                m_position -= m_read_offset;
+                m_read_offset = 0;
+                advance(pos - m_position);
+                return static_cast<pos_type>(m_position);
+            }
+
+            if ((mode & std::ios_base::out) && this->can_write() && pos == m_size)
+            {
+                return static_cast<pos_type>(m_position);
+            }
+        }
+
+        return static_cast<pos_type>(traits::eof());
+    }
+
+    virtual pos_type seekoff(off_type offset, std::ios_base::seekdir way, std::ios_base::openmode mode)
+    {
+        pos_type beg = 0;
+        pos_type cur = static_cast<pos_type>(m_position);
+        pos_type end = static_cast<pos_type>(m_size);
+
+        switch (way)
+        {
+            case std::ios_base::beg: return seekpos(beg + offset, mode);
+
+            case std::ios_base::cur: return seekpos(cur + offset, mode);
+
+            case std::ios_base::end: return seekpos(end + offset, mode);
+
+            default: return static_cast<pos_type>(traits::eof());
+        }
+    }
+
+private:
+    template<typename _CollectionType1>
+    friend class streams::segmented_container_buffer;
+
+    // Segments start small and double up to a cap, so short streams stay compact and long ones are not split into
+    // many tiny pieces.
+    static const size_t first_segment_size = 4096;
+    static const size_t max_segment_size = 1024 * 1024;
+
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    basic_segmented_container_buffer(std::ios_base::openmode mode)
+        : streambuf_state_manager<_CharType>(mode)
+        , m_size(0)
+        , m_position(0)
+        , m_read_segment(0)
+        , m_read_offset(0)
+        , m_allocated(0)
+    {
+        validate_mode(mode);
+    }
+
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    basic_segmented_container_buffer(std::vector<_CollectionType> segments, std::ios_base::openmode mode)
+        : streambuf_state_manager<_CharType>(mode)
+        , m_segments(std::move(segments))
+        , m_size(0)
+        , m_position(0)
+        , m_read_segment(0)
+        , m_read_offset(0)
+        , m_allocated(0)
+    {
+        validate_mode(mode);
+        for (const auto& segment : m_segments)
+        {
+            m_size += segment.size();
+        }
+        if (!(mode & std::ios_base::in)) m_position = m_size;
+    }
+
+    static void validate_mode(std::ios_base::openmode mode)
+    {
+        // Disallow simultaneous use of the stream buffer for writing and reading.
+        if ((mode & std::ios_base::in) && (mode & std::ios_base::out))
+            throw std::invalid_argument("this combination of modes on container stream not supported");
+    }
+
+    /// <summary>
+    /// Returns the last segment, after appending a new one if it cannot take another count characters.
+    /// </summary>
+    _CollectionType& segment_for_write(size_t count)
+    {
+        if (m_segments.empty() || m_segments.back().capacity() - m_segments.back().size() < count)
+        {
+            const size_t next = m_segments.empty()
+                                    ? static_cast<size_t>(first_segment_size)
+                                    : (std::min)(m_segments.back().capacity() * 2, static_cast<size_t>(max_segment_size));
+            _CollectionType segment;
+            segment.reserve((std::max)(next, count));
+            m_segments.push_back(std::move(segment));
+        }
+        return m_segments.back();
+    }
+
+    /// <summary>
+    /// Moves the read head past segments that have been read to the end.
+    /// </summary>
+    void skip_drained_segments()
+    {
+        while (m_read_segment < m_segments.size() && m_read_offset == m_segments[m_read_segment].size())
+        {
+            ++m_read_segment;
+            m_read_offset = 0;
+        }
+    }
+
+    /// <summary>
+    /// Moves the read head ahead by count characters, which must be available.
+    /// </summary>
+    void advance(size_t count)
+    {
+        m_position += count;
+        while (count > 0)
+        {
+            skip_drained_segments();
+            const size_t step = (std::min)(count, m_segments[m_read_segment].size() - m_read_offset);
+            m_read_offset += step;
+            count -= step;
+        }
+    }
+
+    int_type read_byte(bool advance = true)
+    {
+        _CharType value;
+        auto read_size = this->read(&value, 1, advance);
+        return read_size == 1 ? static_cast<int_type>(value) : traits::eof();
+    }
+
+    /// <summary>
+    /// Reads up to count characters into ptr and returns the count of characters copied.
+    /// </summary>
+    size_t read(_Out_writes_(count) _CharType* ptr, _In_ size_t count, bool advance = true)
+    {
+        const size_t read_size = (std::min)(count, in_avail());
+        size_t segment = m_read_segment;
+        size_t offset = m_read_offset;
+        for (size_t copied = 0; copied < read_size;)
+        {
+            if (offset == m_segments[segment].size())
+            {
+                ++segment;
+                offset = 0;
+                continue;
+            }
+            const size_t step = (std::min)(read_size - copied, m_segments[segment].size() - offset);
+            std::copy(m_segments[segment].begin() + offset, m_segments[segment].begin() + offset + step, ptr + copied);
+            offset += step;
+            copied += step;
+        }
+
+        if (advance)
+        {
+            m_read_segment = segment;
+            m_read_offset = offset;
+            m_position += read_size;
+        }
+        return read_size;
+    }
+
+    /// <summary>
+    /// Appends count characters from ptr, filling the last segment before starting a new one.
+    /// </summary>
+    size_t write(const _CharType* ptr, size_t count)
+    {
+        if (!this->can_write() || (count == 0)) return 0;
+
+        for (size_t written = 0; written < count;)
+        {
+            auto& segment = segment_for_write(1);
+            const size_t step = (std::min)(count - written, segment.capacity() - segment.size());
+            segment.insert(segment.end(), ptr + written, ptr + written + step);
+            written += step;
+        }
+
+        m_size += count;
+        m_position = m_size;
+        return count;
+    }
+
+    // The actual data store
+    std::vector<_CollectionType> m_segments;
+
+    // Total number of characters in all segments
+    size_t m_size;
+
+    // Read/write head, and the segment and offset within it the read head is at
+    size_t m_position;
+    size_t m_read_segment;
+    size_t m_read_offset;
+
+    // Size of the block handed out by _alloc, which is not yet committed
+    size_t m_allocated;
+};
+
 } // namespace details
 
 /// <summary>
@@ -512,6 +905,62 @@ public:
     }
 };
 
+/// <summary>
+/// The segmented_container_buffer class serves as a memory-based stream buffer that keeps its data in a list of STL
+/// containers. Writes append to the last segment, or start a new one, without moving earlier data, which makes it a
+/// better fit than <c>container_buffer</c> for accumulating large amounts of data. The segments may be walked in
+/// place, or gathered into a single collection at the end.
+/// </summary>
+/// <typeparam name="_CollectionType">
+/// The type of the container used for each segment.
+/// </typeparam>
+/// <remarks>
+/// This is a reference-counted version of <c>basic_segmented_container_buffer</c>.
+/// </remarks>
+template<typename _CollectionType>
+class segmented_container_buffer : public streambuf<typename _CollectionType::value_type>
+{
+public:
+    typedef typename _CollectionType::value_type char_type;
+
+    /// <summary>
+    /// Creates a segmented_container_buffer that reads the given segments in order.
+    /// </summary>
+    /// <param name="segments">The collections that make up the buffer</param>
+    /// <param name="mode">The I/O mode that the buffer should use (in / out)</param>
+    segmented_container_buffer(std::vector<_CollectionType> segments, std::ios_base::openmode mode = std::ios_base::in)
+        : streambuf<char_type>(std::shared_ptr<details::basic_segmented_container_buffer<_CollectionType>>(
+              new details::basic_segmented_container_buffer<_CollectionType>(std::move(segments), mode)))
+    {
+    }
+
+    /// <summary>
+    /// Creates an empty segmented_container_buffer.
+    /// </summary>
+    /// <param name="mode">The I/O mode that the buffer should use (in / out)</param>
+    segmented_container_buffer(std::ios_base::openmode mode = std::ios_base::out)
+        : streambuf<char_type>(std::shared_ptr<details::basic_segmented_container_buffer<_CollectionType>>(
+              new details::basic_segmented_container_buffer<_CollectionType>(mode)))
+    {
+    }
+
+    /// <summary>
+    /// Returns the segments holding the data, in order.
+    /// </summary>
+    const std::vector<_CollectionType>& segments() const { return buffer()->segments(); }
+
+    /// <summary>
+    /// Copies the data into a single collection, which is allocated once.
+    /// </summary>
+    _CollectionType gather() const { return buffer()->gather(); }
+
+private:
+    details::basic_segmented_container_buffer<_CollectionType>* buffer() const
+    {
+        return static_cast<details::basic_segmented_container_buffer<_CollectionType>*>(this->get_base().get());
+    }
+};
+
 /// <summary>
 /// A static class to allow users to create input and out streams based off STL
 /// collections. The sole purpose of this class to avoid users from having to know
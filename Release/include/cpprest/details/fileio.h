@@ -72,6 +72,11 @@ struct _file_info
     pplx::extensibility::recursive_lock_t m_lock;
 };
 
+/// <summary>
+/// The record of a read-only, memory-mapped file. Its layout is private to the implementation.
+/// </summary>
+struct _mmap_info;
+
 /// <summary>
 /// This interface provides the necessary callbacks for completion events.
 /// </summary>
@@ -217,4 +222,54 @@ extern "C"
     _ASYNCRTIMP size_t __cdecl _seekwrpos_fsb(_In_ concurrency::streams::details::_file_info* info,
                                               size_t pos,
                                               size_t char_size);
+
+#if !defined(_WIN32)
+    /// <summary>
+    /// Get the file descriptor of an open file stream, so that its content can be transmitted by the operating system.
+    /// </summary>
+    /// <param name="info">The file info record of the file</param>
+    /// <returns>The file descriptor, or -1 if the file is not open</returns>
+    _ASYNCRTIMP int __cdecl _get_fd_fsb(_In_ concurrency::streams::details::_file_info* info);
+#endif
+
+#if !defined(__cplusplus_winrt)
+    /// <summary>
+    /// Open a file for memory-mapped reading. Nothing is mapped until <c>_map_mmap</c> is called.
+    /// </summary>
+    /// <param name="filename">The name of the file to open</param>
+    /// <param name="window_size">The largest number of bytes of the file to keep mapped at any time</param>
+    /// <param name="error">Receives the system error code if the file could not be opened</param>
+    /// <returns>The record of the opened file, or <c>nullptr</c> if it could not be opened.</returns>
+    _ASYNCRTIMP concurrency::streams::details::_mmap_info* __cdecl _open_mmap(const utility::char_t* filename,
+                                                                              size_t window_size,
+                                                                              _Out_ unsigned long* error);
+
+    /// <summary>
+    /// Get the size of a memory-mapped file, in bytes.
+    /// </summary>
+    /// <param name="info">The record of the file</param>
+    /// <returns>The file size</returns>
+    _ASYNCRTIMP utility::size64_t __cdecl _mmap_size(_In_ const concurrency::streams::details::_mmap_info* info);
+
+    /// <summary>
+    /// Map the window of the file that contains the given offset, unmapping the previous window if necessary.
+    /// </summary>
+    /// <param name="info">The record of the file</param>
+    /// <param name="offset">The offset (in bytes) of the data to map</param>
+    /// <param name="length">Receives the number of bytes mapped contiguously starting at the offset</param>
+    /// <param name="error">Receives the system error code if the mapping failed</param>
+    /// <returns>A pointer to the data at the offset, or <c>nullptr</c> at the end of the file or on error.</returns>
+    /// <remarks>The pointer remains valid until the next call to <c>_map_mmap</c> for a different window, or until
+    /// the file is closed.</remarks>
+    _ASYNCRTIMP const char* __cdecl _map_mmap(_In_ concurrency::streams::details::_mmap_info* info,
+                                              utility::size64_t offset,
+                                              _Out_ size_t* length,
+                                              _Out_ unsigned long* error);
+
+    /// <summary>
+    /// Unmap and close a memory-mapped file.
+    /// </summary>
+    /// <param name="info">The record of the file</param>
+    _ASYNCRTIMP void __cdecl _close_mmap(_In_ concurrency::streams::details::_mmap_info* info);
+#endif
 }
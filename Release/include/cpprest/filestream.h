@@ -39,6 +39,8 @@ namespace streams
 // Forward declarations
 template<typename _CharType>
 class file_buffer;
+template<typename _CharType>
+class mmap_buffer;
 
 namespace details
 {
@@ -105,6 +107,27 @@ public:
         }
     }
 
+#if !defined(_WIN32)
+    /// <summary>
+    /// Gets the file descriptor and the current read position of the stream, so that the content that follows can be
+    /// transmitted by the operating system (e.g. with <c>sendfile</c>) instead of being read through the buffer.
+    /// </summary>
+    /// <param name="fd">Receives the file descriptor</param>
+    /// <param name="offset">Receives the read position, in bytes</param>
+    /// <returns><c>true</c> if the stream is open for reading, <c>false</c> otherwise.</returns>
+    /// <remarks>Reading from the descriptor with an explicit offset leaves the stream untouched; seek the stream
+    /// afterwards to account for the data transmitted.</remarks>
+    bool _get_read_handle(int& fd, utility::size64_t& offset) const
+    {
+        if (!this->can_read()) return false;
+
+        pplx::extensibility::scoped_recursive_lock_t lck(m_info->m_lock);
+        fd = _get_fd_fsb(m_info);
+        offset = static_cast<utility::size64_t>(m_info->m_rdpos) * sizeof(_CharType);
+        return fd != -1;
+    }
+#endif
+
 protected:
     /// <summary>
     /// <c>can_seek</c> is used to determine whether a stream buffer supports seeking.
@@ -142,7 +165,10 @@ protected:
     /// <param name="direction">The direction of buffering (in or out)</param>
     /// <remarks>An implementation that does not support buffering will silently ignore calls to this function and it
     /// will not have
-    ///          any effect on what is returned by subsequent calls to buffer_size().</remarks>
+    ///          any effect on what is returned by subsequent calls to buffer_size().
+    /// On POSIX platforms sequential reads use read-ahead: the read buffer grows up to <paramref name="size"/>, 64 KiB
+    /// by default, and the next block is read into a second buffer of the same size, so the stream may hold up to
+    /// twice <paramref name="size"/> bytes. A size of 512 bytes or less turns read-ahead off.</remarks>
     virtual void set_buffer_size(size_t size, std::ios_base::openmode direction = std::ios_base::in)
     {
         if (direction == std::ios_base::out) return;
@@ -316,12 +342,25 @@ protected:
     /// The stream buffer may not de-allocate the block until <see cref="::release method" /> is called.
     /// If the end of the stream is reached, the function will return <c>true</c>, a null pointer, and a count of zero;
     /// a subsequent read will not succeed.
+    /// Only the characters already in the read buffer are exposed, so read_line() and read_to_delim() can search them
+    /// in place. An empty read buffer returns <c>false</c> and the caller falls back to an ordinary read.
     /// </remarks>
     virtual bool acquire(_Out_ _CharType*& ptr, _Out_ size_t& count)
     {
         ptr = nullptr;
         count = 0;
-        return false;
+        if (!this->can_read()) return false;
+
+        m_readOps.wait();
+
+        pplx::extensibility::scoped_recursive_lock_t lck(m_info->m_lock);
+
+        count = _in_avail_unprot();
+        if (count == 0) return false;
+
+        auto bufoff = m_info->m_rdpos - m_info->m_bufoff;
+        ptr = reinterpret_cast<_CharType*>(m_info->m_buffer + bufoff * sizeof(_CharType));
+        return true;
     }
 
     /// <summary>
@@ -330,7 +369,13 @@ protected:
     /// </summary>
     /// <param name="ptr">A pointer to the block of data to be released.</param>
     /// <param name="count">The number of characters that were read.</param>
-    virtual void release(_Out_writes_(count) _CharType*, _In_ size_t count) { (void)(count); }
+    virtual void release(_Out_writes_(count) _CharType*, _In_ size_t count)
+    {
+        if (count == 0 || !this->is_open()) return;
+
+        pplx::extensibility::scoped_recursive_lock_t lck(m_info->m_lock);
+        m_info->m_rdpos += count;
+    }
 
     /// <summary>
     /// Writes a number of characters to the stream.
@@ -927,6 +972,255 @@ private:
     async_operation_queue m_readOps;
 };
 
+#if !defined(__cplusplus_winrt)
+/// <summary>
+/// Private stream buffer implementation for read-only, memory-mapped files. Reads are served straight from the
+/// mapped pages, and <c>acquire</c> hands out pointers into them, so consumers can read the file without copying it.
+/// Only a window of the file is mapped at a time, which allows files larger than the address space to be read.
+/// </summary>
+template<typename _CharType>
+class basic_mmap_buffer : public details::streambuf_state_manager<_CharType>
+{
+public:
+    typedef typename basic_streambuf<_CharType>::traits traits;
+    typedef typename basic_streambuf<_CharType>::int_type int_type;
+    typedef typename basic_streambuf<_CharType>::pos_type pos_type;
+    typedef typename basic_streambuf<_CharType>::off_type off_type;
+
+    virtual ~basic_mmap_buffer()
+    {
+        this->_close_read();
+        unmap();
+    }
+
+    static pplx::task<std::shared_ptr<basic_streambuf<_CharType>>> open(const utility::string_t& file_name,
+                                                                        size_t window_size)
+    {
+        return pplx::create_task([=]() -> std::shared_ptr<basic_streambuf<_CharType>> {
+            unsigned long error = 0;
+            auto info = _open_mmap(file_name.c_str(), window_size, &error);
+            if (info == nullptr)
+            {
+                throw utility::details::create_system_error(error);
+            }
+            return std::shared_ptr<basic_streambuf<_CharType>>(new basic_mmap_buffer<_CharType>(info));
+        });
+    }
+
+protected:
+    virtual bool can_seek() const { return this->is_open(); }
+
+    virtual bool has_size() const { return this->is_open(); }
+
+    virtual utility::size64_t size() const { return m_size; }
+
+    /// <summary>
+    /// The mapping is the buffer, so there is no buffering to report or configure.
+    /// </summary>
+    virtual size_t buffer_size(std::ios_base::openmode = std::ios_base::in) const { return 0; }
+
+    virtual void set_buffer_size(size_t, std::ios_base::openmode = std::ios_base::in) {}
+
+    virtual size_t in_avail() const
+    {
+        if (!this->can_read() || m_pos >= m_size) return 0;
+        return static_cast<size_t>((std::min)(m_size - m_pos, utility::size64_t((std::numeric_limits<size_t>::max)())));
+    }
+
+    virtual pplx::task<void> close(std::ios_base::openmode mode)
+    {
+        if (mode & std::ios_base::in)
+        {
+            this->_close_read().get(); // Safe to call get() here.
+            unmap();
+        }
+        return pplx::task_from_result();
+    }
+
+    virtual pplx::task<bool> _sync() { return pplx::task_from_result(true); }
+
+    virtual pplx::task<int_type> _putc(_CharType) { return pplx::task_from_result<int_type>(traits::eof()); }
+
+    virtual pplx::task<size_t> _putn(const _CharType*, size_t) { return pplx::task_from_result<size_t>(0); }
+
+    _CharType* _alloc(size_t) { return nullptr; }
+
+    void _commit(size_t) {}
+
+    /// <summary>
+    /// Gets a pointer to the mapped data at the read position.
+    /// </summary>
+    /// <remarks>
+    /// The block ends at the end of the current mapping window; a subsequent acquire after <c>release</c> maps the
+    /// next window. The block stays valid until it is released.
+    /// </remarks>
+    virtual bool acquire(_Out_ _CharType*& ptr, _Out_ size_t& count)
+    {
+        ptr = nullptr;
+        count = 0;
+        if (!this->can_read()) return false;
+
+        const char* data = map(count);
+        if (data != nullptr && count > 0)
+        {
+            ptr = reinterpret_cast<_CharType*>(const_cast<char*>(data));
+        }
+
+        // At the end of the stream, report success with an empty block.
+        return true;
+    }
+
+    virtual void release(_Out_writes_opt_(count) _CharType* ptr, _In_ size_t count)
+    {
+        if (ptr != nullptr) m_pos += count;
+    }
+
+    virtual pplx::task<size_t> _getn(_Out_writes_(count) _CharType* ptr, _In_ size_t count)
+    {
+        try
+        {
+            return pplx::task_from_result(this->read(ptr, count));
+        }
+        catch (...)
+        {
+            return pplx::task_from_exception<size_t>(std::current_exception());
+        }
+    }
+
+    size_t _sgetn(_Out_writes_(count) _CharType* ptr, _In_ size_t count) { return this->read(ptr, count); }
+
+    virtual size_t _scopy(_Out_writes_(count) _CharType* ptr, _In_ size_t count)
+    {
+        return this->read(ptr, count, false);
+    }
+
+    virtual pplx::task<int_type> _bumpc() { return pplx::task_from_result(this->read_byte(true)); }
+
+    virtual int_type _sbumpc() { return this->read_byte(true); }
+
+    virtual pplx::task<int_type> _getc() { return pplx::task_from_result(this->read_byte(false)); }
+
+    int_type _sgetc() { return this->read_byte(false); }
+
+    virtual pplx::task<int_type> _nextc()
+    {
+        if (m_pos + 1 >= m_size) return pplx::task_from_result(traits::eof());
+
+        ++m_pos;
+        return pplx::task_from_result(this->read_byte(false));
+    }
+
+    virtual pplx::task<int_type> _ungetc()
+    {
+        auto pos = seekoff(-1, std::ios_base::cur, std::ios_base::in);
+        if (pos == (pos_type)traits::eof()) return pplx::task_from_result(traits::eof());
+        return this->getc();
+    }
+
+    virtual pos_type getpos(std::ios_base::openmode mode) const
+    {
+        if (mode != std::ios_base::in || !this->can_read()) return static_cast<pos_type>(traits::eof());
+        return static_cast<pos_type>(m_pos);
+    }
+
+    virtual pos_type seekpos(pos_type position, std::ios_base::openmode mode)
+    {
+        if ((mode & std::ios_base::in) && this->can_read() && position >= pos_type(0) &&
+            static_cast<utility::size64_t>(position) <= m_size)
+        {
+            m_pos = static_cast<utility::size64_t>(position);
+            return position;
+        }
+        return static_cast<pos_type>(traits::eof());
+    }
+
+    virtual pos_type seekoff(off_type offset, std::ios_base::seekdir way, std::ios_base::openmode mode)
+    {
+        switch (way)
+        {
+            case std::ios_base::beg: return seekpos(static_cast<pos_type>(offset), mode);
+            case std::ios_base::cur: return seekpos(static_cast<pos_type>(m_pos) + offset, mode);
+            case std::ios_base::end: return seekpos(static_cast<pos_type>(m_size) + offset, mode);
+            default: return static_cast<pos_type>(traits::eof());
+        }
+    }
+
+private:
+    template<typename _CharType1>
+    friend class ::concurrency::streams::mmap_buffer;
+
+    basic_mmap_buffer(_In_ _mmap_info* info)
+        : streambuf_state_manager<_CharType>(std::ios_base::in)
+        , m_info(info)
+        , m_size(_mmap_size(info) / sizeof(_CharType))
+        , m_pos(0)
+    {
+    }
+
+    /// <summary>
+    /// Maps the data at the read position and returns a pointer to it, with count receiving the number of whole
+    /// characters available from there.
+    /// </summary>
+    const char* map(size_t& count)
+    {
+        count = 0;
+        if (m_info == nullptr || m_pos >= m_size) return nullptr;
+
+        size_t length = 0;
+        unsigned long error = 0;
+        const char* data = _map_mmap(m_info, m_pos * sizeof(_CharType), &length, &error);
+        if (data == nullptr && error != 0)
+        {
+            throw utility::details::create_system_error(error);
+        }
+        count = static_cast<size_t>(
+            (std::min)(utility::size64_t(length / sizeof(_CharType)), utility::size64_t(m_size - m_pos)));
+        return data;
+    }
+
+    size_t read(_Out_writes_(count) _CharType* ptr, _In_ size_t count, bool advance = true)
+    {
+        const utility::size64_t start = m_pos;
+        size_t total = 0;
+        while (total < count)
+        {
+            size_t available = 0;
+            const char* data = map(available);
+            if (data == nullptr || available == 0) break;
+
+            const size_t chunk = (std::min)(available, count - total);
+            std::memcpy(ptr + total, data, chunk * sizeof(_CharType));
+            total += chunk;
+            m_pos += chunk;
+        }
+
+        if (!advance) m_pos = start;
+        return total;
+    }
+
+    int_type read_byte(bool advance)
+    {
+        _CharType value;
+        return this->read(&value, 1, advance) == 1 ? static_cast<int_type>(value) : traits::eof();
+    }
+
+    void unmap()
+    {
+        if (m_info != nullptr)
+        {
+            _close_mmap(m_info);
+            m_info = nullptr;
+        }
+    }
+
+    _mmap_info* m_info;
+
+    // The file size and the read position, in characters.
+    utility::size64_t m_size;
+    utility::size64_t m_pos;
+};
+#endif
+
 } // namespace details
 
 /// <summary>
@@ -983,6 +1277,40 @@ public:
 #endif
 };
 
+#if !defined(__cplusplus_winrt)
+/// <summary>
+/// Read-only stream buffer over a memory-mapped file.
+/// </summary>
+/// <typeparam name="_CharType">
+/// The data type of the basic element of the <c>mmap_buffer</c>.
+/// </typeparam>
+/// <remarks>
+/// The file must not be truncated while it is mapped. This makes the buffer best suited to static content and
+/// other immutable files.
+/// </remarks>
+template<typename _CharType>
+class mmap_buffer
+{
+public:
+    /// <summary>
+    /// Open a new stream buffer that reads the given file through a memory mapping.
+    /// </summary>
+    /// <param name="file_name">The name of the file</param>
+    /// <param name="window_size">The largest number of bytes of the file to keep mapped at any time. It is rounded up
+    /// to the system's mapping granularity.</param>
+    /// <returns>A <c>task</c> that returns an opened stream buffer on completion.</returns>
+    static pplx::task<streambuf<_CharType>> open(const utility::string_t& file_name,
+                                                 size_t window_size = sizeof(void*) < 8 ? 16 * 1024 * 1024
+                                                                                        : 256 * 1024 * 1024)
+    {
+        return details::basic_mmap_buffer<_CharType>::open(file_name, window_size)
+            .then([](std::shared_ptr<details::basic_streambuf<_CharType>> buf) -> streambuf<_CharType> {
+                return streambuf<_CharType>(buf);
+            });
+    }
+};
+#endif
+
 /// <summary>
 /// File stream class containing factory functions for file streams.
 /// </summary>
@@ -246,6 +246,26 @@ public:
     /// only supported on Windows and OSX.</remarks>
     void set_request_compressed_response(bool request_compressed) { m_request_compressed = request_compressed; }
 
+    /// <summary>
+    /// Gets the preset dictionaries offered to the server for compressing response bodies.
+    /// </summary>
+    /// <returns>The dictionaries.</returns>
+    const std::vector<std::shared_ptr<http::compression::dictionary>>& compression_dictionaries() const
+    {
+        return m_compression_dictionaries;
+    }
+
+    /// <summary>
+    /// Sets the preset dictionaries offered to the server for compressing response bodies. When a compressed response
+    /// is requested, their ids are sent in the Dictionary-ID header, and a response that names one of them in its
+    /// Content-Dictionary header is decompressed with it.
+    /// </summary>
+    /// <param name="dictionaries">The dictionaries, which the server must hold as well.</param>
+    void set_compression_dictionaries(std::vector<std::shared_ptr<http::compression::dictionary>> dictionaries)
+    {
+        m_compression_dictionaries = std::move(dictionaries);
+    }
+
 #if !defined(__cplusplus_winrt)
     /// <summary>
     /// Gets the server certificate validation property.
@@ -376,6 +396,7 @@ private:
     std::chrono::microseconds m_timeout;
     size_t m_chunksize;
     bool m_request_compressed;
+    std::vector<std::shared_ptr<http::compression::dictionary>> m_compression_dictionaries;
 
 #if !defined(__cplusplus_winrt)
     // IXmlHttpRequest2 doesn't allow configuration of certificate verification.
@@ -101,6 +101,25 @@ public:
     virtual ~decompress_factory() = default;
 };
 
+/// <summary>
+/// A preset dictionary: data such as common keys and values, which is expected to recur in message bodies and with
+/// which compressors are primed so that even small bodies compress well. Both ends must hold the same dictionary;
+/// it is identified by the id exchanged in the Dictionary-ID and Content-Dictionary headers.
+/// </summary>
+class dictionary
+{
+public:
+    dictionary(utility::string_t id, std::vector<uint8_t> data) : m_id(std::move(id)), m_data(std::move(data)) {}
+
+    const utility::string_t& id() const { return m_id; }
+
+    const std::vector<uint8_t>& data() const { return m_data; }
+
+private:
+    utility::string_t m_id;
+    std::vector<uint8_t> m_data;
+};
+
 /// <summary>
 /// Built-in compression support
 /// </summary>
@@ -121,10 +140,12 @@ namespace algorithm
 const utility::char_t* const GZIP = _XPLATSTR("gzip");
 const utility::char_t* const DEFLATE = _XPLATSTR("deflate");
 const utility::char_t* const BROTLI = _XPLATSTR("br");
+const utility::char_t* const ZSTD = _XPLATSTR("zstd");
 #else // ^^^ VS2013 and before ^^^ // vvv VS2015+, and everything else vvv
 constexpr const utility::char_t* const GZIP = _XPLATSTR("gzip");
 constexpr const utility::char_t* const DEFLATE = _XPLATSTR("deflate");
 constexpr const utility::char_t* const BROTLI = _XPLATSTR("br");
+constexpr const utility::char_t* const ZSTD = _XPLATSTR("zstd");
 #endif
 
 /// <summary>
@@ -157,6 +178,30 @@ _ASYNCRTIMP std::unique_ptr<compress_provider> make_compressor(const utility::st
 /// </returns>
 _ASYNCRTIMP std::unique_ptr<decompress_provider> make_decompressor(const utility::string_t& algorithm);
 
+/// <summary>
+/// Factory function to instantiate a built-in compression provider primed with a preset dictionary.
+/// </summary>
+/// <param name="algorithm">The name of the algorithm for which to instantiate a provider.</param>
+/// <param name="dict">The dictionary, which must be used for decompression as well.</param>
+/// <returns>
+/// A caller-owned pointer to a provider of the requested-type, or to nullptr if no such built-in type exists or it
+/// does not support preset dictionaries. Only deflate and zstd do; the gzip format has no room for a dictionary.
+/// </returns>
+_ASYNCRTIMP std::unique_ptr<compress_provider> make_compressor(const utility::string_t& algorithm,
+                                                               const std::shared_ptr<dictionary>& dict);
+
+/// <summary>
+/// Factory function to instantiate a built-in decompression provider for data compressed with a preset dictionary.
+/// </summary>
+/// <param name="algorithm">The name of the algorithm for which to instantiate a provider.</param>
+/// <param name="dict">The dictionary the data was compressed with.</param>
+/// <returns>
+/// A caller-owned pointer to a provider of the requested-type, or to nullptr if no such built-in type exists or it
+/// does not support preset dictionaries.
+/// </returns>
+_ASYNCRTIMP std::unique_ptr<decompress_provider> make_decompressor(const utility::string_t& algorithm,
+                                                                   const std::shared_ptr<dictionary>& dict);
+
 /// <summary>
 /// Factory function to obtain a pointer to a built-in compression provider factory by compression algorithm name.
 /// </summary>
@@ -208,6 +253,95 @@ _ASYNCRTIMP std::unique_ptr<compress_provider> make_deflate_compressor(int compr
 /// </returns>
 _ASYNCRTIMP std::unique_ptr<compress_provider> make_brotli_compressor(
     uint32_t window, uint32_t quality, uint32_t mode, uint32_t block, uint32_t nomodel, uint32_t hint);
+
+/// <summary>
+// Factory function to instantiate a built-in gzip compression provider which compresses blocks of the body on several
+// threads at once. The result is a standard gzip stream.
+/// </summary>
+/// <param name="compressionLevel">The zlib compression level.</param>
+/// <param name="blockSize">The size of the blocks the body is split into, or 0 for 128 KiB. Each block is primed with
+/// the last 32 KiB of the one before, so little is lost to the split.</param>
+/// <param name="threads">The number of blocks compressed at once, or 0 for the number of hardware threads.</param>
+/// <returns>
+/// A caller-owned pointer to a gzip compression provider, or to nullptr if the library was built without built-in
+/// compression support.
+/// </returns>
+/// <remarks>
+/// The provider never blocks waiting for a block. The synchronous compress() returns without progress while every
+/// block in flight is still being compressed; the asynchronous overload completes once progress has been made.
+/// </remarks>
+_ASYNCRTIMP std::unique_ptr<compress_provider> make_parallel_gzip_compressor(int compressionLevel,
+                                                                             size_t blockSize,
+                                                                             size_t threads);
+
+/// <summary>
+// Factory function to instantiate a built-in deflate compression provider which compresses blocks of the body on
+// several threads at once. The result is a standard zlib stream.
+/// </summary>
+/// <param name="compressionLevel">The zlib compression level.</param>
+/// <param name="blockSize">The size of the blocks the body is split into, or 0 for 128 KiB.</param>
+/// <param name="threads">The number of blocks compressed at once, or 0 for the number of hardware threads.</param>
+/// <returns>
+/// A caller-owned pointer to a deflate compression provider, or to nullptr if the library was built without built-in
+/// compression support.
+/// </returns>
+/// <remarks>
+/// The provider never blocks waiting for a block. The synchronous compress() returns without progress while every
+/// block in flight is still being compressed; the asynchronous overload completes once progress has been made.
+/// </remarks>
+_ASYNCRTIMP std::unique_ptr<compress_provider> make_parallel_deflate_compressor(int compressionLevel,
+                                                                                size_t blockSize,
+                                                                                size_t threads);
+
+/// <summary>
+// Factory function to instantiate a built-in Zstandard compression provider with caller-selected parameters.
+/// </summary>
+/// <param name="level">The compression level; negative levels trade ratio for speed.</param>
+/// <param name="window_log">The base-2 logarithm of the window size, or 0 to use the level's default.</param>
+/// <returns>
+/// A caller-owned pointer to a Zstandard compression provider, or to nullptr if the library was built without built-in
+/// Zstandard compression support.
+/// </returns>
+_ASYNCRTIMP std::unique_ptr<compress_provider> make_zstd_compressor(int level, int window_log);
+
+/// <summary>
+/// Counters for the pool of reusable providers behind one built-in factory
+/// </summary>
+struct provider_pool_stats
+{
+    size_t created;   // Providers constructed because none was idle
+    size_t reused;    // Providers handed out again from the pool
+    size_t returned;  // Providers reset and kept for reuse once the caller was done with them
+    size_t discarded; // Providers destroyed because the pool was full or they could not be reset
+    size_t idle;      // Providers currently kept in the pool
+};
+
+/// <summary>
+/// Sets how many idle providers the built-in factories keep for reuse, per algorithm and separately for compression
+/// and decompression. The default is 8; 0 disables the reuse of providers.
+/// </summary>
+/// <remarks>
+/// Providers obtained from the built-in factories, including through <c>make_compressor</c> and
+/// <c>make_decompressor</c>, are reset and returned to their pool when they are destroyed, so that their internal
+/// state need not be set up again for each message. Those from the functions taking caller-selected parameters are
+/// not pooled.
+/// </remarks>
+/// <param name="limit">The maximum number of idle providers to keep for each algorithm.</param>
+_ASYNCRTIMP void set_provider_pool_limit(size_t limit);
+
+/// <summary>
+/// Gets the counters for the pool of the built-in compression providers of an algorithm.
+/// </summary>
+/// <param name="algorithm">The name of the algorithm.</param>
+/// <returns>The counters, or all zeros if no such built-in algorithm exists.</returns>
+_ASYNCRTIMP provider_pool_stats compressor_pool_stats(const utility::string_t& algorithm);
+
+/// <summary>
+/// Gets the counters for the pool of the built-in decompression providers of an algorithm.
+/// </summary>
+/// <param name="algorithm">The name of the algorithm.</param>
+/// <returns>The counters, or all zeros if no such built-in algorithm exists.</returns>
+_ASYNCRTIMP provider_pool_stats decompressor_pool_stats(const utility::string_t& algorithm);
 } // namespace builtin
 
 /// <summary>
@@ -320,6 +454,26 @@ _ASYNCRTIMP std::unique_ptr<decompress_provider> get_decompressor_from_header(
 _ASYNCRTIMP utility::string_t build_supported_header(header_types type,
                                                      const std::vector<std::shared_ptr<decompress_factory>>& factories =
                                                          std::vector<std::shared_ptr<decompress_factory>>());
+
+/// <summary>
+/// Helper function to compose a Dictionary-ID header listing the ids of the supplied dictionaries.
+/// </summary>
+/// <param name="dictionaries">The dictionaries to offer.</param>
+/// <returns>
+/// A well-formed header, without the header name, or an empty string if there are no dictionaries.
+/// </returns>
+_ASYNCRTIMP utility::string_t build_dictionary_header(const std::vector<std::shared_ptr<dictionary>>& dictionaries);
+
+/// <summary>
+/// Helper function to find the first dictionary named in a Dictionary-ID or Content-Dictionary header.
+/// </summary>
+/// <param name="ids">The header to interpret, a comma-separated list of dictionary ids.</param>
+/// <param name="dictionaries">The dictionaries to choose from.</param>
+/// <returns>
+/// A pointer to the dictionary, or to nullptr if none of the ids is that of one of the supplied dictionaries.
+/// </returns>
+_ASYNCRTIMP std::shared_ptr<dictionary> find_dictionary(const utility::string_t& ids,
+                                                        const std::vector<std::shared_ptr<dictionary>>& dictionaries);
 } // namespace details
 } // namespace compression
 } // namespace http
@@ -16,6 +16,9 @@
 #include "cpprest/http_msg.h"
 #include <functional>
 #include <limits>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 #if !defined(_WIN32) && !defined(__cplusplus_winrt) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
 #include <boost/asio/ssl.hpp>
 #endif
@@ -33,6 +36,89 @@ namespace experimental
 /// HTTP server side library.
 namespace listener
 {
+/// <summary>
+/// A bounded cache of compressed response bodies, shared by the connections of one or more listeners.
+/// </summary>
+/// <remarks>
+/// Entries are keyed by the request URI, the strong ETag of the response and the content coding it was compressed
+/// with. When the cache is full, the least recently used entries are dropped.
+/// </remarks>
+class compressed_response_cache
+{
+public:
+    /// <summary>
+    /// Creates an empty cache.
+    /// </summary>
+    /// <param name="capacity">The total size of the bodies the cache holds at most, in bytes.</param>
+    _ASYNCRTIMP explicit compressed_response_cache(size_t capacity);
+
+    /// <summary>
+    /// Get the total size of the bodies the cache holds at most
+    /// </summary>
+    /// <returns>The capacity in bytes.</returns>
+    size_t capacity() const { return m_capacity; }
+
+    /// <summary>
+    /// Get the total size of the bodies in the cache
+    /// </summary>
+    /// <returns>The size in bytes.</returns>
+    _ASYNCRTIMP size_t size() const;
+
+    /// <summary>
+    /// Get the number of lookups that found a body
+    /// </summary>
+    _ASYNCRTIMP size_t hits() const;
+
+    /// <summary>
+    /// Get the number of lookups that found nothing
+    /// </summary>
+    _ASYNCRTIMP size_t misses() const;
+
+    /// <summary>
+    /// Looks up a compressed body, and marks it as the most recently used.
+    /// </summary>
+    /// <param name="resource">The request URI.</param>
+    /// <param name="etag">The ETag of the response.</param>
+    /// <param name="encoding">The content coding of the body.</param>
+    /// <returns>The body, or nullptr if it is not in the cache.</returns>
+    _ASYNCRTIMP std::shared_ptr<const std::vector<uint8_t>> find(const utility::string_t& resource,
+                                                                 const utility::string_t& etag,
+                                                                 const utility::string_t& encoding);
+
+    /// <summary>
+    /// Adds a compressed body, replacing any body stored under the same key.
+    /// </summary>
+    /// <param name="resource">The request URI.</param>
+    /// <param name="etag">The ETag of the response.</param>
+    /// <param name="encoding">The content coding of the body.</param>
+    /// <param name="body">The compressed body. Bodies larger than the capacity are not stored.</param>
+    _ASYNCRTIMP void insert(const utility::string_t& resource,
+                            const utility::string_t& etag,
+                            const utility::string_t& encoding,
+                            std::vector<uint8_t> body);
+
+    /// <summary>
+    /// Removes all bodies from the cache.
+    /// </summary>
+    _ASYNCRTIMP void clear();
+
+private:
+    compressed_response_cache(const compressed_response_cache&);
+    compressed_response_cache& operator=(const compressed_response_cache&);
+
+    typedef std::pair<utility::string_t, std::shared_ptr<const std::vector<uint8_t>>> entry;
+
+    const size_t m_capacity;
+    size_t m_size;
+    size_t m_hits;
+    size_t m_misses;
+
+    // Most recently used entries first
+    std::list<entry> m_entries;
+    std::unordered_map<utility::string_t, std::list<entry>::iterator> m_index;
+    mutable std::mutex m_lock;
+};
+
 /// <summary>
 /// Configuration class used to set various options when constructing and http_listener instance.
 /// </summary>
@@ -42,7 +128,18 @@ public:
     /// <summary>
     /// Create an http_listener configuration with default options.
     /// </summary>
-    http_listener_config() : m_timeout(utility::seconds(120)), m_backlog(0) {}
+    http_listener_config()
+        : m_timeout(utility::seconds(120))
+        , m_backlog(0)
+        , m_compress_responses(false)
+        , m_compression_threshold(1024)
+        , m_compressible_content_types({_XPLATSTR("text/"),
+                                        _XPLATSTR("application/json"),
+                                        _XPLATSTR("application/javascript"),
+                                        _XPLATSTR("application/xml"),
+                                        _XPLATSTR("image/svg+xml")})
+    {
+    }
 
     /// <summary>
     /// Copy constructor.
@@ -51,6 +148,11 @@ public:
     http_listener_config(const http_listener_config& other)
         : m_timeout(other.m_timeout)
         , m_backlog(other.m_backlog)
+        , m_compress_responses(other.m_compress_responses)
+        , m_compression_threshold(other.m_compression_threshold)
+        , m_compressible_content_types(other.m_compressible_content_types)
+        , m_compression_dictionaries(other.m_compression_dictionaries)
+        , m_response_cache(other.m_response_cache)
 #if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
         , m_ssl_context_callback(other.m_ssl_context_callback)
 #endif
@@ -64,6 +166,11 @@ public:
     http_listener_config(http_listener_config&& other)
         : m_timeout(std::move(other.m_timeout))
         , m_backlog(std::move(other.m_backlog))
+        , m_compress_responses(other.m_compress_responses)
+        , m_compression_threshold(other.m_compression_threshold)
+        , m_compressible_content_types(std::move(other.m_compressible_content_types))
+        , m_compression_dictionaries(std::move(other.m_compression_dictionaries))
+        , m_response_cache(std::move(other.m_response_cache))
 #if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
         , m_ssl_context_callback(std::move(other.m_ssl_context_callback))
 #endif
@@ -80,6 +187,11 @@ public:
         {
             m_timeout = rhs.m_timeout;
             m_backlog = rhs.m_backlog;
+            m_compress_responses = rhs.m_compress_responses;
+            m_compression_threshold = rhs.m_compression_threshold;
+            m_compressible_content_types = rhs.m_compressible_content_types;
+            m_compression_dictionaries = rhs.m_compression_dictionaries;
+            m_response_cache = rhs.m_response_cache;
 #if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
             m_ssl_context_callback = rhs.m_ssl_context_callback;
 #endif
@@ -97,6 +209,11 @@ public:
         {
             m_timeout = std::move(rhs.m_timeout);
             m_backlog = std::move(rhs.m_backlog);
+            m_compress_responses = rhs.m_compress_responses;
+            m_compression_threshold = rhs.m_compression_threshold;
+            m_compressible_content_types = std::move(rhs.m_compressible_content_types);
+            m_compression_dictionaries = std::move(rhs.m_compression_dictionaries);
+            m_response_cache = std::move(rhs.m_response_cache);
 #if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
             m_ssl_context_callback = std::move(rhs.m_ssl_context_callback);
 #endif
@@ -130,6 +247,87 @@ public:
     /// default.</param> <remarks>The implementation may not honour this value.</remarks>
     void set_backlog(int backlog) { m_backlog = backlog; }
 
+    /// <summary>
+    /// Get whether responses are compressed for clients that accept it
+    /// </summary>
+    /// <returns>True if responses are compressed, false otherwise.</returns>
+    bool compress_responses() const { return m_compress_responses; }
+
+    /// <summary>
+    /// Set whether responses are compressed for clients that accept it
+    /// </summary>
+    /// <param name="compress_responses">True to compress responses, using the best of the built-in algorithms
+    /// listed in the request's Accept-Encoding header.</param>
+    /// <remarks>Only responses that carry no Content-Encoding of their own, and whose Content-Type is one of the
+    /// compressible content types, are compressed. The implementation may not honour this value.</remarks>
+    void set_compress_responses(bool compress_responses) { m_compress_responses = compress_responses; }
+
+    /// <summary>
+    /// Get the minimum length of a compressed response body
+    /// </summary>
+    /// <returns>The length, in bytes, below which a response body with a Content-Length is sent as it is.</returns>
+    size_t compression_threshold() const { return m_compression_threshold; }
+
+    /// <summary>
+    /// Set the minimum length of a compressed response body
+    /// </summary>
+    /// <param name="threshold">The length, in bytes, below which a response body with a Content-Length is sent as it
+    /// is. Bodies of unknown length are always compressed.</param>
+    void set_compression_threshold(size_t threshold) { m_compression_threshold = threshold; }
+
+    /// <summary>
+    /// Get the content types of responses that are compressed
+    /// </summary>
+    /// <returns>The media types; an entry ending with a slash, such as "text/", matches any subtype.</returns>
+    const std::vector<utility::string_t>& compressible_content_types() const { return m_compressible_content_types; }
+
+    /// <summary>
+    /// Set the content types of responses that are compressed
+    /// </summary>
+    /// <param name="content_types">The media types; an entry ending with a slash, such as "text/", matches any
+    /// subtype.</param>
+    void set_compressible_content_types(std::vector<utility::string_t> content_types)
+    {
+        m_compressible_content_types = std::move(content_types);
+    }
+
+    /// <summary>
+    /// Get the preset dictionaries responses may be compressed with
+    /// </summary>
+    /// <returns>The dictionaries.</returns>
+    const std::vector<std::shared_ptr<http::compression::dictionary>>& compression_dictionaries() const
+    {
+        return m_compression_dictionaries;
+    }
+
+    /// <summary>
+    /// Set the preset dictionaries responses may be compressed with
+    /// </summary>
+    /// <param name="dictionaries">The dictionaries. A response to a client that names one of them in its
+    /// Dictionary-ID header is compressed with it, if the client accepts an algorithm that supports preset
+    /// dictionaries, and names it in the Content-Dictionary header.</param>
+    void set_compression_dictionaries(std::vector<std::shared_ptr<http::compression::dictionary>> dictionaries)
+    {
+        m_compression_dictionaries = std::move(dictionaries);
+    }
+
+    /// <summary>
+    /// Get the cache of compressed response bodies
+    /// </summary>
+    /// <returns>The cache, or nullptr if responses are compressed every time.</returns>
+    const std::shared_ptr<compressed_response_cache>& response_cache() const { return m_response_cache; }
+
+    /// <summary>
+    /// Set the cache of compressed response bodies
+    /// </summary>
+    /// <param name="cache">The cache. Compressed responses that carry a strong ETag and a Content-Length are stored
+    /// in it, and later responses with the same request URI, ETag and content coding are sent from it without being
+    /// compressed again. The cache may be shared by several listeners.</param>
+    void set_response_cache(std::shared_ptr<compressed_response_cache> cache)
+    {
+        m_response_cache = std::move(cache);
+    }
+
 #if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
     /// <summary>
     /// Get the callback of ssl context
@@ -154,6 +352,11 @@ public:
 private:
     utility::seconds m_timeout;
     int m_backlog;
+    bool m_compress_responses;
+    size_t m_compression_threshold;
+    std::vector<utility::string_t> m_compressible_content_types;
+    std::vector<std::shared_ptr<http::compression::dictionary>> m_compression_dictionaries;
+    std::shared_ptr<compressed_response_cache> m_response_cache;
 #if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
     std::function<void(boost::asio::ssl::context&)> m_ssl_context_callback;
 #endif
@@ -309,8 +309,16 @@ public:
     _ASYNCRTIMP utility::string_t extract_string(bool ignore_content_type = false);
 
     _ASYNCRTIMP json::value _extract_json(bool ignore_content_type = false);
+    _ASYNCRTIMP json::value _extract_cbor(bool ignore_content_type = false);
+    _ASYNCRTIMP json::value _extract_msgpack(bool ignore_content_type = false);
     _ASYNCRTIMP std::vector<unsigned char> _extract_vector();
 
+    /// <summary>
+    /// Sets the body to a json value encoded according to the given content type: CBOR for
+    /// 'application/cbor', MessagePack for 'application/msgpack' and JSON text otherwise.
+    /// </summary>
+    _ASYNCRTIMP void _set_json_body(const json::value& body_data, const utility::string_t& content_type);
+
     virtual _ASYNCRTIMP utility::string_t to_string() const;
 
     /// <summary>
@@ -379,6 +387,12 @@ public:
     /// </summary>
     _ASYNCRTIMP void _prepare_to_receive_data();
 
+    /// <summary>
+    /// Lets the output stream created by <c>_prepare_to_receive_data</c> size its storage for a body of the given
+    /// length, usually taken from the Content-Length header. Must be called before any body data is written.
+    /// </summary>
+    _ASYNCRTIMP void _set_body_size_hint(utility::size64_t size);
+
     /// <summary>
     /// Determine the remaining input stream length
     /// </summary>
@@ -640,6 +654,35 @@ public:
         });
     }
 
+    /// <summary>
+    /// Extracts the body of the response message into a json value, checking that the content type is application/cbor.
+    /// A body can only be extracted once because in some cases an optimization is made where the data is 'moved' out.
+    /// </summary>
+    /// <param name="ignore_content_type">If true, ignores the Content-Type header and assumes CBOR.</param>
+    /// <returns>JSON value decoded from the CBOR body of this message.</returns>
+    pplx::task<json::value> extract_cbor(bool ignore_content_type = false) const
+    {
+        auto impl = _m_impl;
+        return pplx::create_task(_m_impl->_get_data_available()).then([impl, ignore_content_type](utility::size64_t) {
+            return impl->_extract_cbor(ignore_content_type);
+        });
+    }
+
+    /// <summary>
+    /// Extracts the body of the response message into a json value, checking that the content type is
+    /// application/msgpack. A body can only be extracted once because in some cases an optimization is made where
+    /// the data is 'moved' out.
+    /// </summary>
+    /// <param name="ignore_content_type">If true, ignores the Content-Type header and assumes MessagePack.</param>
+    /// <returns>JSON value decoded from the MessagePack body of this message.</returns>
+    pplx::task<json::value> extract_msgpack(bool ignore_content_type = false) const
+    {
+        auto impl = _m_impl;
+        return pplx::create_task(_m_impl->_get_data_available()).then([impl, ignore_content_type](utility::size64_t) {
+            return impl->_extract_msgpack(ignore_content_type);
+        });
+    }
+
     /// <summary>
     /// Extracts the body of the response message into a vector of bytes.
     /// </summary>
@@ -722,6 +765,21 @@ public:
                  _XPLATSTR("application/json"));
     }
 
+    /// <summary>
+    /// Sets the body of the message to contain json value, encoded according to <paramref name="content_type" />:
+    /// CBOR for 'application/cbor', MessagePack for 'application/msgpack' and JSON text for anything else.
+    /// If the 'Content-Type' header hasn't already been set it will be set to <paramref name="content_type" />.
+    /// </summary>
+    /// <param name="body_data">json value.</param>
+    /// <param name="content_type">MIME type selecting the encoding of the body.</param>
+    /// <remarks>
+    /// This will overwrite any previously set body data.
+    /// </remarks>
+    void set_body(const json::value& body_data, const utility::string_t& content_type)
+    {
+        _m_impl->_set_json_body(body_data, content_type);
+    }
+
     /// <summary>
     /// Sets the body of the message to the contents of a byte vector. If the 'Content-Type'
     /// header hasn't already been set it will be set to 'application/octet-stream'.
@@ -1069,6 +1127,35 @@ public:
         });
     }
 
+    /// <summary>
+    /// Extracts the body of the request message into a json value, checking that the content type is application/cbor.
+    /// A body can only be extracted once because in some cases an optimization is made where the data is 'moved' out.
+    /// </summary>
+    /// <param name="ignore_content_type">If true, ignores the Content-Type header and assumes CBOR.</param>
+    /// <returns>JSON value decoded from the CBOR body of this message.</returns>
+    pplx::task<json::value> extract_cbor(bool ignore_content_type = false) const
+    {
+        auto impl = _m_impl;
+        return pplx::create_task(_m_impl->_get_data_available()).then([impl, ignore_content_type](utility::size64_t) {
+            return impl->_extract_cbor(ignore_content_type);
+        });
+    }
+
+    /// <summary>
+    /// Extracts the body of the request message into a json value, checking that the content type is
+    /// application/msgpack. A body can only be extracted once because in some cases an optimization is made where
+    /// the data is 'moved' out.
+    /// </summary>
+    /// <param name="ignore_content_type">If true, ignores the Content-Type header and assumes MessagePack.</param>
+    /// <returns>JSON value decoded from the MessagePack body of this message.</returns>
+    pplx::task<json::value> extract_msgpack(bool ignore_content_type = false) const
+    {
+        auto impl = _m_impl;
+        return pplx::create_task(_m_impl->_get_data_available()).then([impl, ignore_content_type](utility::size64_t) {
+            return impl->_extract_msgpack(ignore_content_type);
+        });
+    }
+
     /// <summary>
     /// Extract the body of the response message into a vector of bytes. Extracting a vector can be done on
     /// </summary>
@@ -1152,6 +1239,21 @@ public:
                           _XPLATSTR("application/json"));
     }
 
+    /// <summary>
+    /// Sets the body of the message to contain json value, encoded according to <paramref name="content_type" />:
+    /// CBOR for 'application/cbor', MessagePack for 'application/msgpack' and JSON text for anything else.
+    /// If the 'Content-Type' header hasn't already been set it will be set to <paramref name="content_type" />.
+    /// </summary>
+    /// <param name="body_data">json value.</param>
+    /// <param name="content_type">MIME type selecting the encoding of the body.</param>
+    /// <remarks>
+    /// This will overwrite any previously set body data.
+    /// </remarks>
+    void set_body(const json::value& body_data, const utility::string_t& content_type)
+    {
+        _m_impl->_set_json_body(body_data, content_type);
+    }
+
     /// <summary>
     /// Sets the body of the message to the contents of a byte vector. If the 'Content-Type'
     /// header hasn't already been set it will be set to 'application/octet-stream'.
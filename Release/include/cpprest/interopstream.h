@@ -71,7 +71,12 @@ private:
     virtual bool can_seek() const { return this->is_open(); }
     virtual bool has_size() const { return false; }
 
-    virtual size_t in_avail() const { return (size_t)m_buffer->in_avail(); }
+    virtual size_t in_avail() const
+    {
+        // std::streambuf reports -1 when it knows there is nothing more to read.
+        const auto avail = m_buffer->in_avail();
+        return avail > 0 ? (size_t)avail : 0;
+    }
 
     virtual size_t buffer_size(std::ios_base::openmode) const { return 0; }
     virtual void set_buffer_size(size_t, std::ios_base::openmode) { return; }
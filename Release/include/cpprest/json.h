@@ -19,8 +19,10 @@
 #include "cpprest/details/basic_types.h"
 #include <cstdint>
 #include <memory>
+#include <new>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -39,6 +41,7 @@ class _Boolean;
 class _String;
 class _Object;
 class _Array;
+class _Lazy;
 template<typename CharType>
 class JSON_Parser;
 } // namespace details
@@ -46,7 +49,13 @@ class JSON_Parser;
 namespace details
 {
 extern bool g_keep_json_object_unsorted;
-}
+
+// Storage inside each json::value, large enough for a number, Boolean or null value so that these are constructed in
+// place rather than on the heap. Strings, objects and arrays are stored out of line to keep json::value small. The
+// alignment is only what a number needs; the default one would pad json::value from 32 to 48 bytes on 64-bit platforms.
+typedef std::aligned_storage<sizeof(void*) + 2 * sizeof(uint64_t), std::alignment_of<uint64_t>::value>::type
+    _Value_storage;
+} // namespace details
 
 /// <summary>
 /// Preserve the order of the name/value pairs when parsing a JSON object.
@@ -202,6 +211,11 @@ public:
     /// <returns>The JSON value object that contains the result of the assignment.</returns>
     _ASYNCRTIMP value& operator=(value&&) CPPREST_NOEXCEPT;
 
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    _ASYNCRTIMP ~value();
+
     // Static factories
 
     /// <summary>
@@ -401,6 +415,22 @@ public:
     /// <returns>The parsed object. Returns web::json::value::null if failed</returns>
     _ASYNCRTIMP static value __cdecl parse(const utility::string_t& value, std::error_code& errorCode);
 
+    /// <summary>
+    /// Parses a UTF-8 string on demand, materializing values only when they are accessed.
+    /// </summary>
+    /// <param name="value">The UTF-8 encoded JSON text. The returned value and all values obtained from it share
+    /// ownership of this buffer.</param>
+    /// <returns>A JSON value backed by the source text.</returns>
+    /// <remarks>
+    /// Only the structure of the text (balanced brackets and terminated strings) is checked up front; the contents
+    /// of an object, array or scalar are parsed the first time they are accessed, which may throw a
+    /// <see cref="json_exception"/> for malformed input. Serializing a value that has not been modified copies the
+    /// original bytes instead of formatting the value again, so documents that are mostly passed through
+    /// unchanged cost little more than a copy. Because accessors materialize values in place, a lazily parsed value
+    /// must not be read concurrently from multiple threads.
+    /// </remarks>
+    _ASYNCRTIMP static value __cdecl parse_lazy(std::string value);
+
     /// <summary>
     /// Serializes the current JSON value to a C++ string.
     /// </summary>
@@ -458,6 +488,55 @@ public:
     _ASYNCRTIMP void serialize(std::ostream& stream) const;
 #endif
 
+    /// <summary>
+    /// Serializes the current JSON value into a CBOR (RFC 8949) encoded byte buffer.
+    /// </summary>
+    /// <returns>The CBOR representation of the value</returns>
+    _ASYNCRTIMP std::vector<unsigned char> to_cbor() const;
+
+    /// <summary>
+    /// Parses a CBOR (RFC 8949) encoded byte buffer and constructs a JSON value.
+    /// Throws <see cref="json_exception"/> if the data is malformed or uses CBOR features
+    /// without a JSON equivalent, such as byte strings or non-string map keys.
+    /// </summary>
+    /// <param name="data">Pointer to the CBOR encoded bytes</param>
+    /// <param name="size">Number of bytes available at <paramref name="data" /></param>
+    /// <returns>The JSON value decoded from the buffer.</returns>
+    _ASYNCRTIMP static value __cdecl from_cbor(const unsigned char* data, size_t size);
+
+    /// <summary>
+    /// Parses a CBOR (RFC 8949) encoded byte buffer and constructs a JSON value.
+    /// </summary>
+    /// <param name="data">The CBOR encoded bytes</param>
+    /// <returns>The JSON value decoded from the buffer.</returns>
+    static value from_cbor(const std::vector<unsigned char>& data) { return from_cbor(data.data(), data.size()); }
+
+    /// <summary>
+    /// Serializes the current JSON value into a MessagePack encoded byte buffer.
+    /// </summary>
+    /// <returns>The MessagePack representation of the value</returns>
+    _ASYNCRTIMP std::vector<unsigned char> to_msgpack() const;
+
+    /// <summary>
+    /// Parses a MessagePack encoded byte buffer and constructs a JSON value.
+    /// Throws <see cref="json_exception"/> if the data is malformed or uses MessagePack features
+    /// without a JSON equivalent, such as binary or extension types or non-string map keys.
+    /// </summary>
+    /// <param name="data">Pointer to the MessagePack encoded bytes</param>
+    /// <param name="size">Number of bytes available at <paramref name="data" /></param>
+    /// <returns>The JSON value decoded from the buffer.</returns>
+    _ASYNCRTIMP static value __cdecl from_msgpack(const unsigned char* data, size_t size);
+
+    /// <summary>
+    /// Parses a MessagePack encoded byte buffer and constructs a JSON value.
+    /// </summary>
+    /// <param name="data">The MessagePack encoded bytes</param>
+    /// <returns>The JSON value decoded from the buffer.</returns>
+    static value from_msgpack(const std::vector<unsigned char>& data)
+    {
+        return from_msgpack(data.data(), data.size());
+    }
+
     /// <summary>
     /// Converts the JSON value to a C++ double, if and only if it is a number value.
     /// Throws <see cref="json_exception"/>  if the value is not a number
@@ -674,6 +753,7 @@ public:
 private:
     friend class web::json::details::_Object;
     friend class web::json::details::_Array;
+    friend class web::json::details::_Lazy;
     template<typename CharType>
     friend class web::json::details::JSON_Parser;
 
@@ -691,14 +771,44 @@ private:
     _ASYNCRTIMP void format(std::basic_string<char>& string) const;
 
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
-    explicit value(std::unique_ptr<details::_Value> v, value_type kind) : m_value(std::move(v)), m_kind(kind)
+    explicit value(std::unique_ptr<details::_Value> v, value_type kind) : m_value(v.release()), m_kind(kind)
 #else
-    explicit value(std::unique_ptr<details::_Value> v) : m_value(std::move(v))
+    explicit value(std::unique_ptr<details::_Value> v) : m_value(v.release())
 #endif
     {
     }
 
-    std::unique_ptr<details::_Value> m_value;
+    /// <summary>
+    /// Replaces the implementation with a <typeparamref name="T"/>, constructed in place if it fits.
+    /// </summary>
+    template<typename T, typename... Args>
+    void _emplace(Args&&... args);
+
+    /// <summary>
+    /// Replaces the implementation with one already allocated on the heap.
+    /// </summary>
+    void _reset(details::_Value* v) CPPREST_NOEXCEPT;
+
+    /// <summary>
+    /// Moves the implementation out of another value, leaving it null.
+    /// </summary>
+    void _take(value& other) CPPREST_NOEXCEPT;
+
+    /// <summary>
+    /// Destroys the implementation, freeing it if it is on the heap.
+    /// </summary>
+    void _release() CPPREST_NOEXCEPT;
+
+    bool _is_inline() const CPPREST_NOEXCEPT
+    {
+        const auto storage = reinterpret_cast<uintptr_t>(&m_storage);
+        const auto impl = reinterpret_cast<uintptr_t>(m_value);
+        return impl >= storage && impl < storage + sizeof(m_storage);
+    }
+
+    // Points either into m_storage or to a heap allocation, and is never null.
+    details::_Value* m_value;
+    details::_Value_storage m_storage;
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     value_type m_kind;
 #endif
@@ -1349,11 +1459,44 @@ private:
 
 namespace details
 {
+template<typename T>
+struct _fits_inline
+    : std::integral_constant<bool,
+                             sizeof(T) <= sizeof(_Value_storage) &&
+                                 std::alignment_of<T>::value <= std::alignment_of<_Value_storage>::value>
+{
+};
+
+template<typename T, typename... Args>
+_Value* _construct_value_impl(_Value_storage& storage, std::true_type, Args&&... args)
+{
+    return new (&storage) T(std::forward<Args>(args)...);
+}
+
+template<typename T, typename... Args>
+_Value* _construct_value_impl(_Value_storage&, std::false_type, Args&&... args)
+{
+    return new T(std::forward<Args>(args)...);
+}
+
+/// <summary>
+/// Constructs a <typeparamref name="T"/> in the storage of a json::value if it fits there, otherwise on the heap.
+/// </summary>
+template<typename T, typename... Args>
+_Value* _construct_value(_Value_storage& storage, Args&&... args)
+{
+    return _construct_value_impl<T>(storage, _fits_inline<T>(), std::forward<Args>(args)...);
+}
+
 class _Value
 {
 public:
     virtual std::unique_ptr<_Value> _copy_value() = 0;
 
+    // Copies the value for another json::value. Only types that may be stored inline need to override these.
+    virtual _Value* _copy_to(_Value_storage&) { return _copy_value().release(); }
+    virtual _Value* _move_to(_Value_storage& storage) { return _copy_to(storage); }
+
     virtual bool has_field(const utility::string_t&) const { return false; }
     virtual value get_field(const utility::string_t&) const { throw json_exception("not an object"); }
     virtual value get_element(array::size_type) const { throw json_exception("not an array"); }
@@ -1394,6 +1537,13 @@ public:
 
     virtual size_t size() const { return 0; }
 
+    // Estimates the serialized length of the value as a member of an object or array, without parsing it.
+    virtual size_t child_reserve_size() const
+    {
+        const size_t valueSize = size() * 20; // Multiply by each object/array element
+        return valueSize == 0 ? 5 : valueSize; // true, false, or null
+    }
+
     virtual ~_Value() {}
 
 protected:
@@ -1411,6 +1561,8 @@ class _Null : public _Value
 {
 public:
     virtual std::unique_ptr<_Value> _copy_value() { return utility::details::make_unique<_Null>(); }
+    virtual _Value* _copy_to(_Value_storage& storage) { return _construct_value<_Null>(storage); }
+    virtual _Value* _move_to(_Value_storage& storage) { return _construct_value<_Null>(storage); }
     virtual json::value::value_type type() const { return json::value::Null; }
 };
 
@@ -1424,6 +1576,8 @@ public:
     _Number(uint64_t value) : m_number(value) {}
 
     virtual std::unique_ptr<_Value> _copy_value() { return utility::details::make_unique<_Number>(*this); }
+    virtual _Value* _copy_to(_Value_storage& storage) { return _construct_value<_Number>(storage, *this); }
+    virtual _Value* _move_to(_Value_storage& storage) { return _construct_value<_Number>(storage, std::move(*this)); }
 
     virtual json::value::value_type type() const { return json::value::Number; }
 
@@ -1454,6 +1608,8 @@ public:
     _Boolean(bool value) : m_value(value) {}
 
     virtual std::unique_ptr<_Value> _copy_value() { return utility::details::make_unique<_Boolean>(*this); }
+    virtual _Value* _copy_to(_Value_storage& storage) { return _construct_value<_Boolean>(storage, *this); }
+    virtual _Value* _move_to(_Value_storage& storage) { return _construct_value<_Boolean>(storage, std::move(*this)); }
 
     virtual json::value::value_type type() const { return json::value::Boolean; }
 
@@ -1496,6 +1652,8 @@ public:
 
     virtual const utility::string_t& as_string() const;
 
+    virtual size_t child_reserve_size() const { return get_reserve_size(); }
+
     virtual void serialize_impl(std::string& str) const { serialize_impl_char_type(str); }
 #ifdef _WIN32
     virtual void serialize_impl(std::wstring& str) const { serialize_impl_char_type(str); }
@@ -1560,13 +1718,6 @@ public:
 
     virtual json::value& index(const utility::string_t& key);
 
-    bool is_equal(const _Object* other) const
-    {
-        if (m_object.size() != other->m_object.size()) return false;
-
-        return std::equal(std::begin(m_object), std::end(m_object), std::begin(other->m_object));
-    }
-
     virtual void serialize_impl(std::string& str) const
     {
         // To avoid repeated allocations reserve some space all up front.
@@ -1624,20 +1775,8 @@ private:
         size_t reserveSize = 2; // For brackets {}
         for (auto iter = m_object.begin(); iter != m_object.end(); ++iter)
         {
-            reserveSize += iter->first.length() + 2;     // 2 for quotes
-            size_t valueSize = iter->second.size() * 20; // Multiply by each object/array element
-            if (valueSize == 0)
-            {
-                if (iter->second.type() == json::value::String)
-                {
-                    valueSize = static_cast<_String*>(iter->second.m_value.get())->get_reserve_size();
-                }
-                else
-                {
-                    valueSize = 5; // true, false, or null
-                }
-            }
-            reserveSize += valueSize;
+            reserveSize += iter->first.length() + 2; // 2 for quotes
+            reserveSize += iter->second.m_value->child_reserve_size();
         }
         return reserveSize;
     }
@@ -1659,23 +1798,6 @@ public:
 
     virtual json::value& index(json::array::size_type index) { return m_array[index]; }
 
-    bool is_equal(const _Array* other) const
-    {
-        if (m_array.size() != other->m_array.size()) return false;
-
-        auto iterT = m_array.cbegin();
-        auto iterO = other->m_array.cbegin();
-        auto iterTe = m_array.cend();
-        auto iterOe = other->m_array.cend();
-
-        for (; iterT != iterTe && iterO != iterOe; ++iterT, ++iterO)
-        {
-            if (*iterT != *iterO) return false;
-        }
-
-        return true;
-    }
-
     virtual void serialize_impl(std::string& str) const
     {
         // To avoid repeated allocations reserve some space all up front.
@@ -1727,17 +1849,31 @@ private:
         size_t reserveSize = 2; // For brackets []
         for (auto iter = m_array.cbegin(); iter != m_array.cend(); ++iter)
         {
-            size_t valueSize = iter->size() * 20; // Per each nested array/object
-
-            if (valueSize == 0) valueSize = 5; // true, false, or null
-
-            reserveSize += valueSize;
+            reserveSize += iter->m_value->child_reserve_size();
         }
         return reserveSize;
     }
 };
 } // namespace details
 
+template<typename T, typename... Args>
+void json::value::_emplace(Args&&... args)
+{
+    _release();
+    try
+    {
+        m_value = details::_construct_value<T>(m_storage, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        m_value = new (&m_storage) details::_Null();
+        throw;
+    }
+#ifdef ENABLE_JSON_VALUE_VISUALIZER
+    m_kind = m_value->type();
+#endif
+}
+
 /// <summary>
 /// Gets the number of children of the value.
 /// </summary>
@@ -0,0 +1,427 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * Compile-time binding between C++ structs and JSON text.
+ *
+ * For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+#pragma once
+
+#ifndef CASA_JSON_BINDING_H
+#define CASA_JSON_BINDING_H
+
+#include "cpprest/json.h"
+#include <limits>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Macros used by CPPREST_JSON_FIELDS to apply a macro to each of up to 32 arguments.
+#define CPPREST_JSON_EXPAND(x) x
+#define CPPREST_JSON_CONCAT(a, b) CPPREST_JSON_CONCAT_IMPL(a, b)
+#define CPPREST_JSON_CONCAT_IMPL(a, b) a##b
+#define CPPREST_JSON_ARG_COUNT(...) \
+    CPPREST_JSON_EXPAND(CPPREST_JSON_ARG_COUNT_IMPL(__VA_ARGS__, \
+        32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, \
+        4, 3, 2, 1))
+#define CPPREST_JSON_ARG_COUNT_IMPL( \
+    _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, \
+    _25, _26, _27, _28, _29, _30, _31, _32, N, ...) \
+    N
+#define CPPREST_JSON_FOR_EACH(m, ...) \
+    CPPREST_JSON_EXPAND( \
+        CPPREST_JSON_CONCAT(CPPREST_JSON_FOR_EACH_, CPPREST_JSON_ARG_COUNT(__VA_ARGS__))(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_1(m, x) m(x)
+#define CPPREST_JSON_FOR_EACH_2(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_1(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_3(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_2(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_4(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_3(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_5(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_4(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_6(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_5(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_7(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_6(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_8(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_7(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_9(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_8(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_10(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_9(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_11(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_10(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_12(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_11(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_13(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_12(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_14(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_13(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_15(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_14(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_16(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_15(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_17(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_16(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_18(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_17(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_19(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_18(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_20(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_19(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_21(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_20(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_22(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_21(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_23(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_22(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_24(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_23(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_25(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_24(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_26(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_25(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_27(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_26(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_28(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_27(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_29(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_28(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_30(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_29(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_31(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_30(m, __VA_ARGS__))
+#define CPPREST_JSON_FOR_EACH_32(m, x, ...) m(x) CPPREST_JSON_EXPAND(CPPREST_JSON_FOR_EACH_31(m, __VA_ARGS__))
+
+#define CPPREST_JSON_VISIT_FIELD(field) visitor(#field, obj.field);
+
+/// <summary>
+/// Declares the members of a struct that are bound to the fields of a JSON object of the same name.
+/// </summary>
+/// <remarks>
+/// Use at namespace scope, in the namespace of the struct, for example
+/// <c>CPPREST_JSON_FIELDS(person, name, age, addresses)</c>. Bound members may be <c>bool</c>, arithmetic types,
+/// <c>std::string</c> (UTF-8), <c>utility::string_t</c>, <c>json::value</c>, <c>std::vector</c> of a bindable type,
+/// or another bound struct. To bind members under different field names, provide a <c>cpprest_json_fields</c>
+/// function template with the same shape as the ones generated here.
+/// </remarks>
+#define CPPREST_JSON_FIELDS(Type, ...)                                                                                 \
+    template<typename Visitor>                                                                                         \
+    inline void cpprest_json_fields(Type& obj, Visitor& visitor)                                                       \
+    {                                                                                                                  \
+        CPPREST_JSON_FOR_EACH(CPPREST_JSON_VISIT_FIELD, __VA_ARGS__)                                                   \
+    }                                                                                                                  \
+    template<typename Visitor>                                                                                         \
+    inline void cpprest_json_fields(const Type& obj, Visitor& visitor)                                                 \
+    {                                                                                                                  \
+        CPPREST_JSON_FOR_EACH(CPPREST_JSON_VISIT_FIELD, __VA_ARGS__)                                                   \
+    }
+
+namespace web
+{
+namespace json
+{
+namespace details
+{
+/// <summary>
+/// Reads JSON text directly into C++ values without building a <see cref="json::value"/>.
+/// </summary>
+class binding_reader
+{
+public:
+    _ASYNCRTIMP binding_reader(const char* begin, const char* end);
+
+    /// <summary>
+    /// Returns the next non-whitespace character without consuming it, or 0 at the end of the input.
+    /// </summary>
+    _ASYNCRTIMP char peek();
+    _ASYNCRTIMP void expect(char ch);
+    _ASYNCRTIMP bool try_consume(char ch);
+
+    /// <summary>
+    /// Consumes a <c>null</c> literal if one is next.
+    /// </summary>
+    _ASYNCRTIMP bool try_read_null();
+    _ASYNCRTIMP bool read_bool();
+    _ASYNCRTIMP int64_t read_int64();
+    _ASYNCRTIMP uint64_t read_uint64();
+    _ASYNCRTIMP double read_double();
+    _ASYNCRTIMP void read_string(std::string& str);
+
+    /// <summary>
+    /// Reads an object field name and the following colon.
+    /// </summary>
+    /// <returns>The field name. The reference is valid until the next call.</returns>
+    _ASYNCRTIMP const std::string& read_key();
+
+    _ASYNCRTIMP void skip_value();
+    _ASYNCRTIMP json::value read_value();
+
+    /// <summary>
+    /// Verifies that only whitespace remains in the input.
+    /// </summary>
+    _ASYNCRTIMP void finish();
+
+    [[noreturn]] _ASYNCRTIMP void fail(const char* message) const;
+
+private:
+    const char* m_begin;
+    const char* m_pos;
+    const char* m_end;
+    std::string m_key;
+#ifndef _WIN32
+    utility::details::scoped_c_thread_locale m_locale;
+#endif
+};
+
+/// <summary>
+/// Writes C++ values as JSON text.
+/// </summary>
+class binding_writer
+{
+public:
+    _ASYNCRTIMP binding_writer(std::string& out);
+
+    void begin_object() { m_out.push_back('{'); }
+    void end_object() { m_out.push_back('}'); }
+    void begin_array() { m_out.push_back('['); }
+    void end_array() { m_out.push_back(']'); }
+    void separator() { m_out.push_back(','); }
+
+    _ASYNCRTIMP void write_key(const char* name);
+    _ASYNCRTIMP void write_null();
+    _ASYNCRTIMP void write_bool(bool value);
+    _ASYNCRTIMP void write_int64(int64_t value);
+    _ASYNCRTIMP void write_uint64(uint64_t value);
+    _ASYNCRTIMP void write_double(double value);
+    _ASYNCRTIMP void write_string(const std::string& value);
+    _ASYNCRTIMP void write_value(const json::value& value);
+
+private:
+    std::string& m_out;
+#ifndef _WIN32
+    utility::details::scoped_c_thread_locale m_locale;
+#endif
+};
+
+inline void bind_read(binding_reader& reader, bool& value) { value = reader.read_bool(); }
+
+inline void bind_read(binding_reader& reader, std::string& value) { reader.read_string(value); }
+
+#ifdef _WIN32
+inline void bind_read(binding_reader& reader, utility::string_t& value)
+{
+    std::string utf8;
+    reader.read_string(utf8);
+    value = utility::conversions::to_string_t(utf8);
+}
+#endif
+
+inline void bind_read(binding_reader& reader, json::value& value) { value = reader.read_value(); }
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type bind_read(
+    binding_reader& reader, T& value)
+{
+    const int64_t number = reader.read_int64();
+    if (number < static_cast<int64_t>((std::numeric_limits<T>::min)()) ||
+        number > static_cast<int64_t>((std::numeric_limits<T>::max)()))
+    {
+        reader.fail("integer out of range");
+    }
+    value = static_cast<T>(number);
+}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value && !std::is_same<T, bool>::value>::type
+bind_read(binding_reader& reader, T& value)
+{
+    const uint64_t number = reader.read_uint64();
+    if (number > static_cast<uint64_t>((std::numeric_limits<T>::max)()))
+    {
+        reader.fail("integer out of range");
+    }
+    value = static_cast<T>(number);
+}
+
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type bind_read(binding_reader& reader, T& value)
+{
+    value = static_cast<T>(reader.read_double());
+}
+
+template<typename T>
+void bind_read(binding_reader& reader, std::vector<T>& value)
+{
+    value.clear();
+    reader.expect('[');
+    if (reader.try_consume(']')) return;
+    do
+    {
+        T element;
+        bind_read(reader, element);
+        value.push_back(std::move(element));
+    } while (reader.try_consume(','));
+    reader.expect(']');
+}
+
+/// <summary>
+/// Visitor that reads the field matching a name found in the input.
+/// </summary>
+class binding_field_reader
+{
+public:
+    binding_field_reader(binding_reader& reader, const std::string& key) : m_reader(reader), m_key(key), m_found(false)
+    {
+    }
+
+    template<typename T>
+    void operator()(const char* name, T& field)
+    {
+        // The key refers to the reader's buffer, which is reused by nested objects, so stop comparing once matched.
+        if (!m_found && m_key == name)
+        {
+            m_found = true;
+            if (!m_reader.try_read_null())
+            {
+                bind_read(m_reader, field);
+            }
+        }
+    }
+
+    bool found() const { return m_found; }
+
+private:
+    binding_reader& m_reader;
+    const std::string& m_key;
+    bool m_found;
+};
+
+template<typename T>
+typename std::enable_if<std::is_class<T>::value>::type bind_read(binding_reader& reader, T& value)
+{
+    reader.expect('{');
+    if (reader.try_consume('}')) return;
+    do
+    {
+        binding_field_reader visitor(reader, reader.read_key());
+        cpprest_json_fields(value, visitor);
+        if (!visitor.found())
+        {
+            reader.skip_value();
+        }
+    } while (reader.try_consume(','));
+    reader.expect('}');
+}
+
+inline void bind_write(binding_writer& writer, bool value) { writer.write_bool(value); }
+
+inline void bind_write(binding_writer& writer, const std::string& value) { writer.write_string(value); }
+
+#ifdef _WIN32
+inline void bind_write(binding_writer& writer, const utility::string_t& value)
+{
+    writer.write_string(utility::conversions::to_utf8string(value));
+}
+#endif
+
+inline void bind_write(binding_writer& writer, const json::value& value) { writer.write_value(value); }
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type bind_write(
+    binding_writer& writer, T value)
+{
+    writer.write_int64(value);
+}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value && !std::is_same<T, bool>::value>::type
+bind_write(binding_writer& writer, T value)
+{
+    writer.write_uint64(value);
+}
+
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type bind_write(binding_writer& writer, T value)
+{
+    writer.write_double(value);
+}
+
+template<typename T>
+void bind_write(binding_writer& writer, const std::vector<T>& value)
+{
+    writer.begin_array();
+    for (auto iter = value.begin(); iter != value.end(); ++iter)
+    {
+        if (iter != value.begin()) writer.separator();
+        bind_write(writer, static_cast<const T&>(*iter));
+    }
+    writer.end_array();
+}
+
+/// <summary>
+/// Visitor that writes each bound field as a name/value pair.
+/// </summary>
+class binding_field_writer
+{
+public:
+    binding_field_writer(binding_writer& writer) : m_writer(writer), m_first(true) {}
+
+    template<typename T>
+    void operator()(const char* name, const T& field)
+    {
+        if (!m_first) m_writer.separator();
+        m_first = false;
+        m_writer.write_key(name);
+        bind_write(m_writer, field);
+    }
+
+private:
+    binding_writer& m_writer;
+    bool m_first;
+};
+
+template<typename T>
+typename std::enable_if<std::is_class<T>::value>::type bind_write(binding_writer& writer, const T& value)
+{
+    writer.begin_object();
+    binding_field_writer visitor(writer);
+    cpprest_json_fields(value, visitor);
+    writer.end_object();
+}
+} // namespace details
+
+/// <summary>
+/// Parses UTF-8 JSON text directly into a value of a bound type, without building a <see cref="json::value"/>.
+/// </summary>
+/// <param name="text">The UTF-8 encoded JSON text.</param>
+/// <param name="obj">The object to read into. Fields missing from the text or set to <c>null</c> keep their
+/// current values, and fields of the text that are not bound are skipped.</param>
+template<typename T>
+void parse_into(const std::string& text, T& obj)
+{
+    details::binding_reader reader(text.data(), text.data() + text.size());
+    details::bind_read(reader, obj);
+    reader.finish();
+}
+
+/// <summary>
+/// Parses UTF-8 JSON text directly into a new value of a bound type.
+/// </summary>
+/// <param name="text">The UTF-8 encoded JSON text.</param>
+/// <returns>A default constructed <typeparamref name="T"/> with the fields of the text applied.</returns>
+template<typename T>
+T parse_as(const std::string& text)
+{
+    T obj;
+    parse_into(text, obj);
+    return obj;
+}
+
+/// <summary>
+/// Serializes a value of a bound type to UTF-8 JSON text, without building a <see cref="json::value"/>.
+/// </summary>
+/// <param name="obj">The object to serialize.</param>
+/// <returns>The UTF-8 encoded JSON text.</returns>
+template<typename T>
+std::string serialize(const T& obj)
+{
+    std::string text;
+    details::binding_writer writer(text);
+    details::bind_write(writer, obj);
+    return text;
+}
+
+/// <summary>
+/// Serializes a value of a bound type as UTF-8 JSON text to a stream.
+/// </summary>
+/// <param name="obj">The object to serialize.</param>
+/// <param name="stream">The stream to write to.</param>
+template<typename T>
+void serialize(const T& obj, std::ostream& stream)
+{
+    const std::string text = serialize(obj);
+    stream.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+} // namespace json
+} // namespace web
+
+#endif
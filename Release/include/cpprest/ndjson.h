@@ -0,0 +1,124 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * Asynchronous reader and writer for newline-delimited JSON (NDJSON) streams.
+ *
+ * For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+#pragma once
+
+#ifndef CASA_NDJSON_H
+#define CASA_NDJSON_H
+
+#include "cpprest/json.h"
+#include "cpprest/streams.h"
+#include <memory>
+
+namespace web
+{
+namespace json
+{
+namespace details
+{
+class _ndjson_reader_impl;
+class _ndjson_writer_impl;
+} // namespace details
+
+/// <summary>
+/// Reads a newline-delimited JSON stream one value at a time.
+/// </summary>
+/// <remarks>
+/// The stream is consumed in fixed size chunks and only the line currently being parsed is buffered, so
+/// unbounded streams such as an <c>http_response::body()</c> can be processed in constant memory.
+/// Empty lines are skipped. A line longer than the configured maximum fails the read with a
+/// <see cref="json_exception"/> and is skipped, so that the next read continues with the following line.
+/// </remarks>
+class ndjson_reader
+{
+public:
+    /// <summary>
+    /// The default upper bound on the length of a single line, in bytes.
+    /// </summary>
+    static const size_t default_max_line_length = 16 * 1024 * 1024;
+
+    /// <summary>
+    /// Creates a reader over an open input stream.
+    /// </summary>
+    /// <param name="stream">The stream to read NDJSON from, for example <c>http_response::body()</c>.</param>
+    /// <param name="max_line_length">Maximum number of bytes a single line may contain.</param>
+    _ASYNCRTIMP ndjson_reader(concurrency::streams::istream stream,
+                              size_t max_line_length = default_max_line_length);
+
+    /// <summary>
+    /// Reads the next value from the stream.
+    /// </summary>
+    /// <returns>A task that completes with <c>true</c> if a value was read and is available from
+    /// <see cref="ndjson_reader::current"/>, or <c>false</c> at the end of the stream.</returns>
+    /// <remarks>Only one read may be outstanding at a time.</remarks>
+    _ASYNCRTIMP pplx::task<bool> read_next();
+
+    /// <summary>
+    /// Gets the value produced by the last successful <see cref="ndjson_reader::read_next"/>.
+    /// </summary>
+    /// <returns>A reference to the current value.</returns>
+    _ASYNCRTIMP json::value& current();
+
+    /// <summary>
+    /// Reads all remaining values from the stream, invoking a handler for each one.
+    /// </summary>
+    /// <param name="handler">Function invoked with each value, in stream order.</param>
+    /// <returns>A task that completes when the end of the stream has been reached.</returns>
+    _ASYNCRTIMP pplx::task<void> for_each(std::function<void(json::value)> handler);
+
+private:
+    std::shared_ptr<details::_ndjson_reader_impl> m_impl;
+};
+
+/// <summary>
+/// Writes JSON values to an output stream as newline-delimited JSON.
+/// </summary>
+/// <remarks>
+/// Writes are queued in call order, so values can be written without waiting for earlier writes
+/// to complete.
+/// </remarks>
+class ndjson_writer
+{
+public:
+    /// <summary>
+    /// Creates a writer over an open output stream.
+    /// </summary>
+    /// <param name="stream">The stream to write NDJSON to.</param>
+    _ASYNCRTIMP ndjson_writer(concurrency::streams::ostream stream);
+
+    /// <summary>
+    /// Serializes a value followed by a newline to the stream.
+    /// </summary>
+    /// <param name="value">The value to write.</param>
+    /// <returns>A task that completes when the value has been handed to the stream.</returns>
+    _ASYNCRTIMP pplx::task<void> write(const json::value& value);
+
+    /// <summary>
+    /// Waits for all queued writes and flushes the stream.
+    /// </summary>
+    /// <returns>A task that completes when the stream has been flushed.</returns>
+    _ASYNCRTIMP pplx::task<void> flush();
+
+    /// <summary>
+    /// Waits for all queued writes and closes the stream.
+    /// </summary>
+    /// <returns>A task that completes when the stream has been closed.</returns>
+    _ASYNCRTIMP pplx::task<void> close();
+
+private:
+    std::shared_ptr<details::_ndjson_writer_impl> m_impl;
+};
+
+} // namespace json
+} // namespace web
+
+#endif
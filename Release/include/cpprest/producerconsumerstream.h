@@ -19,6 +19,9 @@
 #include "cpprest/astreambuf.h"
 #include "pplx/pplxtasks.h"
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
 #include <iterator>
 #include <queue>
 #include <vector>
@@ -45,9 +48,13 @@ public:
     /// <summary>
     /// Constructor
     /// </summary>
-    basic_producer_consumer_buffer(size_t alloc_size)
+    /// <param name="alloc_size">The default block size.</param>
+    /// <param name="high_water_mark">The number of buffered characters at which writes start waiting for the reader
+    /// to catch up, or 0 to never wait.</param>
+    basic_producer_consumer_buffer(size_t alloc_size, size_t high_water_mark = 0)
         : streambuf_state_manager<_CharType>(std::ios_base::out | std::ios_base::in)
         , m_alloc_size(alloc_size)
+        , m_high_water_mark(high_water_mark)
         , m_allocBlock(nullptr)
         , m_total(0)
         , m_total_read(0)
@@ -86,18 +93,28 @@ public:
     /// Get the stream buffer size, if one has been set.
     /// </summary>
     /// <param name="direction">The direction of buffering (in or out)</param>
-    /// <remarks>An implementation that does not support buffering will always return '0'.</remarks>
-    virtual size_t buffer_size(std::ios_base::openmode = std::ios_base::in) const { return 0; }
+    /// <remarks>For the output direction this is the size of the blocks that written data is stored in. There is no
+    /// buffering in the input direction, which always returns '0'.</remarks>
+    virtual size_t buffer_size(std::ios_base::openmode direction = std::ios_base::in) const
+    {
+        return direction == std::ios_base::out ? static_cast<size_t>(m_alloc_size) : 0;
+    }
 
     /// <summary>
     /// Sets the stream buffer implementation to buffer or not buffer.
     /// </summary>
     /// <param name="size">The size to use for internal buffering, 0 if no buffering should be done.</param>
     /// <param name="direction">The direction of buffering (in or out)</param>
-    /// <remarks>An implementation that does not support buffering will silently ignore calls to this function and it
-    /// will not have any effect on what is returned by subsequent calls to <see cref="::buffer_size method"
-    /// />.</remarks>
-    virtual void set_buffer_size(size_t, std::ios_base::openmode = std::ios_base::in) { return; }
+    /// <remarks>For the output direction this sets the size of the blocks allocated from then on; writes are always
+    /// buffered, so a size of 0 is ignored. Calls for the input direction are silently ignored.</remarks>
+    virtual void set_buffer_size(size_t size, std::ios_base::openmode direction = std::ios_base::in)
+    {
+        if (direction != std::ios_base::out || size == 0) return;
+
+        pplx::extensibility::scoped_critical_section_t l(m_lock);
+        m_alloc_size = size;
+        m_free_blocks.clear();
+    }
 
     /// <summary>
     /// For any input stream, <c>in_avail</c> returns the number of characters that are immediately available
@@ -147,12 +164,21 @@ public:
             return nullptr;
         }
 
-        // We always allocate a new block even if the count could be satisfied by
-        // the current write block. While this does lead to wasted space it allows for
-        // easier book keeping
+        // The room left in the current write block is handed out when it is large enough, so that a writer that
+        // commits less than it allocated continues where it left off instead of starting a new block every time.
 
         _ASSERTE(!m_allocBlock);
-        m_allocBlock = std::make_shared<_block>(count);
+        {
+            pplx::extensibility::scoped_critical_section_t l(m_lock);
+            if (!m_blocks.empty() && m_blocks.back()->wr_chars_left() >= count)
+            {
+                m_allocBlock = m_blocks.back();
+            }
+            else
+            {
+                m_allocBlock = new_block(count);
+            }
+        }
         return m_allocBlock->wbegin();
     }
 
@@ -164,13 +190,17 @@ public:
     {
         pplx::extensibility::scoped_critical_section_t l(m_lock);
 
-        // The count does not reflect the actual size of the block.
-        // Since we do not allow any more writes to this block it would suffice.
-        // If we ever change the algorithm to reuse blocks then this needs to be revisited.
+        // The count does not reflect the actual size of the block. Any room left after the committed
+        // characters is used by subsequent writes, which keeps the data in order.
 
         _ASSERTE((bool)m_allocBlock);
         m_allocBlock->update_write_head(count);
-        m_blocks.push_back(m_allocBlock);
+
+        // A write block that was drained while the allocation was outstanding has been dropped from the list.
+        if ((m_blocks.empty() || m_blocks.back() != m_allocBlock) && count > 0)
+        {
+            m_blocks.push_back(m_allocBlock);
+        }
         m_allocBlock = nullptr;
 
         update_write_head(count);
@@ -249,12 +279,12 @@ protected:
 
     virtual pplx::task<int_type> _putc(_CharType ch)
     {
-        return pplx::task_from_result((this->write(&ch, 1) == 1) ? static_cast<int_type>(ch) : traits::eof());
+        return complete_write((this->write(&ch, 1) == 1) ? static_cast<int_type>(ch) : traits::eof());
     }
 
     virtual pplx::task<size_t> _putn(const _CharType* ptr, size_t count)
     {
-        return pplx::task_from_result<size_t>(this->write(ptr, count));
+        return complete_write<size_t>(this->write(ptr, count));
     }
 
     virtual pplx::task<size_t> _getn(_Out_writes_(count) _CharType* ptr, _In_ size_t count)
@@ -319,6 +349,23 @@ protected:
     virtual pplx::task<int_type> _ungetc() { return pplx::task_from_result<int_type>(traits::eof()); }
 
 private:
+    /// <summary>
+    /// Close the stream buffer for reading
+    /// </summary>
+    pplx::task<void> _close_read()
+    {
+        this->m_stream_can_read = false;
+
+        {
+            pplx::extensibility::scoped_critical_section_t l(this->m_lock);
+
+            // Nothing will be read any more, so writers have no reason to wait.
+            this->release_writers();
+        }
+
+        return pplx::task_from_result();
+    }
+
     /// <summary>
     /// Close the stream buffer for writing
     /// </summary>
@@ -366,8 +413,7 @@ private:
         // Allocate a new block if necessary
         if (m_blocks.empty() || m_blocks.back()->wr_chars_left() < count)
         {
-            msl::safeint3::SafeInt<size_t> alloc = m_alloc_size.Max(count);
-            m_blocks.push_back(std::make_shared<_block>(alloc));
+            m_blocks.push_back(new_block(count));
         }
 
         // The block at the back is always the write head
@@ -379,6 +425,45 @@ private:
         return countWritten;
     }
 
+    /// <summary>
+    /// Completes a write with the given result, once the buffered data is below the high-water mark.
+    /// </summary>
+    template<typename _ResultType>
+    pplx::task<_ResultType> complete_write(_ResultType result)
+    {
+        pplx::task_completion_event<_ResultType> tce;
+        {
+            pplx::extensibility::scoped_critical_section_t l(m_lock);
+            if (!above_high_water_mark()) return pplx::task_from_result(result);
+
+            m_write_waiters.push([tce, result]() { tce.set(result); });
+        }
+        return pplx::create_task(tce);
+    }
+
+    /// <summary>
+    /// Determine whether writers have to wait for the reader to catch up.
+    /// </summary>
+    /// <remarks>This should be called with the lock held</remarks>
+    bool above_high_water_mark() const
+    {
+        return m_high_water_mark > 0 && m_total >= m_high_water_mark && this->can_read();
+    }
+
+    /// <summary>
+    /// Completes the writes that were waiting for the buffered data to drop below the high-water mark.
+    /// </summary>
+    /// <remarks>This should be called with the lock held</remarks>
+    void release_writers()
+    {
+        while (!m_write_waiters.empty() && !above_high_water_mark())
+        {
+            auto complete = std::move(m_write_waiters.front());
+            m_write_waiters.pop();
+            complete();
+        }
+    }
+
     /// <summary>
     /// Fulfill pending requests
     /// </summary>
@@ -501,6 +586,36 @@ private:
         size_t m_count;
     };
 
+    /// <summary>
+    /// Returns an empty block that can hold at least count characters, reusing a drained block when possible.
+    /// </summary>
+    /// <remarks>This should be called with the lock held</remarks>
+    std::shared_ptr<_block> new_block(size_t count)
+    {
+        if (count <= static_cast<size_t>(m_alloc_size) && !m_free_blocks.empty())
+        {
+            auto block = std::move(m_free_blocks.back());
+            m_free_blocks.pop_back();
+            block->m_read = block->m_pos = 0;
+            return block;
+        }
+
+        msl::safeint3::SafeInt<size_t> alloc = m_alloc_size.Max(count);
+        return std::make_shared<_block>(alloc);
+    }
+
+    /// <summary>
+    /// Keeps a drained block for reuse, as long as it has the default size and the free list is not full.
+    /// </summary>
+    /// <remarks>This should be called with the lock held</remarks>
+    void recycle_block(std::shared_ptr<_block> block)
+    {
+        if (block->m_size == static_cast<size_t>(m_alloc_size) && m_free_blocks.size() < max_free_blocks)
+        {
+            m_free_blocks.push_back(std::move(block));
+        }
+    }
+
     void enqueue_request(_request req)
     {
         pplx::extensibility::scoped_critical_section_t l(m_lock);
@@ -583,9 +698,16 @@ private:
             // If front block is not empty - we are done
             if (m_blocks.front()->rd_chars_left() > 0) break;
 
-            // The block has no more data to be read. Relase the block
+            // The block has no more data to be read. Release the block, keeping its memory for later writes unless a
+            // writer is still filling it through alloc().
+            if (m_blocks.front() != m_allocBlock)
+            {
+                recycle_block(std::move(m_blocks.front()));
+            }
             m_blocks.pop_front();
         }
+
+        release_writers();
     }
 
     // The in/out mode for the buffer
@@ -594,6 +716,9 @@ private:
     // Default block size
     msl::safeint3::SafeInt<size_t> m_alloc_size;
 
+    // The number of buffered characters at which writes wait for the reader; 0 if writes never wait
+    size_t m_high_water_mark;
+
     // Block used for alloc/commit
     std::shared_ptr<_block> m_allocBlock;
 
@@ -620,31 +745,750 @@ private:
 
     // Queue of requests
     std::queue<_request> m_requests;
-};
 
-} // namespace details
+    // Drained blocks of the default size, kept so that steady streaming does not allocate
+    static const size_t max_free_blocks = 8;
+    std::vector<std::shared_ptr<_block>> m_free_blocks;
+
+    // Completions of writes that are waiting for the buffered data to drop below the high-water mark
+    std::queue<std::function<void()>> m_write_waiters;
+};
 
 /// <summary>
-/// The producer_consumer_buffer class serves as a memory-based steam buffer that supports both writing and reading
-/// sequences of bytes. It can be used as a consumer/producer buffer.
+/// The basic_spsc_producer_consumer_buffer class is a producer_consumer_buffer for exactly one writer and one reader.
+/// Writes, and reads of data that has already arrived, proceed without taking a lock; the lock and the request queue
+/// are only used when a read has to wait for data or a write has to wait for the reader to catch up.
 /// </summary>
-/// <typeparam name="_CharType">
-/// The data type of the basic element of the <c>producer_consumer_buffer</c>.
-/// </typeparam>
-/// <remarks>
-/// This is a reference-counted version of basic_producer_consumer_buffer.</remarks>
+/// <remarks>The writer's operations (writes, alloc/commit, sync) must not overlap with each other, and neither must the
+/// reader's, but the two sides may run concurrently on different threads.</remarks>
 template<typename _CharType>
-class producer_consumer_buffer : public streambuf<_CharType>
+class basic_spsc_producer_consumer_buffer : public streams::details::streambuf_state_manager<_CharType>
 {
 public:
-    typedef _CharType char_type;
+    typedef typename ::concurrency::streams::char_traits<_CharType> traits;
+    typedef typename basic_streambuf<_CharType>::int_type int_type;
+    typedef typename basic_streambuf<_CharType>::pos_type pos_type;
+    typedef typename basic_streambuf<_CharType>::off_type off_type;
 
     /// <summary>
-    /// Create a producer_consumer_buffer.
+    /// Constructor
     /// </summary>
-    /// <param name="alloc_size">The internal default block size.</param>
-    producer_consumer_buffer(size_t alloc_size = 512)
-        : streambuf<_CharType>(std::make_shared<details::basic_producer_consumer_buffer<_CharType>>(alloc_size))
+    /// <param name="alloc_size">The default block size.</param>
+    /// <param name="high_water_mark">The number of buffered characters at which writes start waiting for the reader
+    /// to catch up, or 0 to never wait.</param>
+    basic_spsc_producer_consumer_buffer(size_t alloc_size, size_t high_water_mark = 0)
+        : streambuf_state_manager<_CharType>(std::ios_base::out | std::ios_base::in)
+        , m_alloc_size(alloc_size > 0 ? alloc_size : 1)
+        , m_high_water_mark(high_water_mark)
+        , m_first(new _segment(m_alloc_size))
+        , m_tail(m_first)
+        , m_head(m_first)
+        , m_total_read(0)
+        , m_total_written(0)
+        , m_sync_point(0)
+        , m_readers_waiting(false)
+        , m_writers_waiting(false)
+    {
+    }
+
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    virtual ~basic_spsc_producer_consumer_buffer()
+    {
+        // As with basic_producer_consumer_buffer, closing completes synchronously.
+        this->_close_read();
+        this->_close_write();
+
+        _ASSERTE(m_requests.empty());
+
+        // All segments, drained or not, are linked from the oldest one.
+        for (_segment* segment = m_first; segment != nullptr;)
+        {
+            _segment* next = segment->m_next.load(std::memory_order_relaxed);
+            delete segment;
+            segment = next;
+        }
+    }
+
+    /// <summary>
+    /// <c>can_seek<c/> is used to determine whether a stream buffer supports seeking.
+    /// </summary>
+    virtual bool can_seek() const { return false; }
+
+    /// <summary>
+    /// <c>has_size<c/> is used to determine whether a stream buffer supports size().
+    /// </summary>
+    virtual bool has_size() const { return false; }
+
+    /// <summary>
+    /// Get the stream buffer size, if one has been set.
+    /// </summary>
+    /// <param name="direction">The direction of buffering (in or out)</param>
+    /// <remarks>For the output direction this is the size of the blocks that written data is stored in. There is no
+    /// buffering in the input direction, which always returns '0'.</remarks>
+    virtual size_t buffer_size(std::ios_base::openmode direction = std::ios_base::in) const
+    {
+        return direction == std::ios_base::out ? m_alloc_size : 0;
+    }
+
+    /// <summary>
+    /// Sets the stream buffer implementation to buffer or not buffer.
+    /// </summary>
+    /// <param name="size">The size to use for internal buffering, 0 if no buffering should be done.</param>
+    /// <param name="direction">The direction of buffering (in or out)</param>
+    /// <remarks>For the output direction this sets the size of the blocks allocated from then on, and must be called
+    /// by the writer. A size of 0 and calls for the input direction are silently ignored.</remarks>
+    virtual void set_buffer_size(size_t size, std::ios_base::openmode direction = std::ios_base::in)
+    {
+        if (direction == std::ios_base::out && size > 0) m_alloc_size = size;
+    }
+
+    /// <summary>
+    /// For any input stream, <c>in_avail</c> returns the number of characters that are immediately available
+    /// to be consumed without blocking. May be used in conjunction with <cref="::sbumpc method"/> to read data without
+    /// incurring the overhead of using tasks.
+    /// </summary>
+    virtual size_t in_avail() const
+    {
+        // Load the read head first, so that it cannot have overtaken the write head that is loaded.
+        const size_t read = m_total_read.load();
+        return m_total_written.load() - read;
+    }
+
+    /// <summary>
+    /// Gets the current read or write position in the stream.
+    /// </summary>
+    /// <param name="direction">The I/O direction to seek (see remarks)</param>
+    /// <returns>The current position. EOF if the operation fails.</returns>
+    /// <remarks>Some streams may have separate write and read cursors.
+    ///          For such streams, the direction parameter defines whether to move the read or the write
+    ///          cursor.</remarks>
+    virtual pos_type getpos(std::ios_base::openmode mode) const
+    {
+        if (((mode & std::ios_base::in) && !this->can_read()) || ((mode & std::ios_base::out) && !this->can_write()))
+            return static_cast<pos_type>(traits::eof());
+
+        if (mode == std::ios_base::in)
+            return (pos_type)m_total_read.load();
+        else if (mode == std::ios_base::out)
+            return (pos_type)m_total_written.load();
+        else
+            return (pos_type)traits::eof();
+    }
+
+    // Seeking is not supported
+    virtual pos_type seekpos(pos_type, std::ios_base::openmode) { return (pos_type)traits::eof(); }
+    virtual pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode)
+    {
+        return (pos_type)traits::eof();
+    }
+
+    /// <summary>
+    /// Allocates a contiguous memory block and returns it.
+    /// </summary>
+    /// <param name="count">The number of characters to allocate.</param>
+    /// <returns>A pointer to a block to write to, null if the stream buffer implementation does not support
+    /// alloc/commit.</returns>
+    virtual _CharType* _alloc(size_t count)
+    {
+        if (!this->can_write())
+        {
+            return nullptr;
+        }
+
+        if (m_tail->wr_chars_left() < count)
+        {
+            append_segment(count);
+        }
+        return m_tail->wbegin();
+    }
+
+    /// <summary>
+    /// Submits a block already allocated by the stream buffer.
+    /// </summary>
+    /// <param name="count">The number of characters to be committed.</param>
+    virtual void _commit(size_t count)
+    {
+        _ASSERTE(m_tail->wr_chars_left() >= count);
+        m_tail->m_written.store(m_tail->m_written.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        update_write_head(count);
+    }
+
+    /// <summary>
+    /// Gets a pointer to the next already allocated contiguous block of data.
+    /// </summary>
+    /// <param name="ptr">A reference to a pointer variable that will hold the address of the block on success.</param>
+    /// <param name="count">The number of contiguous characters available at the address in 'ptr'.</param>
+    /// <returns><c>true</c> if the operation succeeded, <c>false</c> otherwise.</returns>
+    /// <remarks>
+    /// A return of false does not necessarily indicate that a subsequent read operation would fail, only that
+    /// there is no block to return immediately or that the stream buffer does not support the operation.
+    /// The stream buffer may not de-allocate the block until <see cref="::release method" /> is called.
+    /// If the end of the stream is reached, the function will return <c>true</c>, a null pointer, and a count of zero;
+    /// a subsequent read will not succeed.
+    /// </remarks>
+    virtual bool acquire(_Out_ _CharType*& ptr, _Out_ size_t& count)
+    {
+        count = 0;
+        ptr = nullptr;
+
+        // Reads waiting in the queue are completed by the writer, so do not compete with them.
+        if (!this->can_read() || m_readers_waiting.load()) return false;
+
+        _segment* segment = read_segment();
+        if (segment->rd_chars_left() == 0)
+        {
+            // If the write head has been closed then have reached the end of the
+            // stream (return true), otherwise more data could be written later (return false).
+            if (this->can_write()) return false;
+
+            // Data written before the close may only just have become visible.
+            segment = read_segment();
+            if (segment->rd_chars_left() == 0) return true;
+        }
+
+        count = segment->rd_chars_left();
+        ptr = segment->rbegin();
+        return true;
+    }
+
+    /// <summary>
+    /// Releases a block of data acquired using <see cref="::acquire method"/>. This frees the stream buffer to
+    /// de-allocate the memory, if it so desires. Move the read position ahead by the count.
+    /// </summary>
+    /// <param name="ptr">A pointer to the block of data to be released.</param>
+    /// <param name="count">The number of characters that were read.</param>
+    virtual void release(_Out_writes_opt_(count) _CharType* ptr, _In_ size_t count)
+    {
+        if (ptr == nullptr) return;
+
+        _segment* segment = m_head.load(std::memory_order_relaxed);
+        _ASSERTE(segment->rd_chars_left() >= count);
+        segment->m_read += count;
+
+        update_read_head(count);
+    }
+
+protected:
+    virtual pplx::task<bool> _sync()
+    {
+        // Everything written so far may be read, even by requests for more than that.
+        m_sync_point.store(m_total_written.load());
+        wake_readers();
+        return pplx::task_from_result(true);
+    }
+
+    virtual pplx::task<int_type> _putc(_CharType ch)
+    {
+        return complete_write((this->write(&ch, 1) == 1) ? static_cast<int_type>(ch) : traits::eof());
+    }
+
+    virtual pplx::task<size_t> _putn(const _CharType* ptr, size_t count)
+    {
+        return complete_write<size_t>(this->write(ptr, count));
+    }
+
+    virtual pplx::task<size_t> _getn(_Out_writes_(count) _CharType* ptr, _In_ size_t count)
+    {
+        if (can_read_now(count)) return pplx::task_from_result(this->read(ptr, count));
+
+        pplx::task_completion_event<size_t> tce;
+        enqueue_request(_request(count, [this, ptr, count, tce]() { tce.set(this->read(ptr, count)); }));
+        return pplx::create_task(tce);
+    }
+
+    virtual size_t _sgetn(_Out_writes_(count) _CharType* ptr, _In_ size_t count)
+    {
+        return can_read_now(count) ? this->read(ptr, count) : (size_t)traits::requires_async();
+    }
+
+    virtual size_t _scopy(_Out_writes_(count) _CharType* ptr, _In_ size_t count)
+    {
+        return can_read_now(count) ? this->read(ptr, count, false) : (size_t)traits::requires_async();
+    }
+
+    virtual pplx::task<int_type> _bumpc()
+    {
+        if (can_read_now(1)) return pplx::task_from_result(this->read_byte(true));
+
+        pplx::task_completion_event<int_type> tce;
+        enqueue_request(_request(1, [this, tce]() { tce.set(this->read_byte(true)); }));
+        return pplx::create_task(tce);
+    }
+
+    virtual int_type _sbumpc() { return can_read_now(1) ? this->read_byte(true) : traits::requires_async(); }
+
+    virtual pplx::task<int_type> _getc()
+    {
+        if (can_read_now(1)) return pplx::task_from_result(this->read_byte(false));
+
+        pplx::task_completion_event<int_type> tce;
+        enqueue_request(_request(1, [this, tce]() { tce.set(this->read_byte(false)); }));
+        return pplx::create_task(tce);
+    }
+
+    int_type _sgetc() { return can_read_now(1) ? this->read_byte(false) : traits::requires_async(); }
+
+    virtual pplx::task<int_type> _nextc()
+    {
+        pplx::task_completion_event<int_type> tce;
+        enqueue_request(_request(1, [this, tce]() {
+            this->read_byte(true);
+            tce.set(this->read_byte(false));
+        }));
+        return pplx::create_task(tce);
+    }
+
+    virtual pplx::task<int_type> _ungetc() { return pplx::task_from_result<int_type>(traits::eof()); }
+
+private:
+    /// <summary>
+    /// Close the stream buffer for reading
+    /// </summary>
+    pplx::task<void> _close_read()
+    {
+        this->m_stream_can_read = false;
+
+        {
+            pplx::extensibility::scoped_critical_section_t l(m_writers_lock);
+
+            // Nothing will be read any more, so writers have no reason to wait.
+            release_writers();
+        }
+
+        return pplx::task_from_result();
+    }
+
+    /// <summary>
+    /// Close the stream buffer for writing
+    /// </summary>
+    pplx::task<void> _close_write()
+    {
+        // First indicate that there could be no more writes.
+        // Fulfill outstanding relies on that to flush all the
+        // read requests.
+        this->m_stream_can_write = false;
+
+        {
+            pplx::extensibility::scoped_critical_section_t l(m_lock);
+            fulfill_outstanding();
+        }
+
+        return pplx::task_from_result();
+    }
+
+    /// <summary>
+    /// Represents a memory block. The writer fills it and publishes its write head, the reader consumes it.
+    /// </summary>
+    class _segment
+    {
+    public:
+        _segment(size_t size) : m_next(nullptr), m_written(0), m_read(0), m_size(size), m_data(new _CharType[size]) {}
+
+        ~_segment() { delete[] m_data; }
+
+        // The segment that follows; linked by the writer once it has moved on from this one
+        std::atomic<_segment*> m_next;
+
+        // Write head, published by the writer
+        std::atomic<size_t> m_written;
+
+        // Read head, only used by the reader
+        size_t m_read;
+
+        // Allocation size (of m_data)
+        size_t m_size;
+
+        // The data store
+        _CharType* m_data;
+
+        // Pointer to the read head
+        _CharType* rbegin() { return m_data + m_read; }
+
+        // Pointer to the write head
+        _CharType* wbegin() { return m_data + m_written.load(std::memory_order_relaxed); }
+
+        size_t rd_chars_left() const { return m_written.load(std::memory_order_acquire) - m_read; }
+        size_t wr_chars_left() const { return m_size - m_written.load(std::memory_order_relaxed); }
+
+    private:
+        // Copy is not supported
+        _segment(const _segment&);
+        _segment& operator=(const _segment&);
+    };
+
+    /// <summary>
+    /// Links an empty segment that can hold at least min_size characters after the write head. Only the writer calls
+    /// this.
+    /// </summary>
+    void append_segment(size_t min_size)
+    {
+        // Segments before the reader's head have been drained. Unlink all of them, so that what is kept stays bounded
+        // by what is buffered, and reuse the first one that is large enough.
+        _segment* const head = m_head.load(std::memory_order_acquire);
+
+        _segment* segment = nullptr;
+        while (m_first != head)
+        {
+            _segment* drained = m_first;
+            m_first = drained->m_next.load(std::memory_order_relaxed);
+            if (segment == nullptr && drained->m_size >= min_size)
+            {
+                drained->m_next.store(nullptr, std::memory_order_relaxed);
+                drained->m_written.store(0, std::memory_order_relaxed);
+                drained->m_read = 0;
+                segment = drained;
+            }
+            else
+            {
+                delete drained;
+            }
+        }
+
+        if (segment == nullptr)
+        {
+            segment = new _segment((std::max)(m_alloc_size, min_size));
+        }
+
+        m_tail->m_next.store(segment, std::memory_order_release);
+        m_tail = segment;
+    }
+
+    /// <summary>
+    /// Writes count characters from ptr into the stream buffer. Only the writer calls this.
+    /// </summary>
+    size_t write(const _CharType* ptr, size_t count)
+    {
+        if (!this->can_write() || (count == 0)) return 0;
+
+        // If no one is going to read, why bother?
+        // Just pretend to be writing!
+        if (!this->can_read()) return count;
+
+        size_t written = 0;
+        while (written < count)
+        {
+            if (m_tail->wr_chars_left() == 0)
+            {
+                append_segment(1);
+            }
+
+            const size_t chunk = (std::min)(m_tail->wr_chars_left(), count - written);
+            std::memcpy(m_tail->wbegin(), ptr + written, chunk * sizeof(_CharType));
+            m_tail->m_written.store(m_tail->m_written.load(std::memory_order_relaxed) + chunk,
+                                    std::memory_order_release);
+            written += chunk;
+        }
+
+        update_write_head(count);
+        return count;
+    }
+
+    /// <summary>
+    /// Publishes count newly written characters to the reader.
+    /// </summary>
+    void update_write_head(size_t count)
+    {
+        m_total_written += count;
+        wake_readers();
+    }
+
+    /// <summary>
+    /// Completes the reads that were waiting for data, if there are any.
+    /// </summary>
+    void wake_readers()
+    {
+        // The flag is raised before a waiting reader checks for data a final time, and the data is published before
+        // the flag is checked here, so one of the two sides always sees the other.
+        if (m_readers_waiting.load())
+        {
+            pplx::extensibility::scoped_critical_section_t l(m_lock);
+            fulfill_outstanding();
+        }
+    }
+
+    /// <summary>
+    /// Returns the segment holding the read head, moving past segments that have been read completely. Only the
+    /// reader calls this.
+    /// </summary>
+    _segment* read_segment()
+    {
+        _segment* segment = m_head.load(std::memory_order_relaxed);
+        while (segment->rd_chars_left() == 0)
+        {
+            _segment* next = segment->m_next.load(std::memory_order_acquire);
+
+            // Once the next segment is linked, the writer has finished this one, but may have added to it first.
+            if (next == nullptr || segment->rd_chars_left() != 0) break;
+
+            segment = next;
+            m_head.store(segment, std::memory_order_release);
+        }
+        return segment;
+    }
+
+    /// <summary>
+    /// Reads up to count characters into ptr and returns the count of characters copied.
+    /// The return value (actual characters copied) could be <= count.
+    /// Note: This routine shall only be called if can_satisfy() returned true.
+    /// </summary>
+    size_t read(_Out_writes_(count) _CharType* ptr, _In_ size_t count, bool advance = true)
+    {
+        _ASSERTE(can_satisfy(count));
+
+        _segment* segment = advance ? read_segment() : m_head.load(std::memory_order_relaxed);
+        size_t position = segment->m_read;
+        size_t read = 0;
+        while (read < count)
+        {
+            const size_t available = segment->m_written.load(std::memory_order_acquire) - position;
+            if (available == 0)
+            {
+                _segment* next = segment->m_next.load(std::memory_order_acquire);
+                if (next == nullptr) break;
+                if (segment->m_written.load(std::memory_order_acquire) != position) continue;
+
+                if (advance)
+                {
+                    segment->m_read = position;
+                    m_head.store(next, std::memory_order_release);
+                }
+                segment = next;
+                position = 0;
+                continue;
+            }
+
+            const size_t chunk = (std::min)(available, count - read);
+            std::memcpy(ptr + read, segment->m_data + position, chunk * sizeof(_CharType));
+            position += chunk;
+            read += chunk;
+        }
+
+        if (advance)
+        {
+            segment->m_read = position;
+            update_read_head(read);
+        }
+
+        return read;
+    }
+
+    /// <summary>
+    /// Reads a byte from the stream and returns it as int_type.
+    /// Note: This routine shall only be called if can_satisfy() returned true.
+    /// </summary>
+    int_type read_byte(bool advance = true)
+    {
+        _CharType value;
+        auto read_size = this->read(&value, 1, advance);
+        return read_size == 1 ? static_cast<int_type>(value) : traits::eof();
+    }
+
+    /// <summary>
+    /// Updates the read head by the specified offset
+    /// </summary>
+    void update_read_head(size_t count)
+    {
+        m_total_read += count;
+
+        // As with waiting readers, the writer raises the flag before checking the buffered size a final time.
+        if (m_writers_waiting.load())
+        {
+            pplx::extensibility::scoped_critical_section_t l(m_writers_lock);
+            release_writers();
+        }
+    }
+
+    /// <summary>
+    /// Represents a request on the stream buffer - typically reads
+    /// </summary>
+    class _request
+    {
+    public:
+        typedef std::function<void()> func_type;
+        _request(size_t count, const func_type& func) : m_func(func), m_count(count) {}
+
+        void complete() { m_func(); }
+
+        size_t size() const { return m_count; }
+
+    private:
+        func_type m_func;
+        size_t m_count;
+    };
+
+    /// <summary>
+    /// Determine if the request can be satisfied.
+    /// </summary>
+    bool can_satisfy(size_t count) const
+    {
+        const size_t read = m_total_read.load();
+        return (m_sync_point.load() > read) || (m_total_written.load() - read >= count) || !this->can_write();
+    }
+
+    /// <summary>
+    /// Determine if a read can be completed right away, without the lock.
+    /// </summary>
+    bool can_read_now(size_t count) const { return !m_readers_waiting.load() && can_satisfy(count); }
+
+    void enqueue_request(_request req)
+    {
+        pplx::extensibility::scoped_critical_section_t l(m_lock);
+
+        // Queue the request first, so that the writer knows to complete it once data arrives.
+        m_requests.push(req);
+        m_readers_waiting = true;
+        fulfill_outstanding();
+    }
+
+    /// <summary>
+    /// Fulfill pending requests
+    /// </summary>
+    /// <remarks>This should be called with the lock held</remarks>
+    void fulfill_outstanding()
+    {
+        while (!m_requests.empty())
+        {
+            auto req = m_requests.front();
+
+            // If we cannot satisfy the request then we need
+            // to wait for the producer to write data
+            if (!can_satisfy(req.size())) return;
+
+            // We have enough data to satisfy this request
+            req.complete();
+
+            // Remove it from the request queue
+            m_requests.pop();
+        }
+
+        m_readers_waiting = false;
+    }
+
+    /// <summary>
+    /// Completes a write with the given result, once the buffered data is below the high-water mark.
+    /// </summary>
+    template<typename _ResultType>
+    pplx::task<_ResultType> complete_write(_ResultType result)
+    {
+        if (!above_high_water_mark()) return pplx::task_from_result(result);
+
+        pplx::task_completion_event<_ResultType> tce;
+        {
+            pplx::extensibility::scoped_critical_section_t l(m_writers_lock);
+            m_write_waiters.push([tce, result]() { tce.set(result); });
+            m_writers_waiting = true;
+
+            // The reader may have caught up before it could see the flag.
+            release_writers();
+        }
+        return pplx::create_task(tce);
+    }
+
+    /// <summary>
+    /// Determine whether writers have to wait for the reader to catch up.
+    /// </summary>
+    bool above_high_water_mark() const
+    {
+        return m_high_water_mark > 0 && in_avail() >= m_high_water_mark && this->can_read();
+    }
+
+    /// <summary>
+    /// Completes the writes that were waiting for the buffered data to drop below the high-water mark.
+    /// </summary>
+    /// <remarks>This should be called with the writers lock held</remarks>
+    void release_writers()
+    {
+        while (!m_write_waiters.empty() && !above_high_water_mark())
+        {
+            auto complete = std::move(m_write_waiters.front());
+            m_write_waiters.pop();
+            complete();
+        }
+
+        if (m_write_waiters.empty()) m_writers_waiting = false;
+    }
+
+    // Default block size
+    size_t m_alloc_size;
+
+    // The number of buffered characters at which writes wait for the reader; 0 if writes never wait
+    size_t m_high_water_mark;
+
+    // The oldest segment not yet released, and the write head segment. Only used by the writer.
+    _segment* m_first;
+    _segment* m_tail;
+
+    // The read head segment; set by the reader
+    std::atomic<_segment*> m_head;
+
+    std::atomic<size_t> m_total_read;
+    std::atomic<size_t> m_total_written;
+
+    // Everything written before this point was flushed, and may be read by requests for more than is available.
+    std::atomic<size_t> m_sync_point;
+
+    // Raised while reads wait in the request queue, or writes wait for the reader.
+    std::atomic<bool> m_readers_waiting;
+    std::atomic<bool> m_writers_waiting;
+
+    // Protects the queue of waiting reads. Only taken when a read has to wait.
+    pplx::extensibility::critical_section_t m_lock;
+    std::queue<_request> m_requests;
+
+    // Protects the queue of waiting writes. Taken after m_lock when both are needed.
+    pplx::extensibility::critical_section_t m_writers_lock;
+    std::queue<std::function<void()>> m_write_waiters;
+};
+
+} // namespace details
+
+/// <summary>
+/// The producer_consumer_buffer class serves as a memory-based steam buffer that supports both writing and reading
+/// sequences of bytes. It can be used as a consumer/producer buffer.
+/// </summary>
+/// <typeparam name="_CharType">
+/// The data type of the basic element of the <c>producer_consumer_buffer</c>.
+/// </typeparam>
+/// <remarks>
+/// This is a reference-counted version of basic_producer_consumer_buffer.</remarks>
+template<typename _CharType>
+class producer_consumer_buffer : public streambuf<_CharType>
+{
+public:
+    typedef _CharType char_type;
+
+    /// <summary>
+    /// Create a producer_consumer_buffer.
+    /// </summary>
+    /// <param name="alloc_size">The internal default block size.</param>
+    /// <param name="high_water_mark">The number of buffered characters at which the tasks returned by writes stop
+    /// completing until the reader has consumed enough data, or 0 to never hold writers back.</param>
+    producer_consumer_buffer(size_t alloc_size = 512, size_t high_water_mark = 0)
+        : streambuf<_CharType>(
+              std::make_shared<details::basic_producer_consumer_buffer<_CharType>>(alloc_size, high_water_mark))
+    {
+    }
+
+    /// <summary>
+    /// Create a producer_consumer_buffer for exactly one writer and one reader. Writes, and reads of data that has
+    /// already been written, do not take a lock.
+    /// </summary>
+    /// <param name="alloc_size">The internal default block size.</param>
+    /// <param name="high_water_mark">The number of buffered characters at which the tasks returned by writes stop
+    /// completing until the reader has consumed enough data, or 0 to never hold writers back.</param>
+    /// <remarks>Each side may be used from any thread, as long as its operations do not overlap, for example when
+    /// each operation is started from the continuation of the previous one.</remarks>
+    static producer_consumer_buffer single_producer_consumer(size_t alloc_size = 512, size_t high_water_mark = 0)
+    {
+        return producer_consumer_buffer(
+            std::make_shared<details::basic_spsc_producer_consumer_buffer<_CharType>>(alloc_size, high_water_mark));
+    }
+
+private:
+    producer_consumer_buffer(const std::shared_ptr<details::basic_streambuf<_CharType>>& ptr)
+        : streambuf<_CharType>(ptr)
     {
     }
 };
@@ -16,7 +16,11 @@
 #define CASA_STREAMS_H
 
 #include "cpprest/astreambuf.h"
+#include <algorithm>
+#include <cstring>
 #include <iosfwd>
+#include <limits>
+#include <type_traits>
 
 namespace Concurrency
 {
@@ -92,8 +96,133 @@ static const char* _in_stream_msg = "stream not set up for input of data";
 static const char* _in_streambuf_msg = "stream buffer not set up for input of data";
 static const char* _out_stream_msg = "stream not set up for output of data";
 static const char* _out_streambuf_msg = "stream buffer not set up for output of data";
+
+/// <summary>
+/// Returns the offset of the first <c>ch</c> among the <c>count</c> characters at <c>data</c>, or <c>count</c>.
+/// </summary>
+template<typename CharType>
+size_t _find_char(const CharType* data, size_t count, CharType ch)
+{
+    return static_cast<size_t>(std::find(data, data + count, ch) - data);
+}
+
+inline size_t _find_char(const char* data, size_t count, char ch)
+{
+    auto found = static_cast<const char*>(std::memchr(data, ch, count));
+    return found == nullptr ? count : static_cast<size_t>(found - data);
+}
+
+inline size_t _find_char(const uint8_t* data, size_t count, uint8_t ch)
+{
+    auto found = static_cast<const uint8_t*>(std::memchr(data, ch, count));
+    return found == nullptr ? count : static_cast<size_t>(found - data);
+}
+
+/// <summary>
+/// Moves up to <c>count</c> characters from <c>source</c> to <c>target</c>. Characters are written straight from
+/// the source's memory when it can be acquired, or read straight into memory allocated by the target; only when
+/// neither buffer exposes its memory are they staged in <c>scratch</c>, which is allocated if null.
+/// </summary>
+template<typename CharType>
+pplx::task<size_t> _transfer(streams::streambuf<CharType> source,
+                             streams::streambuf<CharType> target,
+                             size_t count,
+                             std::shared_ptr<CharType> scratch,
+                             size_t scratch_size)
+{
+    if (count == 0) return pplx::task_from_result<size_t>(0);
+
+    CharType* data = nullptr;
+    size_t available = 0;
+    if (source.acquire(data, available))
+    {
+        if (data == nullptr || available == 0)
+        {
+            // The source has reached its end.
+            source.release(data, 0);
+            return pplx::task_from_result<size_t>(0);
+        }
+
+        const size_t chunk = (std::min)(count, available);
+        return target.putn_nocopy(data, chunk).then([source, data, chunk](pplx::task<size_t> op) mutable -> size_t {
+            size_t written = 0;
+            try
+            {
+                written = op.get();
+            }
+            catch (...)
+            {
+                source.release(data, 0);
+                throw;
+            }
+            source.release(data, written);
+            if (written != chunk) throw std::runtime_error("failed to write all bytes");
+            return written;
+        });
+    }
+
+    // Only what the source already holds is read into target memory, so that the allocation is fully committed.
+    const size_t buffered = (std::min)(count, source.in_avail());
+    if (buffered > 0)
+    {
+        CharType* space = target.alloc(buffered);
+        if (space != nullptr)
+        {
+            return source.getn(space, buffered).then([target](pplx::task<size_t> op) mutable -> size_t {
+                size_t read = 0;
+                try
+                {
+                    read = op.get();
+                }
+                catch (...)
+                {
+                    target.commit(0);
+                    throw;
+                }
+                target.commit(read);
+                return read;
+            });
+        }
+    }
+
+    if (!scratch)
+    {
+        scratch_size = (std::min)(count, static_cast<size_t>(16 * 1024));
+        scratch = std::shared_ptr<CharType>(new CharType[scratch_size], [](CharType* buf) { delete[] buf; });
+    }
+    return source.getn(scratch.get(), (std::min)(count, scratch_size))
+        .then([target, scratch](size_t read) mutable -> pplx::task<size_t> {
+            if (read == 0) return pplx::task_from_result<size_t>(0);
+            return target.putn_nocopy(scratch.get(), read).then([scratch, read](size_t written) -> size_t {
+                if (written != read) throw std::runtime_error("failed to write all bytes");
+                return written;
+            });
+        });
+}
 } // namespace details
 
+/// <summary>
+/// Moves up to <c>count</c> characters from one stream buffer to another. When either buffer exposes its memory,
+/// as container, raw pointer, producer/consumer and memory-mapped buffers do, the characters are copied only once.
+/// </summary>
+/// <param name="source">A stream buffer supporting read operations.</param>
+/// <param name="target">A stream buffer supporting write operations.</param>
+/// <param name="count">The maximum number of characters to move.</param>
+/// <returns>A <c>task</c> that holds the number of characters moved. Like a single read, this may be fewer than
+/// <c>count</c> before the end of the source is reached, where it is 0.</returns>
+template<typename CharType>
+pplx::task<size_t> transfer(streambuf<CharType> source, streambuf<CharType> target, size_t count)
+{
+    if (!source.can_read())
+        return pplx::task_from_exception<size_t>(
+            std::make_exception_ptr(std::runtime_error(details::_in_streambuf_msg)));
+    if (!target.can_write())
+        return pplx::task_from_exception<size_t>(
+            std::make_exception_ptr(std::runtime_error(details::_out_streambuf_msg)));
+
+    return details::_transfer(source, target, count, std::shared_ptr<CharType>(), 0);
+}
+
 /// <summary>
 /// Base interface for all asynchronous output streams.
 /// </summary>
@@ -805,7 +934,23 @@ public:
             return true;
         };
 
+        // Only a delimiter that some character widens to can be searched for as a character.
+        typedef typename std::make_unsigned<CharType>::type uchar_type;
+        const bool delim_is_char = delim == static_cast<int_type>(static_cast<uchar_type>(delim));
+
         auto loop = pplx::details::_do_while([=]() mutable -> pplx::task<bool> {
+            // Blocks the buffer exposes are searched for the delimiter and copied a run at a time.
+            CharType* data = nullptr;
+            size_t available = 0;
+            if (delim_is_char && buffer.acquire(data, available) && data != nullptr && available > 0)
+            {
+                const size_t run = details::_find_char(data, available, static_cast<CharType>(delim));
+                const bool found = run < available;
+                _locals->append(data, run, buffer, flush);
+                buffer.release(data, found ? run + 1 : run);
+                return pplx::task_from_result(!found);
+            }
+
             while (buffer.in_avail() > 0)
             {
                 int_type ch = buffer.sbumpc();
@@ -887,6 +1032,36 @@ public:
         };
 
         auto loop = pplx::details::_do_while([=]() mutable -> pplx::task<bool> {
+            // Blocks the buffer exposes are searched for the line end and copied a run at a time.
+            CharType* data = nullptr;
+            size_t available = 0;
+            if (!_locals->saw_CR && buffer.acquire(data, available) && data != nullptr && available > 0)
+            {
+                size_t run = details::_find_char(data, available, CharType('\n'));
+                run = details::_find_char(data, run, CharType('\r'));
+                _locals->append(data, run, buffer, flush);
+                if (run == available)
+                {
+                    buffer.release(data, run);
+                    return pplx::task_from_result(true);
+                }
+
+                size_t consumed = run + 1;
+                if (data[run] == CharType('\r'))
+                {
+                    if (consumed == available)
+                    {
+                        // A newline may follow in the next block.
+                        _locals->saw_CR = true;
+                        buffer.release(data, consumed);
+                        return pplx::task_from_result(true);
+                    }
+                    if (data[consumed] == CharType('\n')) ++consumed;
+                }
+                buffer.release(data, consumed);
+                return pplx::task_from_result(false);
+            }
+
             while (buffer.in_avail() > 0)
             {
                 int_type ch;
@@ -938,24 +1113,15 @@ public:
         auto copy_to_target = [l_locals, target, l_buffer, l_buf_size]() mutable -> pplx::task<bool> {
             // We need to capture these, because the object itself may go away
             // before we're done processing the data.
-            // auto locs = _locals;
-            // auto trg = target;
-
-            return l_buffer.getn(l_locals->outbuf, l_buf_size).then([=](size_t rd) mutable -> pplx::task<bool> {
-                if (rd == 0) return pplx::task_from_result(false);
-
-                // Must be nested to capture rd
-                return target.putn_nocopy(l_locals->outbuf, rd)
-                    .then([target, l_locals, rd](size_t wr) mutable -> pplx::task<bool> {
-                        l_locals->total += wr;
-
-                        if (rd != wr)
-                            // Number of bytes written is less than number of bytes received.
-                            throw std::runtime_error("failed to write all bytes");
-
-                        return target.sync().then([]() { return true; });
-                    });
-            });
+            // Memory exposed by either buffer is used directly, outbuf only stages data otherwise.
+            std::shared_ptr<CharType> scratch(l_locals, l_locals->outbuf);
+            return details::_transfer(l_buffer, target, (std::numeric_limits<size_t>::max)(), scratch, l_buf_size)
+                .then([target, l_locals](size_t wr) mutable -> pplx::task<bool> {
+                    if (wr == 0) return pplx::task_from_result(false);
+
+                    l_locals->total += wr;
+                    return target.sync().then([]() { return true; });
+                });
         };
 
         auto loop = pplx::details::_do_while(copy_to_target);
@@ -1084,6 +1250,32 @@ private:
 
         bool is_full() const { return write_pos == buf_size; }
 
+        // Copies a run of characters acquired from 'source' to the output buffer, flushing it as it fills. On
+        // failure, the acquired block is released and only the characters already copied are consumed.
+        template<typename Flush>
+        void append(const CharType* data, size_t count, streams::streambuf<CharType>& source, Flush& flush)
+        {
+            size_t copied = 0;
+            try
+            {
+                while (copied < count)
+                {
+                    const size_t chunk = (std::min)(count - copied, buf_size - write_pos);
+                    std::memcpy(outbuf + write_pos, data + copied, chunk * sizeof(CharType));
+                    write_pos += chunk;
+                    copied += chunk;
+
+                    // Flushing synchronously, as the per-character paths do.
+                    if (is_full()) flush().get();
+                }
+            }
+            catch (...)
+            {
+                source.release(const_cast<CharType*>(data), copied);
+                throw;
+            }
+        }
+
         _read_helper() : total(0), write_pos(0), saw_CR(false) {}
     };
 
@@ -23,6 +23,7 @@
 #include "cpprest/uri.h"
 #include "cpprest/ws_msg.h"
 #include "pplx/pplxtasks.h"
+#include <chrono>
 #include <condition_variable>
 #include <limits>
 #include <memory>
@@ -58,6 +59,98 @@ enum class websocket_close_status
     server_terminate = 1011,
 };
 
+/// <summary>
+/// Parameters offered for the permessage-deflate extension (RFC 7692), which compresses the payload of each message.
+/// The server may accept the extension with these parameters or tighter ones, or decline it.
+/// </summary>
+class websocket_deflate_options
+{
+public:
+    /// <summary>
+    /// Creates options that offer the extension with the largest windows, and with context takeover both ways.
+    /// </summary>
+    websocket_deflate_options()
+        : m_client_no_context_takeover(false)
+        , m_server_no_context_takeover(false)
+        , m_client_max_window_bits(15)
+        , m_server_max_window_bits(15)
+    {
+    }
+
+    /// <summary>
+    /// Get whether the client compresses each message on its own
+    /// </summary>
+    /// <returns>True if the client does not use earlier messages to compress later ones.</returns>
+    bool client_no_context_takeover() const { return m_client_no_context_takeover; }
+
+    /// <summary>
+    /// Set whether the client compresses each message on its own
+    /// </summary>
+    /// <param name="value">True to keep no compression state from one message to the next, which saves memory at
+    /// the cost of ratio. This is offered as a hint, and applies once the server's response includes it.</param>
+    void set_client_no_context_takeover(bool value) { m_client_no_context_takeover = value; }
+
+    /// <summary>
+    /// Get whether the server is asked to compress each message on its own
+    /// </summary>
+    /// <returns>True if the server is asked not to use earlier messages to compress later ones.</returns>
+    bool server_no_context_takeover() const { return m_server_no_context_takeover; }
+
+    /// <summary>
+    /// Set whether the server is asked to compress each message on its own
+    /// </summary>
+    /// <param name="value">True to ask the server to keep no compression state from one message to the next.</param>
+    void set_server_no_context_takeover(bool value) { m_server_no_context_takeover = value; }
+
+    /// <summary>
+    /// Get the base-2 logarithm of the largest window the client compresses with
+    /// </summary>
+    /// <returns>The window size, from 9 to 15.</returns>
+    uint8_t client_max_window_bits() const { return m_client_max_window_bits; }
+
+    /// <summary>
+    /// Set the base-2 logarithm of the largest window the client compresses with
+    /// </summary>
+    /// <param name="bits">The window size, from 9 to 15. This is offered as a hint, and applies once the server's
+    /// response includes it. The server may ask for a smaller one.</param>
+    void set_client_max_window_bits(uint8_t bits)
+    {
+        check_window_bits(bits);
+        m_client_max_window_bits = bits;
+    }
+
+    /// <summary>
+    /// Get the base-2 logarithm of the largest window the server is asked to compress with
+    /// </summary>
+    /// <returns>The window size, from 9 to 15.</returns>
+    uint8_t server_max_window_bits() const { return m_server_max_window_bits; }
+
+    /// <summary>
+    /// Set the base-2 logarithm of the largest window the server is asked to compress with
+    /// </summary>
+    /// <param name="bits">The window size, from 9 to 15. Smaller windows take less memory to decompress.</param>
+    void set_server_max_window_bits(uint8_t bits)
+    {
+        check_window_bits(bits);
+        m_server_max_window_bits = bits;
+    }
+
+private:
+    // RFC 7692 allows 8 as well, but zlib does not compress with a window that small
+    static void check_window_bits(uint8_t bits)
+    {
+        if (bits < 9 || bits > 15)
+        {
+            throw std::invalid_argument("window bits must be in the range 9 to 15");
+        }
+    }
+
+    bool m_client_no_context_takeover;
+    bool m_server_no_context_takeover;
+    uint8_t m_client_max_window_bits;
+    uint8_t m_server_max_window_bits;
+};
+
 /// <summary>
 /// Websocket client configuration class, used to set the possible configuration options
 /// used to create an websocket_client instance.
@@ -68,7 +161,10 @@ public:
     /// <summary>
     /// Creates a websocket client configuration with default settings.
     /// </summary>
-    websocket_client_config() : m_sni_enabled(true), m_validate_certificates(true) {}
+    websocket_client_config()
+        : m_sni_enabled(true), m_validate_certificates(true), m_permessage_deflate(false), m_send_coalescing_delay(0)
+    {
+    }
 
     /// <summary>
     /// Get the web proxy object
@@ -168,6 +264,45 @@ public:
     /// caution.</remarks>
     void set_validate_certificates(bool validate_certs) { m_validate_certificates = validate_certs; }
 
+    /// <summary>
+    /// Gets whether the permessage-deflate extension is offered to the server.
+    /// </summary>
+    /// <returns>True if message payloads are compressed when the server accepts it, false otherwise.</returns>
+    bool permessage_deflate() const { return m_permessage_deflate; }
+
+    /// <summary>
+    /// Sets whether the permessage-deflate extension is offered to the server. Default is off.
+    /// </summary>
+    /// <param name="enabled">True to offer the extension.</param>
+    /// <param name="options">The parameters offered with it.</param>
+    /// <remarks>The extension is supported by the WebSocket++ based client only.</remarks>
+    void set_permessage_deflate(bool enabled, websocket_deflate_options options = websocket_deflate_options())
+    {
+        m_permessage_deflate = enabled;
+        m_deflate_options = options;
+    }
+
+    /// <summary>
+    /// Gets the parameters offered with the permessage-deflate extension.
+    /// </summary>
+    /// <returns>The parameters.</returns>
+    const websocket_deflate_options& permessage_deflate_options() const { return m_deflate_options; }
+
+    /// <summary>
+    /// Gets how long a small message may wait for more messages to be sent in the same write.
+    /// </summary>
+    /// <returns>The delay; zero if messages are sent as soon as possible.</returns>
+    std::chrono::milliseconds send_coalescing_delay() const { return m_send_coalescing_delay; }
+
+    /// <summary>
+    /// Sets how long a small message may wait for more messages to be sent in the same write. Default is zero.
+    /// </summary>
+    /// <param name="delay">The longest a small message is held back.</param>
+    /// <remarks>With a delay, messages queued while others are being sent are written together, and bursts of small
+    /// messages share writes even when the connection is idle, at the cost of their latency. Without one, each
+    /// message is written on its own. It is supported by the WebSocket++ based client only.</remarks>
+    void set_send_coalescing_delay(std::chrono::milliseconds delay) { m_send_coalescing_delay = delay; }
+
 private:
     web::web_proxy m_proxy;
     web::credentials m_credentials;
@@ -175,6 +310,9 @@ private:
     bool m_sni_enabled;
     utf8string m_sni_hostname;
     bool m_validate_certificates;
+    bool m_permessage_deflate;
+    websocket_deflate_options m_deflate_options;
+    std::chrono::milliseconds m_send_coalescing_delay;
 };
 
 /// <summary>
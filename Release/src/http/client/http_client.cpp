@@ -118,6 +118,20 @@ bool request_context::handle_compression()
             // we don't need to look for it here because winhttp de-chunks for us in that case
             m_decompressor = compression::details::get_decompressor_from_header(
                 encoding, compression::details::header_types::content_encoding, m_request.decompress_factories());
+
+            // The body may have been compressed with one of the dictionaries offered in the request
+            utility::string_t dictionary_id;
+            if (m_decompressor && headers.match(web::http::header_names::content_dictionary, dictionary_id))
+            {
+                auto dict = compression::details::find_dictionary(
+                    dictionary_id, m_http_client->client_config().compression_dictionaries());
+                m_decompressor =
+                    dict ? compression::builtin::make_decompressor(m_decompressor->algorithm(), dict) : nullptr;
+                if (!m_decompressor)
+                {
+                    throw http_exception(U("Response body compressed with an unknown dictionary"));
+                }
+            }
         }
         else if (!m_request.decompress_factories().empty() &&
                  headers.match(web::http::header_names::transfer_encoding, encoding))
@@ -150,6 +164,14 @@ utility::string_t request_context::get_compression_header() const
             headers.append(compression::details::build_supported_header(
                 compression::details::header_types::accept_encoding, m_request.decompress_factories()));
             headers.append(U("\r\n"));
+
+            const auto& dictionaries = m_http_client->client_config().compression_dictionaries();
+            if (!dictionaries.empty())
+            {
+                headers.append(header_names::dictionary_id + U(": "));
+                headers.append(compression::details::build_dictionary_header(dictionaries));
+                headers.append(U("\r\n"));
+            }
         }
     }
     else if (!m_request.decompress_factories().empty())
@@ -520,6 +520,11 @@ public:
         , m_content_length(0)
         , m_needChunked(false)
         , m_timer(client->client_config().timeout<std::chrono::microseconds>())
+        , m_decompress_space(0)
+        , m_compress_read(0)
+        , m_compress_used(0)
+        , m_compress_eof(false)
+        , m_compress_done(false)
         , m_connection(connection)
 #ifdef CPPREST_PLATFORM_ASIO_CERT_VERIFICATION_AVAILABLE
         , m_openssl_failed(false)
@@ -814,8 +819,24 @@ public:
 
             // Check user specified transfer-encoding.
             std::string transferencoding;
-            if (ctx->m_request.headers().match(header_names::transfer_encoding, transferencoding) &&
-                boost::icontains(transferencoding, U("chunked")))
+            if (ctx->m_request.body() && ctx->m_request.compressor())
+            {
+                // The compressed length is not known up front, so the body is sent in chunks; this also checks any
+                // Transfer-Encoding the user set against the compressor's
+                try
+                {
+                    ctx->m_request._get_impl()->_get_content_length_and_set_compression();
+                }
+                catch (...)
+                {
+                    ctx->report_exception(std::current_exception());
+                    return;
+                }
+                ctx->m_request.headers().remove(header_names::content_length);
+                ctx->m_needChunked = true;
+            }
+            else if (ctx->m_request.headers().match(header_names::transfer_encoding, transferencoding) &&
+                     boost::icontains(transferencoding, U("chunked")))
             {
                 ctx->m_needChunked = true;
             }
@@ -1116,7 +1137,11 @@ private:
         }
         else
         {
-            if (m_needChunked)
+            if (m_request.compressor())
+            {
+                handle_write_compressed_body(ec);
+            }
+            else if (m_needChunked)
             {
                 handle_write_chunked_body(ec);
             }
@@ -1190,6 +1215,121 @@ private:
             });
     }
 
+    void handle_write_compressed_body(const boost::system::error_code& ec)
+    {
+        if (ec)
+        {
+            // Reuse error handling.
+            return handle_write_body(ec);
+        }
+
+        m_timer.reset();
+        const auto& progress = m_request._get_impl()->_progress_handler();
+        if (progress)
+        {
+            try
+            {
+                (*progress)(message_direction::upload, m_uploaded);
+            }
+            catch (...)
+            {
+                report_exception(std::current_exception());
+                return;
+            }
+        }
+
+        const auto chunkSize = m_http_client->client_config().chunksize();
+        const auto this_request = shared_from_this();
+        if (m_compress_done)
+        {
+            // All of the compressed body is out; only the last, empty chunk is left to send
+            uint8_t* buf = boost::asio::buffer_cast<uint8_t*>(
+                m_body_buf.prepare(http::details::chunked_encoding::additional_encoding_space));
+            const size_t offset = http::details::chunked_encoding::add_chunked_delimiters(
+                buf, http::details::chunked_encoding::additional_encoding_space, 0);
+            m_body_buf.commit(http::details::chunked_encoding::additional_encoding_space);
+            m_body_buf.consume(offset);
+            m_connection->async_write(
+                m_body_buf,
+                boost::bind(&asio_context::handle_write_body, this_request, boost::asio::placeholders::error));
+            return;
+        }
+
+        // More of the body is read only once the compressor has taken all that was read before
+        const bool reading = m_compress_used == m_compress_read && !m_compress_eof;
+        pplx::task<size_t> read = pplx::task_from_result<size_t>(0);
+        if (reading)
+        {
+            m_compress_input.resize(chunkSize);
+            read = _get_readbuffer().getn(m_compress_input.data(), chunkSize);
+        }
+        read.then([this_request, chunkSize, reading](pplx::task<size_t> op) -> pplx::task<void> {
+            size_t readSize = 0;
+            try
+            {
+                readSize = op.get();
+            }
+            catch (...)
+            {
+                this_request->report_exception(std::current_exception());
+                return pplx::task_from_result();
+            }
+
+            if (reading)
+            {
+                this_request->m_compress_read = readSize;
+                this_request->m_compress_used = 0;
+                this_request->m_compress_eof = readSize == 0;
+                this_request->m_uploaded += static_cast<uint64_t>(readSize);
+            }
+
+            uint8_t* buf = boost::asio::buffer_cast<uint8_t*>(this_request->m_body_buf.prepare(
+                chunkSize + http::details::chunked_encoding::additional_encoding_space));
+            const auto hint = this_request->m_compress_eof ? http::compression::operation_hint::is_last
+                                                           : http::compression::operation_hint::has_more;
+            return this_request->m_request.compressor()
+                ->compress(this_request->m_compress_input.data() + this_request->m_compress_used,
+                           this_request->m_compress_read - this_request->m_compress_used,
+                           buf + http::details::chunked_encoding::data_offset,
+                           chunkSize,
+                           hint)
+                .then([this_request, buf, chunkSize, hint](pplx::task<http::compression::operation_result> op) {
+                    http::compression::operation_result result;
+                    try
+                    {
+                        result = op.get();
+                    }
+                    catch (...)
+                    {
+                        this_request->report_exception(std::current_exception());
+                        return;
+                    }
+
+                    this_request->m_compress_used += result.input_bytes_processed;
+                    this_request->m_compress_done =
+                        hint == http::compression::operation_hint::is_last && result.done;
+                    if (result.output_bytes_produced == 0)
+                    {
+                        // The compressor kept what it was given; go on with the next part of the body
+                        this_request->handle_write_compressed_body(boost::system::error_code());
+                        return;
+                    }
+
+                    const size_t offset = http::details::chunked_encoding::add_chunked_delimiters(
+                        buf,
+                        chunkSize + http::details::chunked_encoding::additional_encoding_space,
+                        result.output_bytes_produced);
+                    this_request->m_body_buf.commit(result.output_bytes_produced +
+                                                    http::details::chunked_encoding::additional_encoding_space);
+                    this_request->m_body_buf.consume(offset);
+                    this_request->m_connection->async_write(this_request->m_body_buf,
+                                                            boost::bind(&asio_context::handle_write_compressed_body,
+                                                                        this_request,
+                                                                        boost::asio::placeholders::error));
+                });
+        });
+    }
+
     void handle_write_large_body(const boost::system::error_code& ec)
     {
         if (ec || m_uploaded >= m_content_length)
@@ -1217,6 +1357,27 @@ private:
         const auto readSize = static_cast<size_t>(
             std::min(static_cast<uint64_t>(m_http_client->client_config().chunksize()), m_content_length - m_uploaded));
         auto readbuf = _get_readbuffer();
+
+        // Bodies that expose their storage, such as a response body being forwarded by a proxy, are written to the
+        // socket in place.
+        uint8_t* block = nullptr;
+        size_t available = 0;
+        if (readbuf.acquire(block, available) && block != nullptr && available > 0)
+        {
+            const auto writeSize = std::min(available, readSize);
+            auto buffer = boost::asio::buffer(static_cast<const uint8_t*>(block), writeSize);
+            m_connection->async_write(
+                buffer,
+                [this_request, readbuf, block, writeSize AND_CAPTURE_MEMBER_FUNCTION_POINTERS](
+                    const boost::system::error_code& ec, std::size_t) {
+                    auto buf = readbuf;
+                    buf.release(block, ec ? 0 : writeSize);
+                    if (!ec) this_request->m_uploaded += static_cast<uint64_t>(writeSize);
+                    this_request->handle_write_large_body(ec);
+                });
+            return;
+        }
+
         readbuf.getn(boost::asio::buffer_cast<uint8_t*>(m_body_buf.prepare(readSize)), readSize)
             .then([this_request AND_CAPTURE_MEMBER_FUNCTION_POINTERS](pplx::task<size_t> op) {
                 try
@@ -1356,6 +1517,10 @@ private:
                     // connection re-establishment transparently. I.e. report the exception
                     // to the calling code.
                     instream.seek(0);
+                    if (new_ctx->m_request.compressor())
+                    {
+                        new_ctx->m_request.compressor()->reset();
+                    }
                 }
                 catch (...)
                 {
@@ -1425,6 +1590,13 @@ private:
             return;
         }
 
+        // The body is stored in as few blocks as its length allows. A compressed body's length says little about
+        // its decompressed size, so it is not used as a hint.
+        if (!m_decompressor && m_content_length != std::numeric_limits<size_t>::max())
+        {
+            m_response._get_impl()->_set_body_size_hint(m_content_length);
+        }
+
         complete_headers();
 
         // Check for HEAD requests and status codes which cannot contain a
@@ -1522,14 +1694,16 @@ private:
         }
     }
 
-    bool decompress(const uint8_t* input, size_t input_size, std::vector<uint8_t>& output)
+    // Decompresses part of the response body into the body stream buffer. The buffer created for the response, when
+    // the caller did not supply a stream, hands out blocks to decompress into directly. Other stream buffers are
+    // written from m_decompressed, which is reused for each part and outlives the returned task, since the next part
+    // is only read once the task completes.
+    // Blocks are of a fixed size, and each part continues where the previous one stopped in the last block, so the
+    // buffer is filled block by block whatever the size of the parts.
+    pplx::task<size_t> decompress(concurrency::streams::streambuf<uint8_t> writeBuffer,
+                                  const uint8_t* input,
+                                  size_t input_size)
     {
-        // Need to guard against attempting to decompress when we're already finished or encountered an error!
-        if (input == nullptr || input_size == 0)
-        {
-            return false;
-        }
-
         size_t processed;
         size_t got;
         size_t inbytes = 0;
@@ -1538,31 +1712,80 @@ private:
 
         try
         {
-            output.resize(input_size * 3);
+            // Need to guard against attempting to decompress when we're already finished or encountered an error!
+            if (input == nullptr || input_size == 0)
+            {
+                throw std::runtime_error("No compressed data");
+            }
+
+            if (!m_request._get_impl()->_response_stream())
+            {
+                do
+                {
+                    // Only this context writes to the buffer, so the space left in the last block is still there.
+                    const size_t size =
+                        m_decompress_space >= min_decompress_space ? m_decompress_space : size_t(decompress_block_size);
+                    uint8_t* block = writeBuffer.alloc(size);
+                    if (block == nullptr)
+                    {
+                        throw std::runtime_error("Cannot write to the response body");
+                    }
+
+                    try
+                    {
+                        got = m_decompressor->decompress(input + inbytes,
+                                                         input_size - inbytes,
+                                                         block,
+                                                         size,
+                                                         web::http::compression::operation_hint::has_more,
+                                                         processed,
+                                                         done);
+                    }
+                    catch (...)
+                    {
+                        writeBuffer.commit(0);
+                        throw;
+                    }
+                    writeBuffer.commit(got);
+                    m_decompress_space = size - got;
+                    inbytes += processed;
+                    outbytes += got;
+                } while (got && !done);
+
+                return pplx::task_from_result(outbytes);
+            }
+
+            m_decompressed.resize(input_size * 3);
             do
             {
                 if (inbytes)
                 {
-                    output.resize(output.size() + std::max(input_size, static_cast<size_t>(1024)));
+                    m_decompressed.resize(m_decompressed.size() + std::max(input_size, static_cast<size_t>(1024)));
                 }
                 got = m_decompressor->decompress(input + inbytes,
                                                  input_size - inbytes,
-                                                 output.data() + outbytes,
-                                                 output.size() - outbytes,
+                                                 m_decompressed.data() + outbytes,
+                                                 m_decompressed.size() - outbytes,
                                                  web::http::compression::operation_hint::has_more,
                                                  processed,
                                                  done);
                 inbytes += processed;
                 outbytes += got;
             } while (got && !done);
-            output.resize(outbytes);
+            m_decompressed.resize(outbytes);
         }
         catch (...)
         {
-            return false;
+            return pplx::task_from_exception<size_t>(std::runtime_error("Failed to decompress the response body"));
         }
 
-        return true;
+        // It is valid for the decompressor to sometimes return an empty output for a given chunk, the data will be
+        // flushed when the next chunk is received
+        if (m_decompressed.empty())
+        {
+            return pplx::task_from_result<size_t>(0);
+        }
+        return writeBuffer.putn_nocopy(m_decompressed.data(), m_decompressed.size());
     }
 
     void handle_chunk(const boost::system::error_code& ec, int to_read)
@@ -1597,54 +1820,25 @@ private:
                 const auto this_request = shared_from_this();
                 if (m_decompressor)
                 {
-                    std::vector<uint8_t> decompressed;
-
-                    bool boo =
-                        decompress(boost::asio::buffer_cast<const uint8_t*>(m_body_buf.data()), to_read, decompressed);
-                    if (!boo)
-                    {
-                        report_exception(std::runtime_error("Failed to decompress the response body"));
-                        return;
-                    }
-
-                    // It is valid for the decompressor to sometimes return an empty output for a given chunk, the data
-                    // will be flushed when the next chunk is received
-                    if (decompressed.empty())
-                    {
-                        m_body_buf.consume(to_read + CRLF.size()); // consume crlf
-                        m_connection->async_read_until(m_body_buf,
-                                                       CRLF,
-                                                       boost::bind(&asio_context::handle_chunk_header,
-                                                                   this_request,
-                                                                   boost::asio::placeholders::error));
-                    }
-                    else
-                    {
-                        // Move the decompressed buffer into a shared_ptr to keep it alive until putn_nocopy completes.
-                        // When VS 2013 support is dropped, this should be changed to a unique_ptr plus a move capture.
-                        auto shared_decompressed = std::make_shared<std::vector<uint8_t>>(std::move(decompressed));
-
-                        writeBuffer.putn_nocopy(shared_decompressed->data(), shared_decompressed->size())
-                            .then([this_request, to_read, shared_decompressed AND_CAPTURE_MEMBER_FUNCTION_POINTERS](
-                                      pplx::task<size_t> op) {
-                                try
-                                {
-                                    op.get();
-                                    this_request->m_body_buf.consume(to_read + CRLF.size()); // consume crlf
-                                    this_request->m_connection->async_read_until(
-                                        this_request->m_body_buf,
-                                        CRLF,
-                                        boost::bind(&asio_context::handle_chunk_header,
-                                                    this_request,
-                                                    boost::asio::placeholders::error));
-                                }
-                                catch (...)
-                                {
-                                    this_request->report_exception(std::current_exception());
-                                    return;
-                                }
-                            });
-                    }
+                    decompress(writeBuffer, boost::asio::buffer_cast<const uint8_t*>(m_body_buf.data()), to_read)
+                        .then([this_request, to_read AND_CAPTURE_MEMBER_FUNCTION_POINTERS](pplx::task<size_t> op) {
+                            try
+                            {
+                                op.get();
+                                this_request->m_body_buf.consume(to_read + CRLF.size()); // consume crlf
+                                this_request->m_connection->async_read_until(
+                                    this_request->m_body_buf,
+                                    CRLF,
+                                    boost::bind(&asio_context::handle_chunk_header,
+                                                this_request,
+                                                boost::asio::placeholders::error));
+                            }
+                            catch (...)
+                            {
+                                this_request->report_exception(std::current_exception());
+                                return;
+                            }
+                        });
                 }
                 else
                 {
@@ -1717,68 +1911,27 @@ private:
 
             if (m_decompressor)
             {
-                std::vector<uint8_t> decompressed;
-
-                bool boo =
-                    decompress(boost::asio::buffer_cast<const uint8_t*>(m_body_buf.data()), read_size, decompressed);
-                if (!boo)
-                {
-                    this_request->report_exception(std::runtime_error("Failed to decompress the response body"));
-                    return;
-                }
-
-                // It is valid for the decompressor to sometimes return an empty output for a given chunk, the data will
-                // be flushed when the next chunk is received
-                if (decompressed.empty())
-                {
-                    try
-                    {
-                        this_request->m_downloaded += static_cast<uint64_t>(read_size);
-
-                        this_request->async_read_until_buffersize(
-                            static_cast<size_t>(std::min(
-                                static_cast<uint64_t>(this_request->m_http_client->client_config().chunksize()),
-                                this_request->m_content_length - this_request->m_downloaded)),
-                            boost::bind(
-                                &asio_context::handle_read_content, this_request, boost::asio::placeholders::error));
-                    }
-                    catch (...)
-                    {
-                        this_request->report_exception(std::current_exception());
-                        return;
-                    }
-                }
-                else
-                {
-                    // Move the decompressed buffer into a shared_ptr to keep it alive until putn_nocopy completes.
-                    // When VS 2013 support is dropped, this should be changed to a unique_ptr plus a move capture.
-                    auto shared_decompressed = std::make_shared<std::vector<uint8_t>>(std::move(decompressed));
-
-                    writeBuffer.putn_nocopy(shared_decompressed->data(), shared_decompressed->size())
-                        .then([this_request, read_size, shared_decompressed AND_CAPTURE_MEMBER_FUNCTION_POINTERS](
-                                  pplx::task<size_t> op) {
-                            size_t writtenSize = 0;
-                            (void)writtenSize;
-                            try
-                            {
-                                writtenSize = op.get();
-                                this_request->m_downloaded += static_cast<uint64_t>(read_size);
-                                this_request->m_body_buf.consume(read_size);
-                                this_request->async_read_until_buffersize(
-                                    static_cast<size_t>(std::min(
-                                        static_cast<uint64_t>(this_request->m_http_client->client_config().chunksize()),
-                                        this_request->m_content_length - this_request->m_downloaded)),
-                                    boost::bind(&asio_context::handle_read_content,
-                                                this_request,
-                                                boost::asio::placeholders::error));
-                            }
-                            catch (...)
-                            {
-                                this_request->report_exception(std::current_exception());
-                                return;
-                            }
-                        });
-                }
+                decompress(writeBuffer, boost::asio::buffer_cast<const uint8_t*>(m_body_buf.data()), read_size)
+                    .then([this_request, read_size AND_CAPTURE_MEMBER_FUNCTION_POINTERS](pplx::task<size_t> op) {
+                        try
+                        {
+                            op.get();
+                            this_request->m_downloaded += static_cast<uint64_t>(read_size);
+                            this_request->m_body_buf.consume(read_size);
+                            this_request->async_read_until_buffersize(
+                                static_cast<size_t>(std::min(
+                                    static_cast<uint64_t>(this_request->m_http_client->client_config().chunksize()),
+                                    this_request->m_content_length - this_request->m_downloaded)),
+                                boost::bind(&asio_context::handle_read_content,
+                                            this_request,
+                                            boost::asio::placeholders::error));
+                        }
+                        catch (...)
+                        {
+                            this_request->report_exception(std::current_exception());
+                            return;
+                        }
+                    });
             }
             else
             {
@@ -1896,10 +2049,21 @@ private:
         boost::asio::steady_timer m_timer;
     };
 
+    // Size of the blocks decompressed into, and the least space left in one that is still used for the next part
+    static const size_t decompress_block_size = 64 * 1024;
+    static const size_t min_decompress_space = 1024;
+
     uint64_t m_content_length;
     bool m_needChunked;
     timeout_timer m_timer;
     boost::asio::streambuf m_body_buf;
+    std::vector<uint8_t> m_decompressed;
+    size_t m_decompress_space;
+    std::vector<uint8_t> m_compress_input;
+    size_t m_compress_read;
+    size_t m_compress_used;
+    bool m_compress_eof;
+    bool m_compress_done;
     std::shared_ptr<asio_connection> m_connection;
 
 #ifdef CPPREST_PLATFORM_ASIO_CERT_VERIFICATION_AVAILABLE
@@ -15,6 +15,7 @@
 
 // CPPREST_EXCLUDE_COMPRESSION is set if we're on a platform that supports compression but we want to explicitly disable
 // it. CPPREST_EXCLUDE_BROTLI is set if we want to explicitly disable Brotli compression support.
+// CPPREST_EXCLUDE_ZSTD is set if we want to explicitly disable Zstandard compression support.
 // CPPREST_EXCLUDE_WEBSOCKETS is a flag that now essentially means "no external dependencies". TODO: Rename
 
 #if __APPLE__
@@ -28,9 +29,16 @@
 #if !defined(CPPREST_EXCLUDE_WEBSOCKETS) && !defined(CPPREST_EXCLUDE_COMPRESSION)
 #define CPPREST_HTTP_COMPRESSION
 #endif // !defined(CPPREST_EXCLUDE_WEBSOCKETS) && !defined(CPPREST_EXCLUDE_COMPRESSION)
+#elif !defined(_WIN32)
+// Elsewhere zlib is found by the build whenever compression is not excluded
+#if !defined(CPPREST_EXCLUDE_COMPRESSION)
+#define CPPREST_HTTP_COMPRESSION
+#endif // !defined(CPPREST_EXCLUDE_COMPRESSION)
 #endif
 
 #if defined(CPPREST_HTTP_COMPRESSION)
+#include <deque>
+#include <thread>
 #include <zlib.h>
 #if !defined(CPPREST_EXCLUDE_BROTLI)
 #define CPPREST_BROTLI_COMPRESSION
@@ -39,6 +47,12 @@
 #include <brotli/decode.h>
 #include <brotli/encode.h>
 #endif // CPPREST_BROTLI_COMPRESSION
+#if !defined(CPPREST_EXCLUDE_ZSTD)
+#define CPPREST_ZSTD_COMPRESSION
+#endif // CPPREST_EXCLUDE_ZSTD
+#if defined(CPPREST_ZSTD_COMPRESSION)
+#include <zstd.h>
+#endif // CPPREST_ZSTD_COMPRESSION
 #endif
 
 namespace web
@@ -61,10 +75,12 @@ public:
                          int compressionLevel = Z_DEFAULT_COMPRESSION,
                          int method = Z_DEFLATED,
                          int strategy = Z_DEFAULT_STRATEGY,
-                         int memLevel = MAX_MEM_LEVEL)
-        : m_algorithm(windowBits >= 16 ? GZIP : DEFLATE)
+                         int memLevel = MAX_MEM_LEVEL,
+                         std::shared_ptr<dictionary> dict = nullptr)
+        : m_dictionary(std::move(dict)), m_algorithm(windowBits >= 16 ? GZIP : DEFLATE)
     {
         m_state = deflateInit2(&m_stream, compressionLevel, method, windowBits, memLevel, strategy);
+        set_dictionary();
     }
 
     const utility::string_t& algorithm() const { return m_algorithm; }
@@ -141,6 +157,7 @@ public:
     void reset()
     {
         m_state = deflateReset(&m_stream);
+        set_dictionary();
         if (m_state != Z_OK)
         {
             throw std::runtime_error("Failed to reset zlib compressor " + std::to_string(m_state));
@@ -150,8 +167,19 @@ public:
     ~zlib_compressor_base() { (void)deflateEnd(&m_stream); }
 
 private:
+    // A preset dictionary has to be supplied anew for each stream, before any data is compressed
+    void set_dictionary()
+    {
+        if (m_state == Z_OK && m_dictionary && !m_dictionary->data().empty())
+        {
+            m_state = deflateSetDictionary(
+                &m_stream, m_dictionary->data().data(), static_cast<uInt>(m_dictionary->data().size()));
+        }
+    }
+
     int m_state {Z_BUF_ERROR};
     z_stream m_stream {};
+    std::shared_ptr<dictionary> m_dictionary;
     const utility::string_t& m_algorithm;
 };
 
@@ -162,8 +190,9 @@ const utility::string_t zlib_compressor_base::DEFLATE(algorithm::DEFLATE);
 class zlib_decompressor_base : public decompress_provider
 {
 public:
-    zlib_decompressor_base(int windowBits)
-        : m_algorithm(windowBits >= 16 ? zlib_compressor_base::GZIP : zlib_compressor_base::DEFLATE)
+    zlib_decompressor_base(int windowBits, std::shared_ptr<dictionary> dict = nullptr)
+        : m_dictionary(std::move(dict))
+        , m_algorithm(windowBits >= 16 ? zlib_compressor_base::GZIP : zlib_compressor_base::DEFLATE)
     {
         m_state = inflateInit2(&m_stream, windowBits);
     }
@@ -208,6 +237,16 @@ public:
         m_stream.avail_out = static_cast<uInt>(output_size);
 
         m_state = inflate(&m_stream, (hint == operation_hint::is_last) ? Z_FINISH : Z_PARTIAL_FLUSH);
+        if (m_state == Z_NEED_DICT && m_dictionary)
+        {
+            // The stream header names the dictionary by checksum, which zlib verifies against the one supplied
+            m_state = inflateSetDictionary(
+                &m_stream, m_dictionary->data().data(), static_cast<uInt>(m_dictionary->data().size()));
+            if (m_state == Z_OK)
+            {
+                m_state = inflate(&m_stream, (hint == operation_hint::is_last) ? Z_FINISH : Z_PARTIAL_FLUSH);
+            }
+        }
         if (m_state != Z_OK && m_state != Z_STREAM_ERROR && m_state != Z_STREAM_END && m_state != Z_BUF_ERROR)
         {
             // Z_BUF_ERROR is a success code for Z_FINISH, and the caller can continue as if operation_hint::is_last was
@@ -254,6 +293,7 @@ public:
 private:
     int m_state {Z_BUF_ERROR};
     z_stream m_stream {};
+    std::shared_ptr<dictionary> m_dictionary;
     const utility::string_t& m_algorithm;
 };
 
@@ -289,6 +329,12 @@ public:
         : zlib_compressor_base(15, compressionLevel, method, strategy, memLevel)
     {
     }
+
+    deflate_compressor(std::shared_ptr<dictionary> dict)
+        : zlib_compressor_base(
+              15, Z_DEFAULT_COMPRESSION, Z_DEFLATED, Z_DEFAULT_STRATEGY, MAX_MEM_LEVEL, std::move(dict))
+    {
+    }
 };
 
 class deflate_decompressor : public zlib_decompressor_base
@@ -297,6 +343,286 @@ public:
     deflate_decompressor() : zlib_decompressor_base(0) // deflate auto-detect
     {
     }
+
+    deflate_decompressor(std::shared_ptr<dictionary> dict) : zlib_decompressor_base(0, std::move(dict)) {}
+};
+
+// Compresses blocks of the body on several threads at once, in the manner of pigz. Each block is compressed into raw
+// deflate data of its own, primed with the end of the block before it, and flushed to a byte boundary, so that the
+// blocks add up to a single deflate stream. The gzip or zlib header and trailer are put around it here, with the
+// checksums of the blocks combined.
+class parallel_zlib_compressor : public compress_provider
+{
+public:
+    static const size_t default_block_size = 128 * 1024;
+
+    parallel_zlib_compressor(bool gzip, int compressionLevel, size_t blockSize, size_t threads)
+        : m_gzip(gzip)
+        , m_level(compressionLevel)
+        , m_block_size(blockSize ? (std::min)(blockSize, static_cast<size_t>(1) << 30) : size_t(default_block_size))
+        , m_threads(threads ? threads : (std::max)(std::thread::hardware_concurrency(), 1u))
+        , m_algorithm(gzip ? zlib_compressor_base::GZIP : zlib_compressor_base::DEFLATE)
+    {
+        // Check the parameters up front, rather than when the first block is compressed
+        z_stream stream {};
+        if (deflateInit2(&stream, m_level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            throw std::runtime_error("Invalid parallel compression level " + std::to_string(m_level));
+        }
+        (void)deflateEnd(&stream);
+        reset();
+    }
+
+    const utility::string_t& algorithm() const { return m_algorithm; }
+
+    size_t compress(const uint8_t* input,
+                    size_t input_size,
+                    uint8_t* output,
+                    size_t output_size,
+                    operation_hint hint,
+                    size_t& input_bytes_processed,
+                    bool& done)
+    {
+        collect();
+        size_t produced = drain(output, output_size);
+        size_t used = 0;
+        if (!m_finished)
+        {
+            // Input is held back while compressed data waits to be taken, or while every thread is busy with a block,
+            // so that neither grows without bound
+            while (used < input_size && m_output.size() - m_output_offset < m_block_size)
+            {
+                if (m_block->size() == m_block_size && !dispatch(false))
+                {
+                    break;
+                }
+                const size_t take = (std::min)(input_size - used, m_block_size - m_block->size());
+                m_block->insert(m_block->end(), input + used, input + used + take);
+                used += take;
+                if (m_block->size() == m_block_size)
+                {
+                    dispatch(false);
+                }
+            }
+            if (hint == operation_hint::is_last && used == input_size && dispatch(true))
+            {
+                m_finished = true;
+            }
+        }
+
+        collect();
+        produced += drain(output + produced, output_size - produced);
+
+        input_bytes_processed = used;
+        done = m_done && m_output_offset == m_output.size();
+        return produced;
+    }
+
+    pplx::task<operation_result> compress(
+        const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, operation_hint hint)
+    {
+        operation_result r;
+
+        try
+        {
+            r.output_bytes_produced =
+                compress(input, input_size, output, output_size, hint, r.input_bytes_processed, r.done);
+        }
+        catch (...)
+        {
+            pplx::task_completion_event<operation_result> ev;
+            ev.set_exception(std::current_exception());
+            return pplx::create_task(ev);
+        }
+
+        if (r.input_bytes_processed == 0 && r.output_bytes_produced == 0 && !r.done && !m_jobs.empty())
+        {
+            // Nothing can happen until the oldest block is compressed, so carry on once it is rather than blocking
+            return m_jobs.front().then([=](pplx::task<block_result>) {
+                return compress(input, input_size, output, output_size, hint);
+            });
+        }
+
+        return pplx::task_from_result<operation_result>(r);
+    }
+
+    void reset()
+    {
+        // Blocks still being compressed only hold their own data, and are left to finish unobserved
+        m_jobs.clear();
+        m_block = std::make_shared<std::vector<uint8_t>>();
+        m_block->reserve(m_block_size);
+        m_previous.reset();
+        m_output.clear();
+        m_output_offset = 0;
+        m_check = m_gzip ? crc32(0L, Z_NULL, 0) : adler32(0L, Z_NULL, 0);
+        m_total = 0;
+        m_finished = false;
+        m_done = false;
+
+        if (m_gzip)
+        {
+            // No file name or time stamp, and an unknown operating system
+            static const uint8_t header[] = {0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 0xff};
+            m_output.assign(header, header + sizeof(header));
+        }
+        else
+        {
+            // The compression level is recorded the way zlib itself does
+            const int level = m_level == Z_DEFAULT_COMPRESSION ? 6 : m_level;
+            const int flags = (level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6;
+            const int method = ((MAX_WBITS - 8) << 4) | Z_DEFLATED;
+            m_output.push_back(static_cast<uint8_t>(method));
+            m_output.push_back(static_cast<uint8_t>(flags + 31 - ((method << 8) | flags) % 31));
+        }
+    }
+
+private:
+    struct block_result
+    {
+        bool succeeded;
+        std::vector<uint8_t> data;
+        uLong check;
+        size_t length;
+    };
+
+    static block_result compress_block(bool gzip,
+                                       int level,
+                                       const std::vector<uint8_t>& input,
+                                       const std::vector<uint8_t>* previous,
+                                       bool last)
+    {
+        block_result result;
+        result.length = input.size();
+        result.check = gzip ? crc32(crc32(0L, Z_NULL, 0), input.data(), static_cast<uInt>(input.size()))
+                            : adler32(adler32(0L, Z_NULL, 0), input.data(), static_cast<uInt>(input.size()));
+
+        z_stream stream {};
+        int state = deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        if (state == Z_OK && previous != nullptr)
+        {
+            // Matches may reach back into the window's worth of data before the block, as in a single stream
+            const size_t size = (std::min)(previous->size(), static_cast<size_t>(1) << MAX_WBITS);
+            state = deflateSetDictionary(&stream, previous->data() + previous->size() - size, static_cast<uInt>(size));
+        }
+        if (state == Z_OK)
+        {
+            // A sync flush ends the block on a byte boundary without ending the stream; it adds at most 10 bytes
+            result.data.resize(deflateBound(&stream, static_cast<uLong>(input.size())) + 10);
+            stream.next_in = const_cast<Bytef*>(input.data());
+            stream.avail_in = static_cast<uInt>(input.size());
+            stream.next_out = result.data.data();
+            stream.avail_out = static_cast<uInt>(result.data.size());
+            state = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+            result.data.resize(result.data.size() - stream.avail_out);
+        }
+        result.succeeded = stream.avail_in == 0 && (last ? state == Z_STREAM_END : state == Z_OK);
+        (void)deflateEnd(&stream);
+        return result;
+    }
+
+    // Hands the block being filled to a thread of its own. Returns false, without waiting, if too many are in flight.
+    bool dispatch(bool last)
+    {
+        collect();
+        if (m_jobs.size() >= m_threads)
+        {
+            return false;
+        }
+
+        const bool gzip = m_gzip;
+        const int level = m_level;
+        std::shared_ptr<const std::vector<uint8_t>> block = std::move(m_block);
+        std::shared_ptr<const std::vector<uint8_t>> previous = m_previous;
+        m_jobs.push_back(pplx::create_task(
+            [=]() { return compress_block(gzip, level, *block, previous ? previous.get() : nullptr, last); }));
+
+        m_previous = std::move(block);
+        m_block = std::make_shared<std::vector<uint8_t>>();
+        m_block->reserve(m_block_size);
+        return true;
+    }
+
+    // Appends the compressed blocks that are ready, in order; once the last block is in, adds the trailer
+    void collect()
+    {
+        while (!m_jobs.empty() && m_jobs.front().is_done())
+        {
+            collect_front();
+        }
+
+        if (m_finished && !m_done && m_jobs.empty())
+        {
+            if (m_gzip)
+            {
+                append_uint32(m_check, false);
+                append_uint32(static_cast<uLong>(m_total & 0xffffffff), false);
+            }
+            else
+            {
+                append_uint32(m_check, true);
+            }
+            m_done = true;
+        }
+    }
+
+    void collect_front()
+    {
+        // A failed block is left in place, so that every later call fails too
+        const auto& result = m_jobs.front().get();
+        if (!result.succeeded)
+        {
+            throw std::runtime_error("Unrecoverable parallel compression error");
+        }
+
+        compact();
+        m_output.insert(m_output.end(), result.data.begin(), result.data.end());
+        m_check = m_gzip ? crc32_combine(m_check, result.check, static_cast<z_off_t>(result.length))
+                         : adler32_combine(m_check, result.check, static_cast<z_off_t>(result.length));
+        m_total += result.length;
+        m_jobs.pop_front();
+    }
+
+    void append_uint32(uLong value, bool big_endian)
+    {
+        compact();
+        for (int i = 0; i < 4; ++i)
+        {
+            const int shift = big_endian ? 24 - 8 * i : 8 * i;
+            m_output.push_back(static_cast<uint8_t>((value >> shift) & 0xff));
+        }
+    }
+
+    // Drops the compressed data that has been taken already
+    void compact()
+    {
+        m_output.erase(m_output.begin(), m_output.begin() + m_output_offset);
+        m_output_offset = 0;
+    }
+
+    size_t drain(uint8_t* output, size_t output_size)
+    {
+        const size_t size = (std::min)(output_size, m_output.size() - m_output_offset);
+        std::copy(m_output.begin() + m_output_offset, m_output.begin() + m_output_offset + size, output);
+        m_output_offset += size;
+        return size;
+    }
+
+    const bool m_gzip;
+    const int m_level;
+    const size_t m_block_size;
+    const size_t m_threads;
+    const utility::string_t& m_algorithm;
+
+    std::shared_ptr<std::vector<uint8_t>> m_block;
+    std::shared_ptr<const std::vector<uint8_t>> m_previous;
+    std::deque<pplx::task<block_result>> m_jobs;
+    std::vector<uint8_t> m_output;
+    size_t m_output_offset;
+    uLong m_check;
+    uint64_t m_total;
+    bool m_finished;
+    bool m_done;
 };
 
 #if defined(CPPREST_BROTLI_COMPRESSION)
@@ -594,6 +920,241 @@ private:
     const utility::string_t& m_algorithm;
 };
 #endif // CPPREST_BROTLI_COMPRESSION
+#if defined(CPPREST_ZSTD_COMPRESSION)
+class zstd_compressor : public compress_provider
+{
+public:
+    static const utility::string_t ZSTD;
+
+    zstd_compressor(int level = ZSTD_CLEVEL_DEFAULT,
+                    int window_log = 0,
+                    const std::shared_ptr<dictionary>& dict = nullptr)
+        : m_level(level), m_window_log(window_log), m_algorithm(ZSTD)
+    {
+        m_stream = ZSTD_createCCtx();
+        if (!m_stream)
+        {
+            throw std::runtime_error("Failed to create Zstandard compressor");
+        }
+
+        // Parameters are sticky; a session-only reset keeps them for each subsequent stream
+        size_t result = ZSTD_CCtx_setParameter(m_stream, ZSTD_c_compressionLevel, m_level);
+        if (!ZSTD_isError(result) && m_window_log != 0)
+        {
+            result = ZSTD_CCtx_setParameter(m_stream, ZSTD_c_windowLog, m_window_log);
+        }
+        if (!ZSTD_isError(result) && dict)
+        {
+            result = ZSTD_CCtx_loadDictionary(m_stream, dict->data().data(), dict->data().size());
+        }
+        if (ZSTD_isError(result))
+        {
+            ZSTD_freeCCtx(m_stream);
+            throw std::runtime_error(std::string("Failed to configure Zstandard compressor: ") +
+                                     ZSTD_getErrorName(result));
+        }
+    }
+
+    const utility::string_t& algorithm() const { return m_algorithm; }
+
+    size_t compress(const uint8_t* input,
+                    size_t input_size,
+                    uint8_t* output,
+                    size_t output_size,
+                    operation_hint hint,
+                    size_t& input_bytes_processed,
+                    bool& done)
+    {
+        if (m_done || (hint != operation_hint::is_last && !input_size && !m_pending))
+        {
+            input_bytes_processed = 0;
+            done = m_done;
+            return 0;
+        }
+
+        if (m_state_error)
+        {
+            throw std::runtime_error("Prior unrecoverable compression stream error");
+        }
+
+        ZSTD_inBuffer in = {input, input_size, 0};
+        ZSTD_outBuffer out = {output, output_size, 0};
+
+        // Each call flushes what it was given, like the other providers, so that streamed bodies are not held back;
+        // the last call also writes the frame epilogue
+        const size_t remaining = ZSTD_compressStream2(
+            m_stream, &out, &in, hint == operation_hint::is_last ? ZSTD_e_end : ZSTD_e_flush);
+        if (ZSTD_isError(remaining))
+        {
+            m_state_error = true;
+            throw std::runtime_error(std::string("Unrecoverable compression stream error: ") +
+                                     ZSTD_getErrorName(remaining));
+        }
+
+        m_pending = remaining != 0;
+        if (hint == operation_hint::is_last && !m_pending && in.pos == in.size)
+        {
+            m_done = true;
+        }
+
+        input_bytes_processed = in.pos;
+        done = m_done;
+        return out.pos;
+    }
+
+    pplx::task<operation_result> compress(
+        const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, operation_hint hint)
+    {
+        operation_result r;
+
+        try
+        {
+            r.output_bytes_produced =
+                compress(input, input_size, output, output_size, hint, r.input_bytes_processed, r.done);
+        }
+        catch (...)
+        {
+            pplx::task_completion_event<operation_result> ev;
+            ev.set_exception(std::current_exception());
+            return pplx::create_task(ev);
+        }
+
+        return pplx::task_from_result<operation_result>(r);
+    }
+
+    void reset()
+    {
+        const size_t result = ZSTD_CCtx_reset(m_stream, ZSTD_reset_session_only);
+        if (ZSTD_isError(result))
+        {
+            throw std::runtime_error("Failed to reset Zstandard compressor");
+        }
+        m_state_error = false;
+        m_pending = false;
+        m_done = false;
+    }
+
+    ~zstd_compressor() { ZSTD_freeCCtx(m_stream); }
+
+private:
+    ZSTD_CCtx* m_stream {nullptr};
+    bool m_state_error {false};
+    bool m_pending {false};
+    bool m_done {false};
+    int m_level;
+    int m_window_log;
+    const utility::string_t& m_algorithm;
+};
+
+const utility::string_t zstd_compressor::ZSTD(algorithm::ZSTD);
+
+class zstd_decompressor : public decompress_provider
+{
+public:
+    zstd_decompressor(const std::shared_ptr<dictionary>& dict = nullptr) : m_algorithm(zstd_compressor::ZSTD)
+    {
+        m_stream = ZSTD_createDCtx();
+        if (!m_stream)
+        {
+            throw std::runtime_error("Failed to create Zstandard decompressor");
+        }
+
+        // Like the compression parameters, the dictionary is kept by a session-only reset
+        if (dict)
+        {
+            const size_t result = ZSTD_DCtx_loadDictionary(m_stream, dict->data().data(), dict->data().size());
+            if (ZSTD_isError(result))
+            {
+                ZSTD_freeDCtx(m_stream);
+                throw std::runtime_error(std::string("Failed to load Zstandard dictionary: ") +
+                                         ZSTD_getErrorName(result));
+            }
+        }
+    }
+
+    const utility::string_t& algorithm() const { return m_algorithm; }
+
+    size_t decompress(const uint8_t* input,
+                      size_t input_size,
+                      uint8_t* output,
+                      size_t output_size,
+                      operation_hint hint,
+                      size_t& input_bytes_processed,
+                      bool& done)
+    {
+        if (m_done)
+        {
+            input_bytes_processed = 0;
+            done = true;
+            return 0;
+        }
+
+        if (m_state_error)
+        {
+            throw std::runtime_error("Prior unrecoverable decompression stream error");
+        }
+
+        ZSTD_inBuffer in = {input, input_size, 0};
+        ZSTD_outBuffer out = {output, output_size, 0};
+
+        // N.B. as for Brotli, 'hint' is ignored; the streaming decoder handles a whole frame in one call just as well
+        (void)hint;
+        const size_t result = ZSTD_decompressStream(m_stream, &out, &in);
+        if (ZSTD_isError(result))
+        {
+            m_state_error = true;
+            throw std::runtime_error(std::string("Unrecoverable decompression stream error: ") +
+                                     ZSTD_getErrorName(result));
+        }
+
+        // A zero result means a frame was completely decoded and flushed
+        m_done = (result == 0);
+
+        input_bytes_processed = in.pos;
+        done = m_done;
+        return out.pos;
+    }
+
+    pplx::task<operation_result> decompress(
+        const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, operation_hint hint)
+    {
+        operation_result r;
+
+        try
+        {
+            r.output_bytes_produced =
+                decompress(input, input_size, output, output_size, hint, r.input_bytes_processed, r.done);
+        }
+        catch (...)
+        {
+            pplx::task_completion_event<operation_result> ev;
+            ev.set_exception(std::current_exception());
+            return pplx::create_task(ev);
+        }
+
+        return pplx::task_from_result<operation_result>(r);
+    }
+
+    void reset()
+    {
+        const size_t result = ZSTD_DCtx_reset(m_stream, ZSTD_reset_session_only);
+        if (ZSTD_isError(result))
+        {
+            throw std::runtime_error("Failed to reset Zstandard decompressor");
+        }
+        m_state_error = false;
+        m_done = false;
+    }
+
+    ~zstd_decompressor() { ZSTD_freeDCtx(m_stream); }
+
+private:
+    ZSTD_DCtx* m_stream {nullptr};
+    bool m_state_error {false};
+    bool m_done {false};
+    const utility::string_t& m_algorithm;
+};
+#endif // CPPREST_ZSTD_COMPRESSION
 #endif // CPPREST_HTTP_COMPRESSION
 
 // Generic internal implementation of the compress_factory API
@@ -640,20 +1201,226 @@ private:
     std::function<std::unique_ptr<decompress_provider>()> _make_decompressor;
 };
 
+// Upper bound on the idle providers kept for each built-in algorithm, separately for compression and decompression
+static std::atomic<size_t> g_provider_pool_limit(8);
+
+// A bounded set of idle built-in providers of one algorithm. Providers are reset() when they are returned, and handed
+// out again instead of being constructed for every message, which for zlib saves the allocation and setup of its
+// window and hash tables.
+template<typename Provider>
+class provider_pool
+{
+public:
+    provider_pool(std::function<std::unique_ptr<Provider>()> make_provider)
+        : m_make_provider(std::move(make_provider)), m_stats()
+    {
+    }
+
+    std::unique_ptr<Provider> acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (!m_idle.empty())
+            {
+                auto provider = std::move(m_idle.back());
+                m_idle.pop_back();
+                ++m_stats.reused;
+                return provider;
+            }
+            ++m_stats.created;
+        }
+
+        return m_make_provider();
+    }
+
+    void release(std::unique_ptr<Provider> provider)
+    {
+        bool reusable = true;
+        try
+        {
+            provider->reset();
+        }
+        catch (...)
+        {
+            reusable = false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (reusable && m_idle.size() < g_provider_pool_limit)
+        {
+            m_idle.push_back(std::move(provider));
+            ++m_stats.returned;
+        }
+        else
+        {
+            ++m_stats.discarded;
+        }
+    }
+
+    provider_pool_stats stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        provider_pool_stats stats = m_stats;
+        stats.idle = m_idle.size();
+        return stats;
+    }
+
+private:
+    std::function<std::unique_ptr<Provider>()> m_make_provider;
+    mutable std::mutex m_lock;
+    std::vector<std::unique_ptr<Provider>> m_idle;
+    provider_pool_stats m_stats;
+};
+
+// A compressor lent out by a pool, which takes it back when the caller is done with it
+class pooled_compressor : public compress_provider
+{
+public:
+    pooled_compressor(std::unique_ptr<compress_provider> provider,
+                      std::shared_ptr<provider_pool<compress_provider>> pool)
+        : m_provider(std::move(provider)), m_pool(std::move(pool))
+    {
+    }
+
+    const utility::string_t& algorithm() const { return m_provider->algorithm(); }
+
+    size_t compress(const uint8_t* input,
+                    size_t input_size,
+                    uint8_t* output,
+                    size_t output_size,
+                    operation_hint hint,
+                    size_t& input_bytes_processed,
+                    bool& done)
+    {
+        return m_provider->compress(input, input_size, output, output_size, hint, input_bytes_processed, done);
+    }
+
+    pplx::task<operation_result> compress(
+        const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, operation_hint hint)
+    {
+        return m_provider->compress(input, input_size, output, output_size, hint);
+    }
+
+    void reset() { m_provider->reset(); }
+
+    ~pooled_compressor() { m_pool->release(std::move(m_provider)); }
+
+private:
+    std::unique_ptr<compress_provider> m_provider;
+    std::shared_ptr<provider_pool<compress_provider>> m_pool;
+};
+
+// A decompressor lent out by a pool, which takes it back when the caller is done with it
+class pooled_decompressor : public decompress_provider
+{
+public:
+    pooled_decompressor(std::unique_ptr<decompress_provider> provider,
+                        std::shared_ptr<provider_pool<decompress_provider>> pool)
+        : m_provider(std::move(provider)), m_pool(std::move(pool))
+    {
+    }
+
+    const utility::string_t& algorithm() const { return m_provider->algorithm(); }
+
+    size_t decompress(const uint8_t* input,
+                      size_t input_size,
+                      uint8_t* output,
+                      size_t output_size,
+                      operation_hint hint,
+                      size_t& input_bytes_processed,
+                      bool& done)
+    {
+        return m_provider->decompress(input, input_size, output, output_size, hint, input_bytes_processed, done);
+    }
+
+    pplx::task<operation_result> decompress(
+        const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, operation_hint hint)
+    {
+        return m_provider->decompress(input, input_size, output, output_size, hint);
+    }
+
+    void reset() { m_provider->reset(); }
+
+    ~pooled_decompressor() { m_pool->release(std::move(m_provider)); }
+
+private:
+    std::unique_ptr<decompress_provider> m_provider;
+    std::shared_ptr<provider_pool<decompress_provider>> m_pool;
+};
+
+// Internal implementation of the compress_factory API for the built-in algorithms, which reuses providers
+class pooled_compress_factory : public compress_factory
+{
+public:
+    pooled_compress_factory(const utility::string_t& algorithm,
+                            std::function<std::unique_ptr<compress_provider>()> make_compressor)
+        : m_algorithm(algorithm), m_pool(std::make_shared<provider_pool<compress_provider>>(make_compressor))
+    {
+    }
+
+    const utility::string_t& algorithm() const { return m_algorithm; }
+
+    std::unique_ptr<compress_provider> make_compressor() const
+    {
+        return utility::details::make_unique<pooled_compressor>(m_pool->acquire(), m_pool);
+    }
+
+    provider_pool_stats stats() const { return m_pool->stats(); }
+
+private:
+    const utility::string_t m_algorithm;
+    std::shared_ptr<provider_pool<compress_provider>> m_pool;
+};
+
+// Internal implementation of the decompress_factory API for the built-in algorithms, which reuses providers
+class pooled_decompress_factory : public decompress_factory
+{
+public:
+    pooled_decompress_factory(const utility::string_t& algorithm,
+                              uint16_t weight,
+                              std::function<std::unique_ptr<decompress_provider>()> make_decompressor)
+        : m_algorithm(algorithm)
+        , m_weight(weight)
+        , m_pool(std::make_shared<provider_pool<decompress_provider>>(make_decompressor))
+    {
+    }
+
+    const utility::string_t& algorithm() const { return m_algorithm; }
+
+    uint16_t weight() const { return m_weight; }
+
+    std::unique_ptr<decompress_provider> make_decompressor() const
+    {
+        return utility::details::make_unique<pooled_decompressor>(m_pool->acquire(), m_pool);
+    }
+
+    provider_pool_stats stats() const { return m_pool->stats(); }
+
+private:
+    const utility::string_t m_algorithm;
+    uint16_t m_weight;
+    std::shared_ptr<provider_pool<decompress_provider>> m_pool;
+};
+
 // "Private" algorithm-to-factory tables for namespace static helpers
 static const std::vector<std::shared_ptr<compress_factory>> g_compress_factories
 #if defined(CPPREST_HTTP_COMPRESSION)
-    = {std::make_shared<generic_compress_factory>(
+    = {std::make_shared<pooled_compress_factory>(
            algorithm::GZIP,
            []() -> std::unique_ptr<compress_provider> { return utility::details::make_unique<gzip_compressor>(); }),
-       std::make_shared<generic_compress_factory>(
+       std::make_shared<pooled_compress_factory>(
            algorithm::DEFLATE,
            []() -> std::unique_ptr<compress_provider> { return utility::details::make_unique<deflate_compressor>(); }),
 #if defined(CPPREST_BROTLI_COMPRESSION)
-       std::make_shared<generic_compress_factory>(
+       std::make_shared<pooled_compress_factory>(
            algorithm::BROTLI,
-           []() -> std::unique_ptr<compress_provider> { return utility::details::make_unique<brotli_compressor>(); })
+           []() -> std::unique_ptr<compress_provider> { return utility::details::make_unique<brotli_compressor>(); }),
 #endif // CPPREST_BROTLI_COMPRESSION
+#if defined(CPPREST_ZSTD_COMPRESSION)
+       std::make_shared<pooled_compress_factory>(
+           algorithm::ZSTD,
+           []() -> std::unique_ptr<compress_provider> { return utility::details::make_unique<zstd_compressor>(); }),
+#endif // CPPREST_ZSTD_COMPRESSION
 };
 #else  // CPPREST_HTTP_COMPRESSION
     ;
@@ -661,22 +1428,28 @@ static const std::vector<std::shared_ptr<compress_factory>> g_compress_factories
 
 static const std::vector<std::shared_ptr<decompress_factory>> g_decompress_factories
 #if defined(CPPREST_HTTP_COMPRESSION)
-    = {std::make_shared<generic_decompress_factory>(
+    = {std::make_shared<pooled_decompress_factory>(
            algorithm::GZIP,
            500,
            []() -> std::unique_ptr<decompress_provider> { return utility::details::make_unique<gzip_decompressor>(); }),
-       std::make_shared<generic_decompress_factory>(algorithm::DEFLATE,
-                                                    500,
-                                                    []() -> std::unique_ptr<decompress_provider> {
-                                                        return utility::details::make_unique<deflate_decompressor>();
-                                                    }),
+       std::make_shared<pooled_decompress_factory>(algorithm::DEFLATE,
+                                                   500,
+                                                   []() -> std::unique_ptr<decompress_provider> {
+                                                       return utility::details::make_unique<deflate_decompressor>();
+                                                   }),
 #if defined(CPPREST_BROTLI_COMPRESSION)
-       std::make_shared<generic_decompress_factory>(algorithm::BROTLI,
-                                                    500,
-                                                    []() -> std::unique_ptr<decompress_provider> {
-                                                        return utility::details::make_unique<brotli_decompressor>();
-                                                    })
+       std::make_shared<pooled_decompress_factory>(algorithm::BROTLI,
+                                                   500,
+                                                   []() -> std::unique_ptr<decompress_provider> {
+                                                       return utility::details::make_unique<brotli_decompressor>();
+                                                   }),
 #endif // CPPREST_BROTLI_COMPRESSION
+#if defined(CPPREST_ZSTD_COMPRESSION)
+       std::make_shared<pooled_decompress_factory>(
+           algorithm::ZSTD,
+           500,
+           []() -> std::unique_ptr<decompress_provider> { return utility::details::make_unique<zstd_decompressor>(); }),
+#endif // CPPREST_ZSTD_COMPRESSION
 };
 #else  // CPPREST_HTTP_COMPRESSION
     ;
@@ -761,6 +1534,64 @@ std::shared_ptr<decompress_factory> get_decompress_factory(const utility::string
     return std::shared_ptr<decompress_factory>();
 }
 
+// Providers primed with a dictionary are specific to it, so they are not pooled
+std::unique_ptr<compress_provider> make_compressor(const utility::string_t& algorithm,
+                                                   const std::shared_ptr<dictionary>& dict)
+{
+#if defined(CPPREST_HTTP_COMPRESSION)
+    if (utility::details::str_iequal(algorithm, algorithm::DEFLATE))
+    {
+        return utility::details::make_unique<deflate_compressor>(dict);
+    }
+#if defined(CPPREST_ZSTD_COMPRESSION)
+    if (utility::details::str_iequal(algorithm, algorithm::ZSTD))
+    {
+        return utility::details::make_unique<zstd_compressor>(ZSTD_CLEVEL_DEFAULT, 0, dict);
+    }
+#endif // CPPREST_ZSTD_COMPRESSION
+#else  // CPPREST_HTTP_COMPRESSION
+    (void)algorithm;
+    (void)dict;
+#endif // CPPREST_HTTP_COMPRESSION
+    return std::unique_ptr<compress_provider>();
+}
+
+std::unique_ptr<decompress_provider> make_decompressor(const utility::string_t& algorithm,
+                                                       const std::shared_ptr<dictionary>& dict)
+{
+#if defined(CPPREST_HTTP_COMPRESSION)
+    if (utility::details::str_iequal(algorithm, algorithm::DEFLATE))
+    {
+        return utility::details::make_unique<deflate_decompressor>(dict);
+    }
+#if defined(CPPREST_ZSTD_COMPRESSION)
+    if (utility::details::str_iequal(algorithm, algorithm::ZSTD))
+    {
+        return utility::details::make_unique<zstd_decompressor>(dict);
+    }
+#endif // CPPREST_ZSTD_COMPRESSION
+#else  // CPPREST_HTTP_COMPRESSION
+    (void)algorithm;
+    (void)dict;
+#endif // CPPREST_HTTP_COMPRESSION
+    return std::unique_ptr<decompress_provider>();
+}
+
+void set_provider_pool_limit(size_t limit) { g_provider_pool_limit = limit; }
+
+// Every factory in the built-in tables is a pooled one
+provider_pool_stats compressor_pool_stats(const utility::string_t& algorithm)
+{
+    auto factory = get_compress_factory(algorithm);
+    return factory ? std::static_pointer_cast<pooled_compress_factory>(factory)->stats() : provider_pool_stats();
+}
+
+provider_pool_stats decompressor_pool_stats(const utility::string_t& algorithm)
+{
+    auto factory = get_decompress_factory(algorithm);
+    return factory ? std::static_pointer_cast<pooled_decompress_factory>(factory)->stats() : provider_pool_stats();
+}
+
 std::unique_ptr<compress_provider> make_gzip_compressor(int compressionLevel, int method, int strategy, int memLevel)
 {
 #if defined(CPPREST_HTTP_COMPRESSION)
@@ -787,6 +1618,32 @@ std::unique_ptr<compress_provider> make_deflate_compressor(int compressionLevel,
 #endif // CPPREST_HTTP_COMPRESSION
 }
 
+std::unique_ptr<compress_provider> make_parallel_gzip_compressor(int compressionLevel, size_t blockSize, size_t threads)
+{
+#if defined(CPPREST_HTTP_COMPRESSION)
+    return utility::details::make_unique<parallel_zlib_compressor>(true, compressionLevel, blockSize, threads);
+#else  // CPPREST_HTTP_COMPRESSION
+    (void)compressionLevel;
+    (void)blockSize;
+    (void)threads;
+    return std::unique_ptr<compress_provider>();
+#endif // CPPREST_HTTP_COMPRESSION
+}
+
+std::unique_ptr<compress_provider> make_parallel_deflate_compressor(int compressionLevel,
+                                                                    size_t blockSize,
+                                                                    size_t threads)
+{
+#if defined(CPPREST_HTTP_COMPRESSION)
+    return utility::details::make_unique<parallel_zlib_compressor>(false, compressionLevel, blockSize, threads);
+#else  // CPPREST_HTTP_COMPRESSION
+    (void)compressionLevel;
+    (void)blockSize;
+    (void)threads;
+    return std::unique_ptr<compress_provider>();
+#endif // CPPREST_HTTP_COMPRESSION
+}
+
 std::unique_ptr<compress_provider> make_brotli_compressor(
     uint32_t window, uint32_t quality, uint32_t mode, uint32_t block, uint32_t nomodel, uint32_t hint)
 {
@@ -802,6 +1659,17 @@ std::unique_ptr<compress_provider> make_brotli_compressor(
     return std::unique_ptr<compress_provider>();
 #endif // CPPREST_BROTLI_COMPRESSION
 }
+
+std::unique_ptr<compress_provider> make_zstd_compressor(int level, int window_log)
+{
+#if defined(CPPREST_HTTP_COMPRESSION) && defined(CPPREST_ZSTD_COMPRESSION)
+    return utility::details::make_unique<zstd_compressor>(level, window_log);
+#else  // CPPREST_ZSTD_COMPRESSION
+    (void)level;
+    (void)window_log;
+    return std::unique_ptr<compress_provider>();
+#endif // CPPREST_ZSTD_COMPRESSION
+}
 } // namespace builtin
 
 std::shared_ptr<compress_factory> make_compress_factory(
@@ -1141,6 +2009,55 @@ utility::string_t build_supported_header(header_types type,
 
     return result;
 }
+
+utility::string_t build_dictionary_header(const std::vector<std::shared_ptr<dictionary>>& dictionaries)
+{
+    utility::string_t result;
+
+    for (auto& dict : dictionaries)
+    {
+        if (dict)
+        {
+            if (!result.empty())
+            {
+                result += _XPLATSTR(", ");
+            }
+            result += dict->id();
+        }
+    }
+
+    return result;
+}
+
+std::shared_ptr<dictionary> find_dictionary(const utility::string_t& ids,
+                                            const std::vector<std::shared_ptr<dictionary>>& dictionaries)
+{
+    size_t start = 0;
+    while (start < ids.size())
+    {
+        size_t comma = ids.find(_XPLATSTR(','), start);
+        if (comma == utility::string_t::npos)
+        {
+            comma = ids.size();
+        }
+        size_t length = comma - start;
+        remove_surrounding_http_whitespace(ids, start, length);
+
+        if (length)
+        {
+            for (auto& dict : dictionaries)
+            {
+                if (dict && dict->id().compare(0, utility::string_t::npos, ids, start, length) == 0)
+                {
+                    return dict;
+                }
+            }
+        }
+        start = comma + 1;
+    }
+
+    return std::shared_ptr<dictionary>();
+}
 } // namespace details
 } // namespace compression
 } // namespace http
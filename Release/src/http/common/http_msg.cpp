@@ -314,6 +314,19 @@ void http_msg_base::_prepare_to_receive_data()
     // or media (like file) that the user can read from...
 }
 
+void http_msg_base::_set_body_size_hint(utility::size64_t size)
+{
+    // Only the buffer created above is ours to size. The hint is capped so that a bogus Content-Length cannot make
+    // the buffer allocate far more than the data that actually arrives.
+    static const utility::size64_t max_block_size = 1024 * 1024;
+    if (m_default_outstream && size > 0)
+    {
+        auto buf = outstream().streambuf();
+        const auto block_size = static_cast<size_t>((std::min)(size, max_block_size));
+        if (block_size > buf.buffer_size(std::ios_base::out)) buf.set_buffer_size(block_size, std::ios_base::out);
+    }
+}
+
 size_t http_msg_base::_get_stream_length()
 {
     auto& stream = instream();
@@ -566,6 +579,23 @@ static bool is_content_type_json(const utility::string_t& content_type)
     return (is_content_type_one_of(std::begin(json_types), std::end(json_types), content_type));
 }
 
+/// <summary>
+/// Determines whether or not the given content type is CBOR.
+/// </summary>
+static bool is_content_type_cbor(const utility::string_t& content_type)
+{
+    return utility::details::str_iequal(content_type, mime_types::application_cbor);
+}
+
+/// <summary>
+/// Determines whether or not the given content type is MessagePack.
+/// </summary>
+static bool is_content_type_msgpack(const utility::string_t& content_type)
+{
+    return utility::details::str_iequal(content_type, mime_types::application_msgpack) ||
+           utility::details::str_iequal(content_type, mime_types::application_xmsgpack);
+}
+
 /// <summary>
 /// Gets the default charset for given content type. If the MIME type is not textual or recognized Latin1 will be
 /// returned.
@@ -660,7 +690,8 @@ utility::string_t details::http_msg_base::parse_and_check_content_type(
         if (!check_content_type(content))
         {
             throw http_exception(
-                _XPLATSTR("Incorrect Content-Type: must be textual to extract_string, JSON to extract_json."));
+                _XPLATSTR("Incorrect Content-Type: must be textual to extract_string, JSON to extract_json, CBOR to "
+                          "extract_cbor, MessagePack to extract_msgpack."));
         }
     }
     return charset;
@@ -945,6 +976,26 @@ json::value details::http_msg_base::_extract_json(bool ignore_content_type)
     }
 }
 
+json::value details::http_msg_base::_extract_cbor(bool ignore_content_type)
+{
+    if (parse_and_check_content_type(ignore_content_type, is_content_type_cbor).empty())
+    {
+        return json::value();
+    }
+
+    return json::value::from_cbor(_extract_vector());
+}
+
+json::value details::http_msg_base::_extract_msgpack(bool ignore_content_type)
+{
+    if (parse_and_check_content_type(ignore_content_type, is_content_type_msgpack).empty())
+    {
+        return json::value();
+    }
+
+    return json::value::from_msgpack(_extract_vector());
+}
+
 std::vector<uint8_t> details::http_msg_base::_extract_vector()
 {
     if (!instream())
@@ -1121,6 +1172,25 @@ void details::http_msg_base::set_body(const concurrency::streams::istream& instr
     m_data_available.set(contentLength);
 }
 
+void details::http_msg_base::_set_json_body(const json::value& body_data, const utility::string_t& content_type)
+{
+    utility::string_t content, charset;
+    parse_content_type_and_charset(content_type, content, charset);
+
+    if (is_content_type_cbor(content) || is_content_type_msgpack(content))
+    {
+        auto body = is_content_type_cbor(content) ? body_data.to_cbor() : body_data.to_msgpack();
+        const auto length = body.size();
+        set_body(streams::bytestream::open_istream(std::move(body)), length, content_type);
+    }
+    else
+    {
+        auto body_text = utility::conversions::to_utf8string(body_data.serialize());
+        const auto length = body_text.size();
+        set_body(streams::bytestream::open_istream(std::move(body_text)), length, content_type);
+    }
+}
+
 details::_http_request::_http_request(http::method mtd)
     : m_method(std::move(mtd))
     , m_initiated_response(0)
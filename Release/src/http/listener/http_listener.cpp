@@ -54,6 +54,101 @@ static void check_listener_uri(const http::uri& address)
     }
 }
 
+compressed_response_cache::compressed_response_cache(size_t capacity)
+    : m_capacity(capacity), m_size(0), m_hits(0), m_misses(0)
+{
+}
+
+size_t compressed_response_cache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_size;
+}
+
+size_t compressed_response_cache::hits() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_hits;
+}
+
+size_t compressed_response_cache::misses() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_misses;
+}
+
+// Neither a request URI nor a header value contains a line break, so joined with them the key parts stay apart.
+static utility::string_t make_cache_key(const utility::string_t& resource,
+                                        const utility::string_t& etag,
+                                        const utility::string_t& encoding)
+{
+    utility::string_t key;
+    key.reserve(resource.size() + etag.size() + encoding.size() + 2);
+    key.append(resource).append(1, _XPLATSTR('\n')).append(etag).append(1, _XPLATSTR('\n')).append(encoding);
+    return key;
+}
+
+std::shared_ptr<const std::vector<uint8_t>> compressed_response_cache::find(const utility::string_t& resource,
+                                                                            const utility::string_t& etag,
+                                                                            const utility::string_t& encoding)
+{
+    const auto key = make_cache_key(resource, etag, encoding);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto found = m_index.find(key);
+    if (found == m_index.end())
+    {
+        ++m_misses;
+        return nullptr;
+    }
+    ++m_hits;
+    m_entries.splice(m_entries.begin(), m_entries, found->second);
+    return found->second->second;
+}
+
+void compressed_response_cache::insert(const utility::string_t& resource,
+                                       const utility::string_t& etag,
+                                       const utility::string_t& encoding,
+                                       std::vector<uint8_t> body)
+{
+    if (body.size() > m_capacity)
+    {
+        return;
+    }
+
+    auto key = make_cache_key(resource, etag, encoding);
+    auto value = std::make_shared<const std::vector<uint8_t>>(std::move(body));
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto found = m_index.find(key);
+    if (found != m_index.end())
+    {
+        m_size -= found->second->second->size();
+        m_entries.erase(found->second);
+        m_index.erase(found);
+    }
+
+    // Connections still sending a dropped body hold their own reference to it
+    while (m_size + value->size() > m_capacity)
+    {
+        m_size -= m_entries.back().second->size();
+        m_index.erase(m_entries.back().first);
+        m_entries.pop_back();
+    }
+
+    m_size += value->size();
+    m_entries.emplace_front(key, std::move(value));
+    m_index.emplace(std::move(key), m_entries.begin());
+}
+
+void compressed_response_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_index.clear();
+    m_entries.clear();
+    m_size = 0;
+}
+
 details::http_listener_impl::http_listener_impl(http::uri address) : m_uri(std::move(address)), m_closed(true)
 {
     check_listener_uri(m_uri);
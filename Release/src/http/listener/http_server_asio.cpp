@@ -16,7 +16,9 @@
 
 #include <boost/algorithm/string/find.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <array>
 #include <boost/asio/read_until.hpp>
+#include <cstring>
 #include <set>
 #include <sstream>
 
@@ -33,9 +35,15 @@
 
 #include "../common/internal_http_helpers.h"
 #include "cpprest/asyncrt_utils.h"
+#include "cpprest/filestream.h"
 #include "http_server_impl.h"
 #include "pplx/threadpool.h"
 
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#endif
+
 #ifdef __ANDROID__
 using utility::conversions::details::to_string;
 #else
@@ -58,6 +66,7 @@ using web::http::http_request;
 using web::http::http_response;
 using web::http::methods;
 using web::http::status_codes;
+using web::http::experimental::listener::compressed_response_cache;
 using web::http::experimental::listener::http_listener_config;
 using web::http::experimental::listener::details::http_listener_impl;
 
@@ -334,6 +343,27 @@ private:
     bool m_chunked;
     std::atomic<int> m_refs; // track how many threads are still referring to this
 
+    // Decompresses the request body as it is received, and compresses the response body as it is sent
+    std::unique_ptr<web::http::compression::decompress_provider> m_decompressor;
+    std::unique_ptr<web::http::compression::compress_provider> m_compressor;
+    std::shared_ptr<web::http::compression::dictionary> m_compression_dictionary;
+    std::vector<uint8_t> m_compress_buffer;
+    size_t m_body_size;
+
+    // Space left after the decompressed data in the last block of the request body buffer
+    size_t m_decompress_space;
+
+    // Compressed bodies are sent from, or collected for, the listener's cache under the request URI and ETag
+    std::shared_ptr<compressed_response_cache> m_response_cache;
+    utility::string_t m_response_resource;
+    utility::string_t m_response_etag;
+    std::shared_ptr<const std::vector<uint8_t>> m_cached_body;
+    std::vector<uint8_t> m_cache_fill;
+
+    // Settings of the listener that decide which responses are compressed
+    size_t m_compression_threshold;
+    std::vector<utility::string_t> m_compressible_content_types;
+
     using ssl_stream = boost::asio::ssl::stream<boost::asio::ip::tcp::socket&>;
 
     std::unique_ptr<boost::asio::ssl::context> m_ssl_context;
@@ -350,6 +380,9 @@ private:
         , m_close(false)
         , m_chunked(false)
         , m_refs(1)
+        , m_body_size(0)
+        , m_decompress_space(0)
+        , m_compression_threshold(0)
     {
     }
 
@@ -416,7 +449,11 @@ private:
     will_deref_t handle_body(const boost::system::error_code& ec);
     will_deref_t handle_chunked_header(const boost::system::error_code& ec);
     will_deref_t handle_chunked_body(const boost::system::error_code& ec, int toWrite);
+    pplx::task<size_t> write_request_body(const uint8_t* data, size_t size);
+    void complete_request_body();
     will_deref_and_erase_t dispatch_request_to_listener();
+    void negotiate_response_compression(const http_request& request, const http_listener_config& config);
+    bool should_compress_response(const http_response& response) const;
     will_erase_from_parent_t do_response()
     {
         auto unique_reference = this->get_reference();
@@ -474,6 +511,16 @@ private:
                                                        const boost::system::error_code& ec);
     will_deref_and_erase_t handle_write_chunked_response(const http_response& response,
                                                          const boost::system::error_code& ec);
+    will_deref_and_erase_t handle_write_compressed_response(const http_response& response,
+                                                            const boost::system::error_code& ec);
+    pplx::task<void> compress_response_chunk(size_t size);
+    utility::string_t response_cache_encoding() const;
+    will_deref_and_erase_t handle_write_cached_response(const http_response& response);
+#if defined(__linux__)
+    will_deref_and_erase_t handle_write_file_response(const http_response& response,
+                                                      int fd,
+                                                      utility::size64_t offset);
+#endif
     will_deref_and_erase_t handle_response_written(const http_response& response, const boost::system::error_code& ec);
     will_deref_and_erase_t finish_request_response();
 
@@ -504,6 +551,11 @@ namespace
 {
 const size_t ChunkSize = 4 * 1024;
 
+// Request bodies are decompressed into blocks of this size, and a block is filled down to the last MinDecompressSpace
+// characters before the next one is started.
+const size_t DecompressBlockSize = 64 * 1024;
+const size_t MinDecompressSpace = 1024;
+
 void hostport_listener::internal_erase_connection(asio_server_connection* conn)
 {
     std::lock_guard<std::mutex> lock(m_connections_lock);
@@ -804,6 +856,52 @@ will_deref_and_erase_t asio_server_connection::handle_headers()
         m_chunked = boost::ifind_first(name, U("chunked"));
     }
 
+    // See if we need to decompress the incoming request body, and if so, prepare for it
+    m_decompressor.reset();
+    m_compressor.reset();
+    m_body_size = 0;
+    m_decompress_space = 0;
+    try
+    {
+        // The handler gets the decoded body, so the coding that was undone is taken off the request headers
+        if (currentRequest.headers().match(header_names::transfer_encoding, name))
+        {
+            m_decompressor = web::http::compression::details::get_decompressor_from_header(
+                name, web::http::compression::details::header_types::transfer_encoding);
+            if (m_decompressor)
+            {
+                currentRequest.headers()[header_names::transfer_encoding] = U("chunked");
+            }
+        }
+        if (!m_decompressor && currentRequest.headers().match(header_names::content_encoding, name))
+        {
+            m_decompressor = web::http::compression::details::get_decompressor_from_header(
+                name, web::http::compression::details::header_types::content_encoding);
+            if (m_decompressor)
+            {
+                currentRequest.headers().remove(header_names::content_encoding);
+            }
+        }
+    }
+    catch (const http_exception& e)
+    {
+        if (e.error_code().value() == status_codes::NotImplemented ||
+            e.error_code().value() == status_codes::UnsupportedMediaType)
+        {
+            // We have no decompressor for this coding; the body is passed on as it is, for the handler to decode
+            m_decompressor.reset();
+        }
+        else
+        {
+            // Something is wrong with the header; the body cannot be read, so the connection cannot be reused either
+            currentRequest.reply(static_cast<web::http::status_code>(e.error_code().value()));
+            m_close = true;
+            (will_erase_from_parent_t) do_bad_response();
+            (will_deref_t) deref();
+            return will_deref_and_erase_t {};
+        }
+    }
+
     currentRequest._get_impl()->_prepare_to_receive_data();
     if (m_chunked)
     {
@@ -823,6 +921,15 @@ will_deref_and_erase_t asio_server_connection::handle_headers()
     }
     else // need to read the sent data
     {
+        if (!m_decompressor)
+        {
+            currentRequest._get_impl()->_set_body_size_hint(m_read_size);
+        }
+        else
+        {
+            // The length is that of the coded body, not of what the handler reads
+            currentRequest.headers().remove(header_names::content_length);
+        }
         m_read = 0;
         ++m_refs;
         async_read_until_buffersize(
@@ -851,7 +958,7 @@ will_deref_t asio_server_connection::handle_chunked_header(const boost::system::
         m_read += len;
         if (len == 0)
         {
-            requestImpl->_complete(m_read);
+            complete_request_body();
             return deref();
         }
         else
@@ -874,8 +981,7 @@ will_deref_t asio_server_connection::handle_chunked_body(const boost::system::er
     }
     else
     {
-        auto writebuf = requestImpl->outstream().streambuf();
-        writebuf.putn_nocopy(buffer_cast<const uint8_t*>(m_request_buf.data()), toWrite)
+        write_request_body(buffer_cast<const uint8_t*>(m_request_buf.data()), toWrite)
             .then([=](pplx::task<size_t> writeChunkTask) -> will_deref_t {
                 try
                 {
@@ -905,10 +1011,8 @@ will_deref_t asio_server_connection::handle_body(const boost::system::error_code
     }
     else if (m_read < m_read_size) // there is more to read
     {
-        auto writebuf = requestImpl->outstream().streambuf();
-        writebuf
-            .putn_nocopy(boost::asio::buffer_cast<const uint8_t*>(m_request_buf.data()),
-                         std::min(m_request_buf.size(), m_read_size - m_read))
+        write_request_body(boost::asio::buffer_cast<const uint8_t*>(m_request_buf.data()),
+                           std::min(m_request_buf.size(), m_read_size - m_read))
             .then([this](pplx::task<size_t> writtenSizeTask) -> will_deref_t {
                 size_t writtenSize = 0;
                 try
@@ -932,11 +1036,78 @@ will_deref_t asio_server_connection::handle_body(const boost::system::error_code
     }
     else // have read request body
     {
-        requestImpl->_complete(m_read);
+        complete_request_body();
         return deref();
     }
 }
 
+pplx::task<size_t> asio_server_connection::write_request_body(const uint8_t* data, size_t size)
+{
+    auto writebuf = get_request()._get_impl()->outstream().streambuf();
+    if (!m_decompressor)
+    {
+        m_body_size += size;
+        return writebuf.putn_nocopy(data, size);
+    }
+
+    // Decompress straight into blocks of the body buffer, continuing in the space the previous part left in the last
+    // one. Only this connection writes to the buffer, so that space is still there.
+    try
+    {
+        size_t total_used = 0;
+        bool done = false;
+        while (total_used < size && !done)
+        {
+            const size_t block_size =
+                m_decompress_space >= MinDecompressSpace ? m_decompress_space : DecompressBlockSize;
+            uint8_t* block = writebuf.alloc(block_size);
+            if (block == nullptr)
+            {
+                throw http_exception("Cannot write the decompressed request body");
+            }
+
+            size_t used = 0;
+            size_t got = 0;
+            try
+            {
+                got = m_decompressor->decompress(data + total_used,
+                                                 size - total_used,
+                                                 block,
+                                                 block_size,
+                                                 web::http::compression::operation_hint::has_more,
+                                                 used,
+                                                 done);
+            }
+            catch (...)
+            {
+                writebuf.commit(0);
+                throw;
+            }
+            writebuf.commit(got);
+            m_decompress_space = block_size - got;
+            m_body_size += got;
+            total_used += used;
+
+            if (used == 0 && got == 0 && !done)
+            {
+                throw http_exception("Invalid compressed request body");
+            }
+        }
+    }
+    catch (...)
+    {
+        return pplx::task_from_exception<size_t>(std::current_exception());
+    }
+
+    // Anything after the end of the compressed data is dropped
+    return pplx::task_from_result(size);
+}
+
+void asio_server_connection::complete_request_body()
+{
+    get_request()._get_impl()->_complete(m_body_size);
+}
+
 will_deref_and_erase_t asio_server_connection::async_write(WriteFunc response_func_ptr, const http_response& response)
 {
     if (m_ssl_stream)
@@ -1022,6 +1193,7 @@ will_deref_and_erase_t asio_server_connection::dispatch_request_to_listener()
     }
 
     currentRequest._set_listener_path(pListener->uri().path());
+    negotiate_response_compression(currentRequest, pListener->configuration());
     (will_erase_from_parent_t) do_response();
 
     // Look up the lock for the http_listener.
@@ -1059,6 +1231,113 @@ will_deref_and_erase_t asio_server_connection::dispatch_request_to_listener()
     return will_deref_and_erase_t {};
 }
 
+void asio_server_connection::negotiate_response_compression(const http_request& request,
+                                                            const http_listener_config& config)
+{
+    m_compression_dictionary.reset();
+    m_response_cache.reset();
+
+    utility::string_t encoding;
+    if (!config.compress_responses() || request.method() == methods::HEAD ||
+        !request.headers().match(header_names::accept_encoding, encoding))
+    {
+        return;
+    }
+
+    try
+    {
+        // A dictionary both ends hold is used with the client's preferred algorithm among those that support one
+        utility::string_t dictionary_id;
+        if (!config.compression_dictionaries().empty() &&
+            request.headers().match(header_names::dictionary_id, dictionary_id))
+        {
+            auto dict = web::http::compression::details::find_dictionary(dictionary_id,
+                                                                          config.compression_dictionaries());
+            if (dict)
+            {
+                std::vector<std::shared_ptr<web::http::compression::compress_factory>> factories;
+                for (auto name : {web::http::compression::builtin::algorithm::ZSTD,
+                                  web::http::compression::builtin::algorithm::DEFLATE})
+                {
+                    if (web::http::compression::builtin::algorithm::supported(name))
+                    {
+                        factories.push_back(web::http::compression::make_compress_factory(name, [=]() {
+                            return web::http::compression::builtin::make_compressor(name, dict);
+                        }));
+                    }
+                }
+                m_compressor = web::http::compression::details::get_compressor_from_header(
+                    encoding, web::http::compression::details::header_types::accept_encoding, factories);
+                if (m_compressor)
+                {
+                    m_compression_dictionary = dict;
+                }
+            }
+        }
+
+        if (!m_compressor)
+        {
+            m_compressor = web::http::compression::details::get_compressor_from_header(
+                encoding, web::http::compression::details::header_types::accept_encoding);
+        }
+    }
+    catch (const http_exception&)
+    {
+        // A malformed header just means the response is sent as it is
+        return;
+    }
+
+    if (m_compressor)
+    {
+        m_compression_threshold = config.compression_threshold();
+        m_compressible_content_types = config.compressible_content_types();
+        m_response_cache = config.response_cache();
+        if (m_response_cache)
+        {
+            m_response_resource = request.request_uri().to_string();
+        }
+    }
+}
+
+bool asio_server_connection::should_compress_response(const http_response& response) const
+{
+    if (!response.body() || response.headers().has(header_names::content_encoding) ||
+        response.status_code() < status_codes::OK || response.status_code() == status_codes::NoContent ||
+        response.status_code() == status_codes::PartialContent ||
+        response.status_code() == status_codes::NotModified || response.headers().has(header_names::content_range))
+    {
+        return false;
+    }
+
+    // Leave alone bodies the responder encodes itself, and those too small to be worth the effort
+    utility::string_t transfer_encoding;
+    if (response.headers().match(header_names::transfer_encoding, transfer_encoding) &&
+        !boost::iequals(transfer_encoding, U("chunked")))
+    {
+        return false;
+    }
+    size_t content_length;
+    if (response.headers().match(header_names::content_length, content_length) &&
+        content_length < m_compression_threshold)
+    {
+        return false;
+    }
+
+    // Entries ending with a slash match the whole media type, such as "text/"; others must match exactly
+    auto content_type = response.headers().content_type();
+    content_type = content_type.substr(0, content_type.find(U(';')));
+    web::http::details::trim_whitespace(content_type);
+    for (const auto& type : m_compressible_content_types)
+    {
+        if (!type.empty() && type.back() == U('/') ? boost::istarts_with(content_type, type)
+                                                   : boost::iequals(content_type, type))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 void asio_server_connection::serialize_headers(http_response response)
 {
     m_response_buf.consume(m_response_buf.size()); // clear the buffer
@@ -1071,6 +1350,50 @@ void asio_server_connection::serialize_headers(http_response response)
     m_chunked = false;
     m_write = m_write_size = 0;
 
+    m_cached_body.reset();
+    m_response_etag.clear();
+    if (m_compressor && !should_compress_response(response))
+    {
+        m_compressor.reset();
+    }
+    if (m_compressor)
+    {
+        // Only a strong ETag promises the same bytes, and only bodies of known length are worth keeping
+        utility::string_t etag;
+        if (response.headers().match(header_names::etag, etag) && !etag.empty() && !boost::starts_with(etag, U("W/")))
+        {
+            if (m_response_cache && response.headers().has(header_names::content_length))
+            {
+                m_cached_body = m_response_cache->find(m_response_resource, etag, response_cache_encoding());
+                if (!m_cached_body)
+                {
+                    m_response_etag = etag;
+                    m_cache_fill.clear();
+                }
+            }
+
+            // The coded bytes differ from those the strong ETag names, so it is weakened, as other servers do
+            response.headers()[header_names::etag] = U("W/") + etag;
+        }
+
+        // Otherwise the compressed length is not known up front, so the body is sent in chunks
+        if (m_cached_body)
+        {
+            response.headers().set_content_length(m_cached_body->size());
+        }
+        else
+        {
+            response.headers().remove(header_names::content_length);
+        }
+        response.headers().add(header_names::content_encoding, m_compressor->algorithm());
+        response.headers().add(header_names::vary, header_names::accept_encoding);
+        if (m_compression_dictionary)
+        {
+            response.headers().add(header_names::content_dictionary, m_compression_dictionary->id());
+            response.headers().add(header_names::vary, header_names::dictionary_id);
+        }
+    }
+
     std::string transferencoding;
     if (response.headers().match(header_names::transfer_encoding, transferencoding) && transferencoding == "chunked")
     {
@@ -1126,6 +1449,39 @@ will_deref_and_erase_t asio_server_connection::handle_write_chunked_response(con
         return cancel_sending_response_with_error(
             response, std::make_exception_ptr(http_exception("Response stream close early!")));
     }
+
+    // Blocks the stream buffer exposes are written in place, with the chunk header and trailer around them.
+    uint8_t* block = nullptr;
+    size_t available = 0;
+    if (readbuf.acquire(block, available) && block != nullptr && available > 0)
+    {
+        const size_t writeBytes = std::min(available, static_cast<size_t>(0xFFFFFFFF));
+        char header[16];
+        const size_t headerSize = static_cast<size_t>(snprintf(header, sizeof(header), "%zX\r\n", writeBytes));
+        std::memcpy(buffer_cast<char*>(m_response_buf.prepare(headerSize)), header, headerSize);
+        m_response_buf.commit(headerSize);
+
+        static const char trailer[] = "\r\n";
+        const std::array<boost::asio::const_buffer, 3> buffers = {{boost::asio::buffer(m_response_buf.data()),
+                                                                   boost::asio::buffer(block, writeBytes),
+                                                                   boost::asio::buffer(trailer, 2)}};
+        auto on_written = [=](const boost::system::error_code& ec, std::size_t) {
+            auto buf = readbuf;
+            buf.release(block, ec ? 0 : writeBytes);
+            m_response_buf.consume(headerSize);
+            (will_deref_and_erase_t) this->handle_write_chunked_response(response, ec);
+        };
+        if (m_ssl_stream)
+        {
+            boost::asio::async_write(*m_ssl_stream, buffers, on_written);
+        }
+        else
+        {
+            boost::asio::async_write(*m_socket, buffers, on_written);
+        }
+        return will_deref_and_erase_t {};
+    }
+
     auto membuf = m_response_buf.prepare(ChunkSize + chunked_encoding::additional_encoding_space);
 
     readbuf.getn(buffer_cast<uint8_t*>(membuf) + chunked_encoding::data_offset, ChunkSize)
@@ -1151,6 +1507,146 @@ will_deref_and_erase_t asio_server_connection::handle_write_chunked_response(con
     return will_deref_and_erase_t {};
 }
 
+will_deref_and_erase_t asio_server_connection::handle_write_compressed_response(const http_response& response,
+                                                                                const boost::system::error_code& ec)
+{
+    if (ec)
+    {
+        return handle_response_written(response, ec);
+    }
+
+    auto readbuf = response._get_impl()->instream().streambuf();
+    if (readbuf.is_eof())
+    {
+        return cancel_sending_response_with_error(
+            response, std::make_exception_ptr(http_exception("Response stream close early!")));
+    }
+
+    m_compress_buffer.resize(ChunkSize);
+    readbuf.getn(m_compress_buffer.data(), ChunkSize)
+        .then([=](size_t actualSize) {
+            return compress_response_chunk(actualSize).then([actualSize]() { return actualSize; });
+        })
+        .then([=](pplx::task<size_t> actualSizeTask) -> will_deref_and_erase_t {
+            size_t actualSize = 0;
+            try
+            {
+                actualSize = actualSizeTask.get();
+            }
+            catch (...)
+            {
+                return cancel_sending_response_with_error(response, std::current_exception());
+            }
+            if (actualSize == 0)
+                return async_write(&asio_server_connection::handle_response_written, response);
+            else
+                return async_write(&asio_server_connection::handle_write_compressed_response, response);
+        });
+    return will_deref_and_erase_t {};
+}
+
+pplx::task<void> asio_server_connection::compress_response_chunk(size_t size)
+{
+    // An empty read marks the end of the body; the compressor is then flushed and the last chunk added
+    const auto hint = size == 0 ? web::http::compression::operation_hint::is_last
+                                : web::http::compression::operation_hint::has_more;
+    auto total_used = std::make_shared<size_t>(0);
+
+    // The asynchronous overload is used so that a compressor waiting on other threads does not hold this one
+    auto loop = pplx::details::_do_while([this, size, hint, total_used]() -> pplx::task<bool> {
+        auto membuf = m_response_buf.prepare(ChunkSize + chunked_encoding::additional_encoding_space);
+        auto chunk = buffer_cast<uint8_t*>(membuf);
+        return m_compressor
+            ->compress(m_compress_buffer.data() + *total_used,
+                       size - *total_used,
+                       chunk + chunked_encoding::data_offset,
+                       ChunkSize,
+                       hint)
+            .then([this, size, hint, total_used, chunk](web::http::compression::operation_result result) {
+                *total_used += result.input_bytes_processed;
+                const size_t got = result.output_bytes_produced;
+                if (got > 0 && !m_response_etag.empty())
+                {
+                    // Give up collecting a body that would not fit in the cache anyway
+                    if (m_cache_fill.size() + got <= m_response_cache->capacity())
+                    {
+                        m_cache_fill.insert(m_cache_fill.end(),
+                                            chunk + chunked_encoding::data_offset,
+                                            chunk + chunked_encoding::data_offset + got);
+                    }
+                    else
+                    {
+                        m_response_etag.clear();
+                        std::vector<uint8_t>().swap(m_cache_fill);
+                    }
+                }
+                if (got > 0)
+                {
+                    // Move the chunk to the start of the prepared space, after whatever is already waiting to be sent
+                    const size_t offset = chunked_encoding::add_chunked_delimiters(
+                        chunk, ChunkSize + chunked_encoding::additional_encoding_space, got);
+                    const size_t length = got + chunked_encoding::additional_encoding_space - offset;
+                    std::memmove(chunk, chunk + offset, length);
+                    m_response_buf.commit(length);
+                }
+                else if (result.input_bytes_processed == 0 && !result.done)
+                {
+                    if (hint == web::http::compression::operation_hint::has_more) return false;
+                    throw http_exception("Compressor made no progress");
+                }
+                return *total_used < size || (hint == web::http::compression::operation_hint::is_last && !result.done);
+            });
+    });
+
+    return loop.then([this, hint](bool) {
+        if (hint == web::http::compression::operation_hint::is_last)
+        {
+            if (!m_response_etag.empty())
+            {
+                m_response_cache->insert(
+                    m_response_resource, m_response_etag, response_cache_encoding(), std::move(m_cache_fill));
+                m_response_etag.clear();
+                m_cache_fill.clear();
+            }
+
+            static const char last_chunk[] = "0\r\n\r\n";
+            const size_t length = sizeof(last_chunk) - 1;
+            std::memcpy(buffer_cast<char*>(m_response_buf.prepare(length)), last_chunk, length);
+            m_response_buf.commit(length);
+        }
+    });
+}
+
+utility::string_t asio_server_connection::response_cache_encoding() const
+{
+    // A body compressed with a preset dictionary is only of use to clients holding the same one
+    auto encoding = m_compressor->algorithm();
+    if (m_compression_dictionary)
+    {
+        encoding.append(U(";dictionary=")).append(m_compression_dictionary->id());
+    }
+    return encoding;
+}
+
+will_deref_and_erase_t asio_server_connection::handle_write_cached_response(const http_response& response)
+{
+    // The body is written straight from the cache; the reference taken here keeps it alive if it is dropped meanwhile
+    auto body = m_cached_body;
+    auto on_written = [=](const boost::system::error_code& ec, std::size_t) {
+        (void)body;
+        (will_deref_and_erase_t) this->handle_response_written(response, ec);
+    };
+    if (m_ssl_stream)
+    {
+        boost::asio::async_write(*m_ssl_stream, boost::asio::buffer(*body), on_written);
+    }
+    else
+    {
+        boost::asio::async_write(*m_socket, boost::asio::buffer(*body), on_written);
+    }
+    return will_deref_and_erase_t {};
+}
+
 will_deref_and_erase_t asio_server_connection::handle_write_large_response(const http_response& response,
                                                                            const boost::system::error_code& ec)
 {
@@ -1160,6 +1656,49 @@ will_deref_and_erase_t asio_server_connection::handle_write_large_response(const
     if (readbuf.is_eof())
         return cancel_sending_response_with_error(
             response, std::make_exception_ptr(http_exception("Response stream close early!")));
+
+#if defined(__linux__)
+    // Regular files sent over plain connections are handed to the kernel, which copies them from the page cache
+    // straight to the socket.
+    if (!m_ssl_stream)
+    {
+        auto filebuf =
+            dynamic_cast<concurrency::streams::details::basic_file_buffer<uint8_t>*>(readbuf.get_base().get());
+        int fd = -1;
+        utility::size64_t offset = 0;
+        struct stat st;
+        if (filebuf != nullptr && filebuf->_get_read_handle(fd, offset) && fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+        {
+            return handle_write_file_response(response, fd, offset);
+        }
+    }
+#endif
+
+    // Stream buffers that expose their storage (memory, memory-mapped files and producer/consumer buffers, such as a
+    // request body being forwarded by a proxy) are written to the socket in place. An acquired block stays put until
+    // it is released, even while a writer keeps appending.
+    uint8_t* block = nullptr;
+    size_t available = 0;
+    if (readbuf.acquire(block, available) && block != nullptr && available > 0)
+    {
+        const size_t writeBytes = std::min(available, m_write_size - m_write);
+        auto on_written = [=](const boost::system::error_code& ec, std::size_t) {
+            auto buf = readbuf;
+            buf.release(block, ec ? 0 : writeBytes);
+            if (!ec) m_write += writeBytes;
+            (will_deref_and_erase_t) this->handle_write_large_response(response, ec);
+        };
+        if (m_ssl_stream)
+        {
+            boost::asio::async_write(*m_ssl_stream, boost::asio::buffer(block, writeBytes), on_written);
+        }
+        else
+        {
+            boost::asio::async_write(*m_socket, boost::asio::buffer(block, writeBytes), on_written);
+        }
+        return will_deref_and_erase_t {};
+    }
+
     size_t readBytes = std::min(ChunkSize, m_write_size - m_write);
     readbuf.getn(buffer_cast<uint8_t*>(m_response_buf.prepare(readBytes)), readBytes)
         .then([=](pplx::task<size_t> actualSizeTask) -> will_deref_and_erase_t {
@@ -1179,6 +1718,51 @@ will_deref_and_erase_t asio_server_connection::handle_write_large_response(const
     return will_deref_and_erase_t {};
 }
 
+#if defined(__linux__)
+will_deref_and_erase_t asio_server_connection::handle_write_file_response(const http_response& response,
+                                                                          int fd,
+                                                                          utility::size64_t offset)
+{
+    boost::system::error_code ec;
+    m_socket->native_non_blocking(true, ec);
+    while (!ec && m_write < m_write_size)
+    {
+        off_t fileOffset = static_cast<off_t>(offset);
+        const ssize_t sent = ::sendfile(m_socket->native_handle(), fd, &fileOffset, m_write_size - m_write);
+        if (sent > 0)
+        {
+            m_write += static_cast<size_t>(sent);
+            offset += static_cast<utility::size64_t>(sent);
+        }
+        else if (sent == 0)
+        {
+            return cancel_sending_response_with_error(
+                response, std::make_exception_ptr(http_exception("Response stream close early!")));
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            // The socket's send buffer is full; carry on once it has drained.
+            m_socket->async_wait(tcp::socket::wait_write, [=](const boost::system::error_code& ec) {
+                if (ec)
+                    (will_deref_and_erase_t) this->handle_response_written(response, ec);
+                else
+                    (will_deref_and_erase_t) this->handle_write_file_response(response, fd, offset);
+            });
+            return will_deref_and_erase_t {};
+        }
+        else if (errno != EINTR)
+        {
+            ec = boost::system::error_code(errno, boost::system::system_category());
+        }
+    }
+
+    // Leave the stream positioned after the data sent, as if the body had been read through it.
+    auto readbuf = response._get_impl()->instream().streambuf();
+    readbuf.seekpos(static_cast<std::streampos>(offset), std::ios_base::in);
+    return handle_response_written(response, ec);
+}
+#endif
+
 will_deref_and_erase_t asio_server_connection::handle_headers_written(const http_response& response,
                                                                       const boost::system::error_code& ec)
 {
@@ -1189,7 +1773,11 @@ will_deref_and_erase_t asio_server_connection::handle_headers_written(const http
     }
     else
     {
-        if (m_chunked)
+        if (m_cached_body)
+            return handle_write_cached_response(response);
+        else if (m_compressor)
+            return handle_write_compressed_response(response, ec);
+        else if (m_chunked)
             return handle_write_chunked_response(response, ec);
         else
             return handle_write_large_response(response, ec);
@@ -31,7 +31,7 @@ utility::istream_t& web::json::operator>>(utility::istream_t& is, json::value& v
 }
 
 web::json::value::value()
-    : m_value(utility::details::make_unique<web::json::details::_Null>())
+    : m_value(details::_construct_value<details::_Null>(m_storage))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Null)
 #endif
@@ -39,7 +39,7 @@ web::json::value::value()
 }
 
 web::json::value::value(int32_t value)
-    : m_value(utility::details::make_unique<web::json::details::_Number>(value))
+    : m_value(details::_construct_value<details::_Number>(m_storage, value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Number)
 #endif
@@ -47,7 +47,7 @@ web::json::value::value(int32_t value)
 }
 
 web::json::value::value(uint32_t value)
-    : m_value(utility::details::make_unique<web::json::details::_Number>(value))
+    : m_value(details::_construct_value<details::_Number>(m_storage, value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Number)
 #endif
@@ -55,7 +55,7 @@ web::json::value::value(uint32_t value)
 }
 
 web::json::value::value(int64_t value)
-    : m_value(utility::details::make_unique<web::json::details::_Number>(value))
+    : m_value(details::_construct_value<details::_Number>(m_storage, value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Number)
 #endif
@@ -63,7 +63,7 @@ web::json::value::value(int64_t value)
 }
 
 web::json::value::value(uint64_t value)
-    : m_value(utility::details::make_unique<web::json::details::_Number>(value))
+    : m_value(details::_construct_value<details::_Number>(m_storage, value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Number)
 #endif
@@ -71,7 +71,7 @@ web::json::value::value(uint64_t value)
 }
 
 web::json::value::value(double value)
-    : m_value(utility::details::make_unique<web::json::details::_Number>(value))
+    : m_value(details::_construct_value<details::_Number>(m_storage, value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Number)
 #endif
@@ -79,7 +79,7 @@ web::json::value::value(double value)
 }
 
 web::json::value::value(bool value)
-    : m_value(utility::details::make_unique<web::json::details::_Boolean>(value))
+    : m_value(details::_construct_value<details::_Boolean>(m_storage, value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::Boolean)
 #endif
@@ -87,7 +87,7 @@ web::json::value::value(bool value)
 }
 
 web::json::value::value(utility::string_t value)
-    : m_value(utility::details::make_unique<web::json::details::_String>(std::move(value)))
+    : m_value(details::_construct_value<details::_String>(m_storage, std::move(value)))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::String)
 #endif
@@ -95,7 +95,7 @@ web::json::value::value(utility::string_t value)
 }
 
 web::json::value::value(utility::string_t value, bool has_escape_chars)
-    : m_value(utility::details::make_unique<web::json::details::_String>(std::move(value), has_escape_chars))
+    : m_value(details::_construct_value<details::_String>(m_storage, std::move(value), has_escape_chars))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::String)
 #endif
@@ -103,7 +103,7 @@ web::json::value::value(utility::string_t value, bool has_escape_chars)
 }
 
 web::json::value::value(const utility::char_t* value)
-    : m_value(utility::details::make_unique<web::json::details::_String>(value))
+    : m_value(details::_construct_value<details::_String>(m_storage, value))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::String)
 #endif
@@ -111,7 +111,7 @@ web::json::value::value(const utility::char_t* value)
 }
 
 web::json::value::value(const utility::char_t* value, bool has_escape_chars)
-    : m_value(utility::details::make_unique<web::json::details::_String>(utility::string_t(value), has_escape_chars))
+    : m_value(details::_construct_value<details::_String>(m_storage, utility::string_t(value), has_escape_chars))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(value::String)
 #endif
@@ -119,7 +119,7 @@ web::json::value::value(const utility::char_t* value, bool has_escape_chars)
 }
 
 web::json::value::value(const value& other)
-    : m_value(other.m_value->_copy_value())
+    : m_value(other.m_value->_copy_to(m_storage))
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
     , m_kind(other.m_kind)
 #endif
@@ -130,7 +130,10 @@ web::json::value& web::json::value::operator=(const value& other)
 {
     if (this != &other)
     {
-        m_value = std::unique_ptr<details::_Value>(other.m_value->_copy_value());
+        // Copy first so that this value is unchanged if copying throws.
+        value copy(other);
+        _release();
+        _take(copy);
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
         m_kind = other.m_kind;
 #endif
@@ -138,26 +141,69 @@ web::json::value& web::json::value::operator=(const value& other)
     return *this;
 }
 
-web::json::value::value(value&& other) CPPREST_NOEXCEPT : m_value(std::move(other.m_value))
+web::json::value::value(value&& other) CPPREST_NOEXCEPT
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
-    ,
-                                                          m_kind(other.m_kind)
+    : m_kind(other.m_kind)
 #endif
 {
+    _take(other);
 }
 
 web::json::value& web::json::value::operator=(web::json::value&& other) CPPREST_NOEXCEPT
 {
     if (this != &other)
     {
-        m_value.swap(other.m_value);
+        // other may be owned by this value, e.g. one of its fields, so take it out before releasing anything.
+        value taken(std::move(other));
+        _release();
+        _take(taken);
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
-        m_kind = other.m_kind;
+        m_kind = taken.m_kind;
 #endif
     }
     return *this;
 }
 
+web::json::value::~value() { _release(); }
+
+void web::json::value::_reset(details::_Value* v) CPPREST_NOEXCEPT
+{
+    _release();
+    m_value = v;
+}
+
+void web::json::value::_take(value& other) CPPREST_NOEXCEPT
+{
+    static_assert(details::_fits_inline<details::_Null>::value, "a null value must not require an allocation");
+    static_assert(details::_fits_inline<details::_Number>::value, "a number value must not require an allocation");
+
+    if (other._is_inline())
+    {
+        m_value = other.m_value->_move_to(m_storage);
+        other.m_value->~_Value();
+    }
+    else
+    {
+        m_value = other.m_value;
+    }
+    other.m_value = new (&other.m_storage) details::_Null();
+#ifdef ENABLE_JSON_VALUE_VISUALIZER
+    other.m_kind = value::Null;
+#endif
+}
+
+void web::json::value::_release() CPPREST_NOEXCEPT
+{
+    if (_is_inline())
+    {
+        m_value->~_Value();
+    }
+    else
+    {
+        delete m_value;
+    }
+}
+
 web::json::value web::json::value::null() { return web::json::value(); }
 
 web::json::value web::json::value::number(double value) { return web::json::value(value); }
@@ -174,38 +220,24 @@ web::json::value web::json::value::boolean(bool value) { return web::json::value
 
 web::json::value web::json::value::string(utility::string_t value)
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_String>(std::move(value));
-    return web::json::value(std::move(ptr)
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-                                ,
-                            value::String
-#endif
-    );
+    web::json::value result;
+    result._emplace<details::_String>(std::move(value));
+    return result;
 }
 
 web::json::value web::json::value::string(utility::string_t value, bool has_escape_chars)
 {
-    std::unique_ptr<details::_Value> ptr =
-        utility::details::make_unique<details::_String>(std::move(value), has_escape_chars);
-    return web::json::value(std::move(ptr)
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-                                ,
-                            value::String
-#endif
-    );
+    web::json::value result;
+    result._emplace<details::_String>(std::move(value), has_escape_chars);
+    return result;
 }
 
 #ifdef _WIN32
 web::json::value web::json::value::string(const std::string& value)
 {
-    std::unique_ptr<details::_Value> ptr =
-        utility::details::make_unique<details::_String>(utility::conversions::to_utf16string(value));
-    return web::json::value(std::move(ptr)
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-                                ,
-                            value::String
-#endif
-    );
+    web::json::value result;
+    result._emplace<details::_String>(utility::conversions::to_utf16string(value));
+    return result;
 }
 #endif
 
@@ -275,11 +307,19 @@ bool web::json::value::as_bool() const { return m_value->as_bool(); }
 
 json::array& web::json::value::as_array() { return m_value->as_array(); }
 
-const json::array& web::json::value::as_array() const { return m_value->as_array(); }
+const json::array& web::json::value::as_array() const
+{
+    // Dispatch to the const overload so that lazily parsed values are not marked as modified.
+    return static_cast<const details::_Value&>(*m_value).as_array();
+}
 
 json::object& web::json::value::as_object() { return m_value->as_object(); }
 
-const json::object& web::json::value::as_object() const { return m_value->as_object(); }
+const json::object& web::json::value::as_object() const
+{
+    // Dispatch to the const overload so that lazily parsed values are not marked as modified.
+    return static_cast<const details::_Value&>(*m_value).as_object();
+}
 
 bool web::json::number::is_int32() const
 {
@@ -406,7 +446,7 @@ utility::string_t json::value::to_string() const
 
 bool json::value::operator==(const json::value& other) const
 {
-    if (this->m_value.get() == other.m_value.get()) return true;
+    if (this->m_value == other.m_value) return true;
     if (this->type() != other.type()) return false;
 
     switch (this->type())
@@ -416,11 +456,18 @@ bool json::value::operator==(const json::value& other) const
         case Boolean: return this->as_bool() == other.as_bool();
         case String: return this->as_string() == other.as_string();
         case Object:
-            return static_cast<const json::details::_Object*>(this->m_value.get())
-                ->is_equal(static_cast<const json::details::_Object*>(other.m_value.get()));
+        {
+            // Compare through the accessors since either side may be a lazily parsed value.
+            const auto& lhs = this->as_object();
+            const auto& rhs = other.as_object();
+            return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+        }
         case Array:
-            return static_cast<const json::details::_Array*>(this->m_value.get())
-                ->is_equal(static_cast<const json::details::_Array*>(other.m_value.get()));
+        {
+            const auto& lhs = this->as_array();
+            const auto& rhs = other.as_array();
+            return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+        }
     }
     __assume(0);
 }
@@ -442,7 +489,7 @@ web::json::value& web::json::value::operator[](const utility::string_t& key)
 {
     if (this->is_null())
     {
-        m_value.reset(new web::json::details::_Object(details::g_keep_json_object_unsorted));
+        _reset(new web::json::details::_Object(details::g_keep_json_object_unsorted));
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
         m_kind = value::Object;
 #endif
@@ -454,7 +501,7 @@ web::json::value& web::json::value::operator[](size_t index)
 {
     if (this->is_null())
     {
-        m_value.reset(new web::json::details::_Array());
+        _reset(new web::json::details::_Array());
 #ifdef ENABLE_JSON_VALUE_VISUALIZER
         m_kind = value::Array;
 #endif
@@ -0,0 +1,723 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * HTTP Library: CBOR (RFC 8949) and MessagePack encoding of JSON values
+ *
+ * For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+
+#include "stdafx.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace web;
+using namespace web::json;
+using namespace utility;
+using namespace utility::conversions;
+
+namespace
+{
+// Same limit as the text parser, protects the recursive decoders against stack exhaustion.
+const size_t max_binary_nesting_depth = 128;
+
+void append_be(std::vector<unsigned char>& out, uint64_t value, size_t bytes)
+{
+    for (size_t shift = bytes * 8; shift != 0; shift -= 8)
+    {
+        out.push_back(static_cast<unsigned char>(value >> (shift - 8)));
+    }
+}
+
+// Doubles which survive a round trip through float are written in the shorter encoding.
+bool fits_in_float(double value)
+{
+    if (!std::isfinite(value))
+    {
+        return true;
+    }
+    return std::fabs(value) <= FLT_MAX && static_cast<double>(static_cast<float>(value)) == value;
+}
+
+uint32_t float_bits(double value)
+{
+    const float f = static_cast<float>(value);
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+uint64_t double_bits(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/// <summary>
+/// Bounds checked big-endian reader over a byte buffer, shared by the CBOR and MessagePack decoders.
+/// </summary>
+class binary_reader
+{
+public:
+    binary_reader(const unsigned char* data, size_t size, const char* format)
+        : m_cur(data), m_end(data + size), m_format(format)
+    {
+    }
+
+    bool at_end() const { return m_cur == m_end; }
+
+    size_t remaining() const { return static_cast<size_t>(m_end - m_cur); }
+
+    unsigned char peek() const
+    {
+        ensure(1);
+        return *m_cur;
+    }
+
+    unsigned char read_byte()
+    {
+        ensure(1);
+        return *m_cur++;
+    }
+
+    uint64_t read_be(size_t bytes)
+    {
+        ensure(bytes);
+        uint64_t result = 0;
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            result = (result << 8) | *m_cur++;
+        }
+        return result;
+    }
+
+    float read_float()
+    {
+        const uint32_t bits = static_cast<uint32_t>(read_be(4));
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    double read_double()
+    {
+        const uint64_t bits = read_be(8);
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+
+    void read_string(uint64_t length, std::string& str)
+    {
+        if (length > remaining())
+        {
+            fail("unexpected end of data");
+        }
+        str.append(reinterpret_cast<const char*>(m_cur), static_cast<size_t>(length));
+        m_cur += static_cast<size_t>(length);
+    }
+
+    // Never reserve more elements than there are bytes left, a malicious length prefix
+    // must not be able to trigger a huge allocation.
+    size_t reserve_hint(uint64_t count) const
+    {
+        return count < remaining() ? static_cast<size_t>(count) : remaining();
+    }
+
+    void check_depth(size_t depth) const
+    {
+        if (depth > max_binary_nesting_depth)
+        {
+            fail("nesting too deep");
+        }
+    }
+
+    void check_at_end() const
+    {
+        if (!at_end())
+        {
+            fail("left-over bytes after decoding a value");
+        }
+    }
+
+    [[noreturn]] void fail(const char* message) const
+    {
+        throw json_exception(std::string(m_format) + ": " + message);
+    }
+
+private:
+    void ensure(size_t bytes) const
+    {
+        if (bytes > remaining())
+        {
+            fail("unexpected end of data");
+        }
+    }
+
+    const unsigned char* m_cur;
+    const unsigned char* m_end;
+    const char* m_format;
+};
+
+json::value make_object(std::vector<std::pair<utility::string_t, json::value>> fields)
+{
+    return json::value::object(std::move(fields), json::details::g_keep_json_object_unsorted);
+}
+
+//
+// CBOR
+//
+
+enum cbor_major_type
+{
+    cbor_unsigned = 0,
+    cbor_negative = 1,
+    cbor_bytes = 2,
+    cbor_text = 3,
+    cbor_array = 4,
+    cbor_map = 5,
+    cbor_tag = 6,
+    cbor_simple = 7
+};
+
+const unsigned char cbor_indefinite = 31;
+const unsigned char cbor_break = 0xff;
+
+void cbor_write_head(std::vector<unsigned char>& out, cbor_major_type major, uint64_t argument)
+{
+    const unsigned char type = static_cast<unsigned char>(major << 5);
+    if (argument < 24)
+    {
+        out.push_back(static_cast<unsigned char>(type | argument));
+    }
+    else if (argument <= 0xff)
+    {
+        out.push_back(type | 24);
+        append_be(out, argument, 1);
+    }
+    else if (argument <= 0xffff)
+    {
+        out.push_back(type | 25);
+        append_be(out, argument, 2);
+    }
+    else if (argument <= 0xffffffff)
+    {
+        out.push_back(type | 26);
+        append_be(out, argument, 4);
+    }
+    else
+    {
+        out.push_back(type | 27);
+        append_be(out, argument, 8);
+    }
+}
+
+void cbor_write_string(std::vector<unsigned char>& out, const utility::string_t& str)
+{
+    const auto& utf8 = to_utf8string(str);
+    cbor_write_head(out, cbor_text, utf8.size());
+    out.insert(out.end(), utf8.begin(), utf8.end());
+}
+
+void cbor_write(std::vector<unsigned char>& out, const json::value& val)
+{
+    switch (val.type())
+    {
+        case json::value::Null: out.push_back(0xf6); break;
+        case json::value::Boolean: out.push_back(val.as_bool() ? 0xf5 : 0xf4); break;
+        case json::value::Number:
+        {
+            const auto& num = val.as_number();
+            if (num.is_uint64())
+            {
+                cbor_write_head(out, cbor_unsigned, num.to_uint64());
+            }
+            else if (num.is_integral())
+            {
+                // Negative integers are encoded as -1 - n.
+                cbor_write_head(out, cbor_negative, static_cast<uint64_t>(-1 - num.to_int64()));
+            }
+            else if (fits_in_float(num.to_double()))
+            {
+                out.push_back(0xfa);
+                append_be(out, float_bits(num.to_double()), 4);
+            }
+            else
+            {
+                out.push_back(0xfb);
+                append_be(out, double_bits(num.to_double()), 8);
+            }
+            break;
+        }
+        case json::value::String: cbor_write_string(out, val.as_string()); break;
+        case json::value::Array:
+        {
+            const auto& arr = val.as_array();
+            cbor_write_head(out, cbor_array, arr.size());
+            for (const auto& element : arr)
+            {
+                cbor_write(out, element);
+            }
+            break;
+        }
+        case json::value::Object:
+        {
+            const auto& obj = val.as_object();
+            cbor_write_head(out, cbor_map, obj.size());
+            for (const auto& field : obj)
+            {
+                cbor_write_string(out, field.first);
+                cbor_write(out, field.second);
+            }
+            break;
+        }
+    }
+}
+
+uint64_t cbor_read_argument(binary_reader& reader, unsigned char info)
+{
+    if (info < 24)
+    {
+        return info;
+    }
+    switch (info)
+    {
+        case 24: return reader.read_be(1);
+        case 25: return reader.read_be(2);
+        case 26: return reader.read_be(4);
+        case 27: return reader.read_be(8);
+        default: reader.fail("invalid additional information");
+    }
+}
+
+double cbor_half_to_double(uint16_t half)
+{
+    const int exponent = (half >> 10) & 0x1f;
+    const int mantissa = half & 0x3ff;
+    double result;
+    if (exponent == 0)
+    {
+        result = std::ldexp(mantissa, -24);
+    }
+    else if (exponent != 31)
+    {
+        result = std::ldexp(mantissa + 1024, exponent - 25);
+    }
+    else
+    {
+        result = mantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+    }
+    return (half & 0x8000) ? -result : result;
+}
+
+void cbor_read_text(binary_reader& reader, unsigned char info, std::string& str)
+{
+    if (info != cbor_indefinite)
+    {
+        reader.read_string(cbor_read_argument(reader, info), str);
+        return;
+    }
+
+    // Indefinite length strings are a sequence of definite length text chunks.
+    while (reader.peek() != cbor_break)
+    {
+        const unsigned char chunk = reader.read_byte();
+        if ((chunk >> 5) != cbor_text || (chunk & 0x1f) == cbor_indefinite)
+        {
+            reader.fail("invalid indefinite length string chunk");
+        }
+        reader.read_string(cbor_read_argument(reader, chunk & 0x1f), str);
+    }
+    reader.read_byte();
+}
+
+json::value cbor_read(binary_reader& reader, size_t depth)
+{
+    reader.check_depth(depth);
+
+    const unsigned char initial = reader.read_byte();
+    const unsigned char info = initial & 0x1f;
+    switch (static_cast<cbor_major_type>(initial >> 5))
+    {
+        case cbor_unsigned: return json::value::number(cbor_read_argument(reader, info));
+        case cbor_negative:
+        {
+            const uint64_t n = cbor_read_argument(reader, info);
+            if (n <= static_cast<uint64_t>((std::numeric_limits<int64_t>::max)()))
+            {
+                return json::value::number(-1 - static_cast<int64_t>(n));
+            }
+            return json::value::number(-1.0 - static_cast<double>(n));
+        }
+        case cbor_bytes: reader.fail("byte strings are not supported");
+        case cbor_text:
+        {
+            std::string str;
+            cbor_read_text(reader, info, str);
+            return json::value::string(to_string_t(std::move(str)));
+        }
+        case cbor_array:
+        {
+            std::vector<json::value> elements;
+            if (info == cbor_indefinite)
+            {
+                while (reader.peek() != cbor_break)
+                {
+                    elements.push_back(cbor_read(reader, depth + 1));
+                }
+                reader.read_byte();
+            }
+            else
+            {
+                const uint64_t count = cbor_read_argument(reader, info);
+                elements.reserve(reader.reserve_hint(count));
+                for (uint64_t i = 0; i < count; ++i)
+                {
+                    elements.push_back(cbor_read(reader, depth + 1));
+                }
+            }
+            return json::value::array(std::move(elements));
+        }
+        case cbor_map:
+        {
+            std::vector<std::pair<utility::string_t, json::value>> fields;
+            const bool indefinite = info == cbor_indefinite;
+            const uint64_t count = indefinite ? 0 : cbor_read_argument(reader, info);
+            fields.reserve(reader.reserve_hint(count));
+            for (uint64_t i = 0; indefinite ? reader.peek() != cbor_break : i < count; ++i)
+            {
+                const unsigned char key = reader.read_byte();
+                if ((key >> 5) != cbor_text)
+                {
+                    reader.fail("map keys must be text strings");
+                }
+                std::string name;
+                cbor_read_text(reader, key & 0x1f, name);
+                auto field = cbor_read(reader, depth + 1);
+                fields.emplace_back(to_string_t(std::move(name)), std::move(field));
+            }
+            if (indefinite)
+            {
+                reader.read_byte();
+            }
+            return make_object(std::move(fields));
+        }
+        case cbor_tag:
+            // Semantic tags have no JSON equivalent, the tagged item is decoded as is.
+            cbor_read_argument(reader, info);
+            return cbor_read(reader, depth + 1);
+        case cbor_simple:
+            switch (info)
+            {
+                case 20: return json::value::boolean(false);
+                case 21: return json::value::boolean(true);
+                case 22:
+                case 23: return json::value::null();
+                case 25: return json::value::number(cbor_half_to_double(static_cast<uint16_t>(reader.read_be(2))));
+                case 26: return json::value::number(static_cast<double>(reader.read_float()));
+                case 27: return json::value::number(reader.read_double());
+                default: reader.fail("unsupported simple value");
+            }
+    }
+    reader.fail("invalid initial byte");
+}
+
+//
+// MessagePack
+//
+
+void msgpack_write_string(std::vector<unsigned char>& out, const utility::string_t& str)
+{
+    const auto& utf8 = to_utf8string(str);
+    const size_t size = utf8.size();
+    if (size <= 31)
+    {
+        out.push_back(static_cast<unsigned char>(0xa0 | size));
+    }
+    else if (size <= 0xff)
+    {
+        out.push_back(0xd9);
+        append_be(out, size, 1);
+    }
+    else if (size <= 0xffff)
+    {
+        out.push_back(0xda);
+        append_be(out, size, 2);
+    }
+    else
+    {
+        out.push_back(0xdb);
+        append_be(out, size, 4);
+    }
+    out.insert(out.end(), utf8.begin(), utf8.end());
+}
+
+void msgpack_write_container(std::vector<unsigned char>& out, size_t size, unsigned char fix, unsigned char first)
+{
+    if (size <= 15)
+    {
+        out.push_back(static_cast<unsigned char>(fix | size));
+    }
+    else if (size <= 0xffff)
+    {
+        out.push_back(first);
+        append_be(out, size, 2);
+    }
+    else
+    {
+        out.push_back(static_cast<unsigned char>(first + 1));
+        append_be(out, size, 4);
+    }
+}
+
+void msgpack_write_integer(std::vector<unsigned char>& out, const json::number& num)
+{
+    if (num.is_uint64())
+    {
+        const uint64_t value = num.to_uint64();
+        if (value <= 0x7f)
+        {
+            out.push_back(static_cast<unsigned char>(value));
+        }
+        else if (value <= 0xff)
+        {
+            out.push_back(0xcc);
+            append_be(out, value, 1);
+        }
+        else if (value <= 0xffff)
+        {
+            out.push_back(0xcd);
+            append_be(out, value, 2);
+        }
+        else if (value <= 0xffffffff)
+        {
+            out.push_back(0xce);
+            append_be(out, value, 4);
+        }
+        else
+        {
+            out.push_back(0xcf);
+            append_be(out, value, 8);
+        }
+        return;
+    }
+
+    const int64_t value = num.to_int64();
+    const uint64_t bits = static_cast<uint64_t>(value);
+    if (value >= -32)
+    {
+        out.push_back(static_cast<unsigned char>(bits));
+    }
+    else if (value >= (std::numeric_limits<int8_t>::min)())
+    {
+        out.push_back(0xd0);
+        append_be(out, bits, 1);
+    }
+    else if (value >= (std::numeric_limits<int16_t>::min)())
+    {
+        out.push_back(0xd1);
+        append_be(out, bits, 2);
+    }
+    else if (value >= (std::numeric_limits<int32_t>::min)())
+    {
+        out.push_back(0xd2);
+        append_be(out, bits, 4);
+    }
+    else
+    {
+        out.push_back(0xd3);
+        append_be(out, bits, 8);
+    }
+}
+
+void msgpack_write(std::vector<unsigned char>& out, const json::value& val)
+{
+    switch (val.type())
+    {
+        case json::value::Null: out.push_back(0xc0); break;
+        case json::value::Boolean: out.push_back(val.as_bool() ? 0xc3 : 0xc2); break;
+        case json::value::Number:
+        {
+            const auto& num = val.as_number();
+            if (num.is_integral())
+            {
+                msgpack_write_integer(out, num);
+            }
+            else if (fits_in_float(num.to_double()))
+            {
+                out.push_back(0xca);
+                append_be(out, float_bits(num.to_double()), 4);
+            }
+            else
+            {
+                out.push_back(0xcb);
+                append_be(out, double_bits(num.to_double()), 8);
+            }
+            break;
+        }
+        case json::value::String: msgpack_write_string(out, val.as_string()); break;
+        case json::value::Array:
+        {
+            const auto& arr = val.as_array();
+            msgpack_write_container(out, arr.size(), 0x90, 0xdc);
+            for (const auto& element : arr)
+            {
+                msgpack_write(out, element);
+            }
+            break;
+        }
+        case json::value::Object:
+        {
+            const auto& obj = val.as_object();
+            msgpack_write_container(out, obj.size(), 0x80, 0xde);
+            for (const auto& field : obj)
+            {
+                msgpack_write_string(out, field.first);
+                msgpack_write(out, field.second);
+            }
+            break;
+        }
+    }
+}
+
+bool msgpack_read_string_length(binary_reader& reader, unsigned char initial, uint64_t& length)
+{
+    if ((initial & 0xe0) == 0xa0)
+    {
+        length = initial & 0x1f;
+        return true;
+    }
+    switch (initial)
+    {
+        case 0xd9: length = reader.read_be(1); return true;
+        case 0xda: length = reader.read_be(2); return true;
+        case 0xdb: length = reader.read_be(4); return true;
+        default: return false;
+    }
+}
+
+json::value msgpack_read(binary_reader& reader, size_t depth);
+
+json::value msgpack_read_array(binary_reader& reader, uint64_t count, size_t depth)
+{
+    std::vector<json::value> elements;
+    elements.reserve(reader.reserve_hint(count));
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        elements.push_back(msgpack_read(reader, depth + 1));
+    }
+    return json::value::array(std::move(elements));
+}
+
+json::value msgpack_read_map(binary_reader& reader, uint64_t count, size_t depth)
+{
+    std::vector<std::pair<utility::string_t, json::value>> fields;
+    fields.reserve(reader.reserve_hint(count));
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        uint64_t length;
+        if (!msgpack_read_string_length(reader, reader.read_byte(), length))
+        {
+            reader.fail("map keys must be strings");
+        }
+        std::string name;
+        reader.read_string(length, name);
+        auto field = msgpack_read(reader, depth + 1);
+        fields.emplace_back(to_string_t(std::move(name)), std::move(field));
+    }
+    return make_object(std::move(fields));
+}
+
+json::value msgpack_read(binary_reader& reader, size_t depth)
+{
+    reader.check_depth(depth);
+
+    const unsigned char initial = reader.read_byte();
+    if (initial <= 0x7f)
+    {
+        return json::value::number(static_cast<uint32_t>(initial));
+    }
+    if (initial >= 0xe0)
+    {
+        return json::value::number(static_cast<int32_t>(static_cast<int8_t>(initial)));
+    }
+    if ((initial & 0xf0) == 0x80)
+    {
+        return msgpack_read_map(reader, initial & 0x0f, depth);
+    }
+    if ((initial & 0xf0) == 0x90)
+    {
+        return msgpack_read_array(reader, initial & 0x0f, depth);
+    }
+
+    uint64_t length;
+    if (msgpack_read_string_length(reader, initial, length))
+    {
+        std::string str;
+        reader.read_string(length, str);
+        return json::value::string(to_string_t(std::move(str)));
+    }
+
+    switch (initial)
+    {
+        case 0xc0: return json::value::null();
+        case 0xc2: return json::value::boolean(false);
+        case 0xc3: return json::value::boolean(true);
+        case 0xca: return json::value::number(static_cast<double>(reader.read_float()));
+        case 0xcb: return json::value::number(reader.read_double());
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+        case 0xcf: return json::value::number(reader.read_be(static_cast<size_t>(1) << (initial - 0xcc)));
+        case 0xd0: return json::value::number(static_cast<int32_t>(static_cast<int8_t>(reader.read_be(1))));
+        case 0xd1: return json::value::number(static_cast<int32_t>(static_cast<int16_t>(reader.read_be(2))));
+        case 0xd2: return json::value::number(static_cast<int32_t>(reader.read_be(4)));
+        case 0xd3: return json::value::number(static_cast<int64_t>(reader.read_be(8)));
+        case 0xdc: return msgpack_read_array(reader, reader.read_be(2), depth);
+        case 0xdd: return msgpack_read_array(reader, reader.read_be(4), depth);
+        case 0xde: return msgpack_read_map(reader, reader.read_be(2), depth);
+        case 0xdf: return msgpack_read_map(reader, reader.read_be(4), depth);
+        case 0xc4:
+        case 0xc5:
+        case 0xc6: reader.fail("binary values are not supported");
+        default: reader.fail("extension types are not supported");
+    }
+}
+} // namespace
+
+std::vector<unsigned char> web::json::value::to_cbor() const
+{
+    std::vector<unsigned char> out;
+    cbor_write(out, *this);
+    return out;
+}
+
+web::json::value web::json::value::from_cbor(const unsigned char* data, size_t size)
+{
+    binary_reader reader(data, size, "CBOR");
+    auto result = cbor_read(reader, 0);
+    reader.check_at_end();
+    return result;
+}
+
+std::vector<unsigned char> web::json::value::to_msgpack() const
+{
+    std::vector<unsigned char> out;
+    msgpack_write(out, *this);
+    return out;
+}
+
+web::json::value web::json::value::from_msgpack(const unsigned char* data, size_t size)
+{
+    binary_reader reader(data, size, "MessagePack");
+    auto result = msgpack_read(reader, 0);
+    reader.check_at_end();
+    return result;
+}
@@ -0,0 +1,427 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * HTTP Library: Reader and writer used to bind C++ structs to JSON text
+ *
+ * For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+
+#include "stdafx.h"
+
+#include "cpprest/json_binding.h"
+#include <cinttypes>
+#include <cstdlib>
+
+using namespace web;
+using namespace web::json::details;
+
+namespace
+{
+bool is_space(char ch) { return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r'; }
+
+bool is_number_char(char ch)
+{
+    return (ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E';
+}
+
+int hex_value(char ch)
+{
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+void append_utf8(std::string& str, uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        str.push_back(static_cast<char>(cp));
+    }
+    else if (cp < 0x800)
+    {
+        str.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        str.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000)
+    {
+        str.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        str.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        str.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else
+    {
+        str.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        str.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        str.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        str.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+} // namespace
+
+binding_reader::binding_reader(const char* begin, const char* end) : m_begin(begin), m_pos(begin), m_end(end) {}
+
+void binding_reader::fail(const char* message) const
+{
+    std::string str("* Offset ");
+    str += std::to_string(m_pos - m_begin);
+    str += " Syntax error: ";
+    str += message;
+    throw json::json_exception(std::move(str));
+}
+
+char binding_reader::peek()
+{
+    while (m_pos != m_end && is_space(*m_pos))
+    {
+        ++m_pos;
+    }
+    return m_pos != m_end ? *m_pos : '\0';
+}
+
+void binding_reader::expect(char ch)
+{
+    if (!try_consume(ch))
+    {
+        fail(ch == '{' ? "expected an object" : ch == '[' ? "expected an array" : "unexpected character");
+    }
+}
+
+bool binding_reader::try_consume(char ch)
+{
+    if (peek() == ch && m_pos != m_end)
+    {
+        ++m_pos;
+        return true;
+    }
+    return false;
+}
+
+bool binding_reader::try_read_null()
+{
+    if (peek() == 'n')
+    {
+        if (m_end - m_pos < 4 || std::string(m_pos, 4) != "null")
+        {
+            fail("malformed literal");
+        }
+        m_pos += 4;
+        return true;
+    }
+    return false;
+}
+
+bool binding_reader::read_bool()
+{
+    if (peek() == 't' && m_end - m_pos >= 4 && std::string(m_pos, 4) == "true")
+    {
+        m_pos += 4;
+        return true;
+    }
+    if (peek() == 'f' && m_end - m_pos >= 5 && std::string(m_pos, 5) == "false")
+    {
+        m_pos += 5;
+        return false;
+    }
+    fail("expected a boolean");
+}
+
+uint64_t binding_reader::read_uint64()
+{
+    if (peek() < '0' || peek() > '9')
+    {
+        fail("expected an unsigned integer");
+    }
+
+    uint64_t value = 0;
+    while (m_pos != m_end && *m_pos >= '0' && *m_pos <= '9')
+    {
+        const unsigned digit = static_cast<unsigned>(*m_pos - '0');
+        if (value > ((std::numeric_limits<uint64_t>::max)() - digit) / 10)
+        {
+            fail("integer out of range");
+        }
+        value = value * 10 + digit;
+        ++m_pos;
+    }
+
+    if (m_pos != m_end && is_number_char(*m_pos))
+    {
+        fail("expected an integer");
+    }
+    return value;
+}
+
+int64_t binding_reader::read_int64()
+{
+    const bool negative = peek() == '-';
+    if (negative)
+    {
+        ++m_pos;
+    }
+
+    const uint64_t magnitude = read_uint64();
+    const uint64_t limit = negative ? static_cast<uint64_t>((std::numeric_limits<int64_t>::max)()) + 1
+                                    : static_cast<uint64_t>((std::numeric_limits<int64_t>::max)());
+    if (magnitude > limit)
+    {
+        fail("integer out of range");
+    }
+    return negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+}
+
+double binding_reader::read_double()
+{
+    peek();
+    const char* start = m_pos;
+    while (m_pos != m_end && is_number_char(*m_pos))
+    {
+        ++m_pos;
+    }
+
+    // Copy the token so that strtod stops at its end.
+    const std::string token(start, m_pos);
+    char* parsed_end = nullptr;
+#ifdef _WIN32
+    const double value = _strtod_l(token.c_str(), &parsed_end, utility::details::scoped_c_thread_locale::c_locale());
+#else
+    const double value = strtod(token.c_str(), &parsed_end);
+#endif
+    if (token.empty() || parsed_end != token.c_str() + token.size())
+    {
+        m_pos = start;
+        fail("expected a number");
+    }
+    return value;
+}
+
+void binding_reader::read_string(std::string& str)
+{
+    expect('"');
+    str.clear();
+    for (;;)
+    {
+        // Copy runs of unescaped characters in one go.
+        const char* run = m_pos;
+        while (m_pos != m_end && *m_pos != '"' && *m_pos != '\\' && static_cast<unsigned char>(*m_pos) >= 0x20)
+        {
+            ++m_pos;
+        }
+        str.append(run, m_pos);
+
+        if (m_pos == m_end)
+        {
+            fail("unterminated string");
+        }
+        const char ch = *m_pos++;
+        if (ch == '"')
+        {
+            return;
+        }
+        if (ch != '\\')
+        {
+            fail("control character in string");
+        }
+        if (m_pos == m_end)
+        {
+            fail("unterminated string");
+        }
+
+        switch (*m_pos++)
+        {
+            case '"': str.push_back('"'); break;
+            case '\\': str.push_back('\\'); break;
+            case '/': str.push_back('/'); break;
+            case 'b': str.push_back('\b'); break;
+            case 'f': str.push_back('\f'); break;
+            case 'n': str.push_back('\n'); break;
+            case 'r': str.push_back('\r'); break;
+            case 't': str.push_back('\t'); break;
+            case 'u':
+            {
+                uint32_t cp = 0;
+                for (int pair = 0; pair < 2; ++pair)
+                {
+                    if (m_end - m_pos < 4)
+                    {
+                        fail("malformed unicode escape");
+                    }
+                    uint32_t unit = 0;
+                    for (int i = 0; i < 4; ++i)
+                    {
+                        const int digit = hex_value(*m_pos++);
+                        if (digit < 0)
+                        {
+                            fail("malformed unicode escape");
+                        }
+                        unit = (unit << 4) | static_cast<uint32_t>(digit);
+                    }
+
+                    if (pair == 0)
+                    {
+                        cp = unit;
+                        // A high surrogate must be followed by an escaped low surrogate.
+                        if (cp < 0xD800 || cp > 0xDBFF) break;
+                        if (m_end - m_pos < 2 || m_pos[0] != '\\' || m_pos[1] != 'u')
+                        {
+                            fail("unpaired surrogate in string");
+                        }
+                        m_pos += 2;
+                    }
+                    else
+                    {
+                        if (unit < 0xDC00 || unit > 0xDFFF)
+                        {
+                            fail("unpaired surrogate in string");
+                        }
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (unit - 0xDC00);
+                    }
+                }
+                append_utf8(str, cp);
+                break;
+            }
+            default: fail("malformed escape sequence");
+        }
+    }
+}
+
+const std::string& binding_reader::read_key()
+{
+    read_string(m_key);
+    expect(':');
+    return m_key;
+}
+
+void binding_reader::skip_value()
+{
+    // Track the expected closing brackets instead of recursing, so deeply nested input cannot exhaust the stack.
+    std::string closers;
+    for (;;)
+    {
+        const char ch = peek();
+        if (ch == '{' || ch == '[')
+        {
+            ++m_pos;
+            const char closer = ch == '{' ? '}' : ']';
+            if (!try_consume(closer))
+            {
+                closers.push_back(closer);
+                if (ch == '{')
+                {
+                    read_key();
+                }
+                continue;
+            }
+        }
+        else if (ch == '"')
+        {
+            read_string(m_key);
+        }
+        else if (ch == 't' || ch == 'f')
+        {
+            read_bool();
+        }
+        else if (!try_read_null())
+        {
+            read_double();
+        }
+
+        // A value is complete: close any containers that end here, or move on to the next element.
+        for (;;)
+        {
+            if (closers.empty())
+            {
+                return;
+            }
+            if (try_consume(','))
+            {
+                if (closers.back() == '}')
+                {
+                    read_key();
+                }
+                break;
+            }
+            expect(closers.back());
+            closers.pop_back();
+        }
+    }
+}
+
+json::value binding_reader::read_value()
+{
+    peek();
+    const char* start = m_pos;
+    skip_value();
+    return json::value::parse(utility::conversions::to_string_t(std::string(start, m_pos)));
+}
+
+void binding_reader::finish()
+{
+    if (peek() != '\0' || m_pos != m_end)
+    {
+        fail("Left-over characters in stream after parsing a JSON value");
+    }
+}
+
+binding_writer::binding_writer(std::string& out) : m_out(out) {}
+
+void binding_writer::write_key(const char* name)
+{
+    m_out.push_back('"');
+    append_escape_string(m_out, std::string(name));
+    m_out.append("\":");
+}
+
+void binding_writer::write_null() { m_out.append("null"); }
+
+void binding_writer::write_bool(bool value) { m_out.append(value ? "true" : "false"); }
+
+void binding_writer::write_int64(int64_t value)
+{
+    char buffer[24];
+    const int length = snprintf(buffer, sizeof(buffer), "%" PRId64, value);
+    m_out.append(buffer, static_cast<size_t>(length));
+}
+
+void binding_writer::write_uint64(uint64_t value)
+{
+    char buffer[24];
+    const int length = snprintf(buffer, sizeof(buffer), "%" PRIu64, value);
+    m_out.append(buffer, static_cast<size_t>(length));
+}
+
+void binding_writer::write_double(double value)
+{
+    // #digits + 2 to avoid loss + 1 for the sign + 1 for decimal point + 5 for exponent (e+xxx) + 1 for null
+    // terminator
+    const size_t size = std::numeric_limits<double>::digits10 + 10;
+    char buffer[size];
+#ifdef _WIN32
+    const auto length = _sprintf_s_l(buffer,
+                                     size,
+                                     "%.*g",
+                                     utility::details::scoped_c_thread_locale::c_locale(),
+                                     std::numeric_limits<double>::digits10 + 2,
+                                     value);
+#else
+    const auto length = snprintf(buffer, size, "%.*g", std::numeric_limits<double>::digits10 + 2, value);
+#endif
+    m_out.append(buffer, static_cast<size_t>(length));
+}
+
+void binding_writer::write_string(const std::string& value)
+{
+    m_out.push_back('"');
+    append_escape_string(m_out, value);
+    m_out.push_back('"');
+}
+
+void binding_writer::write_value(const json::value& value)
+{
+    m_out.append(utility::conversions::to_utf8string(value.serialize()));
+}
@@ -0,0 +1,380 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * HTTP Library: On-demand JSON parsing over a shared UTF-8 source buffer
+ *
+ * For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+
+#include "stdafx.h"
+
+using namespace web;
+using namespace utility;
+using namespace utility::conversions;
+
+namespace
+{
+typedef std::shared_ptr<const std::string> source_ptr;
+
+bool is_space(char ch) { return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r'; }
+
+size_t skip_space(const std::string& src, size_t pos, size_t end)
+{
+    while (pos < end && is_space(src[pos]))
+    {
+        ++pos;
+    }
+    return pos;
+}
+
+[[noreturn]] void malformed(const char* what) { throw json::json_exception(what); }
+
+// Returns the position just past the closing quote of the string starting at pos.
+size_t skip_string(const std::string& src, size_t pos, size_t end)
+{
+    for (++pos; pos < end; ++pos)
+    {
+        if (src[pos] == '\\')
+        {
+            ++pos;
+        }
+        else if (src[pos] == '"')
+        {
+            return pos + 1;
+        }
+    }
+    malformed("Malformed string literal");
+}
+
+// Returns the position just past the value starting at pos, checking only that
+// brackets are balanced and strings are terminated.
+size_t skip_value(const std::string& src, size_t pos, size_t end)
+{
+    if (pos >= end)
+    {
+        malformed("Unexpected end of JSON text");
+    }
+
+    const char first = src[pos];
+    if (first == '"')
+    {
+        return skip_string(src, pos, end);
+    }
+
+    if (first == '{' || first == '[')
+    {
+        std::string closers(1, first == '{' ? '}' : ']');
+        for (++pos; pos < end; ++pos)
+        {
+            const char ch = src[pos];
+            if (ch == '"')
+            {
+                pos = skip_string(src, pos, end) - 1;
+            }
+            else if (ch == '{' || ch == '[')
+            {
+                closers.push_back(ch == '{' ? '}' : ']');
+            }
+            else if (ch == '}' || ch == ']')
+            {
+                if (ch != closers.back())
+                {
+                    malformed("Mismatched brackets in JSON text");
+                }
+                closers.pop_back();
+                if (closers.empty())
+                {
+                    return pos + 1;
+                }
+            }
+        }
+        malformed("Unexpected end of JSON text");
+    }
+
+    if (first != '-' && first != 't' && first != 'f' && first != 'n' && (first < '0' || first > '9'))
+    {
+        malformed("Malformed token");
+    }
+
+    while (pos < end && !is_space(src[pos]) && src[pos] != ',' && src[pos] != ']' && src[pos] != '}')
+    {
+        ++pos;
+    }
+    return pos;
+}
+
+// Decodes the quoted string in [begin, end), using the full parser only when escapes are present.
+utility::string_t decode_string(const std::string& src, size_t begin, size_t end)
+{
+    for (size_t i = begin + 1; i + 1 < end; ++i)
+    {
+        if (src[i] == '\\' || static_cast<unsigned char>(src[i]) < 0x20)
+        {
+            return json::value::parse(to_string_t(src.substr(begin, end - begin))).as_string();
+        }
+    }
+    return to_string_t(src.substr(begin + 1, end - begin - 2));
+}
+} // namespace
+
+namespace web
+{
+namespace json
+{
+namespace details
+{
+/// <summary>
+/// A value that refers to a range of a UTF-8 source buffer and is parsed the first time it is accessed.
+/// </summary>
+class _Lazy : public _Value
+{
+public:
+    _Lazy(source_ptr source, size_t begin, size_t end)
+        : m_source(std::move(source)), m_begin(begin), m_end(end), m_materialized(false), m_modified(false)
+    {
+    }
+
+    static json::value make(source_ptr source, size_t begin, size_t end)
+    {
+        auto lazy = utility::details::make_unique<_Lazy>(std::move(source), begin, end);
+#ifdef ENABLE_JSON_VALUE_VISUALIZER
+        const auto kind = lazy->type();
+        return json::value(std::move(lazy), kind);
+#else
+        return json::value(std::move(lazy));
+#endif
+    }
+
+    virtual std::unique_ptr<_Value> _copy_value()
+    {
+        auto copy = utility::details::make_unique<_Lazy>(m_source, m_begin, m_end);
+        if (m_materialized)
+        {
+            copy->m_cache = m_cache;
+            copy->m_materialized = true;
+            copy->m_modified = m_modified;
+        }
+        return copy;
+    }
+
+    virtual bool has_field(const utility::string_t& key) const { return get().has_field(key); }
+    virtual value get_field(const utility::string_t& key) const { return get().m_value->get_field(key); }
+    virtual value get_element(array::size_type index) const { return get().m_value->get_element(index); }
+
+    virtual value& index(const utility::string_t& key) { return get_mutable().m_value->index(key); }
+    virtual value& index(array::size_type index) { return get_mutable().m_value->index(index); }
+
+    virtual const value& cnst_index(const utility::string_t& key) const { return get().m_value->cnst_index(key); }
+    virtual const value& cnst_index(array::size_type index) const { return get().m_value->cnst_index(index); }
+
+    virtual void serialize_impl(std::string& str) const { format(str); }
+#ifdef _WIN32
+    virtual void serialize_impl(std::wstring& str) const { format(str); }
+#endif
+
+    virtual json::value::value_type type() const
+    {
+        if (m_materialized)
+        {
+            return m_cache.type();
+        }
+
+        // The first character identifies the kind of value without parsing it.
+        switch ((*m_source)[m_begin])
+        {
+            case '"': return json::value::String;
+            case '{': return json::value::Object;
+            case '[': return json::value::Array;
+            case 't':
+            case 'f': return json::value::Boolean;
+            case 'n': return json::value::Null;
+            default: return json::value::Number;
+        }
+    }
+
+    virtual bool is_integer() const { return get().is_integer(); }
+    virtual bool is_double() const { return get().is_double(); }
+
+    virtual const json::number& as_number() { return get().as_number(); }
+    virtual double as_double() const { return get().as_double(); }
+    virtual int as_integer() const { return get().as_integer(); }
+    virtual bool as_bool() const { return get().as_bool(); }
+    virtual json::array& as_array() { return get_mutable().as_array(); }
+    virtual const json::array& as_array() const { return get().as_array(); }
+    virtual json::object& as_object() { return get_mutable().as_object(); }
+    virtual const json::object& as_object() const { return get().as_object(); }
+    virtual const utility::string_t& as_string() const { return get().as_string(); }
+
+    virtual size_t size() const
+    {
+        const auto kind = type();
+        return kind == json::value::Object || kind == json::value::Array ? get().size() : 0;
+    }
+
+    virtual size_t child_reserve_size() const
+    {
+        // Unmodified values are written as their source bytes.
+        return m_modified ? m_cache.m_value->child_reserve_size() : m_end - m_begin;
+    }
+
+protected:
+    virtual void format(std::basic_string<char>& str) const
+    {
+        if (m_modified)
+        {
+            m_cache.format(str);
+        }
+        else
+        {
+            str.append(*m_source, m_begin, m_end - m_begin);
+        }
+    }
+#ifdef _WIN32
+    virtual void format(std::basic_string<wchar_t>& str) const
+    {
+        if (m_modified)
+        {
+            m_cache.format(str);
+        }
+        else
+        {
+            str.append(to_utf16string(m_source->substr(m_begin, m_end - m_begin)));
+        }
+    }
+#endif
+
+private:
+    const json::value& get() const
+    {
+        if (!m_materialized)
+        {
+            m_cache = materialize();
+            m_materialized = true;
+        }
+        return m_cache;
+    }
+
+    // Non-const access may modify the value, after which the source bytes no longer represent it.
+    json::value& get_mutable()
+    {
+        get();
+        m_modified = true;
+        return m_cache;
+    }
+
+    json::value materialize() const
+    {
+        const std::string& src = *m_source;
+        switch (src[m_begin])
+        {
+            case '{': return materialize_object();
+            case '[': return materialize_array();
+            case '"': return json::value::string(decode_string(src, m_begin, m_end));
+            default: return json::value::parse(to_string_t(src.substr(m_begin, m_end - m_begin)));
+        }
+    }
+
+    json::value materialize_object() const
+    {
+        const std::string& src = *m_source;
+        std::vector<std::pair<utility::string_t, json::value>> fields;
+
+        size_t pos = skip_space(src, m_begin + 1, m_end);
+        if (src[pos] != '}')
+        {
+            for (;;)
+            {
+                if (src[pos] != '"')
+                {
+                    malformed("Malformed object literal");
+                }
+                const size_t key_end = skip_string(src, pos, m_end);
+                auto key = decode_string(src, pos, key_end);
+
+                pos = skip_space(src, key_end, m_end);
+                if (src[pos] != ':')
+                {
+                    malformed("Malformed object literal");
+                }
+                pos = skip_space(src, pos + 1, m_end);
+                const size_t value_end = skip_value(src, pos, m_end);
+                fields.emplace_back(std::move(key), lazy_child(pos, value_end));
+
+                pos = skip_space(src, value_end, m_end);
+                if (src[pos] == '}')
+                {
+                    break;
+                }
+                if (src[pos] != ',')
+                {
+                    malformed("Malformed object literal");
+                }
+                pos = skip_space(src, pos + 1, m_end);
+            }
+        }
+
+        return json::value::object(std::move(fields), details::g_keep_json_object_unsorted);
+    }
+
+    json::value materialize_array() const
+    {
+        const std::string& src = *m_source;
+        std::vector<json::value> elements;
+
+        size_t pos = skip_space(src, m_begin + 1, m_end);
+        if (src[pos] != ']')
+        {
+            for (;;)
+            {
+                const size_t value_end = skip_value(src, pos, m_end);
+                elements.push_back(lazy_child(pos, value_end));
+
+                pos = skip_space(src, value_end, m_end);
+                if (src[pos] == ']')
+                {
+                    break;
+                }
+                if (src[pos] != ',')
+                {
+                    malformed("Malformed array literal");
+                }
+                pos = skip_space(src, pos + 1, m_end);
+            }
+        }
+
+        return json::value::array(std::move(elements));
+    }
+
+    json::value lazy_child(size_t begin, size_t end) const { return make(m_source, begin, end); }
+
+    source_ptr m_source;
+    size_t m_begin;
+    size_t m_end;
+
+    mutable json::value m_cache;
+    mutable bool m_materialized;
+    bool m_modified;
+};
+} // namespace details
+} // namespace json
+} // namespace web
+
+web::json::value web::json::value::parse_lazy(std::string str)
+{
+    auto source = std::make_shared<const std::string>(std::move(str));
+    const size_t end = source->size();
+
+    const size_t begin = skip_space(*source, 0, end);
+    const size_t value_end = skip_value(*source, begin, end);
+    if (skip_space(*source, value_end, end) != end)
+    {
+        malformed("Left-over characters in stream after parsing a JSON value");
+    }
+
+    return details::_Lazy::make(std::move(source), begin, value_end);
+}
@@ -123,13 +123,7 @@ public:
         utility::details::scoped_c_thread_locale locale;
 #endif
 
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-        auto _value = _ParseValue(first);
-        auto type = _value->type();
-        return web::json::value(std::move(_value), type);
-#else
-        return web::json::value(_ParseValue(first));
-#endif
+        return _ParseValue(first);
     }
 
 protected:
@@ -148,9 +142,9 @@ private:
     bool CompleteKeywordTrue(Token& token);
     bool CompleteKeywordFalse(Token& token);
     bool CompleteKeywordNull(Token& token);
-    std::unique_ptr<web::json::details::_Value> _ParseValue(typename JSON_Parser<CharType>::Token& first);
-    std::unique_ptr<web::json::details::_Value> _ParseObject(typename JSON_Parser<CharType>::Token& tkn);
-    std::unique_ptr<web::json::details::_Value> _ParseArray(typename JSON_Parser<CharType>::Token& tkn);
+    web::json::value _ParseValue(typename JSON_Parser<CharType>::Token& first);
+    web::json::value _ParseObject(typename JSON_Parser<CharType>::Token& tkn);
+    web::json::value _ParseArray(typename JSON_Parser<CharType>::Token& tkn);
 
     JSON_Parser& operator=(const JSON_Parser&);
 
@@ -940,8 +934,7 @@ try_again:
 }
 
 template<typename CharType>
-std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseObject(
-    typename JSON_Parser<CharType>::Token& tkn)
+web::json::value JSON_Parser<CharType>::_ParseObject(typename JSON_Parser<CharType>::Token& tkn)
 {
     auto obj = utility::details::make_unique<web::json::details::_Object>(g_keep_json_object_unsorted);
     auto& elems = obj->m_object.m_elements;
@@ -971,14 +964,7 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseObject(
             if (tkn.m_error) goto error;
 
                 // State 3: Looking for an expression.
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-            auto fieldValue = _ParseValue(tkn);
-            auto type = fieldValue->type();
-            elems.emplace_back(utility::conversions::to_string_t(std::move(fieldName)),
-                               json::value(std::move(fieldValue), type));
-#else
-            elems.emplace_back(utility::conversions::to_string_t(std::move(fieldName)), json::value(_ParseValue(tkn)));
-#endif
+            elems.emplace_back(utility::conversions::to_string_t(std::move(fieldName)), _ParseValue(tkn));
             if (tkn.m_error) goto error;
 
             // State 4: Looking for a comma or a closing brace
@@ -996,29 +982,32 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseObject(
 
 done:
     GetNextToken(tkn);
-    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+    if (tkn.m_error) return web::json::value();
 
     if (!g_keep_json_object_unsorted)
     {
         ::std::sort(elems.begin(), elems.end(), json::object::compare_pairs);
     }
 
-    return std::unique_ptr<web::json::details::_Value>(obj.release());
+#ifdef ENABLE_JSON_VALUE_VISUALIZER
+    return web::json::value(std::move(obj), json::value::Object);
+#else
+    return web::json::value(std::move(obj));
+#endif
 
 error:
     if (!tkn.m_error)
     {
         SetErrorCode(tkn, json_error::malformed_object_literal);
     }
-    return utility::details::make_unique<web::json::details::_Null>();
+    return web::json::value();
 }
 
 template<typename CharType>
-std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseArray(
-    typename JSON_Parser<CharType>::Token& tkn)
+web::json::value JSON_Parser<CharType>::_ParseArray(typename JSON_Parser<CharType>::Token& tkn)
 {
     GetNextToken(tkn);
-    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+    if (tkn.m_error) return web::json::value();
 
     auto result = utility::details::make_unique<web::json::details::_Array>();
 
@@ -1028,35 +1017,39 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseArray(
         {
             // State 1: Looking for an expression.
             result->m_array.m_elements.emplace_back(ParseValue(tkn));
-            if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+            if (tkn.m_error) return web::json::value();
 
             // State 4: Looking for a comma or a closing bracket
             switch (tkn.kind)
             {
                 case JSON_Parser<CharType>::Token::TKN_Comma:
                     GetNextToken(tkn);
-                    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+                    if (tkn.m_error) return web::json::value();
                     break;
                 case JSON_Parser<CharType>::Token::TKN_CloseBracket:
                     GetNextToken(tkn);
-                    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
-                    return std::move(result);
+                    if (tkn.m_error) return web::json::value();
+                    goto done;
                 default:
                     SetErrorCode(tkn, json_error::malformed_array_literal);
-                    return utility::details::make_unique<web::json::details::_Null>();
+                    return web::json::value();
             }
         }
     }
 
     GetNextToken(tkn);
-    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+    if (tkn.m_error) return web::json::value();
 
-    return std::unique_ptr<web::json::details::_Value>(result.release());
+done:
+#ifdef ENABLE_JSON_VALUE_VISUALIZER
+    return web::json::value(std::move(result), json::value::Array);
+#else
+    return web::json::value(std::move(result));
+#endif
 }
 
 template<typename CharType>
-std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseValue(
-    typename JSON_Parser<CharType>::Token& tkn)
+web::json::value JSON_Parser<CharType>::_ParseValue(typename JSON_Parser<CharType>::Token& tkn)
 {
     switch (tkn.kind)
     {
@@ -1070,48 +1063,45 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseValue(
         }
         case JSON_Parser<CharType>::Token::TKN_StringLiteral:
         {
-            auto value = utility::details::make_unique<web::json::details::_String>(std::move(tkn.string_val),
-                                                                                    tkn.has_unescape_symbol);
+            web::json::value value;
+            value._emplace<web::json::details::_String>(std::move(tkn.string_val), tkn.has_unescape_symbol);
             GetNextToken(tkn);
-            if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
-            return std::move(value);
+            if (tkn.m_error) return web::json::value();
+            return value;
         }
         case JSON_Parser<CharType>::Token::TKN_IntegerLiteral:
         {
-            std::unique_ptr<web::json::details::_Number> value;
-            if (tkn.signed_number)
-                value = utility::details::make_unique<web::json::details::_Number>(tkn.int64_val);
-            else
-                value = utility::details::make_unique<web::json::details::_Number>(tkn.uint64_val);
+            web::json::value value =
+                tkn.signed_number ? web::json::value(tkn.int64_val) : web::json::value(tkn.uint64_val);
 
             GetNextToken(tkn);
-            if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
-            return std::move(value);
+            if (tkn.m_error) return web::json::value();
+            return value;
         }
         case JSON_Parser<CharType>::Token::TKN_NumberLiteral:
         {
-            auto value = utility::details::make_unique<web::json::details::_Number>(tkn.double_val);
+            web::json::value value(tkn.double_val);
             GetNextToken(tkn);
-            if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
-            return std::move(value);
+            if (tkn.m_error) return web::json::value();
+            return value;
         }
         case JSON_Parser<CharType>::Token::TKN_BooleanLiteral:
         {
-            auto value = utility::details::make_unique<web::json::details::_Boolean>(tkn.boolean_val);
+            web::json::value value(tkn.boolean_val);
             GetNextToken(tkn);
-            if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
-            return std::move(value);
+            if (tkn.m_error) return web::json::value();
+            return value;
         }
         case JSON_Parser<CharType>::Token::TKN_NullLiteral:
         {
             GetNextToken(tkn);
             // Returning a null value whether or not an error occurred.
-            return utility::details::make_unique<web::json::details::_Null>();
+            return web::json::value();
         }
         default:
         {
             SetErrorCode(tkn, json_error::malformed_token);
-            return utility::details::make_unique<web::json::details::_Null>();
+            return web::json::value();
         }
     }
 }
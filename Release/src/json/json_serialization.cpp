@@ -112,6 +112,14 @@ void web::json::details::append_escape_string(std::basic_string<CharType>& str,
     }
 }
 
+// Explicitly instantiated since the escaping is also used by the struct binding writer.
+template void web::json::details::append_escape_string(std::basic_string<char>& str,
+                                                       const std::basic_string<char>& escaped);
+#ifdef _WIN32
+template void web::json::details::append_escape_string(std::basic_string<wchar_t>& str,
+                                                       const std::basic_string<wchar_t>& escaped);
+#endif
+
 void web::json::details::format_string(const utility::string_t& key, utility::string_t& str)
 {
     str.push_back('"');
@@ -0,0 +1,244 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * Asynchronous reader and writer for newline-delimited JSON (NDJSON) streams.
+ *
+ * For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+
+#include "stdafx.h"
+
+#include "cpprest/ndjson.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace web;
+using namespace utility;
+using namespace concurrency;
+
+namespace web
+{
+namespace json
+{
+namespace details
+{
+class _ndjson_reader_impl
+{
+public:
+    _ndjson_reader_impl(streams::istream stream, size_t max_line_length)
+        : m_buffer(stream.streambuf())
+        , m_chunk(chunk_size)
+        , m_pos(0)
+        , m_len(0)
+        , m_eof(false)
+        , m_found(false)
+        , m_discarding(false)
+        , m_max_line_length(max_line_length)
+    {
+    }
+
+    // Appends chunk data up to the next newline to the pending line.
+    // Returns true if a complete line is now available.
+    bool take_line()
+    {
+        const char* begin = m_chunk.data() + m_pos;
+        const size_t available = m_len - m_pos;
+        const char* newline = static_cast<const char*>(std::memchr(begin, '\n', available));
+        const size_t count = newline != nullptr ? static_cast<size_t>(newline - begin) : available;
+
+        if (m_discarding)
+        {
+            // Skip the remainder of a line that was too long.
+            m_pos += newline != nullptr ? count + 1 : count;
+            m_discarding = newline == nullptr;
+            return false;
+        }
+
+        if (m_line.size() + count > m_max_line_length)
+        {
+            // Drop the line, including what has not been received yet, so that reading can resume with the next one.
+            m_line.clear();
+            m_pos += newline != nullptr ? count + 1 : count;
+            m_discarding = newline == nullptr;
+            throw json_exception("NDJSON line exceeds the maximum line length");
+        }
+
+        m_line.append(begin, count);
+        m_pos += newline != nullptr ? count + 1 : count;
+        return newline != nullptr;
+    }
+
+    // Parses the pending line into m_current. Returns false for blank lines.
+    bool parse_line()
+    {
+        if (!m_line.empty() && m_line.back() == '\r')
+        {
+            m_line.pop_back();
+        }
+
+        bool parsed = false;
+        if (m_line.find_first_not_of(" \t") != std::string::npos)
+        {
+            try
+            {
+                m_current = json::value::parse(conversions::to_string_t(m_line));
+            }
+            catch (...)
+            {
+                // Drop the malformed line so that reading can resume with the next one.
+                m_line.clear();
+                throw;
+            }
+            parsed = true;
+        }
+
+        // clear() keeps the capacity, so steady state reading does not reallocate the line buffer.
+        m_line.clear();
+        return parsed;
+    }
+
+    static const size_t chunk_size = 64 * 1024;
+
+    streams::streambuf<uint8_t> m_buffer;
+    std::vector<char> m_chunk;
+    size_t m_pos;
+    size_t m_len;
+    bool m_eof;
+    bool m_found;
+    bool m_discarding;
+    size_t m_max_line_length;
+    std::string m_line;
+    json::value m_current;
+};
+
+class _ndjson_writer_impl
+{
+public:
+    _ndjson_writer_impl(streams::ostream stream) : m_stream(std::move(stream)), m_last(pplx::task_from_result()) {}
+
+    // Chains an operation after all previously queued writes.
+    pplx::task<void> enqueue(std::function<pplx::task<void>()> op)
+    {
+        pplx::extensibility::scoped_critical_section_t l(m_lock);
+        m_last = m_last.then(std::move(op));
+        return m_last;
+    }
+
+    streams::ostream m_stream;
+
+private:
+    pplx::extensibility::critical_section_t m_lock;
+    pplx::task<void> m_last;
+};
+} // namespace details
+} // namespace json
+} // namespace web
+
+json::ndjson_reader::ndjson_reader(streams::istream stream, size_t max_line_length)
+    : m_impl(std::make_shared<details::_ndjson_reader_impl>(std::move(stream), max_line_length))
+{
+}
+
+pplx::task<bool> json::ndjson_reader::read_next()
+{
+    auto impl = m_impl;
+    impl->m_found = false;
+
+    auto loop = pplx::details::_do_while([impl]() -> pplx::task<bool> {
+        // The first iteration runs on the calling thread, so errors must be returned in the task rather than thrown.
+        try
+        {
+            // Consume lines already buffered without going asynchronous.
+            while (impl->m_pos < impl->m_len)
+            {
+                if (impl->take_line() && impl->parse_line())
+                {
+                    impl->m_found = true;
+                    return pplx::task_from_result(false);
+                }
+            }
+
+            if (impl->m_eof)
+            {
+                // The last line does not need a terminating newline.
+                impl->m_found = !impl->m_discarding && impl->parse_line();
+                impl->m_discarding = false;
+                return pplx::task_from_result(false);
+            }
+        }
+        catch (...)
+        {
+            return pplx::task_from_exception<bool>(std::current_exception());
+        }
+
+        // Only ask for what is already available so that live streams, which complete a read only once the
+        // requested count arrives, yield each line as soon as it is received.
+        const size_t available = impl->m_buffer.in_avail();
+        const size_t count = available == 0 ? 1 : (std::min)(available, impl->m_chunk.size());
+        return impl->m_buffer.getn(reinterpret_cast<uint8_t*>(&impl->m_chunk[0]), count)
+            .then([impl](size_t read) {
+                impl->m_pos = 0;
+                impl->m_len = read;
+                impl->m_eof = read == 0;
+                return true;
+            });
+    });
+
+    return loop.then([impl](bool) { return impl->m_found; });
+}
+
+json::value& json::ndjson_reader::current() { return m_impl->m_current; }
+
+pplx::task<void> json::ndjson_reader::for_each(std::function<void(json::value)> handler)
+{
+    ndjson_reader reader = *this;
+    auto loop = pplx::details::_do_while([reader, handler]() mutable -> pplx::task<bool> {
+        return reader.read_next().then([reader, handler](bool found) mutable {
+            if (found)
+            {
+                handler(std::move(reader.current()));
+            }
+            return found;
+        });
+    });
+    return loop.then([](bool) {});
+}
+
+json::ndjson_writer::ndjson_writer(streams::ostream stream)
+    : m_impl(std::make_shared<details::_ndjson_writer_impl>(std::move(stream)))
+{
+}
+
+pplx::task<void> json::ndjson_writer::write(const json::value& value)
+{
+    auto line = std::make_shared<std::string>(conversions::to_utf8string(value.serialize()));
+    line->push_back('\n');
+
+    auto buffer = m_impl->m_stream.streambuf();
+    return m_impl->enqueue([buffer, line]() mutable {
+        return buffer.putn_nocopy(reinterpret_cast<const uint8_t*>(line->data()), line->size())
+            .then([line](size_t written) {
+                if (written != line->size())
+                {
+                    throw std::runtime_error("failed to write all bytes");
+                }
+            });
+    });
+}
+
+pplx::task<void> json::ndjson_writer::flush()
+{
+    auto stream = m_impl->m_stream;
+    return m_impl->enqueue([stream]() { return stream.flush(); });
+}
+
+pplx::task<void> json::ndjson_writer::close()
+{
+    auto stream = m_impl->m_stream;
+    return m_impl->enqueue([stream]() { return stream.close(); });
+}
@@ -19,9 +19,361 @@
 
 #include "cpprest/details/fileio.h"
 
+#include <sys/mman.h>
+
+#if defined(CPPREST_HAS_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <thread>
+#endif
+
 using namespace boost::asio;
 using namespace Concurrency::streams::details;
 
+#if defined(CPPREST_HAS_IO_URING)
+namespace
+{
+/// <summary>
+/// A single io_uring instance shared by all file streams. Reads and writes are handed to the kernel directly and
+/// completed on a dedicated thread, so threadpool threads never block on file I/O while the ring is available.
+/// </summary>
+class io_uring_queue
+{
+public:
+    /// <summary>
+    /// Returns the shared queue, or nullptr if the kernel does not support io_uring (or it is disabled), in which case
+    /// callers use the threadpool instead.
+    /// </summary>
+    static io_uring_queue* instance()
+    {
+        static io_uring_queue queue;
+        return queue.m_fd != -1 && !s_forked ? &queue : nullptr;
+    }
+
+    /// <summary>
+    /// Queues a single-buffer read or write at an absolute file offset.
+    /// </summary>
+    /// <returns>False if the request could not be queued; the completion is not called in that case.</returns>
+    bool submit(uint8_t opcode, int fd, void* ptr, size_t count, size_t offset, std::function<void(int)> completion)
+    {
+        if (m_failed.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        std::unique_ptr<operation> op(new operation);
+        op->opcode = opcode;
+        op->fd = fd;
+        op->offset = offset;
+        op->iov.iov_base = ptr;
+        op->iov.iov_len = count;
+        op->completion = std::move(completion);
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_failed.load(std::memory_order_relaxed) || m_inflight.load() >= m_cq_entries || !push(op.get()))
+            {
+                return false;
+            }
+            ++m_inflight;
+            op.release();
+        }
+
+        flush();
+        return true;
+    }
+
+    ~io_uring_queue()
+    {
+        if (m_fd == -1)
+        {
+            return;
+        }
+
+        if (s_forked || m_failed.load(std::memory_order_acquire))
+        {
+            // The completion thread does not exist in a forked child, and after a failure it may never wake up, so
+            // neither can be joined. The process is exiting, so the ring is left to the kernel.
+            m_thread.release();
+            return;
+        }
+
+        // A no-op request without an operation attached tells the completion thread to exit.
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            while (!push(nullptr))
+            {
+                std::this_thread::yield();
+            }
+        }
+        flush();
+        m_thread->join();
+
+        munmap(m_sqes, m_sqes_size);
+        if (m_cq_ring != m_sq_ring)
+        {
+            munmap(m_cq_ring, m_cq_size);
+        }
+        munmap(m_sq_ring, m_sq_size);
+        close(m_fd);
+    }
+
+private:
+    struct operation
+    {
+        uint8_t opcode;
+        int fd;
+        size_t offset;
+        iovec iov;
+        std::function<void(int)> completion;
+    };
+
+    io_uring_queue()
+        : m_fd(-1)
+        , m_sq_ring(MAP_FAILED)
+        , m_cq_ring(MAP_FAILED)
+        , m_sqes(static_cast<io_uring_sqe*>(MAP_FAILED))
+        , m_sq_size(0)
+        , m_cq_size(0)
+        , m_sqes_size(0)
+        , m_cq_entries(0)
+        , m_inflight(0)
+        , m_submitting(false)
+        , m_failed(false)
+    {
+        if (getenv("CPPREST_DISABLE_IO_URING") != nullptr)
+        {
+            return;
+        }
+
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        const int fd = static_cast<int>(syscall(__NR_io_uring_setup, 256, &params));
+        if (fd < 0)
+        {
+            return;
+        }
+
+        m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap)
+        {
+            m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+        }
+        m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+        m_sq_ring = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        m_cq_ring = single_mmap ? m_sq_ring
+                                : mmap(nullptr,
+                                       m_cq_size,
+                                       PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_POPULATE,
+                                       fd,
+                                       IORING_OFF_CQ_RING);
+        void* sqes =
+            mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (m_sq_ring == MAP_FAILED || m_cq_ring == MAP_FAILED || sqes == MAP_FAILED)
+        {
+            if (sqes != MAP_FAILED) munmap(sqes, m_sqes_size);
+            if (m_cq_ring != MAP_FAILED && m_cq_ring != m_sq_ring) munmap(m_cq_ring, m_cq_size);
+            if (m_sq_ring != MAP_FAILED) munmap(m_sq_ring, m_sq_size);
+            close(fd);
+            return;
+        }
+        m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto sq = static_cast<char*>(m_sq_ring);
+        m_sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        m_sq_entries = params.sq_entries;
+        m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        auto cq = static_cast<char*>(m_cq_ring);
+        m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        m_cq_entries = params.cq_entries;
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // The ring and the completion thread belong to this process; a forked child uses the threadpool instead.
+        pthread_atfork(nullptr, nullptr, []() { s_forked = true; });
+
+        m_fd = fd;
+        m_thread.reset(new std::thread([this]() { run(); }));
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, m_fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    unsigned unsubmitted() const
+    {
+        return __atomic_load_n(m_sq_tail, __ATOMIC_ACQUIRE) - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+    }
+
+    // Adds an entry to the submission queue without submitting it. Must be called with m_lock held.
+    bool push(operation* op)
+    {
+        const unsigned tail = *m_sq_tail;
+        if (tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) >= m_sq_entries)
+        {
+            return false;
+        }
+
+        const unsigned index = tail & m_sq_mask;
+        io_uring_sqe& sqe = m_sqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = op != nullptr ? op->opcode : static_cast<uint8_t>(IORING_OP_NOP);
+        sqe.fd = op != nullptr ? op->fd : -1;
+        sqe.addr = op != nullptr ? reinterpret_cast<uint64_t>(&op->iov) : 0;
+        sqe.len = op != nullptr ? 1 : 0;
+        sqe.off = op != nullptr ? op->offset : 0;
+        sqe.user_data = reinterpret_cast<uint64_t>(op);
+        m_sq_array[index] = index;
+        __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Hands queued entries to the kernel. One thread submits at a time and picks up whatever others have pushed in the
+    // meantime, so the system call is made without holding m_lock and several entries can go in one call.
+    void flush()
+    {
+        while (!m_submitting.exchange(true, std::memory_order_acquire))
+        {
+            for (unsigned pending = unsubmitted(); pending != 0; pending = unsubmitted())
+            {
+                const int submitted = enter(pending, 0, 0);
+                if (submitted < 0 ? errno != EINTR : submitted == 0)
+                {
+                    fail_unsubmitted();
+                }
+            }
+            m_submitting.store(false, std::memory_order_release);
+
+            if (unsubmitted() == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    // Disables the ring and performs the entries the kernel did not accept on the threadpool. Only the submitting
+    // thread may call this, since no other thread can then hand entries to the kernel.
+    void fail_unsubmitted()
+    {
+        std::vector<operation*> ops;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_failed.store(true, std::memory_order_release);
+
+            const unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+            for (unsigned i = head; i != *m_sq_tail; ++i)
+            {
+                ops.push_back(reinterpret_cast<operation*>(m_sqes[i & m_sq_mask].user_data));
+            }
+            __atomic_store_n(m_sq_tail, head, __ATOMIC_RELEASE);
+        }
+
+        for (auto op : ops)
+        {
+            if (op != nullptr)
+            {
+                pplx::create_task([this, op]() { complete(std::unique_ptr<operation>(op), perform(*op)); });
+            }
+        }
+    }
+
+    static int perform(const operation& op)
+    {
+        const ssize_t result = op.opcode == IORING_OP_READV ? preadv(op.fd, &op.iov, 1, op.offset)
+                                                            : pwritev(op.fd, &op.iov, 1, op.offset);
+        return result < 0 ? -errno : static_cast<int>(result);
+    }
+
+    void complete(std::unique_ptr<operation> op, int result)
+    {
+        --m_inflight;
+        op->completion(result);
+    }
+
+    void run()
+    {
+        for (;;)
+        {
+            if (!m_failed.load(std::memory_order_acquire))
+            {
+                if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN)
+                {
+                    // New requests go to the threadpool from now on. Those the kernel already has still complete into
+                    // the ring, which is polled until they are all done.
+                    m_failed.store(true, std::memory_order_release);
+                }
+            }
+            else if (m_inflight.load() == 0)
+            {
+                return;
+            }
+            else if (*m_cq_head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE))
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            unsigned head = *m_cq_head;
+            while (head != __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE))
+            {
+                const io_uring_cqe& cqe = m_cqes[head & m_cq_mask];
+                std::unique_ptr<operation> op(reinterpret_cast<operation*>(cqe.user_data));
+                const int result = cqe.res;
+                __atomic_store_n(m_cq_head, ++head, __ATOMIC_RELEASE);
+
+                if (!op)
+                {
+                    return;
+                }
+                complete(std::move(op), result);
+            }
+        }
+    }
+
+    // Set in a child process after fork().
+    static bool s_forked;
+
+    int m_fd;
+    void* m_sq_ring;
+    void* m_cq_ring;
+    io_uring_sqe* m_sqes;
+    size_t m_sq_size;
+    size_t m_cq_size;
+    size_t m_sqes_size;
+
+    unsigned* m_sq_head;
+    unsigned* m_sq_tail;
+    unsigned* m_sq_array;
+    unsigned m_sq_mask;
+    unsigned m_sq_entries;
+
+    unsigned* m_cq_head;
+    unsigned* m_cq_tail;
+    io_uring_cqe* m_cqes;
+    unsigned m_cq_mask;
+    unsigned m_cq_entries;
+
+    // Guards adding entries to the submission queue.
+    std::mutex m_lock;
+    std::atomic<unsigned> m_inflight;
+    std::atomic<bool> m_submitting;
+    std::atomic<bool> m_failed;
+    std::unique_ptr<std::thread> m_thread;
+};
+
+bool io_uring_queue::s_forked = false;
+} // namespace
+#endif
+
 namespace Concurrency
 {
 namespace streams
@@ -41,10 +393,32 @@ namespace details
 /// independent. The actual allocated record is larger and has details that the implementation
 /// require in order to function.
 /// </summary>
+static const size_t PageSize = 512;
+
+// The read buffer starts at InitialReadAhead bytes and doubles with every sequential refill up to buffer_size(), while
+// the following block is read into a second buffer of the same size. The default cap keeps a stream at 128 KiB or less;
+// a buffer_size() of PageSize or less turns read-ahead off.
+static const size_t InitialReadAhead = 4096;
+static const size_t DefaultReadAheadLimit = 64 * 1024;
+
 struct _file_info_impl : _file_info
 {
     _file_info_impl(int handle, std::ios_base::openmode mode, bool buffer_reads)
-        : _file_info(mode, 512), m_handle(handle), m_buffer_reads(buffer_reads), m_outstanding_writes(0)
+        : _file_info(mode, DefaultReadAheadLimit)
+        , m_handle(handle)
+        , m_buffer_reads(buffer_reads)
+        , m_outstanding_writes(0)
+        , m_readahead(InitialReadAhead)
+        , m_prefetch(nullptr)
+        , m_prefetch_off(0)
+        , m_prefetch_size(0)
+        , m_prefetch_fill(0)
+        , m_prefetch_done(false)
+        , m_prefetch_failed(false)
+        , m_prefetch_pending(0)
+        , m_spare(nullptr)
+        , m_spare_size(0)
+        , m_advised_sequential(false)
     {
     }
 
@@ -61,6 +435,58 @@ struct _file_info_impl : _file_info
     std::vector<_filestream_callback*> m_sync_waiters;
 
     std::atomic<long> m_outstanding_writes;
+
+    /// <summary>
+    /// The number of bytes requested by the next refill of the read buffer.
+    /// </summary>
+    size_t m_readahead;
+
+    /// <summary>
+    /// Once sequential reading is detected, the data following the read buffer is read into this second buffer in the
+    /// background, so the next refill does not have to wait for the disk.
+    /// </summary>
+    char* m_prefetch;
+    size_t m_prefetch_off;  // File offset (in bytes) of the read-ahead data.
+    size_t m_prefetch_size; // Number of bytes requested.
+    size_t m_prefetch_fill; // Number of bytes actually read, once done.
+    bool m_prefetch_done;
+    bool m_prefetch_failed;
+
+    /// <summary>
+    /// A refill waiting for the read-ahead to arrive.
+    /// </summary>
+    std::function<void()> m_prefetch_waiter;
+
+    /// <summary>
+    /// Read-ahead requests still in flight, including abandoned ones. Closing is deferred until there are none.
+    /// </summary>
+    int m_prefetch_pending;
+    std::function<void()> m_on_prefetch_idle;
+
+    /// <summary>
+    /// The read buffer given up by the last swap, kept to receive the next read-ahead.
+    /// </summary>
+    char* m_spare;
+    size_t m_spare_size;
+
+    bool m_advised_sequential;
+};
+
+/// <summary>
+/// The record of a read-only, memory-mapped file.
+/// </summary>
+struct _mmap_info
+{
+    int m_handle;
+    utility::size64_t m_size;
+
+    // Windows are aligned to the page size and at most m_window_size bytes long.
+    size_t m_page_size;
+    size_t m_window_size;
+
+    const char* m_window;
+    utility::size64_t m_window_off;
+    size_t m_window_len;
 };
 
 } // namespace details
@@ -171,6 +597,37 @@ bool _open_fsb_str(_filestream_callback* callback, const char* filename, std::io
     return true;
 }
 
+/// <summary>
+/// Forget the read-ahead buffer. A read that is still in flight frees its buffer when it completes.
+/// </summary>
+void _discard_prefetch(_file_info_impl* fInfo)
+{
+    if (fInfo->m_prefetch != nullptr && fInfo->m_prefetch_done)
+    {
+        delete[] fInfo->m_prefetch;
+    }
+    fInfo->m_prefetch = nullptr;
+    fInfo->m_prefetch_done = fInfo->m_prefetch_failed = false;
+
+    delete[] fInfo->m_spare;
+    fInfo->m_spare = nullptr;
+    fInfo->m_spare_size = 0;
+}
+
+/// <summary>
+/// Drop the read buffer after a seek; reading starts over with a small read-ahead.
+/// </summary>
+void _drop_read_buffer(_file_info_impl* fInfo)
+{
+    if (fInfo->m_buffer != nullptr)
+    {
+        delete[] fInfo->m_buffer;
+        fInfo->m_buffer = nullptr;
+        fInfo->m_bufoff = fInfo->m_buffill = fInfo->m_bufsize = 0;
+    }
+    _discard_prefetch(fInfo);
+}
+
 /// <summary>
 /// Close a file stream buffer.
 /// </summary>
@@ -192,7 +649,7 @@ bool _close_fsb_nolock(_file_info** info, Concurrency::streams::details::_filest
     // Since closing a file may involve waiting for outstanding writes which can take some time
     // if the file is on a network share, the close action is done in a separate task, as
     // CloseHandle doesn't have I/O completion events.
-    pplx::create_task([=]() -> void {
+    auto close_file = [=]() -> void {
         bool result = false;
 
         {
@@ -218,7 +675,18 @@ bool _close_fsb_nolock(_file_info** info, Concurrency::streams::details::_filest
         {
             callback->on_error(std::make_exception_ptr(utility::details::create_system_error(errno)));
         }
-    });
+    };
+
+    // A read-ahead still in flight refers to the file info record, so it has to land before the record goes away.
+    _discard_prefetch(fInfo);
+    if (fInfo->m_prefetch_pending > 0)
+    {
+        fInfo->m_on_prefetch_idle = [=]() { pplx::create_task(close_file); };
+    }
+    else
+    {
+        pplx::create_task(close_file);
+    }
 
     *info = nullptr;
 
@@ -235,6 +703,42 @@ bool _close_fsb(_file_info** info, Concurrency::streams::details::_filestream_ca
     return _close_fsb_nolock(info, callback);
 }
 
+/// <summary>
+/// Report the result of a write and release anyone waiting for outstanding writes to drain.
+/// </summary>
+/// <param name="fInfo">The file info record of the file</param>
+/// <param name="callback">A pointer to the callback interface to invoke with the result.</param>
+/// <param name="bytes_written">The number of bytes written, or -1 if the write failed</param>
+/// <param name="error">The errno value describing the failure</param>
+void _finish_write(Concurrency::streams::details::_file_info_impl* fInfo,
+                   Concurrency::streams::details::_filestream_callback* callback,
+                   ssize_t bytes_written,
+                   int error)
+{
+    if (bytes_written == -1)
+    {
+        callback->on_error(std::make_exception_ptr(utility::details::create_system_error(error)));
+    }
+
+    callback->on_completed(static_cast<size_t>(bytes_written));
+
+    {
+        pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
+
+        // Decrement the counter of outstanding write events.
+        if (--fInfo->m_outstanding_writes == 0)
+        {
+            // If this was the last one, signal all objects waiting for it to complete.
+
+            for (auto iter = fInfo->m_sync_waiters.begin(); iter != fInfo->m_sync_waiters.end(); iter++)
+            {
+                (*iter)->on_completed(0);
+            }
+            fInfo->m_sync_waiters.clear();
+        }
+    }
+}
+
 /// <summary>
 /// Initiate an asynchronous (overlapped) write to the file stream.
 /// </summary>
@@ -252,6 +756,21 @@ size_t _write_file_async(Concurrency::streams::details::_file_info_impl* fInfo,
 {
     ++fInfo->m_outstanding_writes;
 
+#if defined(CPPREST_HAS_IO_URING)
+    // Appends need the current end of the file, which only the blocking path below can determine safely.
+    auto queue = position != static_cast<size_t>(-1) ? io_uring_queue::instance() : nullptr;
+    if (queue != nullptr &&
+        queue->submit(IORING_OP_WRITEV,
+                      fInfo->m_handle,
+                      const_cast<void*>(ptr),
+                      count,
+                      position,
+                      [=](int result) { _finish_write(fInfo, callback, result < 0 ? -1 : result, -result); }))
+    {
+        return 0;
+    }
+#endif
+
     pplx::create_task([=]() -> void {
         off_t abs_position;
         bool must_restore_pos;
@@ -270,33 +789,14 @@ size_t _write_file_async(Concurrency::streams::details::_file_info_impl* fInfo,
         }
 
         auto bytes_written = pwrite(fInfo->m_handle, ptr, count, abs_position);
-        if (bytes_written == -1)
-        {
-            callback->on_error(std::make_exception_ptr(utility::details::create_system_error(errno)));
-        }
+        const int error = errno;
 
         if (must_restore_pos)
         {
             lseek(fInfo->m_handle, orig_pos, SEEK_SET);
         }
 
-        callback->on_completed(bytes_written);
-
-        {
-            pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
-
-            // Decrement the counter of outstanding write events.
-            if (--fInfo->m_outstanding_writes == 0)
-            {
-                // If this was the last one, signal all objects waiting for it to complete.
-
-                for (auto iter = fInfo->m_sync_waiters.begin(); iter != fInfo->m_sync_waiters.end(); iter++)
-                {
-                    (*iter)->on_completed(0);
-                }
-                fInfo->m_sync_waiters.clear();
-            }
-        }
+        _finish_write(fInfo, callback, bytes_written, error);
     });
 
     return 0;
@@ -318,6 +818,23 @@ size_t _read_file_async(Concurrency::streams::details::_file_info_impl* fInfo,
                         size_t count,
                         size_t offset)
 {
+#if defined(CPPREST_HAS_IO_URING)
+    auto queue = io_uring_queue::instance();
+    if (queue != nullptr && queue->submit(IORING_OP_READV, fInfo->m_handle, ptr, count, offset, [=](int result) {
+            if (result < 0)
+            {
+                callback->on_error(std::make_exception_ptr(utility::details::create_system_error(-result)));
+            }
+            else
+            {
+                callback->on_completed(static_cast<size_t>(result));
+            }
+        }))
+    {
+        return 0;
+    }
+#endif
+
     pplx::create_task([=]() -> void {
         auto bytes_read = pread(fInfo->m_handle, ptr, count, offset);
         if (bytes_read < 0)
@@ -368,64 +885,216 @@ _filestream_callback_fill_buffer<Func>* create_callback(_file_info* info,
     return new _filestream_callback_fill_buffer<Func>(info, callback, func);
 }
 
-static const size_t PageSize = 512;
-
-size_t _fill_buffer_fsb(_file_info_impl* fInfo, _filestream_callback* callback, size_t count, size_t charSize)
+/// <summary>
+/// Completion of a background read-ahead request.
+/// </summary>
+class _filestream_callback_readahead : public _filestream_callback
 {
-    size_t byteCount = count * charSize;
-    if (fInfo->m_buffer == nullptr)
+public:
+    _filestream_callback_readahead(_file_info_impl* info, char* buffer) : m_info(info), m_buffer(buffer) {}
+
+    virtual void on_completed(size_t result) override { finish(result, false); }
+    virtual void on_error(const std::exception_ptr&) override { finish(0, true); }
+
+private:
+    void finish(size_t result, bool failed)
     {
-        fInfo->m_bufsize = std::max(PageSize, byteCount);
-        fInfo->m_buffer = new char[static_cast<size_t>(fInfo->m_bufsize)];
-        fInfo->m_bufoff = fInfo->m_rdpos;
+        std::function<void()> waiter, idle;
+        {
+            pplx::extensibility::scoped_recursive_lock_t lock(m_info->m_lock);
 
-        auto cb = create_callback(fInfo, callback, [=](size_t result) {
-            pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
-            fInfo->m_buffill = result / charSize;
-            callback->on_completed(result);
-        });
+            if (m_info->m_prefetch == m_buffer)
+            {
+                m_info->m_prefetch_fill = result;
+                m_info->m_prefetch_done = true;
+                m_info->m_prefetch_failed = failed;
+            }
+            else
+            {
+                // The reader seeked away or closed the file while the data was in flight.
+                delete[] m_buffer;
+            }
 
-        return _read_file_async(fInfo, cb, (uint8_t*)fInfo->m_buffer, fInfo->m_bufsize, fInfo->m_rdpos * charSize);
+            waiter.swap(m_info->m_prefetch_waiter);
+            if (--m_info->m_prefetch_pending == 0)
+            {
+                idle.swap(m_info->m_on_prefetch_idle);
+            }
+        }
+
+        if (waiter) waiter();
+        if (idle) idle();
+        delete this;
     }
 
-    // First, we need to understand how far into the buffer we have already read
-    // and how much remains.
+    _file_info_impl* m_info;
+    char* m_buffer;
+};
 
-    size_t bufpos = fInfo->m_rdpos - fInfo->m_bufoff;
-    size_t bufrem = fInfo->m_buffill - bufpos;
+/// <summary>
+/// Start reading the data that follows the read buffer into the read-ahead buffer.
+/// </summary>
+void _start_prefetch(_file_info_impl* fInfo, size_t charSize)
+{
+    if (fInfo->m_buffer_size <= PageSize)
+    {
+        return;
+    }
 
-    if (bufrem < count)
+    fInfo->m_prefetch_size = fInfo->m_readahead;
+    fInfo->m_prefetch_off = (fInfo->m_bufoff + fInfo->m_buffill) * charSize;
+    if (fInfo->m_spare != nullptr && fInfo->m_spare_size >= fInfo->m_prefetch_size)
+    {
+        fInfo->m_prefetch = fInfo->m_spare;
+        fInfo->m_prefetch_size = fInfo->m_spare_size;
+    }
+    else
     {
-        fInfo->m_bufsize = std::max(PageSize, byteCount);
+        delete[] fInfo->m_spare;
+        fInfo->m_prefetch = new char[fInfo->m_prefetch_size];
+    }
+    fInfo->m_spare = nullptr;
+    fInfo->m_spare_size = 0;
+    fInfo->m_prefetch_done = fInfo->m_prefetch_failed = false;
+    ++fInfo->m_prefetch_pending;
 
-        // Then, we allocate a new buffer.
+    auto cb = new _filestream_callback_readahead(fInfo, fInfo->m_prefetch);
+    _read_file_async(fInfo, cb, fInfo->m_prefetch, fInfo->m_prefetch_size, fInfo->m_prefetch_off);
+}
 
-        char* newbuf = new char[static_cast<size_t>(fInfo->m_bufsize)];
+/// <summary>
+/// Make the completed read-ahead data the read buffer, after the bufrem characters that have not been read yet.
+/// </summary>
+void _absorb_prefetch(_file_info_impl* fInfo, size_t bufrem, size_t charSize)
+{
+    const size_t leftover = bufrem * charSize;
+    if (leftover == 0)
+    {
+        // The common case for sequential reads: swap buffers, and keep the consumed one for the next read-ahead.
+        delete[] fInfo->m_spare;
+        fInfo->m_spare = fInfo->m_buffer;
+        fInfo->m_spare_size = static_cast<size_t>(fInfo->m_bufsize);
+        fInfo->m_buffer = fInfo->m_prefetch;
+        fInfo->m_bufsize = fInfo->m_prefetch_size;
+    }
+    else
+    {
+        char* joined = new char[leftover + fInfo->m_prefetch_fill];
+        memcpy(joined, fInfo->m_buffer + (fInfo->m_rdpos - fInfo->m_bufoff) * charSize, leftover);
+        memcpy(joined + leftover, fInfo->m_prefetch, fInfo->m_prefetch_fill);
+        delete[] fInfo->m_buffer;
+        delete[] fInfo->m_spare;
+        fInfo->m_spare = fInfo->m_prefetch;
+        fInfo->m_spare_size = fInfo->m_prefetch_size;
+        fInfo->m_buffer = joined;
+        fInfo->m_bufsize = leftover + fInfo->m_prefetch_fill;
+    }
 
-        // Then, we copy the unread part to the new buffer and delete the old buffer
+    fInfo->m_bufoff = fInfo->m_rdpos;
+    fInfo->m_buffill = bufrem + fInfo->m_prefetch_fill / charSize;
+    fInfo->m_prefetch = nullptr;
+    fInfo->m_prefetch_done = false;
+}
 
-        if (bufrem > 0) memcpy(newbuf, fInfo->m_buffer + bufpos * charSize, bufrem * charSize);
+size_t _fill_buffer_fsb(_file_info_impl* fInfo, _filestream_callback* callback, size_t count, size_t charSize)
+{
+    size_t byteCount = count * charSize;
+    const size_t limit = std::max(PageSize, fInfo->m_buffer_size);
+
+    // A refill of an existing buffer continues where the reader left off, so the file is being read sequentially:
+    // grow the read-ahead and let the kernel know. The first read, and the first one after a seek, start small in
+    // case access is random.
+    const bool sequential = fInfo->m_buffer != nullptr;
+    size_t bufrem = 0;
+    if (sequential)
+    {
+        bufrem = fInfo->m_bufoff + fInfo->m_buffill - fInfo->m_rdpos;
+        if (bufrem >= count) return byteCount;
 
-        delete[] fInfo->m_buffer;
-        fInfo->m_buffer = newbuf;
+        fInfo->m_readahead = std::min(limit, fInfo->m_readahead * 2);
+        if (!fInfo->m_advised_sequential)
+        {
+            posix_fadvise(fInfo->m_handle, 0, 0, POSIX_FADV_SEQUENTIAL);
+            fInfo->m_advised_sequential = true;
+        }
+    }
+    else
+    {
+        fInfo->m_readahead = std::min(limit, InitialReadAhead);
+        if (fInfo->m_advised_sequential)
+        {
+            posix_fadvise(fInfo->m_handle, 0, 0, POSIX_FADV_NORMAL);
+            fInfo->m_advised_sequential = false;
+        }
+    }
 
-        // Then, we read the remainder of the count into the new buffer
-        fInfo->m_bufoff = fInfo->m_rdpos;
+    if (fInfo->m_prefetch != nullptr)
+    {
+        if (fInfo->m_prefetch_off != (fInfo->m_rdpos + bufrem) * charSize || fInfo->m_prefetch_failed)
+        {
+            _discard_prefetch(fInfo);
+        }
+        else if (!fInfo->m_prefetch_done)
+        {
+            // The data is already on its way; pick this refill up again once it arrives.
+            fInfo->m_prefetch_waiter = [=]() {
+                pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
+                size_t read = _fill_buffer_fsb(fInfo, callback, count, charSize);
+                if (read != 0) callback->on_completed(read);
+            };
+            return 0;
+        }
+        else
+        {
+            const bool at_end = fInfo->m_prefetch_fill < fInfo->m_prefetch_size;
+            _absorb_prefetch(fInfo, bufrem, charSize);
+            bufrem = fInfo->m_buffill;
 
-        auto cb = create_callback(fInfo, callback, [=](size_t result) {
-            pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
-            fInfo->m_buffill = result / charSize;
-            callback->on_completed(result + bufrem * charSize);
-        });
+            if (bufrem >= count || at_end)
+            {
+                if (!at_end) _start_prefetch(fInfo, charSize);
+                if (bufrem >= count) return byteCount;
+                if (bufrem > 0) return bufrem * charSize;
+
+                // Zero means "pending" to the caller, so an empty result at the end of the file is delivered through
+                // the callback instead.
+                callback->on_completed(0);
+                return 0;
+            }
+        }
+    }
 
-        return _read_file_async(fInfo,
-                                cb,
-                                (uint8_t*)fInfo->m_buffer + bufrem * charSize,
-                                fInfo->m_bufsize - bufrem * charSize,
-                                (fInfo->m_rdpos + bufrem) * charSize);
+    // Read the rest into a buffer that holds the unread characters followed by the new data. The existing buffer is
+    // reused if it is large enough.
+    const size_t leftover = bufrem * charSize;
+    const size_t size = std::max(fInfo->m_readahead, byteCount);
+    if (fInfo->m_buffer == nullptr || static_cast<size_t>(fInfo->m_bufsize) < size)
+    {
+        char* newbuf = new char[size];
+        if (leftover > 0) memcpy(newbuf, fInfo->m_buffer + (fInfo->m_rdpos - fInfo->m_bufoff) * charSize, leftover);
+        delete[] fInfo->m_buffer;
+        fInfo->m_buffer = newbuf;
+        fInfo->m_bufsize = size;
     }
-    else
-        return byteCount;
+    else if (leftover > 0)
+    {
+        memmove(fInfo->m_buffer, fInfo->m_buffer + (fInfo->m_rdpos - fInfo->m_bufoff) * charSize, leftover);
+    }
+    fInfo->m_bufoff = fInfo->m_rdpos;
+    fInfo->m_buffill = bufrem;
+
+    const size_t toread = static_cast<size_t>(fInfo->m_bufsize) - leftover;
+    auto cb = create_callback(fInfo, callback, [=](size_t result) {
+        pplx::extensibility::scoped_recursive_lock_t lock(fInfo->m_lock);
+        fInfo->m_buffill = bufrem + result / charSize;
+        if (sequential && result == toread)
+        {
+            _start_prefetch(fInfo, charSize);
+        }
+        callback->on_completed(result + leftover);
+    });
+
+    return _read_file_async(fInfo, cb, fInfo->m_buffer + leftover, toread, (fInfo->m_rdpos + bufrem) * charSize);
 }
 
 /// <summary>
@@ -467,6 +1136,7 @@ size_t _getn_fsb(Concurrency::streams::details::_file_info* info,
 
         if (static_cast<int>(read) > 0)
         {
+            delete cb;
             auto copy = std::min(read, byteCount);
             auto bufoff = fInfo->m_rdpos - fInfo->m_bufoff;
             memcpy(ptr, fInfo->m_buffer + bufoff * charSize, copy);
@@ -560,12 +1230,7 @@ size_t _seekrdtoend_fsb(Concurrency::streams::details::_file_info* info, int64_t
 
     if (fInfo->m_handle == -1) return static_cast<size_t>(-1);
 
-    if (fInfo->m_buffer != nullptr)
-    {
-        delete[] fInfo->m_buffer;
-        fInfo->m_buffer = nullptr;
-        fInfo->m_bufoff = fInfo->m_buffill = fInfo->m_bufsize = 0;
-    }
+    _drop_read_buffer(fInfo);
 
     auto newpos = lseek(fInfo->m_handle, static_cast<off_t>(offset * char_size), SEEK_END);
 
@@ -585,12 +1250,7 @@ utility::size64_t _get_size(_In_ concurrency::streams::details::_file_info* info
 
     if (fInfo->m_handle == -1) return static_cast<size_t>(-1);
 
-    if (fInfo->m_buffer != nullptr)
-    {
-        delete[] fInfo->m_buffer;
-        fInfo->m_buffer = nullptr;
-        fInfo->m_bufoff = fInfo->m_buffill = fInfo->m_bufsize = 0;
-    }
+    _drop_read_buffer(fInfo);
 
     auto oldpos = lseek(fInfo->m_handle, 0, SEEK_CUR);
 
@@ -623,9 +1283,7 @@ size_t _seekrdpos_fsb(Concurrency::streams::details::_file_info* info, size_t po
 
     if (pos < fInfo->m_bufoff || pos > (fInfo->m_bufoff + fInfo->m_buffill))
     {
-        delete[] fInfo->m_buffer;
-        fInfo->m_buffer = nullptr;
-        fInfo->m_bufoff = fInfo->m_buffill = fInfo->m_bufsize = 0;
+        _drop_read_buffer(fInfo);
     }
 
     fInfo->m_rdpos = pos;
@@ -651,3 +1309,118 @@ size_t _seekwrpos_fsb(Concurrency::streams::details::_file_info* info, size_t po
     fInfo->m_wrpos = pos;
     return fInfo->m_wrpos;
 }
+
+/// <summary>
+/// Get the file descriptor of an open file stream, so that its content can be transmitted by the operating system.
+/// </summary>
+/// <param name="info">The file info record of the file</param>
+/// <returns>The file descriptor, or -1 if the file is not open</returns>
+int _get_fd_fsb(Concurrency::streams::details::_file_info* info)
+{
+    if (info == nullptr) return -1;
+
+    _file_info_impl* fInfo = static_cast<_file_info_impl*>(info);
+
+    pplx::extensibility::scoped_recursive_lock_t lock(info->m_lock);
+
+    return fInfo->m_handle;
+}
+
+/// <summary>
+/// Open a file for memory-mapped reading. Nothing is mapped until <c>_map_mmap</c> is called.
+/// </summary>
+/// <param name="filename">The name of the file to open</param>
+/// <param name="window_size">The largest number of bytes of the file to keep mapped at any time</param>
+/// <param name="error">Receives the errno value if the file could not be opened</param>
+/// <returns>The record of the opened file, or nullptr if it could not be opened.</returns>
+_mmap_info* _open_mmap(const char* filename, size_t window_size, unsigned long* error)
+{
+    *error = 0;
+    int fh = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fh == -1)
+    {
+        *error = errno;
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fh, &st) == -1)
+    {
+        *error = errno;
+        close(fh);
+        return nullptr;
+    }
+
+    auto info = new _mmap_info();
+    info->m_handle = fh;
+    info->m_size = static_cast<utility::size64_t>(st.st_size);
+    info->m_page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    info->m_window_size =
+        std::max(info->m_page_size, (window_size + info->m_page_size - 1) / info->m_page_size * info->m_page_size);
+    info->m_window = nullptr;
+    info->m_window_off = 0;
+    info->m_window_len = 0;
+    return info;
+}
+
+utility::size64_t _mmap_size(const _mmap_info* info) { return info->m_size; }
+
+/// <summary>
+/// Map the window of the file that contains the given offset, unmapping the previous window if necessary.
+/// </summary>
+/// <param name="info">The record of the file</param>
+/// <param name="offset">The offset (in bytes) of the data to map</param>
+/// <param name="length">Receives the number of bytes mapped contiguously starting at the offset</param>
+/// <param name="error">Receives the errno value if the mapping failed</param>
+/// <returns>A pointer to the data at the offset, or nullptr at the end of the file or on error.</returns>
+const char* _map_mmap(_mmap_info* info, utility::size64_t offset, size_t* length, unsigned long* error)
+{
+    *length = 0;
+    *error = 0;
+    if (offset >= info->m_size) return nullptr;
+
+    if (info->m_window == nullptr || offset < info->m_window_off || offset >= info->m_window_off + info->m_window_len)
+    {
+        if (info->m_window != nullptr)
+        {
+            munmap(const_cast<char*>(info->m_window), info->m_window_len);
+            info->m_window = nullptr;
+        }
+
+        const utility::size64_t start = offset - offset % info->m_page_size;
+        const size_t len = static_cast<size_t>(std::min<utility::size64_t>(info->m_window_size, info->m_size - start));
+        void* window = mmap(nullptr, len, PROT_READ, MAP_SHARED, info->m_handle, static_cast<off_t>(start));
+        if (window == MAP_FAILED)
+        {
+            *error = errno;
+            return nullptr;
+        }
+
+        // Readers of mapped files almost always stream through them.
+        madvise(window, len, MADV_SEQUENTIAL);
+
+        info->m_window = static_cast<const char*>(window);
+        info->m_window_off = start;
+        info->m_window_len = len;
+    }
+
+    const size_t skip = static_cast<size_t>(offset - info->m_window_off);
+    *length = info->m_window_len - skip;
+    return info->m_window + skip;
+}
+
+/// <summary>
+/// Unmap and close a memory-mapped file.
+/// </summary>
+/// <param name="info">The record of the file</param>
+void _close_mmap(_mmap_info* info)
+{
+    if (info == nullptr) return;
+
+    if (info->m_window != nullptr)
+    {
+        munmap(const_cast<char*>(info->m_window), info->m_window_len);
+    }
+    close(info->m_handle);
+    delete info;
+}
@@ -61,6 +61,24 @@ struct _file_info_impl : _file_info
     void* m_io_context;
 };
 
+/// <summary>
+/// The record of a read-only, memory-mapped file.
+/// </summary>
+struct _mmap_info
+{
+    HANDLE m_handle;
+    HANDLE m_mapping;
+    utility::size64_t m_size;
+
+    // Windows are aligned to the allocation granularity and at most m_window_size bytes long.
+    size_t m_granularity;
+    size_t m_window_size;
+
+    const char* m_window;
+    utility::size64_t m_window_off;
+    size_t m_window_len;
+};
+
 } // namespace details
 } // namespace streams
 } // namespace Concurrency
@@ -951,3 +969,131 @@ size_t __cdecl _seekwrpos_fsb(_In_ streams::details::_file_info* info, size_t po
     fInfo->m_wrpos = pos;
     return fInfo->m_wrpos;
 }
+
+/// <summary>
+/// Open a file for memory-mapped reading. Nothing is mapped until <c>_map_mmap</c> is called.
+/// </summary>
+/// <param name="filename">The name of the file to open</param>
+/// <param name="window_size">The largest number of bytes of the file to keep mapped at any time</param>
+/// <param name="error">Receives the Win32 error code if the file could not be opened</param>
+/// <returns>The record of the opened file, or nullptr if it could not be opened.</returns>
+_mmap_info* __cdecl _open_mmap(const utility::char_t* filename, size_t window_size, _Out_ unsigned long* error)
+{
+    *error = 0;
+    HANDLE fh = ::CreateFileW(filename,
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                              nullptr);
+    if (fh == INVALID_HANDLE_VALUE)
+    {
+        *error = GetLastError();
+        return nullptr;
+    }
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(fh, &size) != TRUE)
+    {
+        *error = GetLastError();
+        CloseHandle(fh);
+        return nullptr;
+    }
+
+    // Empty files cannot be mapped, but there is nothing to read from them either.
+    HANDLE mapping = nullptr;
+    if (size.QuadPart > 0)
+    {
+        mapping = CreateFileMappingW(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            *error = GetLastError();
+            CloseHandle(fh);
+            return nullptr;
+        }
+    }
+
+    SYSTEM_INFO sysinfo;
+    GetSystemInfo(&sysinfo);
+
+    auto info = new _mmap_info();
+    info->m_handle = fh;
+    info->m_mapping = mapping;
+    info->m_size = static_cast<utility::size64_t>(size.QuadPart);
+    info->m_granularity = sysinfo.dwAllocationGranularity;
+    info->m_window_size = (std::max)(
+        info->m_granularity, (window_size + info->m_granularity - 1) / info->m_granularity * info->m_granularity);
+    info->m_window = nullptr;
+    info->m_window_off = 0;
+    info->m_window_len = 0;
+    return info;
+}
+
+utility::size64_t __cdecl _mmap_size(_In_ const _mmap_info* info) { return info->m_size; }
+
+/// <summary>
+/// Map the window of the file that contains the given offset, unmapping the previous window if necessary.
+/// </summary>
+/// <param name="info">The record of the file</param>
+/// <param name="offset">The offset (in bytes) of the data to map</param>
+/// <param name="length">Receives the number of bytes mapped contiguously starting at the offset</param>
+/// <param name="error">Receives the Win32 error code if the mapping failed</param>
+/// <returns>A pointer to the data at the offset, or nullptr at the end of the file or on error.</returns>
+const char* __cdecl _map_mmap(_In_ _mmap_info* info,
+                              utility::size64_t offset,
+                              _Out_ size_t* length,
+                              _Out_ unsigned long* error)
+{
+    *length = 0;
+    *error = 0;
+    if (offset >= info->m_size) return nullptr;
+
+    if (info->m_window == nullptr || offset < info->m_window_off || offset >= info->m_window_off + info->m_window_len)
+    {
+        if (info->m_window != nullptr)
+        {
+            UnmapViewOfFile(info->m_window);
+            info->m_window = nullptr;
+        }
+
+        const utility::size64_t start = offset - offset % info->m_granularity;
+        const size_t len =
+            static_cast<size_t>((std::min)(utility::size64_t(info->m_window_size), info->m_size - start));
+        void* window = MapViewOfFile(
+            info->m_mapping, FILE_MAP_READ, static_cast<DWORD>(start >> 32), static_cast<DWORD>(start), len);
+        if (window == nullptr)
+        {
+            *error = GetLastError();
+            return nullptr;
+        }
+
+        info->m_window = static_cast<const char*>(window);
+        info->m_window_off = start;
+        info->m_window_len = len;
+    }
+
+    const size_t skip = static_cast<size_t>(offset - info->m_window_off);
+    *length = info->m_window_len - skip;
+    return info->m_window + skip;
+}
+
+/// <summary>
+/// Unmap and close a memory-mapped file.
+/// </summary>
+/// <param name="info">The record of the file</param>
+void __cdecl _close_mmap(_In_ _mmap_info* info)
+{
+    if (info == nullptr) return;
+
+    if (info->m_window != nullptr)
+    {
+        UnmapViewOfFile(info->m_window);
+    }
+    if (info->m_mapping != nullptr)
+    {
+        CloseHandle(info->m_mapping);
+    }
+    CloseHandle(info->m_handle);
+    delete info;
+}
@@ -2,8 +2,10 @@
 
 #include "cpprest/ws_client.h"
 #include "cpprest/ws_msg.h"
+#include <algorithm>
+#include <deque>
 #include <mutex>
-#include <queue>
+#include <vector>
 
 namespace web
 {
@@ -30,7 +32,7 @@ struct outgoing_msg_queue
             ret = state::was_empty;
         }
 
-        m_queue.push(msg);
+        m_queue.push_back(msg);
         return ret;
     }
 
@@ -38,7 +40,7 @@ struct outgoing_msg_queue
     {
         std::lock_guard<std::mutex> lock(m_lock);
 
-        m_queue.pop();
+        m_queue.pop_front();
 
         if (m_queue.empty())
         {
@@ -48,9 +50,25 @@ struct outgoing_msg_queue
         return true;
     }
 
+    // Copies up to max_count messages from the front of the queue, the one being sent first, so they can be sent
+    // together.
+    void peek(std::vector<websocket_outgoing_message>& msgs, size_t max_count)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        msgs.assign(m_queue.begin(), m_queue.begin() + (std::min)(max_count, m_queue.size()));
+    }
+
+    // Removes count messages that have been sent, and returns whether more are waiting.
+    bool pop(size_t count)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_queue.erase(m_queue.begin(), m_queue.begin() + count);
+        return !m_queue.empty();
+    }
+
 private:
     std::mutex m_lock;
-    std::queue<websocket_outgoing_message> m_queue;
+    std::deque<websocket_outgoing_message> m_queue;
 };
 
 } // namespace details
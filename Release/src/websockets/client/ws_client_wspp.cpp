@@ -13,6 +13,7 @@
 
 #include "stdafx.h"
 
+#include <cstdlib>
 #include <thread>
 
 #if !defined(CPPREST_EXCLUDE_WEBSOCKETS)
@@ -49,6 +50,10 @@
 #include <websocketpp/client.hpp>
 #include <websocketpp/config/asio_client.hpp>
 #include <websocketpp/config/asio_no_tls_client.hpp>
+#if !defined(CPPREST_EXCLUDE_COMPRESSION)
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+#include <zlib.h>
+#endif
 
 #if defined(_WIN32)
 #pragma warning(pop)
@@ -109,6 +114,248 @@ static std::string build_error_msg(const std::error_code& ec, const std::string&
 
 static utility::string_t g_subProtocolHeader(_XPLATSTR("Sec-WebSocket-Protocol"));
 
+// Messages shorter than this may be held back by the send coalescing delay of the client configuration
+static const size_t g_small_message_size = 1024;
+
+// At most this many queued messages are handed to WebSocket++ in one pass, so a long queue is not copied each time
+static const size_t g_max_batched_messages = 64;
+
+#if !defined(CPPREST_EXCLUDE_COMPRESSION)
+// The client side of the permessage-deflate extension (RFC 7692). The extension of WebSocket++ only takes the server
+// role: it reads the parameters it is given as an offer to answer, and makes no offer of its own. This one sends no
+// offer either, as the offer is built from the configuration of each client and added to the request of its
+// connection, see deflate_offer(). It reads the parameters as the server's response to that offer instead, and sets up
+// zlib for the client end of the connection from them.
+template<typename ExtensionConfig>
+class permessage_deflate_extension
+{
+public:
+    permessage_deflate_extension()
+        : m_enabled(false)
+        , m_initialized(false)
+        , m_client_no_context_takeover(false)
+        , m_client_max_window_bits(max_window_bits)
+        , m_flush(Z_SYNC_FLUSH)
+        , m_deflate()
+        , m_inflate()
+        , m_buffer(new unsigned char[buffer_size])
+    {
+    }
+
+    ~permessage_deflate_extension()
+    {
+        if (m_initialized)
+        {
+            deflateEnd(&m_deflate);
+            inflateEnd(&m_inflate);
+        }
+    }
+
+    bool is_implemented() const { return true; }
+
+    bool is_enabled() const { return m_enabled; }
+
+    std::string generate_offer() const { return std::string(); }
+
+    std::pair<websocketpp::lib::error_code, std::string> negotiate(const websocketpp::http::attribute_list& response)
+    {
+        using namespace websocketpp::extensions::permessage_deflate;
+
+        for (const auto& attribute : response)
+        {
+            const auto& name = attribute.first;
+            const auto& value = attribute.second;
+            if (name == "server_no_context_takeover" || name == "client_no_context_takeover")
+            {
+                if (!value.empty())
+                {
+                    return std::make_pair(error::make_error_code(error::invalid_attribute_value), std::string());
+                }
+
+                // The server's own context makes no difference to inflating, so only the client's is of interest
+                if (name == "client_no_context_takeover")
+                {
+                    m_client_no_context_takeover = true;
+                }
+            }
+            else if (name == "server_max_window_bits" || name == "client_max_window_bits")
+            {
+                // The response always has a value. Raw deflate in zlib cannot keep to a window of 8 bits, so a server
+                // asking the client for one cannot be obliged; inflating works with any window the server uses.
+                const int bits = value.empty() ? 0 : std::atoi(value.c_str());
+                if (bits < min_window_bits || bits > max_window_bits ||
+                    (name == "client_max_window_bits" && bits == min_window_bits))
+                {
+                    return std::make_pair(error::make_error_code(error::invalid_max_window_bits), std::string());
+                }
+                if (name == "client_max_window_bits")
+                {
+                    m_client_max_window_bits = bits;
+                }
+            }
+            else
+            {
+                return std::make_pair(error::make_error_code(error::unsupported_attributes), std::string());
+            }
+        }
+
+        m_enabled = true;
+        return std::make_pair(websocketpp::lib::error_code(), std::string());
+    }
+
+    websocketpp::lib::error_code init(bool is_server)
+    {
+        using namespace websocketpp::extensions::permessage_deflate;
+
+        if (is_server)
+        {
+            return error::make_error_code(error::general);
+        }
+        if (m_initialized)
+        {
+            return websocketpp::lib::error_code();
+        }
+
+        // Raw deflate data, without a zlib header, as the extension sends it
+        const int memory_level = 8;
+        if (deflateInit2(&m_deflate,
+                         Z_DEFAULT_COMPRESSION,
+                         Z_DEFLATED,
+                         -m_client_max_window_bits,
+                         memory_level,
+                         Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            return error::make_error_code(error::zlib_error);
+        }
+        if (inflateInit2(&m_inflate, -max_window_bits) != Z_OK)
+        {
+            deflateEnd(&m_deflate);
+            return error::make_error_code(error::zlib_error);
+        }
+
+        // A full flush makes each message independent of those before it
+        m_flush = m_client_no_context_takeover ? Z_FULL_FLUSH : Z_SYNC_FLUSH;
+        m_initialized = true;
+        return websocketpp::lib::error_code();
+    }
+
+    websocketpp::lib::error_code compress(const std::string& in, std::string& out)
+    {
+        using namespace websocketpp::extensions::permessage_deflate;
+
+        if (!m_initialized)
+        {
+            return error::make_error_code(error::uninitialized);
+        }
+
+        // WebSocket++ strips the last four bytes, which the flush always ends with, so an empty message is sent as the
+        // empty block those bytes end
+        if (in.empty())
+        {
+            const char empty[] = {0x02, 0x00, 0x00, 0x00, static_cast<char>(0xff), static_cast<char>(0xff)};
+            out.append(empty, sizeof(empty));
+            return websocketpp::lib::error_code();
+        }
+
+        m_deflate.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+        m_deflate.avail_in = static_cast<uInt>(in.size());
+        do
+        {
+            m_deflate.next_out = m_buffer.get();
+            m_deflate.avail_out = buffer_size;
+            if (deflate(&m_deflate, m_flush) == Z_STREAM_ERROR)
+            {
+                return error::make_error_code(error::zlib_error);
+            }
+            out.append(reinterpret_cast<const char*>(m_buffer.get()), buffer_size - m_deflate.avail_out);
+        } while (m_deflate.avail_out == 0);
+        return websocketpp::lib::error_code();
+    }
+
+    websocketpp::lib::error_code decompress(const uint8_t* buf, size_t len, std::string& out)
+    {
+        using namespace websocketpp::extensions::permessage_deflate;
+
+        if (!m_initialized)
+        {
+            return error::make_error_code(error::uninitialized);
+        }
+
+        m_inflate.next_in = const_cast<Bytef*>(buf);
+        m_inflate.avail_in = static_cast<uInt>(len);
+        do
+        {
+            m_inflate.next_out = m_buffer.get();
+            m_inflate.avail_out = buffer_size;
+            const int result = inflate(&m_inflate, Z_SYNC_FLUSH);
+            if (result == Z_NEED_DICT || result == Z_DATA_ERROR || result == Z_MEM_ERROR ||
+                result == Z_STREAM_ERROR)
+            {
+                return error::make_error_code(error::zlib_error);
+            }
+            out.append(reinterpret_cast<const char*>(m_buffer.get()), buffer_size - m_inflate.avail_out);
+        } while (m_inflate.avail_out == 0);
+        return websocketpp::lib::error_code();
+    }
+
+private:
+    static const int min_window_bits = 8;
+    static const int max_window_bits = 15;
+    static const uInt buffer_size = 16 * 1024;
+
+    bool m_enabled;
+    bool m_initialized;
+    bool m_client_no_context_takeover;
+    int m_client_max_window_bits;
+    int m_flush;
+    z_stream m_deflate;
+    z_stream m_inflate;
+    std::unique_ptr<unsigned char[]> m_buffer;
+};
+
+// The value of the Sec-WebSocket-Extensions header offering permessage-deflate with the given parameters. The client
+// parameters are hints; the client uses them once the server's response includes them.
+static std::string deflate_offer(const websocket_deflate_options& options)
+{
+    std::string offer = "permessage-deflate";
+    if (options.client_no_context_takeover())
+    {
+        offer += "; client_no_context_takeover";
+    }
+    if (options.server_no_context_takeover())
+    {
+        offer += "; server_no_context_takeover";
+    }
+    if (options.server_max_window_bits() < 15)
+    {
+        offer += "; server_max_window_bits=" + std::to_string(options.server_max_window_bits());
+    }
+    if (options.client_max_window_bits() < 15)
+    {
+        offer += "; client_max_window_bits=" + std::to_string(options.client_max_window_bits());
+    }
+    else
+    {
+        // Without a value, the parameter only tells the server it may ask for a smaller window
+        offer += "; client_max_window_bits";
+    }
+    return offer;
+}
+#endif
+
+// The stock WebSocket++ client configurations, with the extension above in place of the disabled one
+template<typename BaseConfig>
+struct client_config : public BaseConfig
+{
+    typedef client_config type;
+#if !defined(CPPREST_EXCLUDE_COMPRESSION)
+    typedef permessage_deflate_extension<typename BaseConfig::permessage_deflate_config> permessage_deflate_type;
+#endif
+};
+
+typedef client_config<websocketpp::config::asio_client> asio_client_config;
+typedef client_config<websocketpp::config::asio_tls_client> asio_tls_client_config;
+
 class wspp_callback_client : public websocket_client_callback_impl,
                              public std::enable_shared_from_this<wspp_callback_client>
 {
@@ -178,12 +425,20 @@ public:
 
     pplx::task<void> connect()
     {
+#if defined(CPPREST_EXCLUDE_COMPRESSION)
+        if (m_config.permessage_deflate())
+        {
+            return pplx::task_from_exception<void>(
+                websocket_exception("The permessage-deflate extension requires compression support."));
+        }
+#endif
+
         if (m_uri.scheme() == U("wss"))
         {
             m_client = std::unique_ptr<websocketpp_client_base>(new websocketpp_tls_client());
 
             // Options specific to TLS client.
-            auto& client = m_client->client<websocketpp::config::asio_tls_client>();
+            auto& client = m_client->client<asio_tls_client_config>();
             client.set_tls_init_handler([this](websocketpp::connection_hdl) {
                 auto sslContext = websocketpp::lib::shared_ptr<boost::asio::ssl::context>(
                     new boost::asio::ssl::context(boost::asio::ssl::context::sslv23));
@@ -256,12 +511,12 @@ public:
                 }
             });
 
-            return connect_impl<websocketpp::config::asio_tls_client>();
+            return connect_impl<asio_tls_client_config>();
         }
         else
         {
             m_client = std::unique_ptr<websocketpp_client_base>(new websocketpp_client());
-            return connect_impl<websocketpp::config::asio_client>();
+            return connect_impl<asio_client_config>();
         }
     }
 
@@ -351,6 +606,14 @@ public:
             }
         }
 
+#if !defined(CPPREST_EXCLUDE_COMPRESSION)
+        // Offer permessage-deflate with the parameters of this client.
+        if (m_config.permessage_deflate())
+        {
+            con->replace_header("Sec-WebSocket-Extensions", deflate_offer(m_config.permessage_deflate_options()));
+        }
+#endif
+
         // Add any specified subprotocols.
         if (headers.has(g_subProtocolHeader))
         {
@@ -443,13 +706,159 @@ public:
         // No sends in progress
         if (msg_pending == outgoing_msg_queue::state::was_empty)
         {
-            // Start sending the message
-            send_msg(msg);
+            if (m_config.send_coalescing_delay().count() == 0)
+            {
+                // Start sending the message
+                send_msg(msg);
+            }
+            else if (length < g_small_message_size)
+            {
+                // Start sending the message once more have had the chance to join it
+                send_queued_after(m_config.send_coalescing_delay());
+            }
+            else
+            {
+                send_queued();
+            }
         }
 
         return pplx::create_task(msg.body_sent());
     }
 
+    // Sends the queued messages, when the client has a send coalescing delay. Those whose data can be taken from their
+    // streams in one block are handed to WebSocket++ together, in batches of up to g_max_batched_messages, and it
+    // gathers each batch into a single write to the socket. A message that has to be read from its stream first is
+    // sent on its own, and the ones after it follow when it is done. Without the delay, each message is sent on its
+    // own by send_msg().
+    void send_queued()
+    {
+        auto this_client = this->shared_from_this();
+        std::vector<websocket_outgoing_message> batch;
+        std::vector<std::exception_ptr> results;
+        for (;;)
+        {
+            m_out_queue.peek(batch, g_max_batched_messages);
+            results.clear();
+            {
+                std::lock_guard<std::mutex> lock(m_wspp_client_lock);
+                for (auto& msg : batch)
+                {
+                    uint8_t* ptr = nullptr;
+                    size_t length = 0;
+                    if (!acquire_body(msg, ptr, length))
+                    {
+                        break;
+                    }
+
+                    std::exception_ptr eptr;
+                    if (m_state > CONNECTED)
+                    {
+                        // The client has already been closed.
+                        eptr = std::make_exception_ptr(websocket_exception("Websocket connection is closed."));
+                    }
+                    else
+                    {
+                        websocketpp::lib::error_code ec;
+                        if (m_client->is_tls_client())
+                        {
+                            send_msg_impl<asio_tls_client_config>(this_client, msg, ptr, length, ec);
+                        }
+                        else
+                        {
+                            send_msg_impl<asio_client_config>(this_client, msg, ptr, length, ec);
+                        }
+                        if (ec.value() != 0)
+                        {
+                            eptr = std::make_exception_ptr(
+                                websocket_exception(ec, build_error_msg(ec, "sending message")));
+                        }
+                    }
+
+                    msg.m_body.release(ptr, length);
+                    results.push_back(eptr);
+                }
+            }
+
+            // Signal outside of the lock, continuations may send more messages.
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                if (results[i])
+                {
+                    batch[i].signal_body_sent(results[i]);
+                }
+                else
+                {
+                    batch[i].signal_body_sent();
+                }
+            }
+
+            if (results.size() < batch.size())
+            {
+                if (!results.empty())
+                {
+                    m_out_queue.pop(results.size());
+                }
+                send_msg(batch[results.size()]);
+                return;
+            }
+
+            if (!m_out_queue.pop(results.size()))
+            {
+                return;
+            }
+        }
+    }
+
+    // Sends the queued messages once the delay has passed, together with the ones queued in the meantime.
+    void send_queued_after(std::chrono::milliseconds delay)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_wspp_client_lock);
+            if (m_state == CONNECTED)
+            {
+                if (m_client->is_tls_client())
+                {
+                    set_send_timer<asio_tls_client_config>(delay);
+                }
+                else
+                {
+                    set_send_timer<asio_client_config>(delay);
+                }
+                return;
+            }
+        }
+
+        // The client is closing, which fails the messages right away.
+        send_queued();
+    }
+
+    // Gets the whole body of the message without copying it, if its stream holds it in one contiguous block.
+    static bool acquire_body(websocket_outgoing_message& msg, uint8_t*& ptr, size_t& length)
+    {
+        auto& is_buf = msg.m_body;
+        length = msg.m_length;
+        if (length == SIZE_MAX)
+        {
+            if (!is_buf.has_size() || is_buf.size() >= SIZE_MAX)
+            {
+                return false;
+            }
+            length = static_cast<size_t>(is_buf.size());
+        }
+
+        size_t acquired_size = 0;
+        if (!is_buf.acquire(ptr, acquired_size))
+        {
+            return false;
+        }
+        if (acquired_size < length)
+        {
+            is_buf.release(ptr, 0);
+            return false;
+        }
+        return true;
+    }
+
     void send_msg(websocket_outgoing_message& msg)
     {
         auto this_client = this->shared_from_this();
@@ -499,7 +908,7 @@ public:
         // over the socket connection.
         std::shared_ptr<uint8_t> sp_allocated;
         size_t acquired_size = 0;
-        uint8_t* ptr;
+        uint8_t* ptr = nullptr;
         auto read_task = pplx::task_from_result();
         bool acquired = is_buf.acquire(ptr, acquired_size);
 
@@ -543,13 +952,13 @@ public:
                 websocketpp::lib::error_code ec;
                 if (this_client->m_client->is_tls_client())
                 {
-                    this_client->send_msg_impl<websocketpp::config::asio_tls_client>(
-                        this_client, msg, sp_allocated, length, ec);
+                    this_client->send_msg_impl<asio_tls_client_config>(
+                        this_client, msg, sp_allocated.get(), length, ec);
                 }
                 else
                 {
-                    this_client->send_msg_impl<websocketpp::config::asio_client>(
-                        this_client, msg, sp_allocated, length, ec);
+                    this_client->send_msg_impl<asio_client_config>(
+                        this_client, msg, sp_allocated.get(), length, ec);
                 }
                 return ec;
             })
@@ -585,6 +994,15 @@ public:
                     msg.signal_body_sent();
                 }
 
+                if (this_client->m_config.send_coalescing_delay().count() > 0)
+                {
+                    if (this_client->m_out_queue.pop(1))
+                    {
+                        this_client->send_queued();
+                    }
+                    return;
+                }
+
                 websocket_outgoing_message next_msg;
                 bool msg_pending = this_client->m_out_queue.pop_and_peek(next_msg);
 
@@ -610,11 +1028,11 @@ public:
                 m_state = CLOSING;
                 if (m_client->is_tls_client())
                 {
-                    close_impl<websocketpp::config::asio_tls_client>(status, reason, ec);
+                    close_impl<asio_tls_client_config>(status, reason, ec);
                 }
                 else
                 {
-                    close_impl<websocketpp::config::asio_client>(status, reason, ec);
+                    close_impl<asio_client_config>(status, reason, ec);
                 }
             }
         }
@@ -667,7 +1085,7 @@ private:
     template<typename WebsocketClientType>
     static void send_msg_impl(const std::shared_ptr<wspp_callback_client>& this_client,
                               const websocket_outgoing_message& msg,
-                              const std::shared_ptr<uint8_t>& sp_allocated,
+                              const uint8_t* data,
                               size_t length,
                               websocketpp::lib::error_code& ec)
     {
@@ -675,10 +1093,10 @@ private:
         switch (msg.m_msg_type)
         {
             case websocket_message_type::text_message:
-                client.send(this_client->m_con, sp_allocated.get(), length, websocketpp::frame::opcode::text, ec);
+                client.send(this_client->m_con, data, length, websocketpp::frame::opcode::text, ec);
                 break;
             case websocket_message_type::binary_message:
-                client.send(this_client->m_con, sp_allocated.get(), length, websocketpp::frame::opcode::binary, ec);
+                client.send(this_client->m_con, data, length, websocketpp::frame::opcode::binary, ec);
                 break;
             case websocket_message_type::pong: client.pong(this_client->m_con, "", ec); break;
             default:
@@ -687,6 +1105,18 @@ private:
         }
     }
 
+    template<typename WebsocketConfig>
+    void set_send_timer(std::chrono::milliseconds delay)
+    {
+        auto this_client = this->shared_from_this();
+        auto& client = m_client->client<WebsocketConfig>();
+        client.set_timer(static_cast<long>(delay.count()), [this_client](const websocketpp::lib::error_code&) {
+            // Send from another thread, WebSocket++ would otherwise write the first message before the others are
+            // queued behind it.
+            pplx::create_task([this_client] { this_client->send_queued(); });
+        });
+    }
+
     template<typename WebsocketConfig>
     void close_impl(websocket_close_status status, const utility::string_t& reason, websocketpp::lib::error_code& ec)
     {
@@ -727,23 +1157,23 @@ private:
                 return reinterpret_cast<websocketpp::client<WebsocketConfig>&>(non_tls_client());
             }
         }
-        virtual websocketpp::client<websocketpp::config::asio_client>& non_tls_client() { throw std::bad_cast(); }
-        virtual websocketpp::client<websocketpp::config::asio_tls_client>& tls_client() { throw std::bad_cast(); }
+        virtual websocketpp::client<asio_client_config>& non_tls_client() { throw std::bad_cast(); }
+        virtual websocketpp::client<asio_tls_client_config>& tls_client() { throw std::bad_cast(); }
         virtual bool is_tls_client() const = 0;
     };
     struct websocketpp_client : websocketpp_client_base
     {
         ~websocketpp_client() CPPREST_NOEXCEPT {}
-        websocketpp::client<websocketpp::config::asio_client>& non_tls_client() override { return m_client; }
+        websocketpp::client<asio_client_config>& non_tls_client() override { return m_client; }
         bool is_tls_client() const override { return false; }
-        websocketpp::client<websocketpp::config::asio_client> m_client;
+        websocketpp::client<asio_client_config> m_client;
     };
     struct websocketpp_tls_client : websocketpp_client_base
     {
         ~websocketpp_tls_client() CPPREST_NOEXCEPT {}
-        websocketpp::client<websocketpp::config::asio_tls_client>& tls_client() override { return m_client; }
+        websocketpp::client<asio_tls_client_config>& tls_client() override { return m_client; }
         bool is_tls_client() const override { return true; }
-        websocketpp::client<websocketpp::config::asio_tls_client> m_client;
+        websocketpp::client<asio_tls_client_config> m_client;
     };
 
     websocketpp::connection_hdl m_con;
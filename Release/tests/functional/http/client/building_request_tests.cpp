@@ -249,6 +249,21 @@ SUITE(building_request_tests)
                       std::invalid_argument);
     }
 
+    TEST(set_body_json_binary)
+    {
+        web::json::value data = web::json::value::parse(U("{\"a\":[1,-2,3.5],\"b\":null}"));
+
+        http_request msg(methods::POST);
+        msg.set_body(data, U("application/cbor"));
+        VERIFY_ARE_EQUAL(U("application/cbor"), msg.headers().content_type());
+        VERIFY_ARE_EQUAL(data, msg.extract_cbor().get());
+
+        msg = http_request(methods::POST);
+        msg.set_body(data, U("application/msgpack"));
+        VERIFY_ARE_EQUAL(U("application/msgpack"), msg.headers().content_type());
+        VERIFY_ARE_EQUAL(data, msg.extract_msgpack().get());
+    }
+
     TEST_FIXTURE(uri_address, set_content_length_locale, "Ignore:Android", "Locale unsupported on Android")
     {
         std::locale changedLocale;
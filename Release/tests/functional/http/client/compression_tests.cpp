@@ -394,6 +394,11 @@ SUITE(compression_tests)
             compress_test(builtin::get_compress_factory(builtin::algorithm::BROTLI),
                           builtin::get_decompress_factory(builtin::algorithm::BROTLI));
         }
+        if (builtin::algorithm::supported(builtin::algorithm::ZSTD))
+        {
+            compress_test(builtin::get_compress_factory(builtin::algorithm::ZSTD),
+                          builtin::get_decompress_factory(builtin::algorithm::ZSTD));
+        }
     }
 
     TEST_FIXTURE(uri_address, compress_headers)
@@ -436,6 +441,10 @@ SUITE(compression_tests)
         {
             VERIFY_IS_TRUE(builtin::supported());
         }
+        if (builtin::algorithm::supported(builtin::algorithm::ZSTD))
+        {
+            VERIFY_IS_TRUE(builtin::supported());
+        }
         VERIFY_IS_FALSE(builtin::algorithm::supported(_XPLATSTR("")));
         VERIFY_IS_FALSE(builtin::algorithm::supported(_XPLATSTR("foo")));
 
@@ -693,6 +702,252 @@ SUITE(compression_tests)
         }
     }
 
+    TEST_FIXTURE(uri_address, compress_with_dictionary)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::DEFLATE)) return;
+
+        const std::string json("{\"id\":42,\"name\":\"widget\",\"price\":9.5,\"tags\":[\"blue\"]}");
+        const std::string text("{\"id\":,\"name\":\"\",\"price\":,\"tags\":[\"blue\",\"red\",\"small\"]}");
+        auto dict = std::make_shared<dictionary>(_XPLATSTR("v1"), std::vector<uint8_t>(text.begin(), text.end()));
+        const std::vector<uint8_t> data(json.begin(), json.end());
+
+        // The gzip format has no room for a dictionary
+        VERIFY_IS_TRUE(!builtin::make_compressor(builtin::algorithm::GZIP, dict));
+        VERIFY_IS_TRUE(!builtin::make_compressor(_XPLATSTR("foo"), dict));
+
+        std::vector<utility::string_t> algorithms {builtin::algorithm::DEFLATE};
+        if (builtin::algorithm::supported(builtin::algorithm::ZSTD))
+        {
+            algorithms.push_back(builtin::algorithm::ZSTD);
+        }
+        for (const auto& algorithm : algorithms)
+        {
+            auto compress = [&](std::unique_ptr<compress_provider> c) {
+                std::vector<uint8_t> result(data.size() + 100);
+                size_t used;
+                bool done;
+                result.resize(c->compress(
+                    data.data(), data.size(), result.data(), result.size(), operation_hint::is_last, used, done));
+                VERIFY_IS_TRUE(done);
+                return result;
+            };
+            const auto with_dictionary = compress(builtin::make_compressor(algorithm, dict));
+            const auto without_dictionary = compress(builtin::make_compressor(algorithm));
+            VERIFY_IS_TRUE(with_dictionary.size() < without_dictionary.size());
+
+            // Decompression needs the same dictionary, also after a reset
+            auto d = builtin::make_decompressor(algorithm, dict);
+            for (int i = 0; i < 2; ++i)
+            {
+                std::vector<uint8_t> result(data.size());
+                size_t used;
+                bool done;
+                result.resize(d->decompress(with_dictionary.data(),
+                                            with_dictionary.size(),
+                                            result.data(),
+                                            result.size(),
+                                            operation_hint::is_last,
+                                            used,
+                                            done));
+                VERIFY_IS_TRUE(done);
+                VERIFY_ARE_EQUAL(data, result);
+                d->reset();
+            }
+
+            std::vector<uint8_t> result(data.size());
+            size_t used;
+            bool done;
+            VERIFY_THROWS(builtin::make_decompressor(algorithm)->decompress(with_dictionary.data(),
+                                                                            with_dictionary.size(),
+                                                                            result.data(),
+                                                                            result.size(),
+                                                                            operation_hint::is_last,
+                                                                            used,
+                                                                            done),
+                          std::runtime_error);
+        }
+
+        // Negotiation headers
+        std::vector<std::shared_ptr<dictionary>> dictionaries {
+            std::make_shared<dictionary>(_XPLATSTR("v0"), std::vector<uint8_t>()), dict};
+        VERIFY_ARE_EQUAL(_XPLATSTR("v0, v1"), compression::details::build_dictionary_header(dictionaries));
+        VERIFY_ARE_EQUAL(dict, compression::details::find_dictionary(_XPLATSTR(" v2 , v1"), dictionaries));
+        VERIFY_IS_TRUE(!compression::details::find_dictionary(_XPLATSTR("v2, v"), dictionaries));
+    }
+
+    TEST_FIXTURE(uri_address, parallel_compressor)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::GZIP)) return;
+
+        // Words in a random order compress a fair amount, but not so much that blocks are trivial
+        static const char* const words[] = {"alpha ", "bravo ", "charlie ", "delta ", "echo ", "foxtrot ", "golf "};
+        std::vector<uint8_t> data;
+        uint32_t seed = 1;
+        while (data.size() < 3 * 1024 * 1024)
+        {
+            seed = seed * 1103515245 + 12345;
+            const std::string word(words[(seed >> 16) % 7]);
+            data.insert(data.end(), word.begin(), word.end());
+        }
+
+        auto compress = [](compress_provider& c, const std::vector<uint8_t>& input) {
+            std::vector<uint8_t> result;
+            std::vector<uint8_t> buffer(16 * 1024);
+            size_t offset = 0;
+            bool done = false;
+            while (!done)
+            {
+                const size_t size = (std::min)(input.size() - offset, static_cast<size_t>(100000));
+                const auto hint = offset + size == input.size() ? operation_hint::is_last : operation_hint::has_more;
+                const auto r = c.compress(input.data() + offset, size, buffer.data(), buffer.size(), hint).get();
+                result.insert(result.end(), buffer.begin(), buffer.begin() + r.output_bytes_produced);
+                offset += r.input_bytes_processed;
+                done = r.done;
+            }
+            VERIFY_ARE_EQUAL(input.size(), offset);
+            return result;
+        };
+        auto decompress = [](const utility::string_t& algorithm, const std::vector<uint8_t>& input, size_t size) {
+            std::vector<uint8_t> result(size + 1);
+            size_t used;
+            bool done;
+            auto d = builtin::make_decompressor(algorithm);
+            result.resize(d->decompress(
+                input.data(), input.size(), result.data(), result.size(), operation_hint::is_last, used, done));
+            VERIFY_IS_TRUE(done);
+            VERIFY_ARE_EQUAL(input.size(), used);
+            return result;
+        };
+
+        for (auto algorithm : {builtin::algorithm::GZIP, builtin::algorithm::DEFLATE})
+        {
+            const bool gzip = algorithm == builtin::algorithm::GZIP;
+            auto c = gzip ? builtin::make_parallel_gzip_compressor(6, 64 * 1024, 4)
+                          : builtin::make_parallel_deflate_compressor(6, 64 * 1024, 4);
+            VERIFY_ARE_EQUAL(algorithm, c->algorithm());
+
+            // The blocks make up one standard stream, barely larger than a single-threaded one
+            const auto parallel = compress(*c, data);
+            VERIFY_ARE_EQUAL(data, decompress(algorithm, parallel, data.size()));
+            const auto serial = compress(*builtin::make_compressor(algorithm), data);
+            VERIFY_IS_TRUE(parallel.size() < serial.size() + serial.size() / 20);
+
+            // A reset provider starts a new stream; an empty body is a valid one too
+            c->reset();
+            VERIFY_ARE_EQUAL(data, decompress(algorithm, compress(*c, data), data.size()));
+            c->reset();
+            VERIFY_IS_TRUE(decompress(algorithm, compress(*c, std::vector<uint8_t>()), 0).empty());
+        }
+    }
+
+    // Compresses all of the input through the asynchronous overload, one step per continuation
+    static pplx::task<void> compress_async(std::shared_ptr<compress_provider> c,
+                                           std::shared_ptr<const std::vector<uint8_t>> input,
+                                           std::shared_ptr<std::vector<uint8_t>> output,
+                                           size_t offset = 0)
+    {
+        const size_t size = input->size() - offset;
+        const size_t start = output->size();
+        output->resize(start + 16 * 1024);
+        return c->compress(input->data() + offset, size, output->data() + start, 16 * 1024, operation_hint::is_last)
+            .then([=](operation_result r) {
+                output->resize(start + r.output_bytes_produced);
+                const size_t next = offset + r.input_bytes_processed;
+                return r.done ? pplx::task_from_result() : compress_async(c, input, output, next);
+            });
+    }
+
+    TEST_FIXTURE(uri_address, parallel_compressor_concurrent_bodies)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::GZIP)) return;
+
+        // Far more bodies than there are threads in the pool; waiting for blocks must not hold on to any of them
+        auto input = std::make_shared<std::vector<uint8_t>>(512 * 1024);
+        for (size_t i = 0; i < input->size(); ++i)
+        {
+            (*input)[i] = static_cast<uint8_t>((i * 7919) >> 5);
+        }
+
+        std::vector<pplx::task<std::shared_ptr<std::vector<uint8_t>>>> bodies;
+        for (int i = 0; i < 128; ++i)
+        {
+            bodies.push_back(pplx::create_task([input]() {
+                std::shared_ptr<compress_provider> c = builtin::make_parallel_gzip_compressor(6, 16 * 1024, 4);
+                auto output = std::make_shared<std::vector<uint8_t>>();
+                return compress_async(c, input, output).then([c, output]() { return output; });
+            }));
+        }
+
+        for (auto& body : bodies)
+        {
+            const auto compressed = body.get();
+            std::vector<uint8_t> result(input->size() + 1);
+            size_t used;
+            bool done;
+            auto d = builtin::make_decompressor(builtin::algorithm::GZIP);
+            result.resize(d->decompress(compressed->data(),
+                                        compressed->size(),
+                                        result.data(),
+                                        result.size(),
+                                        operation_hint::is_last,
+                                        used,
+                                        done));
+            VERIFY_IS_TRUE(done);
+            VERIFY_IS_TRUE(*input == result);
+        }
+    }
+
+    TEST_FIXTURE(uri_address, builtin_provider_pool)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::GZIP)) return;
+
+        const std::vector<uint8_t> data(10000, 'a');
+        auto round_trip = [&]() {
+            std::vector<uint8_t> cmp(1000);
+            std::vector<uint8_t> dcmp(data.size());
+            size_t used;
+            bool done;
+            auto c = builtin::make_compressor(builtin::algorithm::GZIP);
+            cmp.resize(
+                c->compress(data.data(), data.size(), cmp.data(), cmp.size(), operation_hint::is_last, used, done));
+            VERIFY_IS_TRUE(done);
+            auto d = builtin::make_decompressor(builtin::algorithm::GZIP);
+            dcmp.resize(
+                d->decompress(cmp.data(), cmp.size(), dcmp.data(), dcmp.size(), operation_hint::is_last, used, done));
+            VERIFY_IS_TRUE(done);
+            VERIFY_ARE_EQUAL(data, dcmp);
+        };
+
+        // Providers are reset when returned, so reused ones behave like new ones
+        round_trip();
+        const auto before = builtin::compressor_pool_stats(builtin::algorithm::GZIP);
+        VERIFY_IS_TRUE(before.idle > 0);
+        round_trip();
+        round_trip();
+        const auto after = builtin::compressor_pool_stats(builtin::algorithm::GZIP);
+        VERIFY_ARE_EQUAL(before.created, after.created);
+        VERIFY_ARE_EQUAL(before.reused + 2, after.reused);
+        VERIFY_ARE_EQUAL(before.returned + 2, after.returned);
+        VERIFY_ARE_EQUAL(before.idle, after.idle);
+        VERIFY_IS_TRUE(builtin::decompressor_pool_stats(builtin::algorithm::GZIP).reused >= 2);
+
+        // The pool is bounded
+        {
+            std::vector<std::unique_ptr<compress_provider>> providers;
+            for (size_t i = 0; i < 3; ++i)
+            {
+                providers.push_back(builtin::make_compressor(builtin::algorithm::GZIP));
+            }
+            builtin::set_provider_pool_limit(1);
+        }
+        const auto bounded = builtin::compressor_pool_stats(builtin::algorithm::GZIP);
+        builtin::set_provider_pool_limit(8);
+        VERIFY_ARE_EQUAL(1u, bounded.idle);
+        VERIFY_ARE_EQUAL(after.discarded + 2, bounded.discarded);
+
+        VERIFY_ARE_EQUAL(0u, builtin::compressor_pool_stats(_XPLATSTR("foo")).created);
+    }
+
     template<typename _CharType>
     class my_rawptr_buffer : public concurrency::streams::rawptr_buffer<_CharType>
     {
@@ -903,6 +1158,18 @@ SUITE(compression_tests)
                     dfactories.push_back(dmap[builtin::algorithm::BROTLI]);
                     cfactories.push_back(builtin::get_compress_factory(builtin::algorithm::BROTLI));
                 }
+                if (builtin::algorithm::supported(builtin::algorithm::ZSTD))
+                {
+                    algorithms.push_back(builtin::algorithm::ZSTD);
+                    dmap[builtin::algorithm::ZSTD] = builtin::get_decompress_factory(builtin::algorithm::ZSTD);
+                    cmap[builtin::algorithm::ZSTD] =
+                        make_compress_factory(builtin::algorithm::ZSTD, []() -> std::unique_ptr<compress_provider> {
+                            // Use a fast, small-window Zstandard instance in some cases for code coverage
+                            return builtin::make_zstd_compressor(-5, 10);
+                        });
+                    dfactories.push_back(dmap[builtin::algorithm::ZSTD]);
+                    cfactories.push_back(builtin::get_compress_factory(builtin::algorithm::ZSTD));
+                }
                 algorithms.push_back(fake_provider::FAKE);
                 dmap[fake_provider::FAKE] = make_decompress_factory(
                     fake_provider::FAKE, 1000, [buffer_size]() -> std::unique_ptr<decompress_provider> {
@@ -1062,16 +1329,23 @@ SUITE(compression_tests)
                                                     }
                                                     done =
                                                         p_request->match_header(header_names::content_encoding, header);
+#if defined(_WIN32) && !defined(__cplusplus_winrt) && !defined(CPPREST_FORCE_HTTP_CLIENT_ASIO)
                                                     VERIFY_IS_TRUE(done);
-                                                    d = compression::details::get_decompressor_from_header(
-                                                        header,
-                                                        compression::details::header_types::content_encoding,
-                                                        dfactories);
+#endif // _WIN32
+                                                    if (done)
+                                                    {
+                                                        d = compression::details::get_decompressor_from_header(
+                                                            header,
+                                                            compression::details::header_types::content_encoding,
+                                                            dfactories);
+                                                    }
                                                 }
 #if defined(_WIN32) && !defined(__cplusplus_winrt) && !defined(CPPREST_FORCE_HTTP_CLIENT_ASIO)
                                                 VERIFY_IS_TRUE((bool)d);
 #else  // _WIN32
-                                                VERIFY_ARE_NOT_EQUAL((bool)d, !!transfer);
+                                                // The listener under the test server decodes the codings it knows and
+                                                // takes them off the headers, which leaves only the fake one to us
+                                                VERIFY_ARE_EQUAL((bool)d, algorithm == fake_provider::FAKE);
 #endif // _WIN32
 
                                                 vv.resize(buffer_size + extra_size(buffer_size));
@@ -1337,6 +1611,143 @@ SUITE(compression_tests)
             }
         }
     }
+#ifndef __cplusplus_winrt
+    TEST_FIXTURE(uri_address, decompress_large_response)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::GZIP)) return;
+
+        std::vector<uint8_t> data(4 * 1024 * 1024);
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            data[i] = static_cast<uint8_t>('a' + (i * 7 + i / 4096) % 26);
+        }
+        std::vector<uint8_t> compressed(data.size());
+        {
+            auto c = builtin::make_compressor(builtin::algorithm::GZIP);
+            size_t used;
+            bool done;
+            compressed.resize(c->compress(
+                data.data(), data.size(), compressed.data(), compressed.size(), operation_hint::is_last, used, done));
+            VERIFY_IS_TRUE(done);
+        }
+
+        // The compressed body is sent with a Content-Length, or chunked when it is streamed
+        web::http::experimental::listener::http_listener listener(m_uri);
+        listener.open().wait();
+        listener.support([&](http_request request) {
+            http_response response(status_codes::OK);
+            response.headers().add(header_names::content_encoding, builtin::algorithm::GZIP);
+            if (request.relative_uri().path() == _XPLATSTR("/chunked"))
+            {
+                concurrency::streams::producer_consumer_buffer<uint8_t> buf;
+                response.set_body(concurrency::streams::istream(buf));
+                request.reply(response);
+                for (size_t written = 0; written < compressed.size(); written += 1000)
+                {
+                    buf.putn_nocopy(compressed.data() + written, std::min<size_t>(1000, compressed.size() - written))
+                        .wait();
+                }
+                buf.close(std::ios_base::out).wait();
+            }
+            else
+            {
+                response.set_body(compressed);
+                request.reply(response);
+            }
+        });
+
+        http_client_config config;
+        config.set_request_compressed_response(true);
+        http_client client(m_uri, config);
+        for (auto path : {_XPLATSTR("/length"), _XPLATSTR("/chunked")})
+        {
+            // Into the body buffer of the response
+            {
+                http_request msg(methods::GET);
+                msg.set_request_uri(path);
+                VERIFY_ARE_EQUAL(data, client.request(msg).get().extract_vector().get());
+            }
+
+            // Into a stream supplied by the caller
+            {
+                concurrency::streams::container_buffer<std::vector<uint8_t>> body;
+                http_request msg(methods::GET);
+                msg.set_request_uri(path);
+                msg.set_response_stream(body.create_ostream());
+                client.request(msg).get().content_ready().wait();
+                VERIFY_ARE_EQUAL(data, body.collection());
+            }
+        }
+
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, decompress_response_blocks)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::GZIP)) return;
+
+        // Text that compresses about two to one, so each part of the response decompresses into a few kilobytes
+        std::vector<uint8_t> data(4 * 1024 * 1024);
+        uint32_t seed = 1;
+        for (auto& b : data)
+        {
+            seed = seed * 1103515245 + 12345;
+            b = static_cast<uint8_t>('a' + (seed >> 16) % 16);
+        }
+        std::vector<uint8_t> compressed(data.size() + 1024);
+        {
+            auto c = builtin::make_compressor(builtin::algorithm::GZIP);
+            size_t used;
+            bool done;
+            compressed.resize(c->compress(
+                data.data(), data.size(), compressed.data(), compressed.size(), operation_hint::is_last, used, done));
+            VERIFY_IS_TRUE(done);
+        }
+
+        web::http::experimental::listener::http_listener listener(m_uri);
+        listener.open().wait();
+        listener.support([&](http_request request) {
+            http_response response(status_codes::OK);
+            response.headers().add(header_names::content_encoding, builtin::algorithm::GZIP);
+            concurrency::streams::producer_consumer_buffer<uint8_t> buf;
+            response.set_body(concurrency::streams::istream(buf));
+            request.reply(response);
+            for (size_t written = 0; written < compressed.size(); written += 1000)
+            {
+                buf.putn_nocopy(compressed.data() + written, std::min<size_t>(1000, compressed.size() - written))
+                    .wait();
+            }
+            buf.close(std::ios_base::out).wait();
+        });
+
+        http_client_config config;
+        config.set_request_compressed_response(true);
+        http_client client(m_uri, config);
+        auto response = client.request(methods::GET).get();
+        response.content_ready().wait();
+
+        // Each block of the body buffer is filled down to its last kilobyte before the next one is started, so the
+        // body is held in a bounded number of blocks no matter how many parts it arrived in.
+        auto body = response.body().streambuf();
+        size_t total = 0;
+        size_t blocks = 0;
+        for (;;)
+        {
+            uint8_t* ptr;
+            size_t count;
+            VERIFY_IS_TRUE(body.acquire(ptr, count));
+            if (count == 0) break;
+            VERIFY_IS_TRUE(count <= 64 * 1024);
+            VERIFY_IS_TRUE(std::equal(ptr, ptr + count, data.begin() + total));
+            body.release(ptr, count);
+            total += count;
+            ++blocks;
+        }
+        VERIFY_ARE_EQUAL(data.size(), total);
+        VERIFY_IS_TRUE(blocks <= data.size() / (63 * 1024) + 1);
+        listener.close().wait();
+    }
+#endif // __cplusplus_winrt
 } // SUITE(request_helper_tests)
 } // namespace client
 } // namespace http
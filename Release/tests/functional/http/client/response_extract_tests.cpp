@@ -443,6 +443,47 @@ SUITE(response_extract_tests)
         VERIFY_THROWS(rsp.extract_json().get(), http_exception);
     }
 
+    TEST_FIXTURE(uri_address, extract_cbor_and_msgpack)
+    {
+        test_http_server::scoped_server scoped(m_uri);
+        http_client client(m_uri);
+
+        json::value data = json::value::parse(U("{\"id\":42,\"tags\":[\"a\",\"b\"],\"ok\":true}"));
+
+        const auto cbor = data.to_cbor();
+        http_response rsp = send_request_response(
+            scoped.server(), &client, U("application/cbor"), std::string(cbor.begin(), cbor.end()));
+        VERIFY_ARE_EQUAL(data, rsp.extract_cbor().get());
+
+        const auto msgpack = data.to_msgpack();
+        rsp = send_request_response(
+            scoped.server(), &client, U("application/msgpack"), std::string(msgpack.begin(), msgpack.end()));
+        VERIFY_ARE_EQUAL(data, rsp.extract_msgpack().get());
+
+        rsp = send_request_response(
+            scoped.server(), &client, U("application/json"), std::string(msgpack.begin(), msgpack.end()));
+        VERIFY_THROWS(rsp.extract_msgpack().get(), http_exception);
+    }
+
+    TEST_FIXTURE(uri_address, extract_vector_sized_from_content_length)
+    {
+        test_http_server::scoped_server scoped(m_uri);
+        http_client client(m_uri);
+
+        std::string data(200000, 'x');
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            data[i] = static_cast<char>('a' + i % 26);
+        }
+
+        // The body buffer stores the response in blocks as large as its Content-Length.
+        http_response rsp = send_request_response(scoped.server(), &client, U("text/plain"), data);
+        const auto body = rsp.extract_vector().get();
+        VERIFY_ARE_EQUAL(data.size(), rsp.body().streambuf().buffer_size(std::ios_base::out));
+        VERIFY_IS_TRUE(std::equal(data.begin(), data.end(), body.begin()));
+        VERIFY_ARE_EQUAL(data.size(), body.size());
+    }
+
     TEST_FIXTURE(uri_address, set_stream_try_extract_json)
     {
         test_http_server::scoped_server scoped(m_uri);
@@ -0,0 +1,479 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * compression_tests.cpp
+ *
+ * Tests cases for request decompression and response compression in the http_listener.
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+
+#include "stdafx.h"
+
+using namespace web;
+using namespace utility;
+using namespace web::http;
+using namespace web::http::client;
+using namespace web::http::compression;
+using namespace web::http::experimental::listener;
+
+using namespace tests::functional::http::utilities;
+
+namespace tests
+{
+namespace functional
+{
+namespace http
+{
+namespace listener
+{
+// Only the Boost.ASIO based listener compresses and decompresses bodies itself
+#if !defined(_WIN32) || defined(CPPREST_FORCE_HTTP_LISTENER_ASIO)
+SUITE(compression_tests)
+{
+    static std::vector<uint8_t> compress(const std::vector<uint8_t>& data)
+    {
+        auto c = builtin::make_compressor(builtin::algorithm::GZIP);
+        std::vector<uint8_t> result(data.size() + 1024);
+        size_t used;
+        bool done;
+        result.resize(
+            c->compress(data.data(), data.size(), result.data(), result.size(), operation_hint::is_last, used, done));
+        VERIFY_ARE_EQUAL(data.size(), used);
+        VERIFY_IS_TRUE(done);
+        return result;
+    }
+
+    static std::vector<uint8_t> decompress(const std::vector<uint8_t>& data, size_t size)
+    {
+        auto d = builtin::make_decompressor(builtin::algorithm::GZIP);
+        std::vector<uint8_t> result(size + 1);
+        size_t used;
+        bool done;
+        result.resize(d->decompress(
+            data.data(), data.size(), result.data(), result.size(), operation_hint::is_last, used, done));
+        VERIFY_ARE_EQUAL(data.size(), used);
+        VERIFY_IS_TRUE(done);
+        return result;
+    }
+
+    static std::vector<uint8_t> make_text(size_t size)
+    {
+        std::vector<uint8_t> text(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            text[i] = static_cast<uint8_t>('a' + (i * 7) % 26);
+        }
+        return text;
+    }
+
+    TEST_FIXTURE(uri_address, request_content_encoding)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::GZIP)) return;
+
+        http_listener listener(m_uri);
+        listener.open().wait();
+        const auto data = make_text(100000);
+
+        // The coding and the coded length are taken off the headers of the decoded request
+        listener.support([&](http_request request) {
+            VERIFY_IS_FALSE(request.headers().has(header_names::content_encoding));
+            VERIFY_IS_FALSE(request.headers().has(header_names::content_length));
+            VERIFY_ARE_EQUAL(data, request.extract_vector().get());
+            request.reply(status_codes::OK);
+        });
+
+        http_client client(m_uri);
+        http_request msg(methods::PUT);
+        msg.headers().add(header_names::content_encoding, builtin::algorithm::GZIP);
+        msg.set_body(compress(data));
+        VERIFY_ARE_EQUAL(status_codes::OK, client.request(msg).get().status_code());
+
+        // A body of unknown length is sent in chunks, and its content coding is decoded all the same
+        auto compressed = compress(data);
+        http_request chunked(methods::PUT);
+        chunked.headers().add(header_names::content_encoding, builtin::algorithm::GZIP);
+        chunked.set_body(concurrency::streams::bytestream::open_istream(std::move(compressed)));
+        VERIFY_ARE_EQUAL(status_codes::OK, client.request(chunked).get().status_code());
+
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, request_transfer_encoding)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::GZIP)) return;
+
+        http_listener listener(m_uri);
+        listener.open().wait();
+        const auto data = make_text(100000);
+
+        listener.support([&](http_request request) {
+            VERIFY_ARE_EQUAL(U("chunked"), request.headers()[header_names::transfer_encoding]);
+            VERIFY_ARE_EQUAL(data, request.extract_vector().get());
+            request.reply(status_codes::OK);
+        });
+
+        // The client compresses the body as it sends it, in chunks
+        http_client client(m_uri);
+        http_request msg(methods::PUT);
+        msg.set_body(data);
+        VERIFY_IS_TRUE(msg.set_compressor(builtin::algorithm::GZIP));
+        VERIFY_ARE_EQUAL(status_codes::OK, client.request(msg).get().status_code());
+
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, request_body_blocks)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::GZIP)) return;
+
+        // Text that compresses about two to one, so each part of the request decompresses into a few kilobytes
+        std::vector<uint8_t> data(4 * 1024 * 1024);
+        uint32_t seed = 1;
+        for (auto& b : data)
+        {
+            seed = seed * 1103515245 + 12345;
+            b = static_cast<uint8_t>('a' + (seed >> 16) % 16);
+        }
+        const auto compressed = compress(data);
+
+        size_t total = 0;
+        size_t blocks = 0;
+        bool matches = true;
+        http_listener listener(m_uri);
+        listener.open().wait();
+        listener.support([&](http_request request) {
+            request.content_ready().wait();
+
+            // Each block of the body buffer is filled down to its last kilobyte before the next one is started, so
+            // the body is held in a bounded number of blocks no matter how many parts it arrived in.
+            auto body = request.body().streambuf();
+            for (;;)
+            {
+                uint8_t* ptr;
+                size_t count;
+                if (!body.acquire(ptr, count) || count == 0) break;
+                matches = matches && count <= 64 * 1024 && std::equal(ptr, ptr + count, data.begin() + total);
+                body.release(ptr, count);
+                total += count;
+                ++blocks;
+            }
+            request.reply(status_codes::OK);
+        });
+
+        // The client sends the body in small chunks, each of which the listener decompresses separately.
+        concurrency::streams::producer_consumer_buffer<uint8_t> buf;
+        http_client_config config;
+        config.set_chunksize(1000);
+        http_client client(m_uri, config);
+        http_request msg(methods::PUT);
+        msg.headers().add(header_names::content_encoding, builtin::algorithm::GZIP);
+        msg.set_body(concurrency::streams::istream(buf));
+        auto response = client.request(msg);
+        for (size_t written = 0; written < compressed.size(); written += 1000)
+        {
+            buf.putn_nocopy(compressed.data() + written, (std::min<size_t>)(1000, compressed.size() - written)).wait();
+        }
+        buf.close(std::ios_base::out).wait();
+        VERIFY_ARE_EQUAL(status_codes::OK, response.get().status_code());
+
+        VERIFY_IS_TRUE(matches);
+        VERIFY_ARE_EQUAL(data.size(), total);
+        VERIFY_IS_TRUE(blocks <= data.size() / (63 * 1024) + 1);
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, request_unknown_encoding)
+    {
+        http_listener listener(m_uri);
+        listener.open().wait();
+        const std::string data("not really compressed");
+
+        // Bodies we cannot decode are passed on as they are
+        listener.support([&](http_request request) {
+            VERIFY_ARE_EQUAL(U("unknown"), request.headers()[header_names::content_encoding]);
+            VERIFY_ARE_EQUAL(data, request.extract_utf8string(true).get());
+            request.reply(status_codes::OK);
+        });
+
+        http_client client(m_uri);
+        http_request msg(methods::PUT);
+        msg.headers().add(header_names::content_encoding, U("unknown"));
+        msg.set_body(data);
+        VERIFY_ARE_EQUAL(status_codes::OK, client.request(msg).get().status_code());
+
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, response_compressed)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::GZIP)) return;
+
+        http_listener_config config;
+        config.set_compress_responses(true);
+        http_listener listener(m_uri, config);
+        listener.open().wait();
+        const auto data = make_text(100000);
+
+        listener.support([&](http_request request) {
+            http_response response(status_codes::OK);
+            response.set_body(data);
+            response.headers().set_content_type(U("application/json; charset=utf-8"));
+            request.reply(response);
+        });
+
+        http_client client(m_uri);
+        http_request msg(methods::GET);
+        msg.headers().add(header_names::accept_encoding, U("deflate;q=0.5, gzip"));
+        auto response = client.request(msg).get();
+        VERIFY_ARE_EQUAL(status_codes::OK, response.status_code());
+        VERIFY_ARE_EQUAL(builtin::algorithm::GZIP, response.headers()[header_names::content_encoding]);
+        VERIFY_ARE_EQUAL(header_names::accept_encoding, response.headers()[header_names::vary]);
+        VERIFY_IS_FALSE(response.headers().has(header_names::content_length));
+
+        const auto body = response.extract_vector().get();
+        VERIFY_IS_TRUE(body.size() < data.size() / 10);
+        VERIFY_ARE_EQUAL(data, decompress(body, data.size()));
+
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, response_stream_compressed)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::GZIP)) return;
+
+        http_listener_config config;
+        config.set_compress_responses(true);
+        http_listener listener(m_uri, config);
+        listener.open().wait();
+        const auto data = make_text(100000);
+
+        // A body of unknown length is compressed as it is written
+        listener.support([&](http_request request) {
+            concurrency::streams::producer_consumer_buffer<uint8_t> buf;
+            http_response response(status_codes::OK);
+            response.set_body(concurrency::streams::istream(buf), U("text/plain"));
+            request.reply(response);
+            for (size_t written = 0; written < data.size(); written += 1000)
+            {
+                buf.putn_nocopy(data.data() + written, 1000).wait();
+            }
+            buf.close(std::ios_base::out).wait();
+        });
+
+        http_client client(m_uri);
+        http_request msg(methods::GET);
+        msg.headers().add(header_names::accept_encoding, builtin::algorithm::GZIP);
+        auto response = client.request(msg).get();
+        VERIFY_ARE_EQUAL(builtin::algorithm::GZIP, response.headers()[header_names::content_encoding]);
+        VERIFY_ARE_EQUAL(data, decompress(response.extract_vector().get(), data.size()));
+
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, response_not_compressed)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::GZIP)) return;
+
+        http_listener_config config;
+        config.set_compress_responses(true);
+        config.set_compression_threshold(1000);
+        http_listener listener(m_uri, config);
+        listener.open().wait();
+        const auto data = make_text(10000);
+
+        listener.support([&](http_request request) {
+            const auto path = request.relative_uri().path();
+            http_response response(status_codes::OK);
+            if (path == U("/small"))
+            {
+                response.set_body(std::vector<uint8_t>(data.begin(), data.begin() + 999));
+                response.headers().set_content_type(U("text/plain"));
+            }
+            else if (path == U("/range"))
+            {
+                response.set_status_code(status_codes::PartialContent);
+                response.set_body(data);
+                response.headers().set_content_type(U("text/plain"));
+                response.headers().add(header_names::content_range, U("bytes 0-9999/20000"));
+            }
+            else if (path == U("/image"))
+            {
+                response.set_body(data);
+                response.headers().set_content_type(U("image/png"));
+            }
+            else
+            {
+                response.set_body(data);
+                response.headers().set_content_type(U("text/html"));
+            }
+            request.reply(response);
+        });
+
+        http_client client(m_uri);
+        auto request = [&](const utility::string_t& path, const utility::string_t& accept_encoding) {
+            http_request msg(methods::GET);
+            msg.set_request_uri(path);
+            if (!accept_encoding.empty()) msg.headers().add(header_names::accept_encoding, accept_encoding);
+            return client.request(msg).get();
+        };
+
+        // Too small, a partial response, not in the allowlist, or not accepted by the client
+        VERIFY_IS_FALSE(request(U("/small"), U("gzip")).headers().has(header_names::content_encoding));
+        VERIFY_IS_FALSE(request(U("/image"), U("gzip")).headers().has(header_names::content_encoding));
+        VERIFY_IS_FALSE(request(U("/range"), U("gzip")).headers().has(header_names::content_encoding));
+        VERIFY_IS_FALSE(request(U("/text"), U("")).headers().has(header_names::content_encoding));
+        VERIFY_IS_FALSE(request(U("/text"), U("identity")).headers().has(header_names::content_encoding));
+        VERIFY_IS_FALSE(request(U("/text"), U("gzip;q=0")).headers().has(header_names::content_encoding));
+
+        auto response = request(U("/text"), U("gzip"));
+        VERIFY_ARE_EQUAL(builtin::algorithm::GZIP, response.headers()[header_names::content_encoding]);
+        VERIFY_ARE_EQUAL(data, decompress(response.extract_vector().get(), data.size()));
+
+        // Compression is off unless enabled in the configuration
+        VERIFY_IS_FALSE(http_listener_config().compress_responses());
+
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, response_compressed_with_dictionary)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::DEFLATE)) return;
+
+        const std::string json("{\"id\":1,\"name\":\"widget\",\"price\":9.5,\"tags\":[\"blue\",\"small\"]}");
+        auto dict = std::make_shared<dictionary>(U("v1"), std::vector<uint8_t>(json.begin(), json.end()));
+
+        http_listener_config config;
+        config.set_compress_responses(true);
+        config.set_compression_threshold(0);
+        config.set_compression_dictionaries({dict});
+        http_listener listener(m_uri, config);
+        listener.open().wait();
+
+        listener.support([&](http_request request) {
+            http_response response(status_codes::OK);
+            response.set_body(json, "application/json");
+            request.reply(response);
+        });
+
+        http_client_config client_config;
+        client_config.set_request_compressed_response(true);
+        client_config.set_compression_dictionaries(
+            {std::make_shared<dictionary>(U("v0"), std::vector<uint8_t>()), dict});
+        http_client client(m_uri, client_config);
+        auto response = client.request(methods::GET).get();
+        VERIFY_ARE_EQUAL(U("v1"), response.headers()[header_names::content_dictionary]);
+        VERIFY_ARE_EQUAL(json, response.extract_utf8string(true).get());
+
+        // Without a shared dictionary the response is compressed as usual
+        client_config.set_compression_dictionaries({});
+        http_client plain_client(m_uri, client_config);
+        response = plain_client.request(methods::GET).get();
+        VERIFY_IS_FALSE(response.headers().has(header_names::content_dictionary));
+        VERIFY_IS_TRUE(response.headers().has(header_names::content_encoding));
+        VERIFY_ARE_EQUAL(json, response.extract_utf8string(true).get());
+
+        listener.close().wait();
+    }
+    TEST_FIXTURE(uri_address, response_cache)
+    {
+        if (!builtin::algorithm::supported(builtin::algorithm::GZIP)) return;
+
+        auto cache = std::make_shared<compressed_response_cache>(1024 * 1024);
+        http_listener_config config;
+        config.set_compress_responses(true);
+        config.set_response_cache(cache);
+        http_listener listener(m_uri, config);
+        listener.open().wait();
+        const auto data = make_text(100000);
+        utility::string_t etag(U("\"v1\""));
+
+        listener.support([&](http_request request) {
+            http_response response(status_codes::OK);
+            response.set_body(data);
+            response.headers().set_content_type(U("text/plain"));
+            response.headers().add(header_names::etag, etag);
+            request.reply(response);
+        });
+
+        http_client client(m_uri);
+        auto request = [&]() {
+            http_request msg(methods::GET);
+            msg.headers().add(header_names::accept_encoding, builtin::algorithm::GZIP);
+            auto response = client.request(msg).get();
+            VERIFY_ARE_EQUAL(builtin::algorithm::GZIP, response.headers()[header_names::content_encoding]);
+            VERIFY_ARE_EQUAL(header_names::accept_encoding, response.headers()[header_names::vary]);
+            const auto body = response.extract_vector().get();
+            VERIFY_ARE_EQUAL(data, decompress(body, data.size()));
+            return response;
+        };
+
+        // The first response is compressed and stored, the second is sent from the cache with its length. Both carry
+        // a weak ETag, while the cache is keyed on the strong one the handler set.
+        auto response = request();
+        VERIFY_IS_FALSE(response.headers().has(header_names::content_length));
+        VERIFY_ARE_EQUAL(U("W/\"v1\""), response.headers()[header_names::etag]);
+        VERIFY_ARE_EQUAL(1u, cache->misses());
+        const auto cached_size = cache->size();
+        VERIFY_IS_TRUE(cached_size > 0 && cached_size < data.size() / 10);
+        response = request();
+        VERIFY_ARE_EQUAL(cached_size, response.headers().content_length());
+        VERIFY_ARE_EQUAL(U("W/\"v1\""), response.headers()[header_names::etag]);
+        VERIFY_ARE_EQUAL(1u, cache->hits());
+
+        // A new version of the resource is compressed again
+        etag = U("\"v2\"");
+        request();
+        VERIFY_ARE_EQUAL(2u, cache->misses());
+        VERIFY_ARE_EQUAL(2 * cached_size, cache->size());
+
+        // Weak validators do not promise the same bytes
+        etag = U("W/\"v3\"");
+        request();
+        request();
+        VERIFY_ARE_EQUAL(2u, cache->misses());
+        VERIFY_ARE_EQUAL(1u, cache->hits());
+
+        listener.close().wait();
+    }
+
+    TEST(response_cache_eviction)
+    {
+        compressed_response_cache cache(25);
+        const auto body = [](uint8_t value) { return std::vector<uint8_t>(10, value); };
+
+        cache.insert(U("/a"), U("\"1\""), U("gzip"), body(1));
+        cache.insert(U("/b"), U("\"1\""), U("gzip"), body(2));
+        VERIFY_ARE_EQUAL(20u, cache.size());
+        VERIFY_IS_TRUE(!cache.find(U("/a"), U("\"1\""), U("br")));
+        VERIFY_IS_TRUE(!cache.find(U("/a"), U("\"2\""), U("gzip")));
+
+        // The least recently used body makes room for a new one
+        VERIFY_ARE_EQUAL(body(1), *cache.find(U("/a"), U("\"1\""), U("gzip")));
+        cache.insert(U("/c"), U("\"1\""), U("gzip"), body(3));
+        VERIFY_ARE_EQUAL(20u, cache.size());
+        VERIFY_IS_TRUE(!cache.find(U("/b"), U("\"1\""), U("gzip")));
+        VERIFY_ARE_EQUAL(body(3), *cache.find(U("/c"), U("\"1\""), U("gzip")));
+
+        // Replacing a body, and bodies too large to store
+        cache.insert(U("/a"), U("\"1\""), U("gzip"), std::vector<uint8_t>(5, 4));
+        VERIFY_ARE_EQUAL(15u, cache.size());
+        cache.insert(U("/d"), U("\"1\""), U("gzip"), std::vector<uint8_t>(26));
+        VERIFY_IS_TRUE(!cache.find(U("/d"), U("\"1\""), U("gzip")));
+        VERIFY_ARE_EQUAL(2u, cache.hits());
+        VERIFY_ARE_EQUAL(4u, cache.misses());
+
+        cache.clear();
+        VERIFY_ARE_EQUAL(0u, cache.size());
+        VERIFY_IS_TRUE(!cache.find(U("/a"), U("\"1\""), U("gzip")));
+    }
+}
+#endif
+
+} // namespace listener
+} // namespace http
+} // namespace functional
+} // namespace tests
@@ -184,6 +184,36 @@ SUITE(request_extract_tests)
 
         listener.close().wait();
     }
+
+    TEST_FIXTURE(uri_address, extract_vector_sized_from_content_length)
+    {
+        http_listener listener(m_uri);
+        listener.open().wait();
+        test_http_client::scoped_client client(m_uri);
+        test_http_client* p_client = client.client();
+        std::string data(300000, 'x');
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            data[i] = static_cast<char>('a' + i % 26);
+        }
+
+        listener.support([&](http_request request) {
+            std::vector<unsigned char> vec = request.extract_vector().get();
+            // The body buffer stores the request in blocks as large as its Content-Length.
+            VERIFY_ARE_EQUAL(data.size(), request.body().streambuf().buffer_size(std::ios_base::out));
+            VERIFY_ARE_EQUAL(data.size(), vec.size());
+            VERIFY_IS_TRUE(std::equal(data.begin(), data.end(), vec.begin()));
+            request.reply(status_codes::OK);
+        });
+        VERIFY_ARE_EQUAL(0, p_client->request(methods::PUT, U(""), U("text/plain"), data));
+        p_client->next_response()
+            .then([](test_response* p_response) {
+                http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+            })
+            .wait();
+
+        listener.close().wait();
+    }
 }
 
 } // namespace listener
@@ -119,6 +119,80 @@ SUITE(response_stream_tests)
         stream.close().get();
     }
 
+    TEST_FIXTURE(uri_address, set_body_mmap_stream)
+    {
+        utility::string_t fname = U("set_response_mmap_stream.txt");
+        fill_file(fname, 2000);
+
+        http_listener listener(m_uri);
+        listener.open().wait();
+        test_http_client::scoped_client client(m_uri);
+        test_http_client* p_client = client.client();
+
+        // A small mapping window makes the response span several windows.
+        http_response response(status_codes::OK);
+        auto stream = streams::mmap_buffer<uint8_t>::open(fname, 4096).get().create_istream();
+        response.set_body(stream);
+        response.headers().set_content_type(U("text/plain; charset=utf-8"));
+        response.headers().set_content_length(26 * 2000);
+
+        listener.support([&](http_request request) { request.reply(response).wait(); });
+        VERIFY_ARE_EQUAL(0u, p_client->request(methods::POST, U("")));
+        p_client->next_response()
+            .then([&](test_response* p_response) {
+                http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+                VERIFY_ARE_EQUAL(26u * 2000, p_response->m_data.size());
+                for (size_t i = 0; i < p_response->m_data.size(); ++i)
+                {
+                    VERIFY_ARE_EQUAL('a' + i % 26, p_response->m_data[i]);
+                }
+            })
+            .wait();
+
+        stream.close().get();
+        listener.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, set_body_stream_after_partial_read)
+    {
+        utility::string_t fname = U("set_response_stream_after_partial_read.txt");
+        fill_file(fname, 40000);
+
+        http_listener listener(m_uri);
+        listener.open().wait();
+        test_http_client::scoped_client client(m_uri);
+        test_http_client* p_client = client.client();
+
+        // Consume the start of the file, so the response has to begin at the stream's read position. The body is
+        // larger than the socket buffer, so it is sent in several goes.
+        http_response response(status_codes::OK);
+        auto stream = streams::file_stream<uint8_t>::open_istream(fname).get();
+        streams::container_buffer<std::vector<uint8_t>> head;
+        VERIFY_ARE_EQUAL(10u, stream.read(head, 10).get());
+        response.set_body(stream);
+        response.headers().set_content_type(U("text/plain; charset=utf-8"));
+        response.headers().set_content_length(26 * 40000 - 20);
+
+        listener.support([&](http_request request) { request.reply(response).wait(); });
+        VERIFY_ARE_EQUAL(0u, p_client->request(methods::POST, U("")));
+        p_client->next_response()
+            .then([&](test_response* p_response) {
+                http_asserts::assert_test_response_equals(p_response, status_codes::OK);
+                VERIFY_ARE_EQUAL(26u * 40000 - 20, p_response->m_data.size());
+                for (size_t i = 0; i < p_response->m_data.size(); ++i)
+                {
+                    VERIFY_ARE_EQUAL('a' + (i + 10) % 26, p_response->m_data[i]);
+                }
+            })
+            .wait();
+
+        // The stream is left after the data that was sent.
+        VERIFY_ARE_EQUAL((size_t)(26 * 40000 - 10), (size_t)stream.seek(0, std::ios_base::cur));
+
+        stream.close().get();
+        listener.close().wait();
+    }
+
     TEST_FIXTURE(uri_address, set_body_stream_partial)
     {
         utility::string_t fname = U("set_response_stream_partial.txt");
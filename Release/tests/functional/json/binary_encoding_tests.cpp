@@ -0,0 +1,162 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * binary_encoding_tests.cpp
+ *
+ * Tests for CBOR and MessagePack encoding of JSON values.
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+
+#include "stdafx.h"
+
+using namespace web;
+using namespace utility;
+
+namespace tests
+{
+namespace functional
+{
+namespace json_tests
+{
+SUITE(binary_encoding_tests)
+{
+    static std::vector<unsigned char> bytes(std::initializer_list<unsigned char> list) { return list; }
+
+    static json::value sample_document()
+    {
+        return json::value::parse(U("{\"name\":\"cpprestsdk\",\"version\":2,\"negative\":-123456789012,")
+                                      U("\"ratio\":0.1,\"half\":0.5,\"big\":18446744073709551615,\"flags\":[true,false,")
+                                      U("null],\"nested\":{\"empty\":{},\"list\":[],\"text\":\"\\u00e9\\u4e2d\"}}"));
+    }
+
+    TEST(cbor_round_trip)
+    {
+        const auto doc = sample_document();
+        VERIFY_ARE_EQUAL(doc, json::value::from_cbor(doc.to_cbor()));
+    }
+
+    TEST(msgpack_round_trip)
+    {
+        const auto doc = sample_document();
+        VERIFY_ARE_EQUAL(doc, json::value::from_msgpack(doc.to_msgpack()));
+    }
+
+    TEST(binary_smaller_than_text)
+    {
+        const auto doc = sample_document();
+        const auto text_size = utility::conversions::to_utf8string(doc.serialize()).size();
+        VERIFY_IS_TRUE(doc.to_cbor().size() < text_size);
+        VERIFY_IS_TRUE(doc.to_msgpack().size() < text_size);
+    }
+
+    TEST(cbor_rfc_examples)
+    {
+        // Examples from RFC 8949 Appendix A.
+        VERIFY_ARE_EQUAL(bytes({0x00}), json::value::number(0).to_cbor());
+        VERIFY_ARE_EQUAL(bytes({0x17}), json::value::number(23).to_cbor());
+        VERIFY_ARE_EQUAL(bytes({0x18, 0x18}), json::value::number(24).to_cbor());
+        VERIFY_ARE_EQUAL(bytes({0x19, 0x03, 0xe8}), json::value::number(1000).to_cbor());
+        VERIFY_ARE_EQUAL(bytes({0x20}), json::value::number(-1).to_cbor());
+        VERIFY_ARE_EQUAL(bytes({0x39, 0x03, 0xe7}), json::value::number(-1000).to_cbor());
+        VERIFY_ARE_EQUAL(bytes({0xfa, 0x47, 0xc3, 0x50, 0x00}), json::value::number(100000.0).to_cbor());
+        VERIFY_ARE_EQUAL(bytes({0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a}),
+                         json::value::number(1.1).to_cbor());
+        VERIFY_ARE_EQUAL(bytes({0xf4}), json::value::boolean(false).to_cbor());
+        VERIFY_ARE_EQUAL(bytes({0xf6}), json::value::null().to_cbor());
+        VERIFY_ARE_EQUAL(bytes({0x64, 0x49, 0x45, 0x54, 0x46}), json::value::string(U("IETF")).to_cbor());
+        VERIFY_ARE_EQUAL(bytes({0x83, 0x01, 0x02, 0x03}), json::value::parse(U("[1,2,3]")).to_cbor());
+        VERIFY_ARE_EQUAL(bytes({0xa2, 0x61, 0x61, 0x01, 0x61, 0x62, 0x82, 0x02, 0x03}),
+                         json::value::parse(U("{\"a\":1,\"b\":[2,3]}")).to_cbor());
+
+        // Half precision and indefinite length items are accepted when decoding.
+        VERIFY_ARE_EQUAL(json::value::number(-4.0), json::value::from_cbor(bytes({0xf9, 0xc4, 0x00})));
+        VERIFY_ARE_EQUAL(json::value::parse(U("[1,[2,3]]")),
+                         json::value::from_cbor(bytes({0x9f, 0x01, 0x82, 0x02, 0x03, 0xff})));
+        VERIFY_ARE_EQUAL(json::value::parse(U("{\"a\":1}")),
+                         json::value::from_cbor(bytes({0xbf, 0x61, 0x61, 0x01, 0xff})));
+        VERIFY_ARE_EQUAL(json::value::string(U("streaming")),
+                         json::value::from_cbor(bytes(
+                             {0x7f, 0x65, 0x73, 0x74, 0x72, 0x65, 0x61, 0x64, 0x6d, 0x69, 0x6e, 0x67, 0xff})));
+
+        // Tags are ignored.
+        VERIFY_ARE_EQUAL(json::value::number(1363896240),
+                         json::value::from_cbor(bytes({0xc1, 0x1a, 0x51, 0x4b, 0x67, 0xb0})));
+    }
+
+    TEST(msgpack_format_selection)
+    {
+        VERIFY_ARE_EQUAL(bytes({0x7f}), json::value::number(127).to_msgpack());
+        VERIFY_ARE_EQUAL(bytes({0xcc, 0x80}), json::value::number(128).to_msgpack());
+        VERIFY_ARE_EQUAL(bytes({0xe0}), json::value::number(-32).to_msgpack());
+        VERIFY_ARE_EQUAL(bytes({0xd0, 0xdf}), json::value::number(-33).to_msgpack());
+        VERIFY_ARE_EQUAL(bytes({0xd1, 0xfc, 0x18}), json::value::number(-1000).to_msgpack());
+        VERIFY_ARE_EQUAL(bytes({0xca, 0x3f, 0x00, 0x00, 0x00}), json::value::number(0.5).to_msgpack());
+        VERIFY_ARE_EQUAL(bytes({0xc0}), json::value::null().to_msgpack());
+        VERIFY_ARE_EQUAL(bytes({0xc3}), json::value::boolean(true).to_msgpack());
+        VERIFY_ARE_EQUAL(bytes({0xa2, 0x68, 0x69}), json::value::string(U("hi")).to_msgpack());
+        VERIFY_ARE_EQUAL(bytes({0x81, 0xa1, 0x61, 0x90}), json::value::parse(U("{\"a\":[]}")).to_msgpack());
+
+        const json::value long_array = json::value::array(std::vector<json::value>(16, json::value::number(1)));
+        const auto encoded = long_array.to_msgpack();
+        VERIFY_ARE_EQUAL(0xdc, static_cast<int>(encoded[0]));
+        VERIFY_ARE_EQUAL(long_array, json::value::from_msgpack(encoded));
+    }
+
+    TEST(integer_limits)
+    {
+        const json::value values[] = {json::value::number((std::numeric_limits<int64_t>::min)()),
+                                      json::value::number((std::numeric_limits<int64_t>::max)()),
+                                      json::value::number((std::numeric_limits<uint64_t>::max)()),
+                                      json::value::number((std::numeric_limits<int32_t>::min)()),
+                                      json::value::number((std::numeric_limits<uint32_t>::max)())};
+        for (const auto& v : values)
+        {
+            VERIFY_ARE_EQUAL(v, json::value::from_cbor(v.to_cbor()));
+            VERIFY_ARE_EQUAL(v, json::value::from_msgpack(v.to_msgpack()));
+        }
+    }
+
+    TEST(malformed_input)
+    {
+        // Truncated data.
+        VERIFY_THROWS(json::value::from_cbor(bytes({0x19, 0x03})), json::json_exception);
+        VERIFY_THROWS(json::value::from_cbor(bytes({0x64, 0x49})), json::json_exception);
+        VERIFY_THROWS(json::value::from_msgpack(bytes({0xcd, 0x03})), json::json_exception);
+        VERIFY_THROWS(json::value::from_msgpack(bytes({0x92, 0x01})), json::json_exception);
+        VERIFY_THROWS(json::value::from_cbor(std::vector<unsigned char>()), json::json_exception);
+
+        // Left over bytes.
+        VERIFY_THROWS(json::value::from_cbor(bytes({0x01, 0x02})), json::json_exception);
+        VERIFY_THROWS(json::value::from_msgpack(bytes({0x01, 0x02})), json::json_exception);
+
+        // No JSON equivalent.
+        VERIFY_THROWS(json::value::from_cbor(bytes({0x41, 0x00})), json::json_exception);
+        VERIFY_THROWS(json::value::from_cbor(bytes({0xa1, 0x01, 0x01})), json::json_exception);
+        VERIFY_THROWS(json::value::from_msgpack(bytes({0xc4, 0x01, 0x00})), json::json_exception);
+        VERIFY_THROWS(json::value::from_msgpack(bytes({0x81, 0x01, 0x01})), json::json_exception);
+
+        // Huge length prefixes must fail cleanly instead of allocating.
+        VERIFY_THROWS(json::value::from_cbor(bytes({0x9b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff})),
+                      json::json_exception);
+        VERIFY_THROWS(json::value::from_msgpack(bytes({0xdd, 0xff, 0xff, 0xff, 0xff})), json::json_exception);
+    }
+
+    TEST(nesting_limit)
+    {
+        std::vector<unsigned char> deep(1000, 0x81);
+        deep.push_back(0x00);
+        VERIFY_THROWS(json::value::from_cbor(deep), json::json_exception);
+
+        std::vector<unsigned char> deep_msgpack(1000, 0x91);
+        deep_msgpack.push_back(0x00);
+        VERIFY_THROWS(json::value::from_msgpack(deep_msgpack), json::json_exception);
+    }
+}
+
+} // namespace json_tests
+} // namespace functional
+} // namespace tests
@@ -0,0 +1,133 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * binding_tests.cpp
+ *
+ * Tests for binding C++ structs to JSON text.
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+
+#include "stdafx.h"
+
+#include "cpprest/json_binding.h"
+#include <sstream>
+
+using namespace web;
+using namespace utility;
+
+namespace tests
+{
+namespace functional
+{
+namespace json_tests
+{
+struct address
+{
+    std::string city;
+    uint32_t zip;
+};
+CPPREST_JSON_FIELDS(address, city, zip)
+
+struct person
+{
+    person() : age(0), balance(0.0), active(false) {}
+
+    std::string name;
+    int age;
+    double balance;
+    bool active;
+    std::vector<std::string> tags;
+    std::vector<address> addresses;
+    json::value extra;
+};
+CPPREST_JSON_FIELDS(person, name, age, balance, active, tags, addresses, extra)
+
+SUITE(binding_tests)
+{
+    static person sample_person()
+    {
+        person p;
+        p.name = "Zo\xc3\xab \"Z\"";
+        p.age = 42;
+        p.balance = -12.5;
+        p.active = true;
+        p.tags.push_back("a");
+        p.tags.push_back("b\n");
+        address home = {"Paris", 75001};
+        p.addresses.push_back(home);
+        p.extra = json::value::parse(U("{\"x\":[1,null]}"));
+        return p;
+    }
+
+    TEST(serialize_struct)
+    {
+        VERIFY_ARE_EQUAL(std::string("{\"name\":\"Zo\xc3\xab \\\"Z\\\"\",\"age\":42,\"balance\":-12.5,\"active\":true,"
+                                     "\"tags\":[\"a\",\"b\\n\"],\"addresses\":[{\"city\":\"Paris\",\"zip\":75001}],"
+                                     "\"extra\":{\"x\":[1,null]}}"),
+                         json::serialize(sample_person()));
+    }
+
+    TEST(serialize_matches_dom)
+    {
+        const auto text = json::serialize(sample_person());
+        const auto dom = json::value::parse(utility::conversions::to_string_t(text));
+        VERIFY_ARE_EQUAL(42, dom.at(U("age")).as_integer());
+        VERIFY_ARE_EQUAL(U("Paris"), dom.at(U("addresses")).at(0).at(U("city")).as_string());
+
+        std::ostringstream stream;
+        json::serialize(sample_person(), stream);
+        VERIFY_ARE_EQUAL(text, stream.str());
+    }
+
+    TEST(round_trip)
+    {
+        const auto original = sample_person();
+        const auto parsed = json::parse_as<person>(json::serialize(original));
+        VERIFY_ARE_EQUAL(original.name, parsed.name);
+        VERIFY_ARE_EQUAL(original.age, parsed.age);
+        VERIFY_ARE_EQUAL(original.balance, parsed.balance);
+        VERIFY_ARE_EQUAL(original.active, parsed.active);
+        VERIFY_ARE_EQUAL(original.tags, parsed.tags);
+        VERIFY_ARE_EQUAL(1u, parsed.addresses.size());
+        VERIFY_ARE_EQUAL(original.addresses[0].city, parsed.addresses[0].city);
+        VERIFY_ARE_EQUAL(original.addresses[0].zip, parsed.addresses[0].zip);
+        VERIFY_ARE_EQUAL(original.extra, parsed.extra);
+    }
+
+    TEST(parse_skips_unknown_and_keeps_missing)
+    {
+        person p;
+        p.age = 7;
+        json::parse_into(" { \"unknown\" : {\"deep\":[1,[2,{}],\"]\"]}, \"name\":\"\\u00e9\\ud83d\\ude00\", "
+                         "\"balance\":1e2, \"active\":null, \"other\":[], \"tags\":[] } ",
+                         p);
+        VERIFY_ARE_EQUAL(std::string("\xc3\xa9\xf0\x9f\x98\x80"), p.name);
+        VERIFY_ARE_EQUAL(7, p.age);
+        VERIFY_ARE_EQUAL(100.0, p.balance);
+        VERIFY_IS_FALSE(p.active);
+        VERIFY_IS_TRUE(p.tags.empty());
+        VERIFY_IS_TRUE(p.extra.is_null());
+    }
+
+    TEST(parse_errors)
+    {
+        VERIFY_THROWS(json::parse_as<person>("[]"), json::json_exception);
+        VERIFY_THROWS(json::parse_as<person>("{\"age\":\"old\"}"), json::json_exception);
+        VERIFY_THROWS(json::parse_as<person>("{\"age\":1.5}"), json::json_exception);
+        VERIFY_THROWS(json::parse_as<person>("{\"age\":99999999999}"), json::json_exception);
+        VERIFY_THROWS(json::parse_as<address>("{\"zip\":-1}"), json::json_exception);
+        VERIFY_THROWS(json::parse_as<address>("{\"zip\":4294967296}"), json::json_exception);
+        VERIFY_THROWS(json::parse_as<person>("{\"name\":\"x\"} x"), json::json_exception);
+        VERIFY_THROWS(json::parse_as<person>("{\"name\":\"x"), json::json_exception);
+        VERIFY_THROWS(json::parse_as<person>("{\"unknown\":[1,}"), json::json_exception);
+        VERIFY_THROWS(json::parse_as<person>("{\"name\":\"\\ud83d\"}"), json::json_exception);
+    }
+}
+
+} // namespace json_tests
+} // namespace functional
+} // namespace tests
@@ -133,6 +133,62 @@ SUITE(construction_tests)
         VERIFY_ARE_EQUAL(U("false"), moved[U("B")].serialize());
     }
 
+    TEST(value_size)
+    {
+        // A pointer and room for a number, with no padding beyond what the number needs.
+        VERIFY_IS_TRUE(sizeof(json::value) <= 4 * sizeof(uint64_t));
+    }
+
+    TEST(move_inline_values)
+    {
+        // Scalars live inside the value itself and strings on the heap, so moves must carry either across.
+        json::value str(U("a string long enough to need its own buffer"));
+        json::value moved(std::move(str));
+        VERIFY_ARE_EQUAL(U("a string long enough to need its own buffer"), moved.as_string());
+        VERIFY_IS_TRUE(str.is_null());
+
+        json::value num(42);
+        num = std::move(moved);
+        VERIFY_IS_TRUE(num.is_string());
+        moved = json::value(1.5);
+        VERIFY_ARE_EQUAL(1.5, moved.as_double());
+
+        json::value self(U("self"));
+        self = self;
+        VERIFY_ARE_EQUAL(U("self"), self.as_string());
+
+        std::vector<json::value> values;
+        for (int i = 0; i < 100; ++i)
+        {
+            values.push_back(i % 2 == 0 ? json::value(i)
+                                        : json::value(utility::conversions::to_string_t(std::to_string(i))));
+        }
+        json::value arr = json::value::array(std::move(values));
+        VERIFY_ARE_EQUAL(100u, arr.size());
+        VERIFY_ARE_EQUAL(98, arr[98].as_integer());
+        VERIFY_ARE_EQUAL(U("99"), arr[99].as_string());
+
+        json::value copy = arr;
+        copy[0] = json::value::string(U("replaced"));
+        VERIFY_ARE_EQUAL(0, arr[0].as_integer());
+        VERIFY_ARE_EQUAL(U("replaced"), copy[0].as_string());
+    }
+
+    TEST(move_assign_from_owned_value)
+    {
+        // The source of the assignment is owned by the target, so it must be taken out before the target is released.
+        json::value v = json::value::parse(U("{\"x\":{\"y\":[1,\"two\",3.5]},\"z\":\"a long enough string\"}"));
+        v = std::move(v[U("x")]);
+        VERIFY_ARE_EQUAL(U("{\"y\":[1,\"two\",3.5]}"), v.serialize());
+
+        v = std::move(v[U("y")][1]);
+        VERIFY_ARE_EQUAL(U("two"), v.as_string());
+
+        json::value n = json::value::parse(U("[42]"));
+        n = std::move(n[0]);
+        VERIFY_ARE_EQUAL(42, n.as_integer());
+    }
+
     TEST(constructor_overloads)
     {
         json::value v0;
@@ -0,0 +1,120 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * lazy_parsing_tests.cpp
+ *
+ * Tests for on-demand parsing of JSON values.
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+
+#include "stdafx.h"
+
+using namespace web;
+using namespace utility;
+
+namespace tests
+{
+namespace functional
+{
+namespace json_tests
+{
+SUITE(lazy_parsing_tests)
+{
+    static const char* const document = " {\"id\" : 42, \"name\":\"caf\\u00e9\",\n\"tags\":[ \"a\", true, null, -1.5e3 ],"
+                                        "\"nested\":{ \"deep\" : { \"x\" : [ ] } }, \"b\" : false } ";
+
+    TEST(access_matches_eager_parse)
+    {
+        auto lazy = json::value::parse_lazy(document);
+        auto eager = json::value::parse(utility::conversions::to_string_t(document));
+
+        VERIFY_IS_TRUE(lazy.is_object());
+        VERIFY_ARE_EQUAL(5u, lazy.size());
+        VERIFY_ARE_EQUAL(42, lazy.at(U("id")).as_integer());
+        VERIFY_ARE_EQUAL(eager.at(U("name")).as_string(), lazy.at(U("name")).as_string());
+        VERIFY_IS_TRUE(lazy.at(U("tags")).at(1).as_bool());
+        VERIFY_IS_TRUE(lazy.at(U("tags")).at(2).is_null());
+        VERIFY_ARE_EQUAL(-1500.0, lazy.at(U("tags")).at(3).as_double());
+        VERIFY_IS_FALSE(lazy.at(U("b")).as_bool());
+        VERIFY_IS_TRUE(lazy.has_field(U("nested")));
+        VERIFY_IS_FALSE(lazy.has_field(U("missing")));
+        VERIFY_ARE_EQUAL(eager, lazy);
+        VERIFY_ARE_EQUAL(lazy, eager);
+    }
+
+    TEST(untouched_values_serialize_original_text)
+    {
+        const auto lazy = json::value::parse_lazy(document);
+        VERIFY_ARE_EQUAL(U("{ \"deep\" : { \"x\" : [ ] } }"), lazy.at(U("nested")).serialize());
+        VERIFY_ARE_EQUAL(U("[ \"a\", true, null, -1.5e3 ]"), lazy.at(U("tags")).serialize());
+
+        // Reading through a const value does not invalidate the source text.
+        std::string text(document);
+        VERIFY_ARE_EQUAL(utility::conversions::to_string_t(text.substr(1, text.size() - 2)), lazy.serialize());
+    }
+
+    TEST(modified_values_reserialize)
+    {
+        auto lazy = json::value::parse_lazy(document);
+        lazy[U("id")] = json::value::number(7);
+        lazy[U("added")] = json::value::string(U("new"));
+
+        // Untouched children keep their original text.
+        VERIFY_ARE_EQUAL(U("{\"added\":\"new\",\"b\":false,\"id\":7,\"name\":\"caf\\u00e9\",")
+                             U("\"nested\":{ \"deep\" : { \"x\" : [ ] } },\"tags\":[ \"a\", true, null, -1.5e3 ]}"),
+                         lazy.serialize());
+
+        lazy[U("nested")][U("deep")][U("y")] = json::value::number(1);
+        VERIFY_ARE_EQUAL(U("{\"deep\":{\"x\":[ ],\"y\":1}}"), lazy.at(U("nested")).serialize());
+    }
+
+    TEST(serializing_does_not_materialize_children)
+    {
+        // Children that are never accessed are only copied, so malformed contents go unnoticed.
+        auto lazy = json::value::parse_lazy("{\"bad\":[1 2],\"str\":\"\\q\"}");
+        lazy[U("added")] = json::value::array({json::value::parse_lazy("{\"x\":[1 2]}")});
+        VERIFY_ARE_EQUAL(U("{\"added\":[{\"x\":[1 2]}],\"bad\":[1 2],\"str\":\"\\q\"}"), lazy.serialize());
+    }
+
+    TEST(copies_are_independent)
+    {
+        auto original = json::value::parse_lazy("[1,{\"a\":2}]");
+        auto copy = original;
+        copy[1][U("a")] = json::value::number(3);
+        VERIFY_ARE_EQUAL(U("[1,{\"a\":2}]"), original.serialize());
+        VERIFY_ARE_EQUAL(U("[1,{\"a\":3}]"), copy.serialize());
+    }
+
+    TEST(scalar_documents)
+    {
+        VERIFY_ARE_EQUAL(12, json::value::parse_lazy(" 12 ").as_integer());
+        VERIFY_IS_TRUE(json::value::parse_lazy("null").is_null());
+        VERIFY_ARE_EQUAL(U("x\ny"), json::value::parse_lazy("\"x\\ny\"").as_string());
+        VERIFY_ARE_EQUAL(U("\"x\\ny\""), json::value::parse_lazy("\"x\\ny\"").serialize());
+    }
+
+    TEST(malformed_structure)
+    {
+        VERIFY_THROWS(json::value::parse_lazy(""), json::json_exception);
+        VERIFY_THROWS(json::value::parse_lazy("{\"a\":[1,2}"), json::json_exception);
+        VERIFY_THROWS(json::value::parse_lazy("[\"unterminated]"), json::json_exception);
+        VERIFY_THROWS(json::value::parse_lazy("[1] 2"), json::json_exception);
+        VERIFY_THROWS(json::value::parse_lazy("@"), json::json_exception);
+    }
+
+    TEST(malformed_content_detected_on_access)
+    {
+        auto lazy = json::value::parse_lazy("{\"ok\":1,\"bad\":[1 2],\"num\":12x}");
+        VERIFY_ARE_EQUAL(1, lazy.at(U("ok")).as_integer());
+        VERIFY_THROWS(lazy.at(U("bad")).size(), json::json_exception);
+        VERIFY_THROWS(lazy.at(U("num")).as_integer(), json::json_exception);
+    }
+}
+
+} // namespace json_tests
+} // namespace functional
+} // namespace tests
@@ -0,0 +1,178 @@
+/***
+ * Copyright (C) Microsoft. All rights reserved.
+ * Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+ *
+ * =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *
+ * ndjson_tests.cpp
+ *
+ * Tests for reading and writing newline-delimited JSON streams.
+ *
+ * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+ ****/
+
+#include "stdafx.h"
+
+#include "cpprest/containerstream.h"
+#include "cpprest/ndjson.h"
+#include "cpprest/producerconsumerstream.h"
+
+using namespace web;
+using namespace utility;
+using namespace concurrency::streams;
+
+namespace tests
+{
+namespace functional
+{
+namespace json_tests
+{
+SUITE(ndjson_tests)
+{
+    static std::vector<json::value> read_all(istream stream, size_t max_line_length = 1024)
+    {
+        std::vector<json::value> values;
+        json::ndjson_reader reader(stream, max_line_length);
+        while (reader.read_next().get())
+        {
+            values.push_back(reader.current());
+        }
+        return values;
+    }
+
+    TEST(read_lines)
+    {
+        auto values = read_all(
+            bytestream::open_istream(std::string("{\"a\":1}\n[1,2]\r\n\n  \n\"text\"\nnull\n42")));
+        VERIFY_ARE_EQUAL(5u, values.size());
+        VERIFY_ARE_EQUAL(json::value::parse(U("{\"a\":1}")), values[0]);
+        VERIFY_ARE_EQUAL(json::value::parse(U("[1,2]")), values[1]);
+        VERIFY_ARE_EQUAL(json::value::string(U("text")), values[2]);
+        VERIFY_IS_TRUE(values[3].is_null());
+        VERIFY_ARE_EQUAL(42, values[4].as_integer());
+    }
+
+    TEST(read_empty_stream)
+    {
+        VERIFY_ARE_EQUAL(0u, read_all(bytestream::open_istream(std::string())).size());
+        VERIFY_ARE_EQUAL(0u, read_all(bytestream::open_istream(std::string("\n\n"))).size());
+    }
+
+    TEST(read_lines_spanning_chunks)
+    {
+        // Lines larger than the reader's internal chunk size are reassembled.
+        std::string big(200 * 1024, 'x');
+        std::string data = "\"" + big + "\"\n{\"k\":true}\n";
+        auto values = read_all(bytestream::open_istream(data), data.size());
+        VERIFY_ARE_EQUAL(2u, values.size());
+        VERIFY_ARE_EQUAL(big, utility::conversions::to_utf8string(values[0].as_string()));
+        VERIFY_IS_TRUE(values[1].at(U("k")).as_bool());
+    }
+
+    TEST(line_too_long)
+    {
+        json::ndjson_reader reader(bytestream::open_istream(std::string("[1,2,3,4,5,6,7,8,9]\n1\n")), 8);
+        VERIFY_THROWS(reader.read_next().get(), json::json_exception);
+        VERIFY_IS_TRUE(reader.read_next().get());
+        VERIFY_ARE_EQUAL(1, reader.current().as_integer());
+        VERIFY_IS_FALSE(reader.read_next().get());
+    }
+
+    TEST(line_too_long_spanning_reads)
+    {
+        // The rest of the over-long line has not arrived yet when the limit is hit, and is skipped once it does.
+        producer_consumer_buffer<uint8_t> buf;
+        json::ndjson_reader reader(buf.create_istream(), 8);
+
+        std::string part1("[1,2,3,4,5,6");
+        buf.putn_nocopy(reinterpret_cast<const uint8_t*>(part1.data()), part1.size()).wait();
+        VERIFY_THROWS(reader.read_next().get(), json::json_exception);
+
+        std::string part2(",7,8,9]\n2\n");
+        buf.putn_nocopy(reinterpret_cast<const uint8_t*>(part2.data()), part2.size()).wait();
+        buf.close(std::ios_base::out).wait();
+        VERIFY_IS_TRUE(reader.read_next().get());
+        VERIFY_ARE_EQUAL(2, reader.current().as_integer());
+        VERIFY_IS_FALSE(reader.read_next().get());
+    }
+
+    TEST(errors_are_reported_through_the_task)
+    {
+        // The second line is already buffered by the first read, so the error is found before read_next() returns.
+        json::ndjson_reader reader(bytestream::open_istream(std::string("1\n[1,2,3,4,5,6,7,8,9]\n")), 8);
+        VERIFY_IS_TRUE(reader.read_next().get());
+
+        pplx::task<bool> read;
+        VERIFY_NO_THROWS(read = reader.read_next());
+        VERIFY_THROWS(read.get(), json::json_exception);
+
+        json::ndjson_reader other(bytestream::open_istream(std::string("1\n{bad\n")));
+        VERIFY_IS_TRUE(other.read_next().get());
+        pplx::task<void> all;
+        VERIFY_NO_THROWS(all = other.for_each([](json::value) {}));
+        VERIFY_THROWS(all.get(), json::json_exception);
+    }
+
+    TEST(malformed_line_can_be_skipped)
+    {
+        json::ndjson_reader reader(bytestream::open_istream(std::string("{bad\n2\n")));
+        VERIFY_THROWS(reader.read_next().get(), json::json_exception);
+        VERIFY_IS_TRUE(reader.read_next().get());
+        VERIFY_ARE_EQUAL(2, reader.current().as_integer());
+    }
+
+    TEST(read_from_producer)
+    {
+        producer_consumer_buffer<uint8_t> buf;
+        json::ndjson_reader reader(buf.create_istream());
+
+        auto first = reader.read_next();
+        std::string part1("{\"seq\":");
+        buf.putn_nocopy(reinterpret_cast<const uint8_t*>(part1.data()), part1.size()).wait();
+        VERIFY_IS_FALSE(first.is_done());
+
+        std::string part2("1}\n{\"seq\":2}\n");
+        buf.putn_nocopy(reinterpret_cast<const uint8_t*>(part2.data()), part2.size()).wait();
+        VERIFY_IS_TRUE(first.get());
+        VERIFY_ARE_EQUAL(1, reader.current().at(U("seq")).as_integer());
+        VERIFY_IS_TRUE(reader.read_next().get());
+        VERIFY_ARE_EQUAL(2, reader.current().at(U("seq")).as_integer());
+
+        buf.close(std::ios_base::out).wait();
+        VERIFY_IS_FALSE(reader.read_next().get());
+    }
+
+    TEST(write_then_read)
+    {
+        producer_consumer_buffer<uint8_t> buf;
+        json::ndjson_writer writer(buf.create_ostream());
+        for (int i = 0; i < 100; ++i)
+        {
+            json::value v = json::value::object();
+            v[U("i")] = json::value::number(i);
+            writer.write(v);
+        }
+        writer.close().wait();
+
+        int expected = 0;
+        json::ndjson_reader(buf.create_istream())
+            .for_each([&expected](json::value v) { VERIFY_ARE_EQUAL(expected++, v.at(U("i")).as_integer()); })
+            .wait();
+        VERIFY_ARE_EQUAL(100, expected);
+    }
+
+    TEST(writer_output_format)
+    {
+        container_buffer<std::vector<uint8_t>> buf;
+        json::ndjson_writer writer(buf.create_ostream());
+        writer.write(json::value::parse(U("{\"a\":[1,2]}")));
+        writer.write(json::value::string(U("line\nbreak")));
+        writer.flush().wait();
+        const auto& data = buf.collection();
+        VERIFY_ARE_EQUAL(std::string("{\"a\":[1,2]}\n\"line\\nbreak\"\n"), std::string(data.begin(), data.end()));
+    }
+}
+
+} // namespace json_tests
+} // namespace functional
+} // namespace tests
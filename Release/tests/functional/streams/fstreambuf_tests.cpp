@@ -881,6 +881,252 @@ SUITE(file_buffer_tests)
         VERIFY_ARE_EQUAL(istream.size(), 2600);
     }
 
+    TEST(large_sequential_and_random_access)
+    {
+        utility::string_t fname = U("large_sequential_and_random_access.txt");
+        std::vector<char> expected(4 * 1024 * 1024);
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            expected[i] = static_cast<char>('a' + (i * 7) % 26);
+        }
+
+        // Many writes are in flight at once before the stream is synced.
+        auto ostream = OPEN_W<char>(fname).get();
+        const size_t chunk = 64 * 1024;
+        std::vector<pplx::task<size_t>> writes;
+        for (size_t offset = 0; offset < expected.size(); offset += chunk)
+        {
+            writes.push_back(ostream.putn_nocopy(&expected[offset], chunk));
+        }
+        pplx::when_all(writes.begin(), writes.end()).wait();
+        ostream.close().wait();
+
+        auto istream = OPEN_R<char>(fname).get();
+        VERIFY_ARE_EQUAL(expected.size(), istream.size());
+
+        std::vector<char> actual(expected.size());
+        size_t total = 0;
+        while (total < actual.size())
+        {
+            const size_t read = istream.getn(&actual[total], chunk).get();
+            VERIFY_ARE_NOT_EQUAL(0u, read);
+            total += read;
+        }
+        VERIFY_IS_TRUE(expected == actual);
+
+        for (size_t i = 0; i < 64; ++i)
+        {
+            const size_t pos = (i * 1000003) % (expected.size() - 4096);
+            char block[4096];
+            istream.seekpos(pos, std::ios_base::in);
+            VERIFY_ARE_EQUAL(sizeof(block), istream.getn(block, sizeof(block)).get());
+            VERIFY_IS_TRUE(std::equal(block, block + sizeof(block), expected.begin() + pos));
+        }
+        istream.close().wait();
+    }
+
+    TEST(sequential_read_ahead_uneven_reads)
+    {
+        utility::string_t fname = U("sequential_read_ahead_uneven_reads.txt");
+        std::string expected;
+        for (size_t i = 0; expected.size() < 3 * 1024 * 1024 + 17; ++i)
+        {
+            expected += std::to_string(i);
+            expected += ',';
+        }
+        {
+            auto ostream = OPEN_W<char>(fname).get();
+            ostream.putn_nocopy(&expected[0], expected.size()).wait();
+            ostream.close().wait();
+        }
+
+        // Read sizes that do not line up with the read-ahead buffer, so refills have unread data left over.
+        auto istream = OPEN_R<char>(fname).get();
+        istream.set_buffer_size(1024 * 1024);
+        std::string actual;
+        char block[7001];
+        for (size_t i = 0;; ++i)
+        {
+            const size_t want = 1 + (i * 977) % sizeof(block);
+            const size_t read = istream.getn(block, want).get();
+            actual.append(block, read);
+            if (read < want) break;
+        }
+        VERIFY_ARE_EQUAL(expected.size(), actual.size());
+        VERIFY_IS_TRUE(expected == actual);
+        istream.close().wait();
+
+        // A small buffer size caps the read-ahead.
+        auto capped = OPEN_R<char>(fname).get();
+        capped.set_buffer_size(1024);
+        concurrency::streams::container_buffer<std::string> target;
+        capped.create_istream().read_to_end(target).wait();
+        VERIFY_IS_TRUE(expected == target.collection());
+        capped.close().wait();
+
+        // The default buffer size reads ahead with a bounded cap.
+        auto defaulted = OPEN_R<char>(fname).get();
+        VERIFY_ARE_EQUAL(64u * 1024u, defaulted.buffer_size());
+        concurrency::streams::container_buffer<std::string> default_target;
+        defaulted.create_istream().read_to_end(default_target).wait();
+        VERIFY_IS_TRUE(expected == default_target.collection());
+        defaulted.close().wait();
+
+        // A page-sized buffer turns read-ahead off.
+        auto plain = OPEN_R<char>(fname).get();
+        plain.set_buffer_size(512);
+        concurrency::streams::container_buffer<std::string> plain_target;
+        plain.create_istream().read_to_end(plain_target).wait();
+        VERIFY_IS_TRUE(expected == plain_target.collection());
+        plain.close().wait();
+    }
+
+#if !defined(__cplusplus_winrt)
+    TEST(mmap_buffer_read)
+    {
+        utility::string_t fname = U("mmap_buffer_read.txt");
+        fill_file(fname, 1000);
+
+        // A window of one page forces the buffer to remap as it moves through the file.
+        auto buf = concurrency::streams::mmap_buffer<char>::open(get_full_name(fname), 4096).get();
+        VERIFY_IS_TRUE(buf.has_size());
+        VERIFY_ARE_EQUAL(26000u, buf.size());
+        VERIFY_IS_FALSE(buf.can_write());
+
+        std::vector<char> data(26000);
+        VERIFY_ARE_EQUAL(26000u, buf.getn(&data[0], data.size()).get());
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL('a' + i % 26, data[i]);
+        }
+        VERIFY_ARE_EQUAL(0u, buf.getn(&data[0], 1).get());
+
+        buf.seekpos(4095, std::ios_base::in);
+        VERIFY_ARE_EQUAL('a' + 4095 % 26, buf.bumpc().get());
+        VERIFY_ARE_EQUAL('a' + 4096 % 26, buf.getc().get());
+        VERIFY_ARE_EQUAL(4096, buf.getpos(std::ios_base::in));
+        VERIFY_ARE_EQUAL(25999, buf.seekoff(-1, std::ios_base::end, std::ios_base::in));
+        VERIFY_ARE_EQUAL('a' + 25999 % 26, buf.bumpc().get());
+        VERIFY_ARE_EQUAL(std::char_traits<char>::eof(), buf.bumpc().get());
+        buf.close().wait();
+    }
+
+    TEST(file_buffer_acquire_read_line)
+    {
+        utility::string_t fname = U("file_buffer_acquire_read_line.txt");
+        std::string expected;
+        for (size_t i = 0; expected.size() < 200 * 1024; ++i)
+        {
+            expected += std::string(i % 300, 'x') + std::to_string(i) + '\n';
+        }
+        {
+            auto ostream = OPEN_W<char>(fname).get();
+            ostream.putn_nocopy(&expected[0], expected.size()).wait();
+            ostream.close().wait();
+        }
+
+        auto buf = OPEN_R<char>(fname).get();
+        auto istream = buf.create_istream();
+        char* ptr;
+        size_t count;
+        VERIFY_IS_FALSE(buf.acquire(ptr, count));
+
+        // Once the first line has been read, the rest of the read buffer is exposed in place.
+        concurrency::streams::container_buffer<std::string> line;
+        VERIFY_ARE_EQUAL(1u, istream.read_line(line).get());
+        VERIFY_IS_TRUE(buf.acquire(ptr, count));
+        VERIFY_ARE_EQUAL(buf.in_avail(), count);
+        VERIFY_ARE_EQUAL(expected[2], ptr[0]);
+        buf.release(ptr, 0);
+
+        std::string lines = line.collection() + '\n';
+        while (!istream.is_eof())
+        {
+            concurrency::streams::container_buffer<std::string> next;
+            istream.read_line(next).wait();
+            if (istream.is_eof() && next.collection().empty()) break;
+            lines += next.collection() + '\n';
+        }
+        VERIFY_IS_TRUE(expected == lines);
+        buf.close().wait();
+
+        // Splitting on a delimiter that is not a line break goes through the same path.
+        auto delimited_buf = OPEN_R<char>(fname).get();
+        auto delimited = delimited_buf.create_istream();
+        std::string fields;
+        for (;;)
+        {
+            concurrency::streams::container_buffer<std::string> field;
+            delimited.read_to_delim(field, 'x').wait();
+            fields += field.collection();
+            if (delimited.is_eof()) break;
+        }
+        std::string stripped;
+        for (char c : expected)
+        {
+            if (c != 'x') stripped += c;
+        }
+        VERIFY_IS_TRUE(stripped == fields);
+        delimited_buf.close().wait();
+    }
+
+    TEST(mmap_buffer_acquire)
+    {
+        utility::string_t fname = U("mmap_buffer_acquire.txt");
+        fill_file(fname, 1000);
+
+        auto buf = concurrency::streams::mmap_buffer<char>::open(get_full_name(fname), 4096).get();
+        size_t total = 0;
+        for (;;)
+        {
+            char* ptr;
+            size_t count;
+            VERIFY_IS_TRUE(buf.acquire(ptr, count));
+            if (count == 0)
+            {
+                VERIFY_IS_TRUE(ptr == nullptr);
+                break;
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                VERIFY_ARE_EQUAL('a' + (total + i) % 26, ptr[i]);
+            }
+            buf.release(ptr, count);
+            total += count;
+        }
+        VERIFY_ARE_EQUAL(26000u, total);
+        buf.close().wait();
+    }
+
+    TEST(mmap_buffer_stream)
+    {
+        utility::string_t fname = U("mmap_buffer_stream.txt");
+        fill_file(fname, 3);
+
+        auto stream = concurrency::streams::mmap_buffer<uint8_t>::open(get_full_name(fname)).get().create_istream();
+        concurrency::streams::container_buffer<std::string> target;
+        VERIFY_ARE_EQUAL(78u, stream.read_to_end(target).get());
+        VERIFY_ARE_EQUAL("abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz",
+                         target.collection());
+        stream.close().wait();
+    }
+
+    TEST(mmap_buffer_empty_and_missing_file)
+    {
+        utility::string_t fname = U("mmap_buffer_empty.txt");
+        OPEN_W<char>(fname).get().close().wait();
+
+        auto buf = concurrency::streams::mmap_buffer<char>::open(get_full_name(fname)).get();
+        VERIFY_ARE_EQUAL(0u, buf.size());
+        char ch;
+        VERIFY_ARE_EQUAL(0u, buf.getn(&ch, 1).get());
+        buf.close().wait();
+
+        VERIFY_THROWS(concurrency::streams::mmap_buffer<char>::open(U("mmap_buffer_missing.txt")).get(),
+                      std::system_error);
+    }
+#endif
+
 #ifdef _WIN32
     TEST(file_size_w)
     {
@@ -804,6 +804,150 @@ SUITE(istream_tests)
         sbuf.close().get();
     }
 
+    TEST(streambuf_transfer)
+    {
+        // The source exposes its memory, which is written straight into the target.
+        const std::string text = "abcdefghijklmnopqrstuvwxyz";
+        stringstreambuf source(text);
+        producer_consumer_buffer<char> target;
+
+        VERIFY_ARE_EQUAL(10u, streams::transfer<char>(source, target, 10).get());
+        VERIFY_ARE_EQUAL(16u, streams::transfer<char>(source, target, 100).get());
+        VERIFY_ARE_EQUAL(0u, streams::transfer<char>(source, target, 100).get());
+        target.close(std::ios_base::out).get();
+
+        char chars[64];
+        VERIFY_ARE_EQUAL(26u, target.getn(chars, sizeof(chars)).get());
+        VERIFY_ARE_EQUAL(text, std::string(chars, 26));
+
+        VERIFY_THROWS(streams::transfer<char>(source, target, 10).get(), std::runtime_error);
+        source.close().get();
+        target.close().get();
+    }
+
+    TEST(fstream_transfer)
+    {
+        // Neither buffer exposes its memory up front; data read ahead by the file is then read straight into the
+        // target's memory.
+        utility::string_t fname = U("fstream_transfer.txt");
+        fill_file(fname, 1024);
+
+        auto source = OPEN_R<char>(fname).get();
+        stringstreambuf target;
+        size_t total = 0;
+        for (size_t moved; (moved = streams::transfer<char>(source, target, 1000).get()) != 0;)
+        {
+            VERIFY_IS_TRUE(moved <= 1000u);
+            total += moved;
+        }
+
+        VERIFY_ARE_EQUAL(26u * 1024, total);
+        const auto& data = target.collection();
+        VERIFY_ARE_EQUAL(26u * 1024, data.size());
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(static_cast<char>('a' + i % 26), data[i]);
+        }
+
+        source.close().get();
+        target.close().get();
+    }
+
+    TEST(stream_read_to_end_while_writing)
+    {
+        // Blocks acquired from the source stay valid while the writer keeps appending.
+        producer_consumer_buffer<char> rbuf(64);
+        streams::basic_istream<char> stream = rbuf;
+        container_buffer<std::vector<char>> target;
+
+        auto read = stream.read_to_end(target);
+        const char* text = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        size_t len = strlen(text);
+        for (int i = 0; i < 1000; ++i)
+        {
+            VERIFY_ARE_EQUAL(len, rbuf.putn_nocopy(text, len).get());
+        }
+        rbuf.close(std::ios_base::out).get();
+
+        VERIFY_ARE_EQUAL(len * 1000, read.get());
+        const auto& data = target.collection();
+        VERIFY_ARE_EQUAL(len * 1000, data.size());
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(text[i % len], data[i]);
+        }
+
+        stream.close().get();
+        target.close().get();
+    }
+
+    TEST(stream_read_line_across_blocks)
+    {
+        // Small blocks split lines, and line ends, between blocks.
+        producer_consumer_buffer<char> rbuf(7);
+        streams::basic_istream<char> stream = rbuf;
+
+        const std::string longline(40000, 'x');
+        const std::string text = "first line\r\nsecond\rthird\n\n" + longline + "\r\nlast";
+        for (size_t pos = 0; pos < text.size(); pos += 5)
+        {
+            const size_t count = (std::min)(text.size() - pos, static_cast<size_t>(5));
+            VERIFY_ARE_EQUAL(count, rbuf.putn_nocopy(text.data() + pos, count).get());
+        }
+        rbuf.close(std::ios_base::out).get();
+
+        std::vector<std::string> lines;
+        while (!stream.is_eof())
+        {
+            container_buffer<std::string> line;
+            stream.read_line(line).get();
+            lines.push_back(line.collection());
+        }
+
+        VERIFY_ARE_EQUAL(6u, lines.size());
+        VERIFY_ARE_EQUAL("first line", lines[0]);
+        VERIFY_ARE_EQUAL("second", lines[1]);
+        VERIFY_ARE_EQUAL("third", lines[2]);
+        VERIFY_ARE_EQUAL("", lines[3]);
+        VERIFY_IS_TRUE(longline == lines[4]);
+        VERIFY_ARE_EQUAL("last", lines[5]);
+        stream.close().get();
+    }
+
+    TEST(stream_read_to_delim_across_blocks)
+    {
+        producer_consumer_buffer<uint8_t> rbuf(4);
+        streams::basic_istream<uint8_t> stream = rbuf;
+
+        const std::string text = "alpha|beta||gamma-";
+        VERIFY_ARE_EQUAL(text.size(), rbuf.putn_nocopy((const uint8_t*)text.data(), text.size()).get());
+
+        container_buffer<std::vector<uint8_t>> target;
+        auto collected = [&target] { return std::string(target.collection().begin(), target.collection().end()); };
+        VERIFY_ARE_EQUAL(5u, stream.read_to_delim(target, '|').get());
+        VERIFY_ARE_EQUAL(4u, stream.read_to_delim(target, '|').get());
+        VERIFY_ARE_EQUAL(0u, stream.read_to_delim(target, '|').get());
+        VERIFY_ARE_EQUAL(std::string("alphabeta"), collected());
+
+        // The rest of the data only arrives after the read has started.
+        auto read = stream.read_to_delim(target, '|');
+        VERIFY_ARE_EQUAL(6u, rbuf.putn_nocopy((const uint8_t*)"delta|", 6).get());
+        VERIFY_ARE_EQUAL(11u, read.get());
+        VERIFY_ARE_EQUAL(std::string("alphabetagamma-delta"), collected());
+        rbuf.close(std::ios_base::out).get();
+        VERIFY_ARE_EQUAL(0u, stream.read_to_delim(target, '|').get());
+        VERIFY_IS_TRUE(stream.is_eof());
+
+        // A delimiter that no character widens to is never found.
+        stringstreambuf source(text);
+        streams::basic_istream<char> stream2 = source;
+        container_buffer<std::string> all;
+        VERIFY_ARE_EQUAL(text.size(), stream2.read_to_delim(all, 0x1234).get());
+        VERIFY_ARE_EQUAL(text, all.collection());
+        stream.close().get();
+        stream2.close().get();
+    }
+
     TEST(istream_extract_string)
     {
         producer_consumer_buffer<char> rbuf;
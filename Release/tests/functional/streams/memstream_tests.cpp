@@ -9,6 +9,9 @@
  * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
  ****/
 #include "stdafx.h"
+
+#include <set>
+
 #if defined(__cplusplus_winrt)
 #include <wrl.h>
 #endif
@@ -1337,6 +1340,345 @@ SUITE(memstream_tests)
         pplx::when_all(std::begin(taskVector), std::end(taskVector)).wait();
     }
 
+    TEST(spsc_buffer_operations)
+    {
+        {
+            auto buf = streams::producer_consumer_buffer<char>::single_producer_consumer();
+            streambuf_putn(buf);
+        }
+        {
+            auto buf = streams::producer_consumer_buffer<utf16char>::single_producer_consumer();
+            streambuf_alloc_commit(buf);
+        }
+        {
+            auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer();
+            streambuf_putn_getn(buf);
+        }
+        {
+            auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer();
+            streambuf_acquire_alloc(buf);
+        }
+        {
+            auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer();
+            streambuf_close(buf);
+        }
+        {
+            auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer();
+            streambuf_close_read_with_pending_read(buf);
+        }
+        {
+            auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer();
+            streambuf_close_write_with_pending_read(buf);
+        }
+        {
+            auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer();
+            streambuf_close_parallel(buf);
+        }
+    }
+
+    TEST(spsc_buffer_sync)
+    {
+        auto buf = streams::producer_consumer_buffer<char>::single_producer_consumer();
+        char data[10];
+        auto read = buf.getn(data, 10);
+        VERIFY_ARE_EQUAL(3u, buf.putn_nocopy("abc", 3).get());
+        VERIFY_IS_FALSE(read.is_done());
+
+        // A flush lets the pending read complete with what is there.
+        buf.sync().wait();
+        VERIFY_ARE_EQUAL(3u, read.get());
+        VERIFY_ARE_EQUAL(std::string("abc"), std::string(data, 3));
+
+        VERIFY_ARE_EQUAL(2u, buf.putn_nocopy("de", 2).get());
+        VERIFY_ARE_EQUAL((int)'d', buf.sbumpc());
+        VERIFY_ARE_EQUAL((int)'e', buf.sgetc());
+        VERIFY_ARE_EQUAL(1u, buf.in_avail());
+        buf.close(std::ios::out).wait();
+        VERIFY_ARE_EQUAL(1u, buf.getn(data, 10).get());
+        VERIFY_ARE_EQUAL(0u, buf.getn(data, 10).get());
+        buf.close().wait();
+    }
+
+    TEST(spsc_buffer_reuses_segments)
+    {
+        auto buffer = producer_consumer_buffer<char>::single_producer_consumer(16);
+        char data[16] = "0123456789abcde";
+        std::vector<char*> blocks;
+        for (int i = 0; i < 3; ++i)
+        {
+            VERIFY_ARE_EQUAL(16u, buffer.putn_nocopy(data, 16).get());
+            char* block = nullptr;
+            size_t count = 0;
+            VERIFY_IS_TRUE(buffer.acquire(block, count));
+            VERIFY_ARE_EQUAL(16u, count);
+            VERIFY_ARE_EQUAL(std::string(data, 16), std::string(block, count));
+            blocks.push_back(block);
+            buffer.release(block, count);
+        }
+
+        // The first block is written again once the reader has moved past it.
+        VERIFY_IS_TRUE(blocks[0] != blocks[1]);
+        VERIFY_IS_TRUE(blocks[0] == blocks[2]);
+        buffer.close().wait();
+    }
+
+    TEST(spsc_buffer_releases_drained_segments)
+    {
+        // Blocks larger than the default size, only partly used, are drained by the reader. They are written again
+        // rather than kept around, so the buffer does not grow with the amount of data passed through it.
+        auto buffer = producer_consumer_buffer<char>::single_producer_consumer();
+        const size_t block_size = 192 * 1024;
+        const size_t used = 100 * 1024;
+        std::vector<char> data(used);
+        std::set<char*> blocks;
+        for (int i = 0; i < 100; ++i)
+        {
+            char* block = buffer.alloc(block_size);
+            VERIFY_IS_TRUE(block != nullptr);
+            blocks.insert(block);
+            buffer.commit(used);
+            VERIFY_ARE_EQUAL(used, buffer.getn(data.data(), used).get());
+        }
+
+        VERIFY_IS_TRUE(blocks.size() <= 3);
+        buffer.close().wait();
+    }
+
+    TEST(spsc_buffer_high_water_mark)
+    {
+        auto buffer = producer_consumer_buffer<char>::single_producer_consumer(8, 20);
+        VERIFY_IS_TRUE(buffer.putn_nocopy("0123456789", 10).is_done());
+        auto write = buffer.putn_nocopy("abcdefghij", 10);
+        VERIFY_IS_FALSE(write.is_done());
+
+        char data[20];
+        VERIFY_ARE_EQUAL(1u, buffer.getn(data, 1).get());
+        VERIFY_ARE_EQUAL(10u, write.get());
+        VERIFY_ARE_EQUAL(19u, buffer.getn(data, 19).get());
+        VERIFY_ARE_EQUAL(std::string("123456789abcdefghij"), std::string(data, 19));
+
+        write = buffer.putn_nocopy("01234567890123456789", 20);
+        VERIFY_IS_FALSE(write.is_done());
+        buffer.close(std::ios::in).wait();
+        VERIFY_ARE_EQUAL(20u, write.get());
+        buffer.close().wait();
+    }
+
+    TEST(spsc_buffer_concurrent_transfer)
+    {
+        // The writer and the reader run on different threads and use writes and reads of varying sizes, so data
+        // crosses block boundaries and the reader often has to wait.
+        auto buf = streams::producer_consumer_buffer<uint8_t>::single_producer_consumer(64, 4096);
+        const size_t total = 1 << 20;
+
+        auto writer = pplx::create_task([&buf, total]() {
+            std::vector<uint8_t> chunk(300);
+            size_t written = 0;
+            for (size_t i = 0; written < total; ++i)
+            {
+                const size_t size = (std::min)(1 + (i * 37) % chunk.size(), total - written);
+                for (size_t j = 0; j < size; ++j)
+                {
+                    chunk[j] = static_cast<uint8_t>((written + j) % 251);
+                }
+
+                if (i % 3 == 0)
+                {
+                    uint8_t* ptr = buf.alloc(size);
+                    std::copy(chunk.begin(), chunk.begin() + size, ptr);
+                    buf.commit(size);
+                }
+                else
+                {
+                    VERIFY_ARE_EQUAL(size, buf.putn_nocopy(chunk.data(), size).get());
+                }
+                written += size;
+            }
+            buf.close(std::ios::out).wait();
+        });
+
+        std::vector<uint8_t> data(500);
+        size_t read = 0;
+        bool mismatch = false;
+        for (size_t i = 0;; ++i)
+        {
+            uint8_t* ptr = nullptr;
+            size_t count = 0;
+            if (i % 2 == 0 || !buf.acquire(ptr, count))
+            {
+                ptr = data.data();
+                count = buf.getn(ptr, 1 + (i * 53) % data.size()).get();
+            }
+            else if (ptr == nullptr)
+            {
+                break;
+            }
+
+            if (count == 0) break;
+            for (size_t j = 0; j < count; ++j)
+            {
+                mismatch |= ptr[j] != static_cast<uint8_t>((read + j) % 251);
+            }
+            if (ptr != data.data()) buf.release(ptr, count);
+            read += count;
+        }
+
+        writer.wait();
+        VERIFY_IS_FALSE(mismatch);
+        VERIFY_ARE_EQUAL(total, read);
+        buf.close().wait();
+    }
+
+    TEST(segmented_buffer_read_operations)
+    {
+        // Segments of uneven length, including an empty one, read as one sequence.
+        const std::vector<std::string> segments {"Hel", "", "lo W", "orld"};
+        std::string s("Hello World");
+        std::vector<char> v(std::begin(s), std::end(s));
+        {
+            segmented_container_buffer<std::string> buf(segments);
+            streambuf_getc(buf, 'H');
+        }
+        {
+            segmented_container_buffer<std::string> buf(segments);
+            streambuf_bumpc(buf, v);
+        }
+        {
+            segmented_container_buffer<std::string> buf(segments);
+            streambuf_sbumpc(buf, v);
+        }
+        {
+            segmented_container_buffer<std::string> buf(segments);
+            streambuf_nextc(buf, v);
+        }
+        {
+            segmented_container_buffer<std::string> buf(segments);
+            streambuf_ungetc(buf, v);
+        }
+        {
+            segmented_container_buffer<std::string> buf(segments);
+            streambuf_getn(buf, v);
+        }
+        {
+            segmented_container_buffer<std::string> buf(segments);
+            streambuf_acquire_release(buf, v);
+        }
+        {
+            segmented_container_buffer<std::string> buf(segments);
+            streambuf_seek_read(buf);
+        }
+    }
+
+    TEST(segmented_buffer_seek_read)
+    {
+        segmented_container_buffer<std::string> buf(std::vector<std::string> {"Hel", "", "lo W", "orld"});
+        VERIFY_ARE_EQUAL(11u, buf.size());
+
+        VERIFY_ARE_EQUAL(7, (int)buf.seekpos(7, std::ios_base::in));
+        VERIFY_ARE_EQUAL('o', buf.sbumpc());
+        char* ptr = nullptr;
+        size_t count = 0;
+        VERIFY_IS_TRUE(buf.acquire(ptr, count));
+        VERIFY_ARE_EQUAL(std::string("rld"), std::string(ptr, count));
+        buf.release(ptr, 1);
+
+        VERIFY_ARE_EQUAL(2, (int)buf.seekoff(-7, std::ios_base::cur, std::ios_base::in));
+        char data[6];
+        VERIFY_ARE_EQUAL(6u, buf.getn(data, 6).get());
+        VERIFY_ARE_EQUAL(std::string("llo Wo"), std::string(data, 6));
+        VERIFY_ARE_EQUAL(3u, buf.in_avail());
+
+        VERIFY_ARE_EQUAL((int)std::char_traits<char>::eof(), (int)buf.seekpos(12, std::ios_base::in));
+        VERIFY_ARE_EQUAL(11, (int)buf.seekoff(0, std::ios_base::end, std::ios_base::in));
+        VERIFY_IS_TRUE(buf.acquire(ptr, count));
+        VERIFY_IS_TRUE(ptr == nullptr);
+        buf.close().wait();
+    }
+
+    TEST(segmented_buffer_write)
+    {
+        segmented_container_buffer<std::vector<uint8_t>> buf;
+        VERIFY_IS_TRUE(buf.can_write());
+        VERIFY_IS_FALSE(buf.can_read());
+
+        std::vector<uint8_t> expected;
+        std::vector<uint8_t> chunk(3000);
+        const uint8_t* first = nullptr;
+        for (size_t i = 0; expected.size() < 3 * 1024 * 1024; ++i)
+        {
+            const size_t size = 1 + (i * 977) % chunk.size();
+            for (size_t j = 0; j < size; ++j)
+            {
+                chunk[j] = static_cast<uint8_t>(expected.size() + j);
+            }
+
+            if (i % 2 == 0)
+            {
+                VERIFY_ARE_EQUAL(size, buf.putn_nocopy(chunk.data(), size).get());
+            }
+            else
+            {
+                // Only part of the allocated block is used.
+                uint8_t* data = buf.alloc(size + 10);
+                VERIFY_IS_TRUE(data != nullptr);
+                std::copy(chunk.begin(), chunk.begin() + size, data);
+                buf.commit(size);
+            }
+            expected.insert(expected.end(), chunk.begin(), chunk.begin() + size);
+
+            // Data already written never moves.
+            if (first == nullptr) first = buf.segments()[0].data();
+            VERIFY_IS_TRUE(first == buf.segments()[0].data());
+        }
+
+        VERIFY_IS_TRUE(buf.segments().size() > 1);
+        VERIFY_ARE_EQUAL(expected.size(), buf.size());
+        VERIFY_ARE_EQUAL(expected.size(), (size_t)buf.getpos(std::ios_base::out));
+
+        size_t total = 0;
+        for (const auto& segment : buf.segments())
+        {
+            VERIFY_IS_TRUE(std::equal(segment.begin(), segment.end(), expected.begin() + total));
+            total += segment.size();
+        }
+        VERIFY_ARE_EQUAL(expected.size(), total);
+
+        const auto gathered = buf.gather();
+        VERIFY_ARE_EQUAL(expected.size(), gathered.capacity());
+        VERIFY_IS_TRUE(expected == gathered);
+
+        buf.close().wait();
+        VERIFY_IS_FALSE(buf.can_write());
+        VERIFY_ARE_EQUAL(0u, buf.putn_nocopy(chunk.data(), 1).get());
+    }
+
+    TEST(segmented_buffer_read_to_end)
+    {
+        producer_consumer_buffer<char> source;
+        std::string expected;
+        for (int i = 0; i < 10000; ++i)
+        {
+            const std::string line = "line " + std::to_string(i) + "\n";
+            VERIFY_ARE_EQUAL(line.size(), source.putn_nocopy(line.data(), line.size()).get());
+            expected += line;
+        }
+        source.close(std::ios_base::out).wait();
+
+        segmented_container_buffer<std::string> target;
+        VERIFY_ARE_EQUAL(expected.size(), streams::basic_istream<char>(source).read_to_end(target).get());
+        VERIFY_ARE_EQUAL(expected, target.gather());
+
+        // The collected segments can be read back as a stream.
+        segmented_container_buffer<std::string> reader(target.segments());
+        streams::basic_istream<char> stream(reader);
+        container_buffer<std::string> line;
+        VERIFY_ARE_EQUAL(6u, stream.read_line(line).get());
+        VERIFY_ARE_EQUAL(std::string("line 0"), line.collection());
+        source.close().wait();
+        target.close().wait();
+        reader.close().wait();
+    }
+
     TEST(string_buffer_ctor)
     {
         std::string src("abcdef ghij");
@@ -2276,6 +2618,36 @@ SUITE(memstream_tests)
         VERIFY_IS_TRUE(buffer.alloc(2) == nullptr);
     }
 
+    TEST(producer_consumer_alloc_continues_block)
+    {
+        // An allocation that fits in the room left by the previous commit continues in the same block.
+        producer_consumer_buffer<char> buffer;
+        char* first = buffer.alloc(1024);
+        memcpy(first, "0123456789", 10);
+        buffer.commit(10);
+        char* second = buffer.alloc(1000);
+        VERIFY_IS_TRUE(second == first + 10);
+        memcpy(second, "abcdef", 6);
+        buffer.commit(6);
+
+        // The block is drained while the next allocation is outstanding, and the commit puts it back.
+        char* third = buffer.alloc(100);
+        VERIFY_IS_TRUE(third == first + 16);
+        char* block = nullptr;
+        size_t count = 0;
+        VERIFY_IS_TRUE(buffer.acquire(block, count));
+        VERIFY_ARE_EQUAL(std::string("0123456789abcdef"), std::string(block, count));
+        buffer.release(block, count);
+        memcpy(third, "xyz", 3);
+        buffer.commit(3);
+        buffer.close(std::ios::out).wait();
+
+        char data[8];
+        VERIFY_ARE_EQUAL(3u, buffer.getn(data, sizeof(data)).get());
+        VERIFY_ARE_EQUAL(std::string("xyz"), std::string(data, 3));
+        buffer.close().wait();
+    }
+
     TEST(producer_consumer_acquire_after_close)
     {
         char* temp = nullptr;
@@ -2297,6 +2669,71 @@ SUITE(memstream_tests)
         buffer.release(temp, size);
     }
 
+    TEST(producer_consumer_buffer_reuses_blocks)
+    {
+        producer_consumer_buffer<char> buffer(16);
+        VERIFY_ARE_EQUAL(16u, buffer.buffer_size(std::ios::out));
+        VERIFY_ARE_EQUAL(0u, buffer.buffer_size(std::ios::in));
+
+        char data[16] = "0123456789abcde";
+        char* first = nullptr;
+        for (int i = 0; i < 4; ++i)
+        {
+            VERIFY_ARE_EQUAL(16u, buffer.putn_nocopy(data, 16).get());
+
+            // A drained block is handed out again for the next write.
+            char* block = nullptr;
+            size_t count = 0;
+            VERIFY_IS_TRUE(buffer.acquire(block, count));
+            VERIFY_ARE_EQUAL(16u, count);
+            VERIFY_ARE_EQUAL(std::string(data, 16), std::string(block, count));
+            if (i == 0) first = block;
+            VERIFY_ARE_EQUAL((void*)first, (void*)block);
+            buffer.release(block, count);
+        }
+
+        // Blocks of the old size are not reused once the size changes.
+        buffer.set_buffer_size(32, std::ios::out);
+        VERIFY_ARE_EQUAL(32u, buffer.buffer_size(std::ios::out));
+        VERIFY_ARE_EQUAL(16u, buffer.putn_nocopy(data, 16).get());
+        VERIFY_ARE_EQUAL(16u, buffer.putn_nocopy(data, 16).get());
+        char* block = nullptr;
+        size_t count = 0;
+        VERIFY_IS_TRUE(buffer.acquire(block, count));
+        VERIFY_ARE_EQUAL(32u, count);
+        buffer.release(block, count);
+        buffer.close().wait();
+    }
+
+    TEST(producer_consumer_buffer_high_water_mark)
+    {
+        producer_consumer_buffer<char> buffer(8, 20);
+        VERIFY_IS_TRUE(buffer.putn_nocopy("0123456789", 10).is_done());
+
+        // Reaching the mark holds the writer back until the reader has caught up.
+        auto write = buffer.putn_nocopy("abcdefghij", 10);
+        auto put = buffer.putc('x');
+        VERIFY_IS_FALSE(write.is_done());
+        VERIFY_IS_FALSE(put.is_done());
+
+        char data[21];
+        VERIFY_ARE_EQUAL(1u, buffer.getn(data, 1).get());
+        VERIFY_IS_FALSE(write.is_done());
+        VERIFY_ARE_EQUAL(1u, buffer.getn(data, 1).get());
+        VERIFY_ARE_EQUAL(10u, write.get());
+        VERIFY_ARE_EQUAL((int)'x', put.get());
+        VERIFY_ARE_EQUAL(19u, buffer.getn(data, 19).get());
+        VERIFY_ARE_EQUAL(std::string("23456789abcdefghijx"), std::string(data, 19));
+
+        // Writers are released when the reader goes away.
+        VERIFY_ARE_EQUAL(15u, buffer.putn_nocopy("012345678901234", 15).get());
+        write = buffer.putn_nocopy("abcdefghij", 10);
+        VERIFY_IS_FALSE(write.is_done());
+        buffer.close(std::ios::in).wait();
+        VERIFY_ARE_EQUAL(10u, write.get());
+        buffer.close().wait();
+    }
+
     TEST(create_buffers_inout_error)
     {
         VERIFY_THROWS(container_buffer<std::string>(std::ios::in | std::ios::out), std::invalid_argument);
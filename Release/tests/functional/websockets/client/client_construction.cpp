@@ -245,6 +245,114 @@ SUITE(client_construction)
         client.close().wait();
     }
 
+    TEST(permessage_deflate_config)
+    {
+        websocket_client_config config;
+        VERIFY_IS_FALSE(config.permessage_deflate());
+
+        websocket_deflate_options options;
+        VERIFY_IS_FALSE(options.client_no_context_takeover());
+        VERIFY_IS_FALSE(options.server_no_context_takeover());
+        VERIFY_ARE_EQUAL(15, options.client_max_window_bits());
+        VERIFY_ARE_EQUAL(15, options.server_max_window_bits());
+
+        options.set_client_no_context_takeover(true);
+        options.set_server_max_window_bits(9);
+        VERIFY_THROWS(options.set_client_max_window_bits(8), std::invalid_argument);
+        VERIFY_THROWS(options.set_server_max_window_bits(16), std::invalid_argument);
+        VERIFY_ARE_EQUAL(15, options.client_max_window_bits());
+        VERIFY_ARE_EQUAL(9, options.server_max_window_bits());
+
+        config.set_permessage_deflate(true, options);
+        websocket_client client(config);
+        VERIFY_IS_TRUE(client.config().permessage_deflate());
+        VERIFY_IS_TRUE(client.config().permessage_deflate_options().client_no_context_takeover());
+        VERIFY_ARE_EQUAL(9, client.config().permessage_deflate_options().server_max_window_bits());
+    }
+
+#if !defined(__cplusplus_winrt) && !defined(CPPREST_EXCLUDE_COMPRESSION)
+    void deflate_offer_test_impl(const uri& address, const websocket_client_config& config, const std::string& expected)
+    {
+        test_websocket_server server;
+        websocket_client client(config);
+
+        server.set_http_handler([&](test_http_request request) {
+            test_http_response resp;
+            if (request->get_header_val("Sec-WebSocket-Extensions") == expected)
+                resp.set_status_code(200); // Handshake request will be completed only if the offer is as expected.
+            else
+                resp.set_status_code(400); // Else fail the handshake, websocket client connect will fail in this case.
+            return resp;
+        });
+        client.connect(address).wait();
+        client.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, permessage_deflate_offer)
+    {
+        websocket_client_config config;
+        deflate_offer_test_impl(m_uri, config, "");
+
+        config.set_permessage_deflate(true);
+        deflate_offer_test_impl(m_uri, config, "permessage-deflate; client_max_window_bits");
+
+        websocket_deflate_options options;
+        options.set_client_no_context_takeover(true);
+        options.set_server_no_context_takeover(true);
+        options.set_client_max_window_bits(12);
+        options.set_server_max_window_bits(10);
+        config.set_permessage_deflate(true, options);
+        deflate_offer_test_impl(m_uri,
+                                config,
+                                "permessage-deflate; client_no_context_takeover; server_no_context_takeover; "
+                                "server_max_window_bits=10; client_max_window_bits=12");
+    }
+
+    TEST_FIXTURE(uri_address, permessage_deflate_round_trip)
+    {
+        std::string body(100000, ' ');
+        for (size_t i = 0; i < body.size(); ++i)
+        {
+            body[i] = static_cast<char>('a' + (i * 7) % 26);
+        }
+
+        // With the defaults each end keeps its context from one message to the next; with these options the client
+        // compresses each message on its own, with a smaller window
+        websocket_deflate_options options;
+        options.set_client_no_context_takeover(true);
+        options.set_client_max_window_bits(10);
+        const websocket_deflate_options configs[] = {websocket_deflate_options(), options};
+        for (const auto& deflate_options : configs)
+        {
+            test_websocket_server server;
+            websocket_client_config config;
+            config.set_permessage_deflate(true, deflate_options);
+            websocket_client client(config);
+            client.connect(m_uri).wait();
+            VERIFY_ARE_EQUAL(0u, server.extensions().find("permessage-deflate"));
+
+            for (int i = 0; i < 2; ++i)
+            {
+                server.next_message([&](test_websocket_msg msg) {
+                    websocket_asserts::assert_message_equals(
+                        msg, body, test_websocket_message_type::WEB_SOCKET_UTF8_MESSAGE_TYPE);
+                });
+                websocket_outgoing_message out;
+                out.set_utf8_message(body);
+                client.send(out).wait();
+
+                test_websocket_msg reply;
+                reply.set_data(std::vector<uint8_t>(body.begin(), body.end()));
+                reply.set_msg_type(test_websocket_message_type::WEB_SOCKET_UTF8_MESSAGE_TYPE);
+                server.send_msg(reply);
+                VERIFY_ARE_EQUAL(body, client.receive().get().extract_string().get());
+            }
+
+            client.close().wait();
+        }
+    }
+#endif
+
 } // SUITE(client_construction)
 
 } // namespace client
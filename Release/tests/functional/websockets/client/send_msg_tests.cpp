@@ -492,6 +492,74 @@ SUITE(send_msg_tests)
         client.close().wait();
     }
 
+    // Send a burst of messages, which are written together, and check they arrive in order
+    void send_burst_helper(websocket_client & client, const web::uri& uri, test_websocket_server& server)
+    {
+        const int count = 200;
+        for (int i = 0; i < count; ++i)
+        {
+            const std::string body = "message " + std::to_string(i);
+            server.next_message([body](test_websocket_msg msg) {
+                websocket_asserts::assert_message_equals(
+                    msg, body, test_websocket_message_type::WEB_SOCKET_UTF8_MESSAGE_TYPE);
+            });
+        }
+
+        client.connect(uri).wait();
+        std::vector<pplx::task<void>> sends;
+        for (int i = 0; i < count; ++i)
+        {
+            websocket_outgoing_message msg;
+            msg.set_utf8_message("message " + std::to_string(i));
+            sends.push_back(client.send(msg));
+        }
+        pplx::when_all(sends.begin(), sends.end()).wait();
+        client.close().wait();
+    }
+
+    TEST_FIXTURE(uri_address, send_msg_burst)
+    {
+        test_websocket_server server;
+        websocket_client client;
+        send_burst_helper(client, m_uri, server);
+    }
+
+#if !defined(__cplusplus_winrt)
+    // Small messages are held back to be written with the ones sent right after them
+    TEST_FIXTURE(uri_address, send_msg_burst_coalescing_delay)
+    {
+        test_websocket_server server;
+        websocket_client_config config;
+        config.set_send_coalescing_delay(std::chrono::milliseconds(5));
+        websocket_client client(config);
+        send_burst_helper(client, m_uri, server);
+    }
+
+    // A message held back by the coalescing delay is still completed when the client closes first
+    TEST_FIXTURE(uri_address, send_msg_coalescing_delay_close)
+    {
+        test_websocket_server server;
+        websocket_client_config config;
+        config.set_send_coalescing_delay(std::chrono::milliseconds(200));
+        websocket_client client(config);
+
+        client.connect(m_uri).wait();
+        websocket_outgoing_message msg;
+        msg.set_utf8_message("held back");
+        auto sent = client.send(msg);
+        client.close().wait();
+
+        // Whether the message went out before the close or failed with it, the send does not hang.
+        try
+        {
+            sent.wait();
+        }
+        catch (const websocket_exception&)
+        {
+        }
+    }
+#endif
+
 #if !defined(__cplusplus_winrt)
     // Send an unsolicited pong message to the server
     TEST_FIXTURE(uri_address, send_pong_msg)
@@ -34,6 +34,9 @@
 
 #include <websocketpp/config/asio_no_tls.hpp>
 #include <websocketpp/server.hpp>
+#if !defined(CPPREST_EXCLUDE_COMPRESSION)
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+#endif
 
 #if defined(__clang__)
 #pragma clang diagnostic pop
@@ -50,8 +53,17 @@ using namespace utility::conversions;
 // In the future this should be configurable through option in test server.
 #define WEBSOCKETS_TEST_SERVER_PORT 9980
 
+// The stock server configuration, which agrees to permessage-deflate when a client offers it
+struct server_config : public websocketpp::config::asio
+{
+    typedef server_config type;
+#if !defined(CPPREST_EXCLUDE_COMPRESSION)
+    typedef websocketpp::extensions::permessage_deflate::enabled<permessage_deflate_config> permessage_deflate_type;
+#endif
+};
+
 // Websocketpp typedefs
-typedef websocketpp::server<websocketpp::config::asio> server;
+typedef websocketpp::server<server_config> server;
 
 namespace tests
 {
@@ -114,6 +126,7 @@ public:
 
         m_srv.set_open_handler([this](websocketpp::connection_hdl hdl) {
             m_con = hdl;
+            m_extensions = m_srv.get_con_from_hdl(hdl)->get_response_header("Sec-WebSocket-Extensions");
             m_server_connected.set();
         });
 
@@ -188,6 +201,12 @@ public:
 
     void send_msg(const test_websocket_msg& msg);
 
+    const std::string& extensions()
+    {
+        pplx::task<void>(m_server_connected).wait();
+        return m_extensions;
+    }
+
     void close(const std::string& reasoning)
     {
         websocketpp::lib::error_code ec;
@@ -202,6 +221,8 @@ private:
 
     server m_srv;
     websocketpp::connection_hdl m_con;
+    // The extensions the server agreed to in its handshake response.
+    std::string m_extensions;
     // Once the WebSocket object has been initialized,
     // the below event wil be used to signal that the server has been initialized.
     // The server can now send messages to the client.
@@ -231,6 +252,8 @@ std::function<void(test_websocket_msg)> test_websocket_server::get_next_message_
 
 void test_websocket_server::send_msg(const test_websocket_msg& msg) { m_p_impl->send_msg(msg); }
 
+std::string test_websocket_server::extensions() { return m_p_impl->extensions(); }
+
 std::shared_ptr<_test_websocket_server> test_websocket_server::get_impl() { return m_p_impl; }
 
 void _test_websocket_server::send_msg(const test_websocket_msg& msg)
@@ -136,6 +136,9 @@ public:
 
     // Tests can use this API to send a message from the server to the client.
     WEBSOCKET_UTILITY_API void send_msg(const test_websocket_msg& msg);
+
+    // The Sec-WebSocket-Extensions header of the server's handshake response, once a client has connected.
+    WEBSOCKET_UTILITY_API std::string extensions();
     WEBSOCKET_UTILITY_API std::shared_ptr<_test_websocket_server> get_impl();
 
 private: